@@ -4,6 +4,7 @@
 #include <sys/types.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 static const char *BMP_Error_Invalid_File_Descriptor =
@@ -39,7 +40,15 @@ static const char *BMP_Error_Invalid_File_Descriptor =
                     "Failed to write the DIB header",
 
                   *BMP_Error_Failed_to_Write_Image_Data =
-                    "Failed to write the image data";
+                    "Failed to write the image data",
+
+                  *BMP_Error_Invalid_Image_Dimensions =
+                    "Invalid image dimensions for the bitmap format",
+
+                  *BMP_Error_Invalid_Region =
+                    "The region lies outside of the image",
+                  *BMP_Error_Failed_to_Copy_Image =
+                    "Failed to copy the image file";
 
 static const int BMP_First_Magic_Byte  = 0x42,
                  BMP_Second_Magic_Byte = 0x4D;
@@ -107,6 +116,43 @@ static void bmp_read_image_data(
                 const char **error_message
             );
 
+static void bmp_create_resized_image(
+                const bmp_image *source_image,
+                bmp_image *image,
+                size_t width,
+                size_t height,
+                const char **error_message
+            );
+
+static void bmp_create_region_image(
+                const bmp_image *source_image,
+                bmp_image *image,
+                size_t width,
+                size_t height,
+                const char **error_message
+            );
+
+/* Only the generator creates images from scratch, the other programs leave it unused */
+static void bmp_create_image_headers(
+                bmp_image *image,
+                size_t width,
+                size_t height,
+                size_t bits_per_pixel,
+                bool top_down,
+                const char **error_message
+            ) __attribute__((unused));
+
+static void bmp_read_image_region(
+                FILE *file_descriptor,
+                const bmp_image *source_image,
+                bmp_image *image,
+                size_t x,
+                size_t y,
+                size_t width,
+                size_t height,
+                const char **error_message
+            );
+
 static void bmp_write_image_headers(
                 FILE *file_descriptor,
                 bmp_image *image,
@@ -119,6 +165,26 @@ static void bmp_write_image_data(
                 const char **error_message
             );
 
+static void bmp_copy_image_file(
+                FILE *source_file_descriptor,
+                FILE *file_descriptor,
+                const bmp_image *image,
+                const char **error_message
+            );
+
+static void bmp_write_image_region(
+                FILE *file_descriptor,
+                const bmp_image *image,
+                const bmp_image *region,
+                size_t region_x,
+                size_t region_y,
+                size_t x,
+                size_t y,
+                size_t width,
+                size_t height,
+                const char **error_message
+            );
+
 static inline uint8_t *bmp_sample_pixel(
                            uint8_t *pixels,
                            ssize_t x,
@@ -1,5 +1,6 @@
 #include "bmp.h"
 #include "utils.h"
+#include "profiler.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -115,6 +116,15 @@ static void bmp_open_image_headers(
     }
     image->channels = 24 == image->dib_header.bits_per_pixel ? 3 : 4;
 
+    image->absolute_image_width =
+        image->dib_header.image_width < 0 ?
+            (size_t) -image->dib_header.image_width :
+            (size_t)  image->dib_header.image_width;
+    image->absolute_image_height =
+        image->dib_header.image_height < 0 ?
+            (size_t) -image->dib_header.image_height :
+            (size_t)  image->dib_header.image_height;
+
     if (image->file_header.file_size <= total_header_size) {
         if (NULL != error_message) {
             *error_message = BMP_Error_Invalid_Size_Information;
@@ -171,7 +181,12 @@ static void bmp_read_image_data(
         goto end;
     }
 
-    if (!fread(image->payload, payload_size, 1, file_descriptor)) {
+PROFILER_SCOPE_BEGIN("read");
+PROFILER_SCOPE_ADD_BYTES(payload_size);
+    size_t payload_read =
+        fread(image->payload, payload_size, 1, file_descriptor);
+PROFILER_SCOPE_END();
+    if (!payload_read) {
         if (NULL != error_message) {
             *error_message = BMP_Error_Failed_to_Read_Image_Data;
         }
@@ -246,6 +261,8 @@ static void bmp_read_image_data(
     }
     image->aligned_image_size = aligned_image_size;
 
+PROFILER_SCOPE_BEGIN("decode");
+PROFILER_SCOPE_ADD_BYTES(image->image_size);
     if (4 == image->channels) {
         for (
             size_t y = 0,
@@ -289,6 +306,7 @@ static void bmp_read_image_data(
     for (size_t linear_position = extended_to_4_image_size; linear_position < aligned_image_size; ++linear_position) {
         image->pixels[linear_position] = 0;
     }
+PROFILER_SCOPE_END();
 
 end:
     return;
@@ -306,6 +324,416 @@ cleanup:
     }
 }
 
+/*
+    Creates an image of `width` by `height` pixels with the headers, the
+    color depth and the row order of `source_image`. The sizes in the
+    headers are rewritten for the new dimensions, the pixels are left
+    uninitialized.
+*/
+static void bmp_create_resized_image(
+                const bmp_image *source_image,
+                bmp_image *image,
+                size_t width,
+                size_t height,
+                const char **error_message
+            )
+{
+    *error_message = NULL;
+
+    if (NULL == source_image || NULL == image || NULL == source_image->payload) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Structure;
+        }
+
+        goto end;
+    }
+
+    size_t bits_per_pixel =
+        source_image->dib_header.bits_per_pixel;
+    size_t padded_row_size =
+        (bits_per_pixel * width + 31) / 32 * 4;
+    size_t image_size =
+        height * padded_row_size;
+
+    size_t header_size =
+        sizeof(source_image->file_header) + (size_t) source_image->dib_header.dib_header_size;
+    size_t first_pixel_index =
+        (size_t) (source_image->raw_pixels - source_image->payload);
+    size_t payload_size =
+        first_pixel_index + image_size;
+
+    if (0 == width || INT32_MAX < width ||
+        0 == height || INT32_MAX < height ||
+        UINT32_MAX < header_size + payload_size) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Dimensions;
+        }
+
+        goto end;
+    }
+
+    bmp_init_image_structure(image);
+
+    image->file_header =
+        source_image->file_header;
+    image->dib_header =
+        source_image->dib_header;
+    memcpy(image->rest_of_dib_header, source_image->rest_of_dib_header, REST_OF_DIB_HEADER_SIZE);
+
+    image->file_header.file_size =
+        (uint32_t) (header_size + payload_size);
+    image->dib_header.image_width =
+        (int32_t) width;
+    image->dib_header.image_height =
+        source_image->dib_header.image_height < 0 ? -(int32_t) height : (int32_t) height;
+    image->dib_header.image_size =
+        (uint32_t) image_size;
+
+    image->channels =
+        source_image->channels;
+    image->absolute_image_width =
+        width;
+    image->absolute_image_height =
+        height;
+    image->pixel_row_padding =
+        padded_row_size - width * image->channels;
+    image->image_size =
+        image_size;
+
+    image->payload_size =
+        payload_size;
+    image->payload =
+        (uint8_t *) malloc(payload_size);
+    if (NULL == image->payload) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Not_Enough_Memory_to_Read;
+        }
+
+        goto cleanup;
+    }
+
+    /* Keeps whatever lies between the headers and the pixel array */
+    memcpy(image->payload, source_image->payload, first_pixel_index);
+    image->raw_pixels =
+        &image->payload[first_pixel_index];
+
+    size_t alignment = 64;
+    size_t extended_to_4_image_size =
+        height * width * 4;
+    size_t aligned_image_size =
+        (((extended_to_4_image_size - 1) / alignment) + 1) * alignment + alignment;
+
+    image->pixels = (uint8_t *) aligned_alloc(alignment, aligned_image_size);
+    if (NULL == image->pixels) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Not_Enough_Memory_to_Read;
+        }
+
+        goto cleanup;
+    }
+    image->aligned_image_size = aligned_image_size;
+
+    memset(
+        &image->pixels[extended_to_4_image_size],
+        0,
+        aligned_image_size - extended_to_4_image_size
+    );
+
+    /* The padding bytes of the rows are written as they are */
+    memset(image->raw_pixels, 0, image_size);
+
+end:
+    return;
+
+cleanup:
+    bmp_free_image_structure(image);
+}
+
+/*
+    Creates an image of `width` by `height` pixels with the color depth of
+    `source_image` for a region of it. The image has pixels only, no file
+    data to write, and they are left uninitialized.
+*/
+static void bmp_create_region_image(
+                const bmp_image *source_image,
+                bmp_image *image,
+                size_t width,
+                size_t height,
+                const char **error_message
+            )
+{
+    if (NULL != error_message) {
+        *error_message = NULL;
+    }
+
+    if (NULL == source_image || NULL == image) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Structure;
+        }
+
+        goto end;
+    }
+
+    if (0 == width || 0 == height) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Dimensions;
+        }
+
+        goto end;
+    }
+
+    bmp_init_image_structure(image);
+
+    image->channels =
+        source_image->channels;
+    image->absolute_image_width =
+        width;
+    image->absolute_image_height =
+        height;
+
+    size_t alignment = 64;
+    size_t extended_to_4_image_size =
+        height * width * 4;
+    size_t aligned_image_size =
+        (((extended_to_4_image_size - 1) / alignment) + 1) * alignment + alignment;
+
+    image->pixels = (uint8_t *) aligned_alloc(alignment, aligned_image_size);
+    if (NULL == image->pixels) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Not_Enough_Memory_to_Read;
+        }
+
+        goto end;
+    }
+    image->aligned_image_size = aligned_image_size;
+
+    memset(
+        &image->pixels[extended_to_4_image_size],
+        0,
+        aligned_image_size - extended_to_4_image_size
+    );
+
+end:
+    return;
+}
+
+/*
+    Fills the headers of a new image of `width` by `height` pixels with a
+    BITMAPINFOHEADER and no color table, bottom-up unless `top_down` is set.
+    The image has neither a payload nor pixels, its rows can be written
+    right after the headers one at a time.
+*/
+static void bmp_create_image_headers(
+                bmp_image *image,
+                size_t width,
+                size_t height,
+                size_t bits_per_pixel,
+                bool top_down,
+                const char **error_message
+            )
+{
+    if (NULL != error_message) {
+        *error_message = NULL;
+    }
+
+    if (NULL == image) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Structure;
+        }
+
+        goto end;
+    }
+
+    if (24 != bits_per_pixel && 32 != bits_per_pixel) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Unsupported_Color_Depth;
+        }
+
+        goto end;
+    }
+
+    size_t padded_row_size =
+        (bits_per_pixel * width + 31) / 32 * 4;
+    size_t image_size =
+        height * padded_row_size;
+    size_t header_size =
+        sizeof(image->file_header) + sizeof(image->dib_header);
+
+    /* The file size field limits 32-bit images to a bit less than 32768 by 32768 pixels */
+    if (0 == width || INT32_MAX < width ||
+        0 == height || INT32_MAX < height ||
+        UINT32_MAX < header_size + image_size) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Dimensions;
+        }
+
+        goto end;
+    }
+
+    bmp_init_image_structure(image);
+
+    image->file_header.signature[0] =
+        (uint8_t) BMP_First_Magic_Byte;
+    image->file_header.signature[1] =
+        (uint8_t) BMP_Second_Magic_Byte;
+    image->file_header.file_size =
+        (uint32_t) (header_size + image_size);
+    image->file_header.pixel_array_offset =
+        (uint32_t) header_size;
+
+    image->dib_header.dib_header_size =
+        (uint32_t) sizeof(image->dib_header);
+    image->dib_header.image_width =
+        (int32_t) width;
+    image->dib_header.image_height =
+        top_down ? -(int32_t) height : (int32_t) height;
+    image->dib_header.planes =
+        1;
+    image->dib_header.bits_per_pixel =
+        (uint16_t) bits_per_pixel;
+    image->dib_header.image_size =
+        (uint32_t) image_size;
+    image->dib_header.x_pixels_per_meter =
+        2835;
+    image->dib_header.y_pixels_per_meter =
+        2835;
+
+    image->channels =
+        bits_per_pixel / 8;
+    image->absolute_image_width =
+        width;
+    image->absolute_image_height =
+        height;
+    image->pixel_row_padding =
+        padded_row_size - width * image->channels;
+    image->image_size =
+        image_size;
+
+end:
+    return;
+}
+
+/* The file offset of the pixel at `x` of the row `y` in the order of the file */
+static inline long _bmp_pixel_offset(const bmp_image *image, size_t x, size_t y)
+{
+    size_t padded_row_size =
+        ((size_t) image->dib_header.bits_per_pixel * image->absolute_image_width + 31) / 32 * 4;
+
+    return (long) ((size_t) image->file_header.pixel_array_offset +
+                       y * padded_row_size + x * image->channels);
+}
+
+/*
+    Reads the `width` by `height` pixels from (`x`, `y`) on of the image
+    whose headers `bmp_open_image_headers` read into `source_image`. Only
+    the rows of the region are read, `y` counts them in the order of the
+    file.
+*/
+static void bmp_read_image_region(
+                FILE *file_descriptor,
+                const bmp_image *source_image,
+                bmp_image *image,
+                size_t x,
+                size_t y,
+                size_t width,
+                size_t height,
+                const char **error_message
+            )
+{
+    if (NULL != error_message) {
+        *error_message = NULL;
+    }
+
+    uint8_t *row =
+        NULL;
+
+    if (NULL == source_image || NULL == image) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Structure;
+        }
+
+        goto end;
+    }
+
+    if (NULL == file_descriptor) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_File_Descriptor;
+        }
+
+        goto end;
+    }
+
+    if (x >= source_image->absolute_image_width || width > source_image->absolute_image_width - x ||
+        y >= source_image->absolute_image_height || height > source_image->absolute_image_height - y) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Region;
+        }
+
+        goto end;
+    }
+
+    /* The pixel array has to be within the file and the size of the header */
+    long end_offset =
+        _bmp_pixel_offset(source_image, 0, source_image->absolute_image_height);
+    if (0 != fseek(file_descriptor, 0, SEEK_END) ||
+        ftell(file_descriptor) < (long) source_image->file_header.file_size ||
+        (long) source_image->file_header.file_size < end_offset) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Size_Information;
+        }
+
+        goto end;
+    }
+
+    bmp_create_region_image(source_image, image, width, height, error_message);
+    if (NULL != *error_message) {
+        goto end;
+    }
+
+    size_t row_size =
+        width * image->channels;
+    if (3 == image->channels) {
+        row = (uint8_t *) malloc(row_size);
+        if (NULL == row) {
+            if (NULL != error_message) {
+                *error_message = BMP_Error_Not_Enough_Memory_to_Read;
+            }
+
+            goto cleanup;
+        }
+    }
+
+    for (size_t i = 0; i < height; ++i) {
+        uint8_t *destination =
+            &image->pixels[i * width * 4];
+
+        if (0 != fseek(file_descriptor, _bmp_pixel_offset(source_image, x, y + i), SEEK_SET) ||
+            !fread(NULL == row ? destination : row, row_size, 1, file_descriptor)) {
+            if (NULL != error_message) {
+                *error_message = BMP_Error_Failed_to_Read_Image_Data;
+            }
+
+            goto cleanup;
+        }
+
+        if (NULL != row) {
+            for (size_t j = 0, k = 0; j < row_size; j += 3, k += 4) {
+                memcpy(&destination[k], &row[j], 3);
+                destination[k + 3] = 255;
+            }
+        }
+    }
+
+    free(row);
+
+end:
+    return;
+
+cleanup:
+    free(row);
+    bmp_free_image_structure(image);
+}
+
 static void bmp_write_image_headers(
                 FILE *file_descriptor,
                 bmp_image *image,
@@ -401,6 +829,8 @@ static void bmp_write_image_data(
     size_t row_size =
         width * image->channels;
 
+PROFILER_SCOPE_BEGIN("encode");
+PROFILER_SCOPE_ADD_BYTES(image->image_size);
     if (4 == image->channels) {
         for (
             size_t y = 0,
@@ -439,7 +869,14 @@ static void bmp_write_image_data(
         }
     }
 
-    if (!fwrite(image->payload, payload_size, 1, file_descriptor)) {
+PROFILER_SCOPE_END();
+
+PROFILER_SCOPE_BEGIN("write");
+PROFILER_SCOPE_ADD_BYTES(payload_size);
+    size_t payload_written =
+        fwrite(image->payload, payload_size, 1, file_descriptor);
+PROFILER_SCOPE_END();
+    if (!payload_written) {
         if (NULL != error_message) {
             *error_message = BMP_Error_Failed_to_Write_Image_Data;
         }
@@ -451,6 +888,138 @@ end:
     return;
 }
 
+/*
+    Copies the file of `image` as it is, its first `file_size` bytes, for
+    `bmp_write_image_region` to overwrite a part of it.
+*/
+static void bmp_copy_image_file(
+                FILE *source_file_descriptor,
+                FILE *file_descriptor,
+                const bmp_image *image,
+                const char **error_message
+            )
+{
+    if (NULL != error_message) {
+        *error_message = NULL;
+    }
+
+    if (NULL == image) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Structure;
+        }
+
+        goto end;
+    }
+
+    if (NULL == source_file_descriptor || NULL == file_descriptor) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_File_Descriptor;
+        }
+
+        goto end;
+    }
+
+    if (!utils_copy_file(source_file_descriptor, file_descriptor, image->file_header.file_size)) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Failed_to_Copy_Image;
+        }
+
+        goto end;
+    }
+
+end:
+    return;
+}
+
+/*
+    Writes the `width` by `height` pixels of `region` from (`region_x`,
+    `region_y`) on to (`x`, `y`) of the pixel array in the file of `image`,
+    the rest of the file is left as it is.
+*/
+static void bmp_write_image_region(
+                FILE *file_descriptor,
+                const bmp_image *image,
+                const bmp_image *region,
+                size_t region_x,
+                size_t region_y,
+                size_t x,
+                size_t y,
+                size_t width,
+                size_t height,
+                const char **error_message
+            )
+{
+    if (NULL != error_message) {
+        *error_message = NULL;
+    }
+
+    uint8_t *row =
+        NULL;
+
+    if (NULL == image || NULL == region || NULL == region->pixels) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Image_Structure;
+        }
+
+        goto end;
+    }
+
+    if (NULL == file_descriptor) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_File_Descriptor;
+        }
+
+        goto end;
+    }
+
+    if (x >= image->absolute_image_width || width > image->absolute_image_width - x ||
+        y >= image->absolute_image_height || height > image->absolute_image_height - y ||
+        region_x + width > region->absolute_image_width ||
+        region_y + height > region->absolute_image_height) {
+        if (NULL != error_message) {
+            *error_message = BMP_Error_Invalid_Region;
+        }
+
+        goto end;
+    }
+
+    size_t row_size =
+        width * image->channels;
+    if (3 == image->channels) {
+        row = (uint8_t *) malloc(row_size);
+        if (NULL == row) {
+            if (NULL != error_message) {
+                *error_message = BMP_Error_Failed_to_Write_Image_Data;
+            }
+
+            goto end;
+        }
+    }
+
+    for (size_t i = 0; i < height; ++i) {
+        const uint8_t *source =
+            &region->pixels[((region_y + i) * region->absolute_image_width + region_x) * 4];
+
+        if (NULL != row) {
+            for (size_t j = 0, k = 0; j < row_size; j += 3, k += 4) {
+                memcpy(&row[j], &source[k], 3);
+            }
+        }
+
+        if (0 != fseek(file_descriptor, _bmp_pixel_offset(image, x, y + i), SEEK_SET) ||
+            !fwrite(NULL == row ? source : row, row_size, 1, file_descriptor)) {
+            if (NULL != error_message) {
+                *error_message = BMP_Error_Failed_to_Write_Image_Data;
+            }
+
+            goto end;
+        }
+    }
+
+end:
+    free(row);
+}
+
 static inline uint8_t *bmp_sample_pixel(
                            uint8_t *pixels,
                            ssize_t x,
@@ -0,0 +1,57 @@
+#ifndef CUBE_H
+#define CUBE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+static const char *CUBE_Error_Invalid_File_Descriptor =
+                    "Invalid file descriptor",
+                  *CUBE_Error_Invalid_LUT_Structure =
+                    "Invalid LUT structure",
+
+                  *CUBE_Error_Invalid_Line =
+                    "Invalid line in the cube file",
+                  *CUBE_Error_Unsupported_1D_LUT =
+                    "1D LUTs are not supported",
+                  *CUBE_Error_Invalid_LUT_Size =
+                    "Missing or invalid LUT_3D_SIZE (2-256)",
+                  *CUBE_Error_Invalid_Domain =
+                    "Invalid DOMAIN_MIN or DOMAIN_MAX",
+                  *CUBE_Error_Wrong_Number_of_Entries =
+                    "The number of table entries does not match LUT_3D_SIZE",
+                  *CUBE_Error_Not_Enough_Memory_to_Read =
+                    "Not enough memory to read the LUT";
+
+#define CUBE_MIN_SIZE 2
+#define CUBE_MAX_SIZE 256
+
+/* Lines longer than this are rejected */
+#define CUBE_MAX_LINE_LENGTH 512
+
+/*
+    A 3D LUT of an Adobe .cube file. `table` holds `size` cubed red, green
+    and blue triples with red changing fastest, then green, then blue, the
+    order of the file. Inputs map to the lattice through the domain of
+    every channel, [0, 1] unless the file says otherwise.
+*/
+typedef struct _cube_lut
+{
+    size_t size;
+    float domain_min[3];            /* red, green and blue                             */
+    float domain_max[3];
+    float *table;
+} cube_lut;
+
+static inline void cube_init_lut_structure(cube_lut *lut);
+static inline void cube_free_lut_structure(cube_lut *lut);
+
+static void cube_read_lut(
+                FILE *file_descriptor,
+                cube_lut *lut,
+                const char **error_message
+            );
+
+#include "cube.impl.h.c"
+
+#endif /* CUBE_H */
@@ -0,0 +1,244 @@
+#include "cube.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+static inline void cube_init_lut_structure(cube_lut *lut)
+{
+    if (NULL != lut) {
+        memset(lut, 0, sizeof(*lut));
+
+        for (size_t channel = 0; channel < 3; ++channel) {
+            lut->domain_max[channel] =
+                1.0f;
+        }
+    }
+}
+
+static inline void cube_free_lut_structure(cube_lut *lut)
+{
+    if (NULL != lut) {
+        if (NULL != lut->table) {
+            free(lut->table);
+            lut->table = NULL;
+        }
+    }
+}
+
+/* The arguments after `keyword` if the line starts with it, NULL otherwise */
+static inline const char *_cube_match_keyword(const char *line, const char *keyword)
+{
+    size_t length =
+        strlen(keyword);
+
+    if (0 != strncmp(line, keyword, length) ||
+        ('\0' != line[length] && !isspace((unsigned char) line[length]))) {
+        return NULL;
+    }
+
+    return &line[length];
+}
+
+/* Parses exactly `count` white space separated numbers */
+static inline bool _cube_parse_values(const char *text, float *values, size_t count)
+{
+    const char *cursor =
+        text;
+    for (size_t i = 0; i < count; ++i) {
+        char *end;
+        values[i] =
+            strtof(cursor, &end);
+        if (end == cursor) {
+            return false;
+        }
+
+        cursor =
+            end;
+    }
+
+    while (isspace((unsigned char) *cursor)) {
+        ++cursor;
+    }
+
+    return '\0' == *cursor;
+}
+
+/*
+    Reads the keywords and the table of a .cube file. Comments, empty lines,
+    titles and the keywords of other applications are skipped, the table
+    has to follow the keywords.
+*/
+static void cube_read_lut(
+                FILE *file_descriptor,
+                cube_lut *lut,
+                const char **error_message
+            )
+{
+    *error_message = NULL;
+
+    if (NULL == lut) {
+        if (NULL != error_message) {
+            *error_message = CUBE_Error_Invalid_LUT_Structure;
+        }
+
+        return;
+    }
+
+    if (NULL == file_descriptor) {
+        if (NULL != error_message) {
+            *error_message = CUBE_Error_Invalid_File_Descriptor;
+        }
+
+        return;
+    }
+
+    size_t entries_count =
+        0;
+    size_t entries_read =
+        0;
+
+    char line[CUBE_MAX_LINE_LENGTH];
+    while (NULL != fgets(line, sizeof(line), file_descriptor)) {
+        size_t length =
+            strlen(line);
+        if (sizeof(line) - 1 == length && '\n' != line[length - 1] && !feof(file_descriptor)) {
+            *error_message = CUBE_Error_Invalid_Line;
+
+            goto cleanup;
+        }
+
+        while (0 < length && isspace((unsigned char) line[length - 1])) {
+            line[--length] = '\0';
+        }
+
+        const char *text =
+            line;
+        while (isspace((unsigned char) *text)) {
+            ++text;
+        }
+
+        if ('\0' == *text || '#' == *text) {
+            continue;
+        }
+
+        if (isalpha((unsigned char) *text)) {
+            const char *arguments;
+
+            if (0 < entries_read) {
+                *error_message = CUBE_Error_Invalid_Line;
+
+                goto cleanup;
+            }
+
+            if (NULL != _cube_match_keyword(text, "LUT_1D_SIZE")) {
+                *error_message = CUBE_Error_Unsupported_1D_LUT;
+
+                goto cleanup;
+            } else if (NULL != (arguments = _cube_match_keyword(text, "LUT_3D_SIZE"))) {
+                char *end;
+                long size =
+                    strtol(arguments, &end, 10);
+                while (isspace((unsigned char) *end)) {
+                    ++end;
+                }
+
+                if (NULL != lut->table || end == arguments || '\0' != *end ||
+                    CUBE_MIN_SIZE > size || CUBE_MAX_SIZE < size) {
+                    *error_message = CUBE_Error_Invalid_LUT_Size;
+
+                    goto cleanup;
+                }
+
+                lut->size =
+                    (size_t) size;
+                entries_count =
+                    lut->size * lut->size * lut->size;
+                lut->table =
+                    malloc(entries_count * 3 * sizeof(*lut->table));
+                if (NULL == lut->table) {
+                    *error_message = CUBE_Error_Not_Enough_Memory_to_Read;
+
+                    goto cleanup;
+                }
+            } else if (NULL != (arguments = _cube_match_keyword(text, "DOMAIN_MIN"))) {
+                if (!_cube_parse_values(arguments, lut->domain_min, 3)) {
+                    *error_message = CUBE_Error_Invalid_Domain;
+
+                    goto cleanup;
+                }
+            } else if (NULL != (arguments = _cube_match_keyword(text, "DOMAIN_MAX"))) {
+                if (!_cube_parse_values(arguments, lut->domain_max, 3)) {
+                    *error_message = CUBE_Error_Invalid_Domain;
+
+                    goto cleanup;
+                }
+            } else if (NULL != (arguments = _cube_match_keyword(text, "LUT_3D_INPUT_RANGE"))) {
+                /* The single range for all the channels of some older files */
+                float range[2];
+                if (!_cube_parse_values(arguments, range, 2)) {
+                    *error_message = CUBE_Error_Invalid_Domain;
+
+                    goto cleanup;
+                }
+
+                for (size_t channel = 0; channel < 3; ++channel) {
+                    lut->domain_min[channel] =
+                        range[0];
+                    lut->domain_max[channel] =
+                        range[1];
+                }
+            }
+
+            continue;
+        }
+
+        if (NULL == lut->table) {
+            *error_message = CUBE_Error_Invalid_LUT_Size;
+
+            goto cleanup;
+        }
+
+        if (entries_count == entries_read) {
+            *error_message = CUBE_Error_Wrong_Number_of_Entries;
+
+            goto cleanup;
+        }
+
+        if (!_cube_parse_values(text, &lut->table[entries_read * 3], 3)) {
+            *error_message = CUBE_Error_Invalid_Line;
+
+            goto cleanup;
+        }
+
+        ++entries_read;
+    }
+
+    if (NULL == lut->table) {
+        *error_message = CUBE_Error_Invalid_LUT_Size;
+
+        goto cleanup;
+    }
+
+    if (entries_count != entries_read) {
+        *error_message = CUBE_Error_Wrong_Number_of_Entries;
+
+        goto cleanup;
+    }
+
+    for (size_t channel = 0; channel < 3; ++channel) {
+        if (!(lut->domain_min[channel] < lut->domain_max[channel])) {
+            *error_message = CUBE_Error_Invalid_Domain;
+
+            goto cleanup;
+        }
+    }
+
+cleanup:
+    if (NULL != *error_message) {
+        cube_free_lut_structure(lut);
+    }
+}
@@ -3,12 +3,243 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #define FILTERS_BRIGHTNESS_CONTRAST_ID 0
 #define FILTERS_SEPIA_ID               1
 #define FILTERS_MEDIAN_ID              2
+#define FILTERS_COLOR_MATRIX_ID        3
+#define FILTERS_GAUSSIAN_ID            4
+#define FILTERS_CONVOLUTION_ID         5
+#define FILTERS_RESIZE_ID              6
+#define FILTERS_AUTO_LEVELS_ID         7
+#define FILTERS_EQUALIZE_ID            8
+#define FILTERS_GRAYSCALE_ID           9
+#define FILTERS_TRANSFORM_ID           10
+#define FILTERS_MORPHOLOGY_ID          11
+#define FILTERS_EDGES_ID               12
+#define FILTERS_UNSHARP_MASK_ID        13
+#define FILTERS_LUT3D_ID               14
 
-#define FILTERS_MEDIAN_WINDOW_SIZE 3
+#define FILTERS_MEDIAN_DEFAULT_RADIUS 1
+#define FILTERS_MEDIAN_MAX_RADIUS     30
+
+/*
+    Radius 1 uses a sorting network, radii up to `FILTERS_MEDIAN_HUANG_MAX_RADIUS`
+    the sliding histogram of Huang, larger radii the constant time column
+    histograms of Perreault and Hébert.
+*/
+#define FILTERS_MEDIAN_HUANG_MAX_RADIUS 8
+
+#define FILTERS_MEDIAN_FINE_BINS   (3 * 256)
+#define FILTERS_MEDIAN_COARSE_BINS (3 * 16)
+
+/* Column histograms of the constant time median for the B, G and R channels */
+typedef struct _filters_median_histograms
+{
+    size_t width, radius;
+    uint8_t *fine_columns;          /* `FILTERS_MEDIAN_FINE_BINS` counters per column   */
+    uint8_t *coarse_columns;        /* `FILTERS_MEDIAN_COARSE_BINS` counters per column */
+    const uint8_t *outgoing_row;    /* the top row of the previous window               */
+} filters_median_histograms_t;
+
+#define FILTERS_COLOR_MATRIX_FIXED_POINT_SHIFT 12
+
+/*
+    A 3x4 color matrix in the blue, green, red order of the pixel data.
+
+    Every row produces one output channel from the blue, green and red
+    input channels plus an offset in channel units. The alpha channel is
+    passed through. The float coefficients are the reference, the
+    fixed-point copies are derived from them by
+    `filters_color_matrix_prepare` and used by the SIMD implementation.
+*/
+typedef struct _filters_color_matrix
+{
+    float coefficients[3][4];
+
+    /* Q12 blue and green weights packed into the low and high 16 bits */
+    int32_t fixed_blue_green[3];
+    /* Q12 red weight in the low 16 bits */
+    int32_t fixed_red[3];
+    /* Q12 offset with the rounding term included */
+    int32_t fixed_offset[3];
+} filters_color_matrix_t;
+
+#define FILTERS_GAUSSIAN_MIN_SIGMA 0.5f
+#define FILTERS_GAUSSIAN_MAX_SIGMA 100.0f
+
+/*
+    Sigmas from `FILTERS_GAUSSIAN_BOX_MIN_SIGMA` on are approximated by three
+    box blurs, which cost the same per pixel for any radius. Smaller ones
+    use the sampled kernel of at most `FILTERS_GAUSSIAN_MAX_KERNEL_RADIUS`.
+*/
+#define FILTERS_GAUSSIAN_BOX_MIN_SIGMA      4.0f
+#define FILTERS_GAUSSIAN_MAX_KERNEL_RADIUS  12
+#define FILTERS_GAUSSIAN_BOX_PASSES         3
+
+/*
+    Kernel weights are in Q15 for `vpmulhrsw`, the products are accumulated
+    in 16 bits with 7 fractional bits. Box sums are divided by multiplying
+    with a Q24 reciprocal.
+*/
+#define FILTERS_GAUSSIAN_WEIGHT_SHIFT      15
+#define FILTERS_GAUSSIAN_ACCUMULATOR_SHIFT 7
+#define FILTERS_GAUSSIAN_BOX_SHIFT         24
+
+/* Width in bytes of the column strips of the vertical pass */
+#define FILTERS_GAUSSIAN_COLUMN_BLOCK 1024
+
+typedef struct _filters_gaussian
+{
+    float sigma;
+    bool box;
+    size_t radius;                  /* rows and columns read on every side of a pixel */
+
+    size_t kernel_radius;
+    int16_t weights[2 * FILTERS_GAUSSIAN_MAX_KERNEL_RADIUS + 1];
+
+    size_t box_radii[FILTERS_GAUSSIAN_BOX_PASSES];
+    uint32_t box_multipliers[FILTERS_GAUSSIAN_BOX_PASSES];
+} filters_gaussian_t;
+
+/*
+    Sharpens by adding the difference to a gaussian blur, scaled by the Q10
+    `fixed_amount`, wherever it is at least `threshold`. The alpha channel
+    is passed through.
+*/
+#define FILTERS_UNSHARP_MASK_DEFAULT_AMOUNT    1.0f
+#define FILTERS_UNSHARP_MASK_MAX_AMOUNT       10.0f
+#define FILTERS_UNSHARP_MASK_DEFAULT_THRESHOLD 0
+#define FILTERS_UNSHARP_MASK_AMOUNT_SHIFT     10
+
+typedef struct _filters_unsharp_mask
+{
+    filters_gaussian_t gaussian;
+    float amount;
+    int16_t fixed_amount;
+    uint8_t threshold;
+} filters_unsharp_mask_t;
+
+/* Kernels have odd sides of at most `FILTERS_CONVOLUTION_MAX_SIZE` pixels */
+#define FILTERS_CONVOLUTION_MAX_SIZE 15
+
+/*
+    An N×M convolution of the blue, green and red channels, the alpha
+    channel is passed through. The weights are stored row by row, the bias
+    is added to every result in channel units.
+*/
+typedef struct _filters_convolution
+{
+    size_t width, height;
+    float weights[FILTERS_CONVOLUTION_MAX_SIZE * FILTERS_CONVOLUTION_MAX_SIZE];
+    float bias;
+} filters_convolution_t;
+
+#define FILTERS_RESIZE_BILINEAR 0
+#define FILTERS_RESIZE_BICUBIC  1
+#define FILTERS_RESIZE_LANCZOS3 2
+
+/* Resampling weights are in Q14, so that two taps fit the 32-bit sums of `vpmaddwd` */
+#define FILTERS_RESIZE_WEIGHT_SHIFT 14
+
+/*
+    The weights of one axis. Every output coordinate `i` is the weighted sum
+    of the `taps` source coordinates from `starts[i]` on, with the weights
+    from `weights[i * taps]` on. `taps` is a multiple of four, the weights
+    past the filter support are zero.
+*/
+typedef struct _filters_resize_axis
+{
+    size_t taps;
+    size_t *starts;
+    int16_t *weights;
+} filters_resize_axis_t;
+
+typedef struct _filters_resize
+{
+    int method;
+    size_t source_width, source_height;
+    size_t width, height;
+    filters_resize_axis_t horizontal, vertical;
+} filters_resize_t;
+
+/* The share of the darkest and of the brightest values clipped by the auto-levels */
+#define FILTERS_AUTO_LEVELS_DEFAULT_CLIP 0.001f
+#define FILTERS_AUTO_LEVELS_MAX_CLIP     0.25f
+
+/* Counts of the blue, green and red channel values */
+typedef struct _filters_histogram
+{
+    uint64_t counts[3][256];
+} filters_histogram_t;
+
+/*
+    Lookup tables for the blue, green and red channels, the alpha channel
+    is passed through. `shifted` holds the values of `values` moved to the
+    byte of their channel in a pixel, it is derived by `filters_lut_prepare`
+    and used by the gathers of the SIMD implementation.
+*/
+typedef struct _filters_lut
+{
+    uint8_t values[3][256];
+    uint32_t shifted[3][256];
+} filters_lut_t;
+
+/*
+    Rotations are clockwise in the order of the rows in memory, which is
+    counterclockwise on screen for bottom-up bitmaps. Vertical flips of
+    whole images only negate the height in the header, the filters flip
+    regions of interest.
+*/
+#define FILTERS_TRANSFORM_ROTATE_90       0
+#define FILTERS_TRANSFORM_ROTATE_180      1
+#define FILTERS_TRANSFORM_ROTATE_270      2
+#define FILTERS_TRANSFORM_FLIP_HORIZONTAL 3
+#define FILTERS_TRANSFORM_FLIP_VERTICAL   4
+
+/* Rotations by 90 and 270 degrees transpose tiles of 16 by 16 pixels */
+#define FILTERS_TRANSFORM_TILE 16
+
+/*
+    The gradient magnitude |gx| + |gy| of every channel with 16-bit
+    intermediates, scaled so that a step from 0 to 255 gives 255. The alpha
+    channel is passed through.
+*/
+#define FILTERS_EDGES_SOBEL  0
+#define FILTERS_EDGES_SCHARR 1
+
+typedef struct _filters_edges
+{
+    int operator;
+    int16_t side_weight, center_weight;
+    unsigned int shift;
+} filters_edges_t;
+
+/* Openings erode then dilate, closings dilate then erode */
+#define FILTERS_MORPHOLOGY_ERODE  0
+#define FILTERS_MORPHOLOGY_DILATE 1
+#define FILTERS_MORPHOLOGY_OPEN   2
+#define FILTERS_MORPHOLOGY_CLOSE  3
+
+/* Structuring elements are rectangles within the window of the median */
+#define FILTERS_MORPHOLOGY_DEFAULT_RADIUS FILTERS_MEDIAN_DEFAULT_RADIUS
+#define FILTERS_MORPHOLOGY_MAX_RADIUS     FILTERS_MEDIAN_MAX_RADIUS
+
+/* Width in bytes of the column strips of the vertical pass */
+#define FILTERS_MORPHOLOGY_COLUMN_BLOCK 1024
+
+/*
+    A minimum (erosion) or maximum (dilation) over a rectangle of
+    `2 * radius_x + 1` by `2 * radius_y + 1` pixels of every channel, alpha
+    included. The van Herk/Gil-Werman running extrema cost three
+    comparisons per channel and direction for any radius.
+*/
+typedef struct _filters_morphology
+{
+    int operation;
+    size_t radius_x, radius_y;
+} filters_morphology_t;
 
 static inline void filters_apply_brightness_contrast(
                        uint8_t *pixels,
@@ -22,14 +253,293 @@ static inline void filters_apply_sepia(
                        size_t position
                    );
 
+static inline void filters_color_matrix_init_sepia(filters_color_matrix_t *matrix);
+
+static inline void filters_color_matrix_init_grayscale(filters_color_matrix_t *matrix);
+
+static inline void filters_color_matrix_init_channel_swap(filters_color_matrix_t *matrix);
+
+static inline void filters_color_matrix_init_saturation(
+                       filters_color_matrix_t *matrix,
+                       float saturation
+                   );
+
+static inline void filters_color_matrix_init_white_balance(
+                       filters_color_matrix_t *matrix,
+                       float red_gain,
+                       float green_gain,
+                       float blue_gain
+                   );
+
+static inline void filters_color_matrix_prepare(filters_color_matrix_t *matrix);
+
+static inline void filters_apply_color_matrix(
+                       uint8_t *pixels,
+                       size_t position,
+                       const filters_color_matrix_t *matrix
+                   );
+
 static inline void filters_apply_median(
-                       uint8_t *source_pixels,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x,
+                       size_t width
+                   );
+
+static inline void filters_apply_median_interior(
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x
+                   );
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+/* Pixels handled at the same time by `filters_apply_median_block` */
+#define FILTERS_MEDIAN_BLOCK_SIZE 16
+
+static inline void filters_apply_median_block(
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x
+                   );
+
+#endif
+
+static inline void filters_apply_median_huang(
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end,
+                       size_t width,
+                       size_t radius,
+                       bool clamp
+                   );
+
+static inline filters_median_histograms_t *filters_median_histograms_create(
+                                               size_t width,
+                                               size_t radius
+                                           );
+
+static inline void filters_median_histograms_destroy(
+                       filters_median_histograms_t *histograms
+                   );
+
+static inline void filters_median_histograms_begin_row(
+                       filters_median_histograms_t *histograms,
+                       uint8_t **rows
+                   );
+
+static inline void filters_apply_median_constant_time(
+                       filters_median_histograms_t *histograms,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end,
+                       bool clamp
+                   );
+
+static inline void filters_gaussian_init(
+                       filters_gaussian_t *gaussian,
+                       float sigma
+                   );
+
+/* Bytes needed for the padded row of `filters_apply_gaussian_horizontal` */
+static inline size_t filters_gaussian_padded_row_size(
+                         const filters_gaussian_t *gaussian,
+                         size_t width
+                     );
+
+static inline void filters_apply_gaussian_horizontal(
+                       const filters_gaussian_t *gaussian,
+                       const uint8_t *source_row,
+                       uint8_t *destination_row,
+                       size_t width,
+                       uint8_t *padded_row
+                   );
+
+static inline void filters_apply_gaussian_vertical(
+                       const filters_gaussian_t *gaussian,
+                       uint8_t *rows,
+                       size_t first_row,
                        uint8_t *destination_pixels,
+                       size_t width,
+                       size_t height,
+                       size_t y_start,
+                       size_t y_end,
+                       uint8_t *strip,
+                       uint32_t *sums,
+                       const filters_unsharp_mask_t *unsharp_mask
+                   );
+
+static inline void filters_unsharp_mask_init(
+                       filters_unsharp_mask_t *unsharp_mask,
+                       float sigma,
+                       float amount,
+                       uint8_t threshold
+                   );
+
+static inline void filters_apply_unsharp_mask(
+                       const filters_unsharp_mask_t *unsharp_mask,
+                       const uint8_t *blurred,
+                       uint8_t *pixels,
+                       size_t count
+                   );
+
+static inline bool filters_convolution_init(
+                       filters_convolution_t *convolution,
+                       size_t width,
+                       size_t height,
+                       const float *weights,
+                       float bias
+                   );
+
+static inline void filters_convolution_init_sharpen(filters_convolution_t *convolution);
+
+static inline void filters_convolution_init_emboss(filters_convolution_t *convolution);
+
+static inline void filters_convolution_init_edge(filters_convolution_t *convolution);
+
+static inline void filters_convolution_init_blur(filters_convolution_t *convolution);
+
+static inline void filters_convolution_init_motion_blur(filters_convolution_t *convolution);
+
+static inline void filters_apply_convolution(
+                       const filters_convolution_t *convolution,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end,
+                       size_t width
+                   );
+
+static inline void filters_apply_convolution_interior(
+                       const filters_convolution_t *convolution,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end
+                   );
+
+static inline filters_resize_t *filters_resize_create(
+                                     int method,
+                                     size_t source_width,
+                                     size_t source_height,
+                                     size_t width,
+                                     size_t height
+                                 );
+
+static inline void filters_resize_destroy(
+                       filters_resize_t *resize
+                   );
+
+static inline void filters_apply_resize_horizontal(
+                       const filters_resize_t *resize,
+                       const uint8_t *source_row,
+                       uint8_t *destination_row
+                   );
+
+static inline void filters_apply_resize_vertical(
+                       const filters_resize_t *resize,
+                       const uint8_t *rows,
+                       size_t first_row,
+                       uint8_t *destination_row,
+                       size_t y
+                   );
+
+static inline void filters_accumulate_histogram(
+                       const uint8_t *pixels,
+                       size_t start,
+                       size_t end,
+                       filters_histogram_t *histogram
+                   );
+
+static inline void filters_merge_histograms(
+                       filters_histogram_t *histogram,
+                       const filters_histogram_t *other
+                   );
+
+static inline void filters_lut_init_auto_levels(
+                       filters_lut_t *lut,
+                       const filters_histogram_t *histogram,
+                       float clip
+                   );
+
+static inline void filters_lut_init_equalize(
+                       filters_lut_t *lut,
+                       const filters_histogram_t *histogram
+                   );
+
+static inline void filters_lut_prepare(filters_lut_t *lut);
+
+static inline void filters_apply_lut(
+                       uint8_t *pixels,
                        size_t position,
-                       size_t x,
-                       size_t y,
+                       const filters_lut_t *lut
+                   );
+
+static inline void filters_apply_transform(
+                       const uint8_t *source_pixels,
+                       uint8_t *destination_pixels,
+                       size_t source_width,
+                       size_t source_height,
+                       int transform,
+                       size_t y_start,
+                       size_t y_end
+                   );
+
+static inline void filters_edges_init(
+                       filters_edges_t *edges,
+                       int operator
+                   );
+
+static inline void filters_apply_edges(
+                       const filters_edges_t *edges,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end,
+                       size_t width
+                   );
+
+static inline void filters_apply_edges_interior(
+                       const filters_edges_t *edges,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end
+                   );
+
+/* Rows around a band that an operation reads, twice the radius for openings and closings */
+static inline size_t filters_morphology_reach(const filters_morphology_t *morphology);
+
+/* Bytes needed for each of the buffers of the running extrema */
+static inline size_t filters_morphology_buffer_size(
+                         const filters_morphology_t *morphology,
+                         size_t width,
+                         size_t rows_count
+                     );
+
+static inline void filters_apply_morphology_vertical(
+                       const uint8_t *source_rows,
+                       size_t rows_count,
+                       uint8_t *destination_rows,
+                       size_t start,
+                       size_t end,
+                       size_t width,
+                       size_t radius,
+                       bool dilate,
+                       uint8_t *prefixes,
+                       uint8_t *suffixes
+                   );
+
+static inline void filters_apply_morphology_horizontal(
+                       uint8_t *rows,
+                       size_t rows_count,
                        size_t width,
-                       size_t height
+                       size_t radius,
+                       bool dilate,
+                       uint8_t *prefixes,
+                       uint8_t *suffixes,
+                       uint8_t *columns
                    );
 
 #include "filters.impl.h.c"
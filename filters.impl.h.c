@@ -2,6 +2,8 @@
 #include "utils.h"
 
 #include <immintrin.h>
+#include <math.h>
+#include <string.h>
 
 /*
     // AT&T/UNIX GCC Inline Assembly Sample
@@ -568,8 +570,220 @@ static inline void filters_apply_sepia(
 #endif
 }
 
-#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+static inline void filters_color_matrix_init_sepia(filters_color_matrix_t *matrix)
+{
+    static const float Sepia_Matrix[3][4] = {
+        { 0.131f, 0.534f, 0.272f, 0.0f },
+        { 0.168f, 0.686f, 0.349f, 0.0f },
+        { 0.189f, 0.769f, 0.393f, 0.0f }
+    };
+
+    memcpy(matrix->coefficients, Sepia_Matrix, sizeof(Sepia_Matrix));
+}
+
+static inline void filters_color_matrix_init_grayscale(filters_color_matrix_t *matrix)
+{
+    filters_color_matrix_init_saturation(matrix, 0.0f);
+}
+
+static inline void filters_color_matrix_init_channel_swap(filters_color_matrix_t *matrix)
+{
+    static const float Channel_Swap_Matrix[3][4] = {
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f },
+        { 1.0f, 0.0f, 0.0f, 0.0f }
+    };
+
+    memcpy(matrix->coefficients, Channel_Swap_Matrix, sizeof(Channel_Swap_Matrix));
+}
+
+static inline void filters_color_matrix_init_saturation(
+                       filters_color_matrix_t *matrix,
+                       float saturation
+                   )
+{
+    /* BT.601 luma weights in the blue, green, red order */
+    static const float Luma_Weights[3] = {
+        0.114f, 0.587f, 0.299f
+    };
+
+    for (size_t row = 0; row < 3; ++row) {
+        for (size_t column = 0; column < 3; ++column) {
+            matrix->coefficients[row][column] =
+                (1.0f - saturation) * Luma_Weights[column] +
+                    (row == column ? saturation : 0.0f);
+        }
+        matrix->coefficients[row][3] =
+            0.0f;
+    }
+}
+
+static inline void filters_color_matrix_init_white_balance(
+                       filters_color_matrix_t *matrix,
+                       float red_gain,
+                       float green_gain,
+                       float blue_gain
+                   )
+{
+    memset(matrix->coefficients, 0, sizeof(matrix->coefficients));
+
+    matrix->coefficients[0][0] =
+        blue_gain;
+    matrix->coefficients[1][1] =
+        green_gain;
+    matrix->coefficients[2][2] =
+        red_gain;
+}
+
+static inline void filters_color_matrix_prepare(filters_color_matrix_t *matrix)
+{
+    const float scale =
+        (float) (1 << FILTERS_COLOR_MATRIX_FIXED_POINT_SHIFT);
+
+    for (size_t row = 0; row < 3; ++row) {
+        int32_t weights[3];
+        for (size_t column = 0; column < 3; ++column) {
+            weights[column] =
+                (int32_t) lrintf(
+                              UTILS_CLAMP(
+                                  matrix->coefficients[row][column] * scale,
+                                  (float) INT16_MIN,
+                                  (float) INT16_MAX
+                              )
+                          );
+        }
+
+        matrix->fixed_blue_green[row] =
+            (int32_t) (((uint32_t) weights[0] & 0xffffu) | ((uint32_t) weights[1] << 16));
+        matrix->fixed_red[row] =
+            (int32_t) ((uint32_t) weights[2] & 0xffffu);
+        matrix->fixed_offset[row] =
+            (int32_t) lrintf(UTILS_CLAMP(matrix->coefficients[row][3], -1024.0f, 1024.0f) * scale) +
+                (1 << (FILTERS_COLOR_MATRIX_FIXED_POINT_SHIFT - 1));
+    }
+}
+
+static inline void filters_apply_color_matrix(
+                       uint8_t *pixels,
+                       size_t position,
+                       const filters_color_matrix_t *matrix
+                   )
+{
+#if !defined FILTERS_C_IMPLEMENTATION &&     \
+    !defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#define FILTERS_C_IMPLEMENTATION 1
+#endif
+
+#if defined FILTERS_C_IMPLEMENTATION
+
+    /* The float reference path, one pixel at a time. */
+    float blue =
+        pixels[position];
+    float green =
+        pixels[position + 1];
+    float red =
+        pixels[position + 2];
+
+    for (size_t channel = 0; channel < 3; ++channel) {
+        const float *row =
+            matrix->coefficients[channel];
+
+        pixels[position + channel] =
+            (uint8_t) UTILS_CLAMP(
+                          row[0] * blue + row[1] * green + row[2] * red + row[3] + 0.5f,
+                          0.0f,
+                          255.0f
+                      );
+    }
+
+#elif defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    /*
+        Process 16 pixels (64 color channels) at the same time in 16-bit
+        fixed point. The blue and green channels of every pixel are spread
+        into the two 16-bit halves of a 32-bit lane and the red channel into
+        the low half of another one, so that `vpmaddwd` produces the whole
+        dot product of a row in two instructions. The three 32-bit results
+        and the original alpha are then saturated back to bytes with two
+        rounds of packing and put back into the B, G, R, A order with one
+        byte shuffle.
+    */
+    const __m512i blue_green_shuffle =
+        _mm512_set4_epi32(
+            (int32_t) 0x800d800c, (int32_t) 0x80098008,
+            (int32_t) 0x80058004, (int32_t) 0x80018000
+        );
+    const __m512i red_shuffle =
+        _mm512_set4_epi32(
+            (int32_t) 0x8080800e, (int32_t) 0x8080800a,
+            (int32_t) 0x80808006, (int32_t) 0x80808002
+        );
+    const __m512i transpose_shuffle =
+        _mm512_set4_epi32(
+            0x0f0b0703, 0x0e0a0602,
+            0x0d090501, 0x0c080400
+        );
+
+    __m512i source =
+        _mm512_loadu_si512((const void *) &pixels[position]);
+    __m512i blue_green =
+        _mm512_shuffle_epi8(source, blue_green_shuffle);
+    __m512i red =
+        _mm512_shuffle_epi8(source, red_shuffle);
+    __m512i alpha =
+        _mm512_srli_epi32(source, 24);
+
+    __m512i results[3];
+    for (size_t channel = 0; channel < 3; ++channel) {
+        __m512i sum =
+            _mm512_add_epi32(
+                _mm512_madd_epi16(blue_green, _mm512_set1_epi32(matrix->fixed_blue_green[channel])),
+                _mm512_madd_epi16(red, _mm512_set1_epi32(matrix->fixed_red[channel]))
+            );
+        sum =
+            _mm512_add_epi32(sum, _mm512_set1_epi32(matrix->fixed_offset[channel]));
+        results[channel] =
+            _mm512_srai_epi32(sum, FILTERS_COLOR_MATRIX_FIXED_POINT_SHIFT);
+    }
+
+    __m512i blue_green_words =
+        _mm512_packus_epi32(results[0], results[1]);
+    __m512i red_alpha_words =
+        _mm512_packus_epi32(results[2], alpha);
+    __m512i channels =
+        _mm512_packus_epi16(blue_green_words, red_alpha_words);
+
+    _mm512_storeu_si512(
+        (void *) &pixels[position],
+        _mm512_shuffle_epi8(channels, transpose_shuffle)
+    );
 
+#endif
+}
+
+/*
+    The optimal 19 comparator network that leaves the median of nine values
+    in the element 4 (A. W. Paeth, "Median Finding on a 3x3 Grid", Graphics
+    Gems, 1990). `SORT(a, b)` must leave the smaller value in `a` and the
+    larger one in `b`.
+*/
+#define FILTERS_MEDIAN_OF_9_NETWORK(SORT) \
+    SORT(1, 2) SORT(4, 5) SORT(7, 8)      \
+    SORT(0, 1) SORT(3, 4) SORT(6, 7)      \
+    SORT(1, 2) SORT(4, 5) SORT(7, 8)      \
+    SORT(0, 3) SORT(5, 8) SORT(4, 7)      \
+    SORT(3, 6) SORT(1, 4) SORT(2, 5)      \
+    SORT(4, 7) SORT(4, 2) SORT(6, 4)      \
+    SORT(4, 2)
+
+#define FILTERS_MEDIAN_SORT_BYTES(A, B)                     \
+    {                                                       \
+        uint8_t minimum = UTILS_MIN(window[A], window[B]);  \
+        window[B] = UTILS_MAX(window[A], window[B]);        \
+        window[A] = minimum;                                \
+    }
+
+/* The window of the sorting network path (radius 1) */
 static const size_t window_width =
     3;
 static const size_t window_height =
@@ -578,284 +792,2695 @@ static const size_t window_center_shift_x =
     1;
 static const size_t window_center_shift_y =
     1;
-static const size_t window_size =
-    8;
 static const size_t window_center =
     4;
 
-static const uint64_t permutations_1[] __attribute__((aligned(0x40))) = {
-    1, 0, 3, 2, 5, 4, 7, 6
-};
-static const uint64_t permutations_2[] __attribute__((aligned(0x40))) = {
-    3, 2, 1, 0, 7, 6, 5, 4
-};
-static const uint64_t permutations_3[] __attribute__((aligned(0x40))) = {
-    7, 6, 5, 4, 3, 2, 1, 0
-};
-static const uint64_t permutations_4[] __attribute__((aligned(0x40))) = {
-    2, 3, 0, 1, 6, 7, 4, 5
-};
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+static const uint64_t Median_Alpha_Mask =
+    0x8888888888888888ull;
 
-#endif
+#define FILTERS_MEDIAN_SORT_VECTORS(A, B)                        \
+    {                                                            \
+        __m512i minimum = _mm512_min_epu8(window[A], window[B]); \
+        window[B] = _mm512_max_epu8(window[A], window[B]);       \
+        window[A] = minimum;                                     \
+    }
 
-static int _filters_compare_color_channels(const void *a, const void *b)
-{
-    return *((const uint8_t *) a) - *((const uint8_t *) b);
-}
+#define FILTERS_MEDIAN_SORT_REGISTERS(A, B)                 \
+    "vpminub %%zmm" #A ", %%zmm" #B ", %%zmm9\n\t"          \
+    "vpmaxub %%zmm" #A ", %%zmm" #B ", %%zmm" #B "\n\t"     \
+    "vmovdqa64 %%zmm9, %%zmm" #A "\n\t"
+
+#endif
 
 static inline void filters_apply_median(
-                       uint8_t *source_pixels,
-                       uint8_t *destination_pixels,
-                       size_t position,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
                        size_t x,
-                       size_t y,
-                       size_t width,
-                       size_t height
+                       size_t width
                    )
 {
-#if !defined FILTERS_C_IMPLEMENTATION &&     \
-    !defined FILTERS_SIMD_ASM_IMPLEMENTATION
-#define FILTERS_C_IMPLEMENTATION 1
-#endif
-
-#if defined FILTERS_C_IMPLEMENTATION
-
-    const size_t window_width =
-        FILTERS_MEDIAN_WINDOW_SIZE % 2 == 0 ?
-            FILTERS_MEDIAN_WINDOW_SIZE + 1 :
-            FILTERS_MEDIAN_WINDOW_SIZE;
-    const size_t window_height =
-        window_width;
-    const size_t window_center_shift_x =
-        window_width / 2;
-    const size_t window_center_shift_y =
-        window_height / 2;
-    const size_t window_size =
-        window_width * window_height;
-    const size_t window_center =
-        window_size / 2;
-
-    uint8_t window[window_size];
+    uint8_t window[window_width * window_height];
     for (size_t channel = 0; channel < 3; ++channel) {
         for (size_t wy = 0; wy < window_height; ++wy) {
             for (size_t wx = 0; wx < window_width; ++wx) {
                 ssize_t adjusted_x =
                     (ssize_t) x - (ssize_t) window_center_shift_x + (ssize_t) wx;
-                ssize_t adjusted_y =
-                    (ssize_t) y - (ssize_t) window_center_shift_y + (ssize_t) wy;
+                size_t column =
+                    (size_t) UTILS_CLAMP(adjusted_x, 0, (ssize_t) width - 1);
 
                 window[wy * window_width + wx] =
-                    bmp_sample_pixel(
-                        source_pixels,
-                        adjusted_x,
-                        adjusted_y,
-                        width,
-                        height
-                    )[channel];
+                    rows[wy][column * 4 + channel];
             }
         }
 
-        qsort(window, window_size, sizeof(*window), _filters_compare_color_channels);
+        FILTERS_MEDIAN_OF_9_NETWORK(FILTERS_MEDIAN_SORT_BYTES)
 
-#elif defined FILTERS_SIMD_ASM_IMPLEMENTATION
+        destination_row[x * 4 + channel] =
+            window[window_center];
+    }
+}
 
-    double window[9] __attribute__((aligned(0x40)));
+static inline void filters_apply_median_interior(
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x
+                   )
+{
+    uint8_t window[window_width * window_height];
     for (size_t channel = 0; channel < 3; ++channel) {
         for (size_t wy = 0; wy < window_height; ++wy) {
-            for (size_t wx = 0; wx < window_width; ++wx) {
-                ssize_t adjusted_x =
-                    (ssize_t) x - (ssize_t) window_center_shift_x + (ssize_t) wx;
-                ssize_t adjusted_y =
-                    (ssize_t) y - (ssize_t) window_center_shift_y + (ssize_t) wy;
+            const uint8_t *sample =
+                rows[wy] + (x - window_center_shift_x) * 4 + channel;
 
+            for (size_t wx = 0; wx < window_width; ++wx, sample += 4) {
                 window[wy * window_width + wx] =
-                    (double) bmp_sample_pixel(
-                                 source_pixels,
-                                 adjusted_x,
-                                 adjusted_y,
-                                 width,
-                                 height
-                             )[channel];
+                    *sample;
             }
         }
 
-#if defined INTRINSICS
+        FILTERS_MEDIAN_OF_9_NETWORK(FILTERS_MEDIAN_SORT_BYTES)
+
+        destination_row[x * 4 + channel] =
+            window[window_center];
+    }
+}
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+/*
+    Computes the 3x3 median of `FILTERS_MEDIAN_BLOCK_SIZE` consecutive pixels
+    starting at the column `x`. The nine neighbours of all 64 color channels
+    are loaded as nine shifted rows and sorted with byte minimums and
+    maximums, one comparator of the network at a time for every channel.
+    The caller must guarantee that the columns from `x - 1` to
+    `x + FILTERS_MEDIAN_BLOCK_SIZE` exist. The alpha channel is copied from
+    the source.
+*/
+static inline void filters_apply_median_block(
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x
+                   )
+{
+    size_t offset =
+        x * 4;
+
+#if defined INTRINSICS || defined x86_32_CPU
+
+    // There are only eight vector registers in 32-bit mode, let the compiler spill.
+    __m512i window[9];
+    for (size_t wy = 0; wy < window_height; ++wy) {
+        const uint8_t *row =
+            rows[wy] + offset - window_center_shift_x * 4;
+
+        for (size_t wx = 0; wx < window_width; ++wx) {
+            window[wy * window_width + wx] =
+                _mm512_loadu_si512((const void *) (row + wx * 4));
+        }
+    }
+
+    FILTERS_MEDIAN_OF_9_NETWORK(FILTERS_MEDIAN_SORT_VECTORS)
+
+    _mm512_storeu_si512(
+        (void *) &destination_row[offset],
+        _mm512_mask_blend_epi8(
+            Median_Alpha_Mask,
+            window[window_center],
+            _mm512_loadu_si512((const void *) &rows[window_center_shift_y][offset])
+        )
+    );
+
+#elif defined x86_64_CPU
+
+    __asm__ __volatile__ (
+        "vmovdqu64 -4(%0), %%zmm0\n\t"
+        "vmovdqu64 (%0), %%zmm1\n\t"
+        "vmovdqu64 4(%0), %%zmm2\n\t"
+        "vmovdqu64 -4(%1), %%zmm3\n\t"
+        "vmovdqu64 (%1), %%zmm4\n\t"
+        "vmovdqu64 4(%1), %%zmm5\n\t"
+        "vmovdqu64 -4(%2), %%zmm6\n\t"
+        "vmovdqu64 (%2), %%zmm7\n\t"
+        "vmovdqu64 4(%2), %%zmm8\n\t"
+
+        FILTERS_MEDIAN_OF_9_NETWORK(FILTERS_MEDIAN_SORT_REGISTERS)
+
+        "kmovq %4, %%k1\n\t"
+        "vmovdqu8 (%1), %%zmm4%{%%k1%}\n\t"
+        "vmovdqu64 %%zmm4, (%3)\n\t"
+    ::
+        "r"(rows[0] + offset), "r"(rows[1] + offset), "r"(rows[2] + offset),
+        "r"(destination_row + offset),
+        "r"(Median_Alpha_Mask)
+    :
+        "k1",
+        "zmm0", "zmm1", "zmm2", "zmm3", "zmm4",
+        "zmm5", "zmm6", "zmm7", "zmm8", "zmm9",
+        "memory"
+    );
+
+#else
+#error "Unsupported processor architecture"
+#endif
+}
 
-        __m512d result = _mm512_load_pd(window);
+#endif
+
+/*
+    Moves the running median of a histogram after values were added to or
+    removed from it. `below` is the number of values smaller than `median`,
+    `half` is the index of the median in the sorted window.
+*/
+static inline void _filters_median_update(
+                       const uint16_t *histogram,
+                       size_t half,
+                       uint8_t *median,
+                       size_t *below
+                   )
+{
+    while (*below > half) {
+        --*median;
+        *below -= histogram[*median];
+    }
 
-        {
-            __m512i idxNoNeigh   = _mm512_set_epi64(6, 7, 4, 5, 2, 3, 0, 1);
-            __m512d permNeigh    = _mm512_permutexvar_pd(idxNoNeigh, result);
-            __m512d permNeighMin = _mm512_min_pd(permNeigh, result);
-            __m512d permNeighMax = _mm512_max_pd(permNeigh, result);
+    while (*below + histogram[*median] <= half) {
+        *below += histogram[*median];
+        ++*median;
+    }
+}
 
-            result = _mm512_mask_mov_pd(permNeighMin, 0xAA, permNeighMax);
+static inline void filters_apply_median_huang(
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end,
+                       size_t width,
+                       size_t radius,
+                       bool clamp
+                   )
+{
+    size_t diameter =
+        2 * radius + 1;
+    size_t half =
+        diameter * diameter / 2;
+
+    uint16_t histograms[3][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    for (ssize_t wx = -(ssize_t) radius; wx <= (ssize_t) radius; ++wx) {
+        ssize_t adjusted_x =
+            (ssize_t) x_start + wx;
+        size_t column =
+            (size_t) (clamp ? UTILS_CLAMP(adjusted_x, 0, (ssize_t) width - 1) : adjusted_x) * 4;
+
+        for (size_t wy = 0; wy < diameter; ++wy) {
+            for (size_t channel = 0; channel < 3; ++channel) {
+                ++histograms[channel][rows[wy][column + channel]];
+            }
         }
+    }
 
-        {
-            __m512i idxNoNeigh   = _mm512_set_epi64(4, 5, 6, 7, 0, 1, 2, 3);
-            __m512d permNeigh    = _mm512_permutexvar_pd(idxNoNeigh, result);
-            __m512d permNeighMin = _mm512_min_pd(permNeigh, result);
-            __m512d permNeighMax = _mm512_max_pd(permNeigh, result);
+    uint8_t medians[3] = { 0, 0, 0 };
+    size_t below[3] = { 0, 0, 0 };
+    for (size_t channel = 0; channel < 3; ++channel) {
+        _filters_median_update(histograms[channel], half, &medians[channel], &below[channel]);
+    }
 
-            result = _mm512_mask_mov_pd(permNeighMin, 0xCC, permNeighMax);
+    for (size_t x = x_start; x < x_end; ++x) {
+        for (size_t channel = 0; channel < 3; ++channel) {
+            destination_row[x * 4 + channel] =
+                medians[channel];
         }
 
-        {
-            __m512i idxNoNeigh   = _mm512_set_epi64(6, 7, 4, 5, 2, 3, 0, 1);
-            __m512d permNeigh    = _mm512_permutexvar_pd(idxNoNeigh, result);
-            __m512d permNeighMin = _mm512_min_pd(permNeigh, result);
-            __m512d permNeighMax = _mm512_max_pd(permNeigh, result);
+        if (x + 1 == x_end) {
+            break;
+        }
 
-            result = _mm512_mask_mov_pd(permNeighMin, 0xAA, permNeighMax);
+        size_t outgoing =
+            clamp ?
+                (size_t) UTILS_MAX((ssize_t) x - (ssize_t) radius, 0) * 4 :
+                (x - radius) * 4;
+        size_t incoming =
+            clamp ?
+                UTILS_MIN(x + radius + 1, width - 1) * 4 :
+                (x + radius + 1) * 4;
+
+        for (size_t wy = 0; wy < diameter; ++wy) {
+            for (size_t channel = 0; channel < 3; ++channel) {
+                uint8_t value =
+                    rows[wy][outgoing + channel];
+                --histograms[channel][value];
+                below[channel] -= value < medians[channel];
+
+                value =
+                    rows[wy][incoming + channel];
+                ++histograms[channel][value];
+                below[channel] += value < medians[channel];
+            }
         }
 
-        {
-            __m512i idxNoNeigh   = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
-            __m512d permNeigh    = _mm512_permutexvar_pd(idxNoNeigh, result);
-            __m512d permNeighMin = _mm512_min_pd(permNeigh, result);
-            __m512d permNeighMax = _mm512_max_pd(permNeigh, result);
+        for (size_t channel = 0; channel < 3; ++channel) {
+            _filters_median_update(histograms[channel], half, &medians[channel], &below[channel]);
+        }
+    }
+}
 
-            result = _mm512_mask_mov_pd(permNeighMin, 0xF0, permNeighMax);
+/* Adds (`sign` is 1) or removes (`sign` is -1) a row of pixels from column histograms */
+static inline void _filters_median_column_histograms_update(
+                       filters_median_histograms_t *histograms,
+                       const uint8_t *row,
+                       int sign
+                   )
+{
+    for (size_t x = 0; x < histograms->width; ++x) {
+        uint8_t *fine =
+            &histograms->fine_columns[x * FILTERS_MEDIAN_FINE_BINS];
+        uint8_t *coarse =
+            &histograms->coarse_columns[x * FILTERS_MEDIAN_COARSE_BINS];
+
+        for (size_t channel = 0; channel < 3; ++channel) {
+            uint8_t value =
+                row[x * 4 + channel];
+
+            fine[channel * 256 + value] += (uint8_t) sign;
+            coarse[channel * 16 + (value >> 4)] += (uint8_t) sign;
         }
+    }
+}
+
+/* kernel += incoming - outgoing for `count` bins, a multiple of 16 */
+static inline void _filters_median_kernel_histogram_slide(
+                       uint16_t *kernel,
+                       const uint8_t *incoming,
+                       const uint8_t *outgoing,
+                       size_t count
+                   )
+{
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i bins =
+            _mm512_loadu_si512((const void *) &kernel[i]);
+        bins =
+            _mm512_add_epi16(bins, _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) &incoming[i])));
+        bins =
+            _mm512_sub_epi16(bins, _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) &outgoing[i])));
+        _mm512_storeu_si512((void *) &kernel[i], bins);
+    }
+    for (; i < count; i += 16) {
+        __m256i bins =
+            _mm256_loadu_si256((const __m256i *) &kernel[i]);
+        bins =
+            _mm256_add_epi16(bins, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &incoming[i])));
+        bins =
+            _mm256_sub_epi16(bins, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &outgoing[i])));
+        _mm256_storeu_si256((__m256i *) &kernel[i], bins);
+    }
 
-        {
-            __m512i idxNoNeigh   = _mm512_set_epi64(5, 4, 7, 6, 1, 0, 3, 2);
-            __m512d permNeigh    = _mm512_permutexvar_pd(idxNoNeigh, result);
-            __m512d permNeighMin = _mm512_min_pd(permNeigh, result);
-            __m512d permNeighMax = _mm512_max_pd(permNeigh, result);
+#else
+
+    for (size_t i = 0; i < count; ++i) {
+        kernel[i] += (uint16_t) incoming[i] - (uint16_t) outgoing[i];
+    }
+
+#endif
+}
+
+static inline filters_median_histograms_t *filters_median_histograms_create(
+                                               size_t width,
+                                               size_t radius
+                                           )
+{
+    filters_median_histograms_t *histograms =
+        malloc(sizeof(*histograms));
+
+    if (NULL == histograms) {
+        return histograms;
+    }
+
+    histograms->width =
+        width;
+    histograms->radius =
+        radius;
+    histograms->outgoing_row =
+        NULL;
+    histograms->fine_columns =
+        (uint8_t *) calloc(width, FILTERS_MEDIAN_FINE_BINS);
+    histograms->coarse_columns =
+        (uint8_t *) calloc(width, FILTERS_MEDIAN_COARSE_BINS);
+
+    if (NULL == histograms->fine_columns || NULL == histograms->coarse_columns) {
+        filters_median_histograms_destroy(histograms);
+
+        return NULL;
+    }
+
+    return histograms;
+}
+
+static inline void filters_median_histograms_destroy(
+                       filters_median_histograms_t *histograms
+                   )
+{
+    if (NULL != histograms) {
+        free(histograms->fine_columns);
+        free(histograms->coarse_columns);
+        free(histograms);
+    }
+}
+
+static inline void filters_median_histograms_begin_row(
+                       filters_median_histograms_t *histograms,
+                       uint8_t **rows
+                   )
+{
+    size_t diameter =
+        2 * histograms->radius + 1;
 
-            result = _mm512_mask_mov_pd(permNeighMin, 0xCC, permNeighMax);
+    if (NULL == histograms->outgoing_row) {
+        for (size_t wy = 0; wy < diameter; ++wy) {
+            _filters_median_column_histograms_update(histograms, rows[wy], 1);
         }
+    } else {
+        _filters_median_column_histograms_update(histograms, histograms->outgoing_row, -1);
+        _filters_median_column_histograms_update(histograms, rows[diameter - 1], 1);
+    }
 
-        {
-            __m512i idxNoNeigh   = _mm512_set_epi64(6, 7, 4, 5, 2, 3, 0, 1);
-            __m512d permNeigh    = _mm512_permutexvar_pd(idxNoNeigh, result);
-            __m512d permNeighMin = _mm512_min_pd(permNeigh, result);
-            __m512d permNeighMax = _mm512_max_pd(permNeigh, result);
+    histograms->outgoing_row =
+        rows[0];
+}
 
-            result = _mm512_mask_mov_pd(permNeighMin, 0xAA, permNeighMax);
+/*
+    The constant time median filter of S. Perreault and P. Hébert ("Median
+    Filtering in Constant Time", IEEE Transactions on Image Processing,
+    2007).
+
+    Every image column keeps a histogram of the `2 * radius + 1` pixels
+    above and below the current row, which is updated with one removal and
+    one addition when moving to the next row by
+    `filters_median_histograms_begin_row`. The histogram of the window is the
+    sum of `2 * radius + 1` column histograms and slides along the row by
+    adding one column histogram and subtracting another one, so the cost per
+    pixel does not depend on the radius. A second level of 16 coarse bins
+    lets the median search skip most of the 256 fine bins.
+*/
+static inline void filters_apply_median_constant_time(
+                       filters_median_histograms_t *histograms,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end,
+                       bool clamp
+                   )
+{
+    size_t width =
+        histograms->width;
+    size_t radius =
+        histograms->radius;
+    size_t diameter =
+        2 * radius + 1;
+    size_t half =
+        diameter * diameter / 2;
+    const uint8_t *fine_columns =
+        histograms->fine_columns;
+    const uint8_t *coarse_columns =
+        histograms->coarse_columns;
+
+    uint16_t fine[FILTERS_MEDIAN_FINE_BINS] __attribute__((aligned(0x40)));
+    uint16_t coarse[FILTERS_MEDIAN_COARSE_BINS] __attribute__((aligned(0x40)));
+
+    memset(fine, 0, sizeof(fine));
+    memset(coarse, 0, sizeof(coarse));
+    for (ssize_t wx = -(ssize_t) radius; wx <= (ssize_t) radius; ++wx) {
+        ssize_t adjusted_x =
+            (ssize_t) x_start + wx;
+        size_t column =
+            (size_t) (clamp ? UTILS_CLAMP(adjusted_x, 0, (ssize_t) width - 1) : adjusted_x);
+
+        for (size_t i = 0; i < FILTERS_MEDIAN_FINE_BINS; ++i) {
+            fine[i] += fine_columns[column * FILTERS_MEDIAN_FINE_BINS + i];
         }
+        for (size_t i = 0; i < FILTERS_MEDIAN_COARSE_BINS; ++i) {
+            coarse[i] += coarse_columns[column * FILTERS_MEDIAN_COARSE_BINS + i];
+        }
+    }
 
-        _mm512_store_pd(window, result);
+    for (size_t x = x_start; x < x_end; ++x) {
+        for (size_t channel = 0; channel < 3; ++channel) {
+            const uint16_t *coarse_bins =
+                &coarse[channel * 16];
+            const uint16_t *fine_bins =
+                &fine[channel * 256];
+
+            size_t count =
+                0;
+            size_t bucket =
+                0;
+            while (count + coarse_bins[bucket] <= half) {
+                count += coarse_bins[bucket];
+                ++bucket;
+            }
 
-#elif defined x86_32_CPU
+            size_t value =
+                bucket * 16;
+            while (count + fine_bins[value] <= half) {
+                count += fine_bins[value];
+                ++value;
+            }
 
-        __asm__ __volatile__ (
-            "vmovapd (%0), %%zmm1\n\t"
-
-            "vmovdqa64 (%1), %%zmm3\n\t"
-            "vmovdqa64 (%2), %%zmm4\n\t"
-            "vmovdqa64 (%3), %%zmm5\n\t"
-            "kmovw %%eax, %%k1\n\t"
-            "movl  $-52, %%eax\n\t"
-            "kmovw %%eax, %%k2\n\t"
-            "movl  $-16, %%eax\n\t"
-            "kmovw %%eax, %%k3\n\t"
-
-            "vpermpd %%zmm1, %%zmm3, %%zmm2\n\t"
-            "vminpd  %%zmm1, %%zmm2, %%zmm0\n\t"
-            "vmaxpd  %%zmm1, %%zmm2, %%zmm0%{%%k1%}\n\t"
-
-            "vpermpd %%zmm0, %%zmm4, %%zmm2\n\t"
-            "vminpd  %%zmm0, %%zmm2, %%zmm1\n\t"
-            "vmaxpd  %%zmm0, %%zmm2, %%zmm1%{%%k2%}\n\t"
-
-            "vpermpd %%zmm1, %%zmm3, %%zmm2\n\t"
-            "vminpd  %%zmm1, %%zmm2, %%zmm0\n\t"
-            "vmaxpd  %%zmm1, %%zmm2, %%zmm0%{%%k1%}\n\t"
-
-            "vpermpd %%zmm0, %%zmm5, %%zmm2\n\t"
-            "vminpd  %%zmm0, %%zmm2, %%zmm1\n\t"
-            "vmaxpd  %%zmm0, %%zmm2, %%zmm1%{%%k3%}\n\t"
-
-            "vpermpd %%zmm1, %%zmm6, %%zmm2\n\t"
-            "vminpd  %%zmm1, %%zmm2, %%zmm0\n\t"
-            "vmaxpd  %%zmm1, %%zmm2, %%zmm0%{%%k2%}\n\t"
-
-            "vpermpd %%zmm0, %%zmm3, %%zmm2\n\t"
-            "vminpd  %%zmm0, %%zmm2, %%zmm1\n\t"
-            "vmaxpd  %%zmm0, %%zmm2, %%zmm1%{%%k1%}\n\t"
-
-            "vmovapd %%zmm1, (%0)\n\t"
-        ::
-            "b"(window),
-            "c"(permutations_1),
-            "d"(permutations_2),
-            "S"(permutations_3),
-            "D"(permutations_4)
-        :
-            "%rax",
-            "k1", "k2", "k3",
-            "%zmm0", "%zmm1", "%zmm2", "%zmm3", "%zmm5", "%zmm6", "%zmm7"
-        );
+            destination_row[x * 4 + channel] =
+                (uint8_t) value;
+        }
 
-#elif defined x86_64_CPU
+        if (x + 1 == x_end) {
+            break;
+        }
 
-        __asm__ __volatile__ (
-            "vmovapd %0, %%zmm1\n\t"
-
-            "vmovdqa64 %1, %%zmm3\n\t"
-            "vmovdqa64 %2, %%zmm4\n\t"
-            "vmovdqa64 %3, %%zmm5\n\t"
-            "vmovdqa64 %4, %%zmm6\n\t"
-
-            "movl  $-86, %%eax\n\t"
-            "kmovw %%eax, %%k1\n\t"
-            "movl  $-52, %%eax\n\t"
-            "kmovw %%eax, %%k2\n\t"
-            "movl  $-16, %%eax\n\t"
-            "kmovw %%eax, %%k3\n\t"
-
-            "vpermpd %%zmm1, %%zmm3, %%zmm2\n\t"
-            "vminpd  %%zmm1, %%zmm2, %%zmm0\n\t"
-            "vmaxpd  %%zmm1, %%zmm2, %%zmm0%{%%k1%}\n\t"
-
-            "vpermpd %%zmm0, %%zmm4, %%zmm2\n\t"
-            "vminpd  %%zmm0, %%zmm2, %%zmm1\n\t"
-            "vmaxpd  %%zmm0, %%zmm2, %%zmm1%{%%k2%}\n\t"
-
-            "vpermpd %%zmm1, %%zmm3, %%zmm2\n\t"
-            "vminpd  %%zmm1, %%zmm2, %%zmm0\n\t"
-            "vmaxpd  %%zmm1, %%zmm2, %%zmm0%{%%k1%}\n\t"
-
-            "vpermpd %%zmm0, %%zmm5, %%zmm2\n\t"
-            "vminpd  %%zmm0, %%zmm2, %%zmm1\n\t"
-            "vmaxpd  %%zmm0, %%zmm2, %%zmm1%{%%k3%}\n\t"
-
-            "vpermpd %%zmm1, %%zmm6, %%zmm2\n\t"
-            "vminpd  %%zmm1, %%zmm2, %%zmm0\n\t"
-            "vmaxpd  %%zmm1, %%zmm2, %%zmm0%{%%k2%}\n\t"
-
-            "vpermpd %%zmm0, %%zmm3, %%zmm2\n\t"
-            "vminpd  %%zmm0, %%zmm2, %%zmm1\n\t"
-            "vmaxpd  %%zmm0, %%zmm2, %%zmm1%{%%k1%}\n\t"
-
-            "vmovapd %%zmm1, %0\n\t"
-        :
-            "+m"(*window)
-        :
-            "m"(*permutations_1), "m"(*permutations_2), "m"(*permutations_3), "m"(*permutations_4)
-        :
-            "rax",
-            "k1", "k2", "k3",
-            "zmm0", "zmm1", "zmm2", "zmm3", "zmm5", "zmm6",
-            "cc"
+        size_t outgoing =
+            clamp ?
+                (size_t) UTILS_MAX((ssize_t) x - (ssize_t) radius, 0) :
+                x - radius;
+        size_t incoming =
+            clamp ?
+                UTILS_MIN(x + radius + 1, width - 1) :
+                x + radius + 1;
+
+        _filters_median_kernel_histogram_slide(
+            fine,
+            &fine_columns[incoming * FILTERS_MEDIAN_FINE_BINS],
+            &fine_columns[outgoing * FILTERS_MEDIAN_FINE_BINS],
+            FILTERS_MEDIAN_FINE_BINS
+        );
+        _filters_median_kernel_histogram_slide(
+            coarse,
+            &coarse_columns[incoming * FILTERS_MEDIAN_COARSE_BINS],
+            &coarse_columns[outgoing * FILTERS_MEDIAN_COARSE_BINS],
+            FILTERS_MEDIAN_COARSE_BINS
         );
+    }
+}
 
-#else
-#error "Unsupported processor architecture"
-#endif
+/* Gaussian Blur */
+
+static inline void filters_gaussian_init(
+                       filters_gaussian_t *gaussian,
+                       float sigma
+                   )
+{
+    sigma =
+        UTILS_CLAMP(sigma, FILTERS_GAUSSIAN_MIN_SIGMA, FILTERS_GAUSSIAN_MAX_SIGMA);
+
+    gaussian->sigma =
+        sigma;
+    gaussian->box =
+        sigma >= FILTERS_GAUSSIAN_BOX_MIN_SIGMA;
+
+    if (!gaussian->box) {
+        size_t radius =
+            (size_t) ceilf(3.0f * sigma);
+        radius =
+            UTILS_MIN(radius, FILTERS_GAUSSIAN_MAX_KERNEL_RADIUS);
+
+        float samples[2 * FILTERS_GAUSSIAN_MAX_KERNEL_RADIUS + 1];
+        float total =
+            0.0f;
+        for (size_t i = 0; i < 2 * radius + 1; ++i) {
+            float distance =
+                (float) i - (float) radius;
+            samples[i] =
+                expf(-distance * distance / (2.0f * sigma * sigma));
+            total +=
+                samples[i];
+        }
+
+        /* The center weight takes the rounding error, so that the weights sum up to one */
+        int32_t center =
+            1 << FILTERS_GAUSSIAN_WEIGHT_SHIFT;
+        for (size_t i = 0; i < 2 * radius + 1; ++i) {
+            if (radius != i) {
+                gaussian->weights[i] =
+                    (int16_t) lrintf(samples[i] / total * (float) (1 << FILTERS_GAUSSIAN_WEIGHT_SHIFT));
+                center -=
+                    gaussian->weights[i];
+            }
+        }
+        gaussian->weights[radius] =
+            (int16_t) UTILS_MIN(center, INT16_MAX);
+
+        gaussian->kernel_radius =
+            radius;
+        gaussian->radius =
+            radius;
+    } else {
+        /*
+            Box widths whose repeated application has the variance of the
+            Gaussian, `passes` of them are `lower` wide and the rest two
+            pixels wider.
+        */
+        float passes =
+            (float) FILTERS_GAUSSIAN_BOX_PASSES;
+        float ideal_width =
+            sqrtf(12.0f * sigma * sigma / passes + 1.0f);
+        int lower =
+            (int) floorf(ideal_width);
+        if (0 == lower % 2) {
+            --lower;
+        }
+        int lower_count =
+            (int) lrintf(
+                      (12.0f * sigma * sigma - passes * (float) (lower * lower) -
+                          4.0f * passes * (float) lower - 3.0f * passes) /
+                      (-4.0f * (float) lower - 4.0f)
+                  );
+
+        gaussian->kernel_radius =
+            0;
+        gaussian->radius =
+            0;
+        for (int i = 0; i < FILTERS_GAUSSIAN_BOX_PASSES; ++i) {
+            size_t width =
+                (size_t) (i < lower_count ? lower : lower + 2);
+
+            gaussian->box_radii[i] =
+                width / 2;
+            gaussian->box_multipliers[i] =
+                (uint32_t) (((1u << FILTERS_GAUSSIAN_BOX_SHIFT) + width / 2) / width);
+            gaussian->radius +=
+                width / 2;
+        }
+    }
+}
+
+static inline size_t filters_gaussian_padded_row_size(
+                         const filters_gaussian_t *gaussian,
+                         size_t width
+                     )
+{
+    /* The box running sum reads one pixel past the padding */
+    return (width + 2 * gaussian->radius) * 4 + 64;
+}
+
+/* Copies the row after `radius` replicas of its first pixel and before as many of its last one */
+static inline void _filters_gaussian_pad_row(
+                       const uint8_t *row,
+                       uint8_t *padded_row,
+                       size_t width,
+                       size_t radius
+                   )
+{
+    memcpy(&padded_row[radius * 4], row, width * 4);
+    for (size_t i = 0; i < radius; ++i) {
+        memcpy(&padded_row[i * 4], row, 4);
+        memcpy(&padded_row[(radius + width + i) * 4], &row[(width - 1) * 4], 4);
+    }
+}
+
+/*
+    destination[i] = sum(weights[k] * taps[k][i]) for `count` channels.
+
+    The taps are the shifted padded row for the horizontal pass and the
+    source rows for the vertical one. The C path does the same fixed-point
+    arithmetic as `vpmulhrsw`, so all the implementations agree exactly.
+*/
+static inline void _filters_gaussian_convolve(
+                       const int16_t *weights,
+                       size_t taps_count,
+                       const uint8_t **taps,
+                       uint8_t *destination,
+                       size_t count
+                   )
+{
+    size_t i = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    const __m512i rounding =
+        _mm512_set1_epi16(1 << (FILTERS_GAUSSIAN_ACCUMULATOR_SHIFT - 1));
+
+    for (; i + 32 <= count; i += 32) {
+        __m512i sum =
+            _mm512_setzero_si512();
+        for (size_t k = 0; k < taps_count; ++k) {
+            __m512i channels =
+                _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) &taps[k][i]));
+            channels =
+                _mm512_slli_epi16(channels, FILTERS_GAUSSIAN_ACCUMULATOR_SHIFT);
+            sum =
+                _mm512_add_epi16(sum, _mm512_mulhrs_epi16(channels, _mm512_set1_epi16(weights[k])));
+        }
+
+        sum =
+            _mm512_srli_epi16(_mm512_add_epi16(sum, rounding), FILTERS_GAUSSIAN_ACCUMULATOR_SHIFT);
+        _mm256_storeu_si256((__m256i *) &destination[i], _mm512_cvtusepi16_epi8(sum));
+    }
 
 #endif
 
-        uint8_t median =
-            window_size % 2 == 0 ?
-                (uint8_t) ((window[window_center - 1] + window[window_center]) * 0.5) :
-                (uint8_t) window[window_center];
+    for (; i < count; ++i) {
+        uint32_t sum =
+            0;
+        for (size_t k = 0; k < taps_count; ++k) {
+            int32_t product =
+                ((int32_t) taps[k][i] << FILTERS_GAUSSIAN_ACCUMULATOR_SHIFT) * weights[k];
+            sum +=
+                (uint32_t) ((product + (1 << (FILTERS_GAUSSIAN_WEIGHT_SHIFT - 1))) >> FILTERS_GAUSSIAN_WEIGHT_SHIFT);
+        }
 
-        destination_pixels[position + channel] =
-            median;
+        sum =
+            (sum + (1 << (FILTERS_GAUSSIAN_ACCUMULATOR_SHIFT - 1))) >> FILTERS_GAUSSIAN_ACCUMULATOR_SHIFT;
+        destination[i] =
+            (uint8_t) UTILS_MIN(sum, 255);
     }
 }
 
+/* A box blur of the padded row with a running sum of every channel */
+static inline void _filters_gaussian_box_row(
+                       const uint8_t *padded_row,
+                       uint8_t *destination_row,
+                       size_t width,
+                       size_t radius,
+                       uint32_t multiplier
+                   )
+{
+    const uint32_t rounding =
+        1u << (FILTERS_GAUSSIAN_BOX_SHIFT - 1);
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    /* The four channels of a pixel share one vector of 32-bit sums */
+    const __m128i multipliers =
+        _mm_set1_epi32((int32_t) multiplier);
+    const __m128i roundings =
+        _mm_set1_epi32((int32_t) rounding);
+
+    __m128i sums =
+        _mm_setzero_si128();
+    for (size_t k = 0; k < 2 * radius + 1; ++k) {
+        sums =
+            _mm_add_epi32(sums, _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int32_t *) &padded_row[k * 4])));
+    }
+
+    for (size_t x = 0; x < width; ++x) {
+        __m128i channels =
+            _mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(sums, multipliers), roundings), FILTERS_GAUSSIAN_BOX_SHIFT);
+        channels =
+            _mm_packus_epi16(_mm_packus_epi32(channels, channels), channels);
+        *(int32_t *) &destination_row[x * 4] =
+            _mm_cvtsi128_si32(channels);
+
+        sums =
+            _mm_add_epi32(
+                sums,
+                _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int32_t *) &padded_row[(x + 2 * radius + 1) * 4]))
+            );
+        sums =
+            _mm_sub_epi32(
+                sums,
+                _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int32_t *) &padded_row[x * 4]))
+            );
+    }
+
+#else
+
+    uint32_t sums[4] = { 0 };
+    for (size_t k = 0; k < 2 * radius + 1; ++k) {
+        for (size_t channel = 0; channel < 4; ++channel) {
+            sums[channel] +=
+                padded_row[k * 4 + channel];
+        }
+    }
+
+    for (size_t x = 0; x < width; ++x) {
+        for (size_t channel = 0; channel < 4; ++channel) {
+            destination_row[x * 4 + channel] =
+                (uint8_t) ((sums[channel] * multiplier + rounding) >> FILTERS_GAUSSIAN_BOX_SHIFT);
+            sums[channel] +=
+                (uint32_t) padded_row[(x + 2 * radius + 1) * 4 + channel] -
+                    (uint32_t) padded_row[x * 4 + channel];
+        }
+    }
+
+#endif
+}
+
+/*
+    A vertical box blur of `count` channels of the rows from `y_start` to
+    `y_end`. Both buffers hold consecutive image rows starting from their
+    `first_row`, rows above and below the image are replicated from its
+    edges.
+*/
+static inline void _filters_gaussian_box_columns(
+                       const uint8_t *source,
+                       size_t source_stride,
+                       size_t source_first_row,
+                       uint8_t *destination,
+                       size_t destination_stride,
+                       size_t destination_first_row,
+                       size_t count,
+                       size_t height,
+                       size_t y_start,
+                       size_t y_end,
+                       size_t radius,
+                       uint32_t multiplier,
+                       uint32_t *sums
+                   )
+{
+#define FILTERS_GAUSSIAN_SOURCE_ROW(Y)                                                   \
+    (&source[                                                                            \
+        ((size_t) UTILS_CLAMP((ssize_t) (Y), 0, (ssize_t) height - 1) - source_first_row) * \
+            source_stride                                                                \
+    ])
+
+    const uint32_t rounding =
+        1u << (FILTERS_GAUSSIAN_BOX_SHIFT - 1);
+
+    memset(sums, 0, count * sizeof(*sums));
+    for (ssize_t k = -(ssize_t) radius; k <= (ssize_t) radius; ++k) {
+        const uint8_t *row =
+            FILTERS_GAUSSIAN_SOURCE_ROW((ssize_t) y_start + k);
+        for (size_t i = 0; i < count; ++i) {
+            sums[i] +=
+                row[i];
+        }
+    }
+
+    for (size_t y = y_start; y < y_end; ++y) {
+        uint8_t *destination_row =
+            &destination[(y - destination_first_row) * destination_stride];
+        const uint8_t *outgoing_row =
+            FILTERS_GAUSSIAN_SOURCE_ROW((ssize_t) y - (ssize_t) radius);
+
+        /* The row after the last one may not be in the source buffer */
+        const uint8_t *incoming_row =
+            y + 1 < y_end ?
+                FILTERS_GAUSSIAN_SOURCE_ROW(y + radius + 1) :
+                outgoing_row;
+
+        size_t i = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+        const __m512i multipliers =
+            _mm512_set1_epi32((int32_t) multiplier);
+        const __m512i roundings =
+            _mm512_set1_epi32((int32_t) rounding);
+
+        for (; i + 16 <= count; i += 16) {
+            __m512i column_sums =
+                _mm512_loadu_si512((const void *) &sums[i]);
+
+            __m512i channels =
+                _mm512_srli_epi32(
+                    _mm512_add_epi32(_mm512_mullo_epi32(column_sums, multipliers), roundings),
+                    FILTERS_GAUSSIAN_BOX_SHIFT
+                );
+            _mm_storeu_si128((__m128i *) &destination_row[i], _mm512_cvtepi32_epi8(channels));
+
+            column_sums =
+                _mm512_add_epi32(column_sums, _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) &incoming_row[i])));
+            column_sums =
+                _mm512_sub_epi32(column_sums, _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) &outgoing_row[i])));
+            _mm512_storeu_si512((void *) &sums[i], column_sums);
+        }
+
+#endif
+
+        for (; i < count; ++i) {
+            destination_row[i] =
+                (uint8_t) ((sums[i] * multiplier + rounding) >> FILTERS_GAUSSIAN_BOX_SHIFT);
+            sums[i] +=
+                (uint32_t) incoming_row[i] - (uint32_t) outgoing_row[i];
+        }
+    }
+
+#undef FILTERS_GAUSSIAN_SOURCE_ROW
+}
+
+/*
+    The horizontal pass of one row. `destination_row` may be the same as
+    `source_row`, `padded_row` needs `filters_gaussian_padded_row_size`
+    bytes.
+*/
+static inline void filters_apply_gaussian_horizontal(
+                       const filters_gaussian_t *gaussian,
+                       const uint8_t *source_row,
+                       uint8_t *destination_row,
+                       size_t width,
+                       uint8_t *padded_row
+                   )
+{
+    if (!gaussian->box) {
+        size_t radius =
+            gaussian->kernel_radius;
+
+        _filters_gaussian_pad_row(source_row, padded_row, width, radius);
+
+        const uint8_t *taps[2 * FILTERS_GAUSSIAN_MAX_KERNEL_RADIUS + 1];
+        for (size_t k = 0; k < 2 * radius + 1; ++k) {
+            taps[k] =
+                &padded_row[k * 4];
+        }
+
+        _filters_gaussian_convolve(
+            gaussian->weights, 2 * radius + 1,
+            taps,
+            destination_row,
+            width * 4
+        );
+    } else {
+        const uint8_t *row =
+            source_row;
+        for (size_t pass = 0; pass < FILTERS_GAUSSIAN_BOX_PASSES; ++pass) {
+            _filters_gaussian_pad_row(row, padded_row, width, gaussian->box_radii[pass]);
+            _filters_gaussian_box_row(
+                padded_row,
+                destination_row,
+                width,
+                gaussian->box_radii[pass],
+                gaussian->box_multipliers[pass]
+            );
+
+            row =
+                destination_row;
+        }
+    }
+}
+
+/*
+    The vertical pass of the image rows from `y_start` to `y_end` into
+    `destination_pixels`.
+
+    `rows` holds the horizontally filtered image rows from `first_row` on,
+    `radius` rows around the processed ones unless they are outside of the
+    image. The box passes use it as scratch space. The columns are processed
+    in strips of `FILTERS_GAUSSIAN_COLUMN_BLOCK` bytes, so that the rows of
+    the window stay in the cache while it slides down. For the box blur
+    `strip` needs `FILTERS_GAUSSIAN_COLUMN_BLOCK` bytes for every row of
+    `rows` and `sums` `FILTERS_GAUSSIAN_COLUMN_BLOCK` counters.
+
+    With `unsharp_mask` the blurred rows of every strip go to `strip`
+    instead and sharpen the destination, which still holds the source rows,
+    so that no more than a strip of the blur exists at a time.
+*/
+static inline void filters_apply_gaussian_vertical(
+                       const filters_gaussian_t *gaussian,
+                       uint8_t *rows,
+                       size_t first_row,
+                       uint8_t *destination_pixels,
+                       size_t width,
+                       size_t height,
+                       size_t y_start,
+                       size_t y_end,
+                       uint8_t *strip,
+                       uint32_t *sums,
+                       const filters_unsharp_mask_t *unsharp_mask
+                   )
+{
+    size_t stride =
+        width * 4;
+
+    for (size_t start = 0; start < stride; start += FILTERS_GAUSSIAN_COLUMN_BLOCK) {
+        size_t count =
+            UTILS_MIN(FILTERS_GAUSSIAN_COLUMN_BLOCK, stride - start);
+
+        if (!gaussian->box) {
+            size_t radius =
+                gaussian->kernel_radius;
+
+            const uint8_t *taps[2 * FILTERS_GAUSSIAN_MAX_KERNEL_RADIUS + 1];
+            for (size_t y = y_start; y < y_end; ++y) {
+                for (size_t k = 0; k < 2 * radius + 1; ++k) {
+                    size_t source_y =
+                        (size_t) UTILS_CLAMP(
+                                     (ssize_t) y - (ssize_t) radius + (ssize_t) k,
+                                     0,
+                                     (ssize_t) height - 1
+                                 );
+
+                    taps[k] =
+                        &rows[(source_y - first_row) * stride + start];
+                }
+
+                _filters_gaussian_convolve(
+                    gaussian->weights, 2 * radius + 1,
+                    taps,
+                    NULL != unsharp_mask ? strip : &destination_pixels[y * stride + start],
+                    count
+                );
+
+                if (NULL != unsharp_mask) {
+                    filters_apply_unsharp_mask(unsharp_mask, strip, &destination_pixels[y * stride + start], count);
+                }
+            }
+        } else {
+            /*
+                Every pass produces the rows that the remaining passes still
+                need, the last one only the requested rows. The passes go
+                from `rows` to `strip`, back to `rows` and to the destination.
+            */
+            size_t margin =
+                gaussian->radius;
+            for (size_t pass = 0; pass < FILTERS_GAUSSIAN_BOX_PASSES; ++pass) {
+                margin -=
+                    gaussian->box_radii[pass];
+
+                size_t pass_start =
+                    y_start > margin ? y_start - margin : 0;
+                size_t pass_end =
+                    UTILS_MIN(y_end + margin, height);
+
+                const uint8_t *source;
+                size_t source_stride;
+                uint8_t *destination;
+                size_t destination_stride;
+                size_t destination_first_row;
+                if (1 == pass % 2) {
+                    source =
+                        strip;
+                    source_stride =
+                        FILTERS_GAUSSIAN_COLUMN_BLOCK;
+                } else {
+                    source =
+                        &rows[start];
+                    source_stride =
+                        stride;
+                }
+                if (FILTERS_GAUSSIAN_BOX_PASSES - 1 == pass && NULL == unsharp_mask) {
+                    destination =
+                        &destination_pixels[start];
+                    destination_stride =
+                        stride;
+                    destination_first_row =
+                        0;
+                } else if (0 == pass % 2) {
+                    destination =
+                        strip;
+                    destination_stride =
+                        FILTERS_GAUSSIAN_COLUMN_BLOCK;
+                    destination_first_row =
+                        first_row;
+                } else {
+                    destination =
+                        &rows[start];
+                    destination_stride =
+                        stride;
+                    destination_first_row =
+                        first_row;
+                }
+
+                _filters_gaussian_box_columns(
+                    source, source_stride, first_row,
+                    destination, destination_stride, destination_first_row,
+                    count,
+                    height,
+                    pass_start, pass_end,
+                    gaussian->box_radii[pass],
+                    gaussian->box_multipliers[pass],
+                    sums
+                );
+            }
+
+            if (NULL != unsharp_mask) {
+                for (size_t y = y_start; y < y_end; ++y) {
+                    filters_apply_unsharp_mask(
+                        unsharp_mask,
+                        &strip[(y - first_row) * FILTERS_GAUSSIAN_COLUMN_BLOCK],
+                        &destination_pixels[y * stride + start],
+                        count
+                    );
+                }
+            }
+        }
+    }
+}
+
+/* Unsharp Mask */
+
+static inline void filters_unsharp_mask_init(
+                       filters_unsharp_mask_t *unsharp_mask,
+                       float sigma,
+                       float amount,
+                       uint8_t threshold
+                   )
+{
+    filters_gaussian_init(&unsharp_mask->gaussian, sigma);
+
+    unsharp_mask->amount =
+        amount;
+    unsharp_mask->fixed_amount =
+        (int16_t) lrintf(amount * (float) (1 << FILTERS_UNSHARP_MASK_AMOUNT_SHIFT));
+    unsharp_mask->threshold =
+        threshold;
+}
+
+/*
+    Sharpens `count` channels of `pixels` with their `blurred` copies. The
+    scaled difference is rounded like `vpmulhrsw` does, with the difference
+    in Q5 and the amount in Q10, so both implementations agree exactly.
+*/
+static inline void filters_apply_unsharp_mask(
+                       const filters_unsharp_mask_t *unsharp_mask,
+                       const uint8_t *blurred,
+                       uint8_t *pixels,
+                       size_t count
+                   )
+{
+    int32_t amount =
+        unsharp_mask->fixed_amount;
+    int32_t threshold =
+        unsharp_mask->threshold;
+
+    size_t i = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    const __m512i amounts =
+        _mm512_set1_epi16((int16_t) amount);
+    const __m512i thresholds =
+        _mm512_set1_epi16((int16_t) threshold);
+    /* Every 4th channel from the start of a row is alpha */
+    const __mmask32 color_mask =
+        0x77777777u;
+
+    for (; i + 32 <= count; i += 32) {
+        __m512i channels =
+            _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) &pixels[i]));
+        __m512i blurred_channels =
+            _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) &blurred[i]));
+
+        __m512i differences =
+            _mm512_sub_epi16(channels, blurred_channels);
+        __mmask32 sharpened =
+            _mm512_mask_cmpge_epi16_mask(color_mask, _mm512_abs_epi16(differences), thresholds);
+
+        __m512i results =
+            _mm512_mask_add_epi16(
+                channels,
+                sharpened,
+                channels,
+                _mm512_mulhrs_epi16(_mm512_slli_epi16(differences, 5), amounts)
+            );
+
+        _mm256_storeu_si256(
+            (__m256i *) &pixels[i],
+            _mm512_cvtusepi16_epi8(_mm512_max_epi16(results, _mm512_setzero_si512()))
+        );
+    }
+
+#endif
+
+    for (; i < count; ++i) {
+        int32_t difference =
+            (int32_t) pixels[i] - (int32_t) blurred[i];
+
+        if (3 != i % 4 && abs(difference) >= threshold) {
+            pixels[i] =
+                (uint8_t) UTILS_CLAMP(
+                              (int32_t) pixels[i] + ((difference * 32 * amount + (1 << 14)) >> 15),
+                              0,
+                              255
+                          );
+        }
+    }
+}
+
+/* Convolution */
+
+static inline bool filters_convolution_init(
+                       filters_convolution_t *convolution,
+                       size_t width,
+                       size_t height,
+                       const float *weights,
+                       float bias
+                   )
+{
+    if (0 == width % 2 || FILTERS_CONVOLUTION_MAX_SIZE < width ||
+        0 == height % 2 || FILTERS_CONVOLUTION_MAX_SIZE < height) {
+        return false;
+    }
+
+    convolution->width =
+        width;
+    convolution->height =
+        height;
+    memcpy(convolution->weights, weights, width * height * sizeof(*weights));
+    convolution->bias =
+        bias;
+
+    return true;
+}
+
+static inline void filters_convolution_init_sharpen(filters_convolution_t *convolution)
+{
+    static const float weights[] = {
+         0.0f, -1.0f,  0.0f,
+        -1.0f,  5.0f, -1.0f,
+         0.0f, -1.0f,  0.0f
+    };
+
+    (void) filters_convolution_init(convolution, 3, 3, weights, 0.0f);
+}
+
+static inline void filters_convolution_init_emboss(filters_convolution_t *convolution)
+{
+    static const float weights[] = {
+        -2.0f, -1.0f,  0.0f,
+        -1.0f,  1.0f,  1.0f,
+         0.0f,  1.0f,  2.0f
+    };
+
+    (void) filters_convolution_init(convolution, 3, 3, weights, 0.0f);
+}
+
+static inline void filters_convolution_init_edge(filters_convolution_t *convolution)
+{
+    static const float weights[] = {
+        -1.0f, -1.0f, -1.0f,
+        -1.0f,  8.0f, -1.0f,
+        -1.0f, -1.0f, -1.0f
+    };
+
+    (void) filters_convolution_init(convolution, 3, 3, weights, 0.0f);
+}
+
+static inline void filters_convolution_init_blur(filters_convolution_t *convolution)
+{
+    /* The 5x5 binomial kernel */
+    static const float binomial[] = {
+        1.0f, 4.0f, 6.0f, 4.0f, 1.0f
+    };
+
+    float weights[5 * 5];
+    for (size_t y = 0; y < 5; ++y) {
+        for (size_t x = 0; x < 5; ++x) {
+            weights[y * 5 + x] =
+                binomial[y] * binomial[x] / 256.0f;
+        }
+    }
+
+    (void) filters_convolution_init(convolution, 5, 5, weights, 0.0f);
+}
+
+static inline void filters_convolution_init_motion_blur(filters_convolution_t *convolution)
+{
+    /* A 7x7 diagonal streak */
+    float weights[7 * 7] = { 0.0f };
+    for (size_t i = 0; i < 7; ++i) {
+        weights[i * 7 + i] =
+            1.0f / 7.0f;
+    }
+
+    (void) filters_convolution_init(convolution, 7, 7, weights, 0.0f);
+}
+
+static inline void _filters_convolve_pixel(
+                       const filters_convolution_t *convolution,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x,
+                       size_t width,
+                       bool clamp
+                   )
+{
+    size_t kernel_width =
+        convolution->width;
+    size_t kernel_height =
+        convolution->height;
+    ssize_t radius_x =
+        (ssize_t) kernel_width / 2;
+
+    float sums[3] = {
+        convolution->bias, convolution->bias, convolution->bias
+    };
+    for (size_t ky = 0; ky < kernel_height; ++ky) {
+        for (size_t kx = 0; kx < kernel_width; ++kx) {
+            ssize_t source_x =
+                (ssize_t) x + (ssize_t) kx - radius_x;
+            if (clamp) {
+                source_x =
+                    UTILS_CLAMP(source_x, 0, (ssize_t) width - 1);
+            }
+
+            const uint8_t *pixel =
+                &rows[ky][(size_t) source_x * 4];
+            float weight =
+                convolution->weights[ky * kernel_width + kx];
+            for (size_t channel = 0; channel < 3; ++channel) {
+                sums[channel] +=
+                    weight * (float) pixel[channel];
+            }
+        }
+    }
+
+    for (size_t channel = 0; channel < 3; ++channel) {
+        destination_row[x * 4 + channel] =
+            (uint8_t) UTILS_CLAMP(lrintf(sums[channel]), 0, 255);
+    }
+    destination_row[x * 4 + 3] =
+        rows[kernel_height / 2][x * 4 + 3];
+}
+
+/* The pixels from `x_start` to `x_end` near the left or right edge */
+static inline void filters_apply_convolution(
+                       const filters_convolution_t *convolution,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end,
+                       size_t width
+                   )
+{
+    for (size_t x = x_start; x < x_end; ++x) {
+        _filters_convolve_pixel(convolution, rows, destination_row, x, width, true);
+    }
+}
+
+/*
+    The interior pixels for a kernel of `kernel_width` by `kernel_height`.
+
+    It is always inlined, so that the specializations below that pass
+    constant sizes get their tap loops fully unrolled with the weights
+    broadcast once per block. Blocks of 16 pixels are accumulated in four
+    vectors of single precision sums, one pixel per 128-bit lane.
+*/
+static inline __attribute__((always_inline)) void _filters_convolve_interior(
+                                                       const filters_convolution_t *convolution,
+                                                       size_t kernel_width,
+                                                       size_t kernel_height,
+                                                       uint8_t **rows,
+                                                       uint8_t *destination_row,
+                                                       size_t x_start,
+                                                       size_t x_end
+                                                   )
+{
+    size_t x =
+        x_start;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    const size_t radius_x =
+        kernel_width / 2;
+    const __mmask64 alpha_mask =
+        0x8888888888888888ULL;
+
+    for (; x + 16 <= x_end; x += 16) {
+        __m512 sums[4];
+        for (size_t group = 0; group < 4; ++group) {
+            sums[group] =
+                _mm512_set1_ps(convolution->bias);
+        }
+
+        _Pragma("GCC unroll 15")
+        for (size_t ky = 0; ky < kernel_height; ++ky) {
+            const uint8_t *row =
+                &rows[ky][(x - radius_x) * 4];
+
+            _Pragma("GCC unroll 15")
+            for (size_t kx = 0; kx < kernel_width; ++kx) {
+                __m512 weight =
+                    _mm512_set1_ps(convolution->weights[ky * kernel_width + kx]);
+
+                _Pragma("GCC unroll 4")
+                for (size_t group = 0; group < 4; ++group) {
+                    __m512 channels =
+                        _mm512_cvtepi32_ps(
+                            _mm512_cvtepu8_epi32(
+                                _mm_loadu_si128((const __m128i *) &row[(kx + group * 4) * 4])
+                            )
+                        );
+                    sums[group] =
+                        _mm512_fmadd_ps(channels, weight, sums[group]);
+                }
+            }
+        }
+
+        __m512i result =
+            _mm512_setzero_si512();
+        for (size_t group = 0; group < 4; ++group) {
+            __m512i channels =
+                _mm512_max_epi32(_mm512_cvtps_epi32(sums[group]), _mm512_setzero_si512());
+            result =
+                _mm512_inserti32x4(result, _mm512_cvtusepi32_epi8(channels), 0);
+            result =
+                _mm512_alignr_epi32(result, result, 4);
+        }
+
+        __m512i center =
+            _mm512_loadu_si512((const void *) &rows[kernel_height / 2][x * 4]);
+        _mm512_storeu_si512(
+            (void *) &destination_row[x * 4],
+            _mm512_mask_blend_epi8(alpha_mask, result, center)
+        );
+    }
+
+#endif
+
+    for (; x < x_end; ++x) {
+        _filters_convolve_pixel(convolution, rows, destination_row, x, 0, false);
+    }
+}
+
+#define FILTERS_CONVOLUTION_DEFINE_INTERIOR(SIZE)                             \
+    static inline void _filters_convolve_interior_##SIZE##x##SIZE(            \
+                           const filters_convolution_t *convolution,          \
+                           uint8_t **rows,                                    \
+                           uint8_t *destination_row,                          \
+                           size_t x_start,                                    \
+                           size_t x_end                                       \
+                       )                                                      \
+    {                                                                         \
+        _filters_convolve_interior(                                           \
+            convolution, SIZE, SIZE,                                          \
+            rows, destination_row,                                            \
+            x_start, x_end                                                    \
+        );                                                                    \
+    }
+
+FILTERS_CONVOLUTION_DEFINE_INTERIOR(3)
+FILTERS_CONVOLUTION_DEFINE_INTERIOR(5)
+FILTERS_CONVOLUTION_DEFINE_INTERIOR(7)
+
+#undef FILTERS_CONVOLUTION_DEFINE_INTERIOR
+
+/* The pixels from `x_start` to `x_end` with all their neighbours inside of the image */
+static inline void filters_apply_convolution_interior(
+                       const filters_convolution_t *convolution,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end
+                   )
+{
+    size_t size =
+        convolution->width == convolution->height ? convolution->width : 0;
+
+    switch (size) {
+        case 3:
+            _filters_convolve_interior_3x3(convolution, rows, destination_row, x_start, x_end);
+            break;
+        case 5:
+            _filters_convolve_interior_5x5(convolution, rows, destination_row, x_start, x_end);
+            break;
+        case 7:
+            _filters_convolve_interior_7x7(convolution, rows, destination_row, x_start, x_end);
+            break;
+        default:
+            _filters_convolve_interior(
+                convolution,
+                convolution->width, convolution->height,
+                rows, destination_row,
+                x_start, x_end
+            );
+    }
+}
+
+/* Resampling */
+
+static inline double _filters_resize_kernel(int method, double x)
+{
+    x =
+        fabs(x);
+
+    switch (method) {
+        case FILTERS_RESIZE_BILINEAR:
+            return x < 1.0 ? 1.0 - x : 0.0;
+        case FILTERS_RESIZE_BICUBIC: {
+            /* Keys' cubic convolution with a = -0.5 */
+            const double a =
+                -0.5;
+
+            if (x < 1.0) {
+                return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+            } else if (x < 2.0) {
+                return ((a * x - 5.0 * a) * x + 8.0 * a) * x - 4.0 * a;
+            }
+
+            return 0.0;
+        }
+        case FILTERS_RESIZE_LANCZOS3: {
+            if (x < 1e-8) {
+                return 1.0;
+            } else if (x < 3.0) {
+                double pi_x =
+                    M_PI * x;
+
+                return 3.0 * sin(pi_x) * sin(pi_x / 3.0) / (pi_x * pi_x);
+            }
+
+            return 0.0;
+        }
+        default:
+            return 0.0;
+    }
+}
+
+static inline double _filters_resize_kernel_support(int method)
+{
+    switch (method) {
+        case FILTERS_RESIZE_BICUBIC:
+            return 2.0;
+        case FILTERS_RESIZE_LANCZOS3:
+            return 3.0;
+        default:
+            return 1.0;
+    }
+}
+
+/*
+    Precomputes the weights of one axis. When shrinking the kernel is
+    stretched over `source_size / size` source pixels, so that every source
+    pixel contributes. Windows are clamped to the image and shifted to the
+    left where they would cross its end, so the taps of every output
+    coordinate are inside of the source unless it is narrower than `taps`.
+*/
+static inline bool _filters_resize_axis_init(
+                       filters_resize_axis_t *axis,
+                       int method,
+                       size_t source_size,
+                       size_t size
+                   )
+{
+    double scale =
+        (double) source_size / (double) size;
+    double kernel_scale =
+        scale > 1.0 ? scale : 1.0;
+    double support =
+        _filters_resize_kernel_support(method) * kernel_scale;
+
+    size_t taps =
+        (size_t) ceil(support) * 2 + 1;
+    taps =
+        (taps + 3) / 4 * 4;
+
+    axis->taps =
+        taps;
+    axis->starts =
+        malloc(size * sizeof(*axis->starts));
+    axis->weights =
+        calloc(size * taps, sizeof(*axis->weights));
+    if (NULL == axis->starts || NULL == axis->weights) {
+        return false;
+    }
+
+    double window[taps];
+    for (size_t i = 0; i < size; ++i) {
+        double center =
+            ((double) i + 0.5) * scale;
+        ssize_t first =
+            (ssize_t) floor(center - support + 0.5);
+        ssize_t last =
+            (ssize_t) floor(center + support + 0.5);
+        first =
+            UTILS_MAX(first, 0);
+        last =
+            UTILS_MIN(last, (ssize_t) source_size);
+        last =
+            UTILS_MIN(last, first + (ssize_t) taps);
+
+        size_t start =
+            source_size > taps ?
+                UTILS_MIN((size_t) first, source_size - taps) :
+                0;
+
+        double total =
+            0.0;
+        for (ssize_t j = first; j < last; ++j) {
+            window[j - first] =
+                _filters_resize_kernel(method, ((double) j - center + 0.5) / kernel_scale);
+            total +=
+                window[j - first];
+        }
+
+        /* The largest weight takes the rounding error, so that flat areas stay flat */
+        int16_t *weights =
+            &axis->weights[i * taps + (size_t) first - start];
+        int32_t sum =
+            0;
+        ssize_t largest =
+            0;
+        for (ssize_t j = 0; j < last - first; ++j) {
+            weights[j] =
+                (int16_t) lround(window[j] / total * (double) (1 << FILTERS_RESIZE_WEIGHT_SHIFT));
+            sum +=
+                weights[j];
+            if (weights[j] > weights[largest]) {
+                largest =
+                    j;
+            }
+        }
+        weights[largest] +=
+            (int16_t) ((1 << FILTERS_RESIZE_WEIGHT_SHIFT) - sum);
+
+        axis->starts[i] =
+            start;
+    }
+
+    return true;
+}
+
+static inline void _filters_resize_axis_free(filters_resize_axis_t *axis)
+{
+    free(axis->starts);
+    free(axis->weights);
+}
+
+static inline filters_resize_t *filters_resize_create(
+                                     int method,
+                                     size_t source_width,
+                                     size_t source_height,
+                                     size_t width,
+                                     size_t height
+                                 )
+{
+    filters_resize_t *resize =
+        calloc(1, sizeof(*resize));
+
+    if (NULL == resize) {
+        return resize;
+    }
+
+    resize->method =
+        method;
+    resize->source_width =
+        source_width;
+    resize->source_height =
+        source_height;
+    resize->width =
+        width;
+    resize->height =
+        height;
+
+    if (!_filters_resize_axis_init(&resize->horizontal, method, source_width, width) ||
+        !_filters_resize_axis_init(&resize->vertical, method, source_height, height)) {
+        filters_resize_destroy(resize);
+
+        return NULL;
+    }
+
+    return resize;
+}
+
+static inline void filters_resize_destroy(
+                       filters_resize_t *resize
+                   )
+{
+    if (NULL != resize) {
+        _filters_resize_axis_free(&resize->horizontal);
+        _filters_resize_axis_free(&resize->vertical);
+        free(resize);
+    }
+}
+
+/* Resamples a source row to `resize->width` pixels */
+static inline void filters_apply_resize_horizontal(
+                       const filters_resize_t *resize,
+                       const uint8_t *source_row,
+                       uint8_t *destination_row
+                   )
+{
+    size_t taps =
+        resize->horizontal.taps;
+    size_t source_width =
+        resize->source_width;
+    const int32_t rounding =
+        1 << (FILTERS_RESIZE_WEIGHT_SHIFT - 1);
+
+    for (size_t x = 0; x < resize->width; ++x) {
+        size_t start =
+            resize->horizontal.starts[x];
+        const int16_t *weights =
+            &resize->horizontal.weights[x * taps];
+        const uint8_t *pixels =
+            &source_row[start * 4];
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+        if (start + taps <= source_width) {
+            /*
+                Four taps per step: the bytes of pixel pairs are interleaved
+                per channel, widened to 16 bits and multiplied with the
+                matching weight pairs by `vpmaddwd`. The low lane sums the
+                first pair, the high lane the second one.
+            */
+            const __m128i pairs_shuffle =
+                _mm_set_epi8(
+                    15, 11, 14, 10, 13, 9, 12, 8,
+                     7,  3,  6,  2,  5, 1,  4, 0
+                );
+            const __m256i weights_permutation =
+                _mm256_set_epi32(1, 1, 1, 1, 0, 0, 0, 0);
+
+            __m256i sums =
+                _mm256_setzero_si256();
+            for (size_t k = 0; k < taps; k += 4) {
+                __m256i channels =
+                    _mm256_cvtepu8_epi16(
+                        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) &pixels[k * 4]), pairs_shuffle)
+                    );
+                __m256i weight_pairs =
+                    _mm256_permutevar8x32_epi32(
+                        _mm256_set1_epi64x(*(const int64_t *) &weights[k]),
+                        weights_permutation
+                    );
+                sums =
+                    _mm256_add_epi32(sums, _mm256_madd_epi16(channels, weight_pairs));
+            }
+
+            __m128i pixel =
+                _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+            pixel =
+                _mm_srai_epi32(_mm_add_epi32(pixel, _mm_set1_epi32(rounding)), FILTERS_RESIZE_WEIGHT_SHIFT);
+            pixel =
+                _mm_packus_epi16(_mm_packs_epi32(pixel, pixel), pixel);
+
+            *(int32_t *) &destination_row[x * 4] =
+                _mm_cvtsi128_si32(pixel);
+
+            continue;
+        }
+
+#endif
+
+        size_t valid_taps =
+            UTILS_MIN(taps, source_width - start);
+        for (size_t channel = 0; channel < 4; ++channel) {
+            int32_t sum =
+                rounding;
+            for (size_t k = 0; k < valid_taps; ++k) {
+                sum +=
+                    weights[k] * (int32_t) pixels[k * 4 + channel];
+            }
+
+            destination_row[x * 4 + channel] =
+                (uint8_t) UTILS_CLAMP(sum >> FILTERS_RESIZE_WEIGHT_SHIFT, 0, 255);
+        }
+    }
+}
+
+/*
+    Computes the output row `y` from the horizontally resampled `rows`, that
+    hold consecutive source rows from `first_row` on.
+*/
+static inline void filters_apply_resize_vertical(
+                       const filters_resize_t *resize,
+                       const uint8_t *rows,
+                       size_t first_row,
+                       uint8_t *destination_row,
+                       size_t y
+                   )
+{
+    size_t taps =
+        resize->vertical.taps;
+    size_t start =
+        resize->vertical.starts[y];
+    const int16_t *weights =
+        &resize->vertical.weights[y * taps];
+    size_t stride =
+        resize->width * 4;
+    const int32_t rounding =
+        1 << (FILTERS_RESIZE_WEIGHT_SHIFT - 1);
+
+    /* Taps past the bottom of a short source have zero weights and reuse its last row */
+    const uint8_t *taps_rows[taps];
+    for (size_t k = 0; k < taps; ++k) {
+        taps_rows[k] =
+            &rows[(UTILS_MIN(start + k, resize->source_height - 1) - first_row) * stride];
+    }
+
+    size_t i = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    /*
+        Two rows per step. Their channels are interleaved by 16-bit unpacks,
+        so that `vpmaddwd` sums a tap pair in every 32-bit lane. The packing
+        at the end undoes the interleaving of the unpacks.
+    */
+    for (; i + 32 <= stride; i += 32) {
+        __m512i low_sums =
+            _mm512_set1_epi32(rounding);
+        __m512i high_sums =
+            low_sums;
+        for (size_t k = 0; k < taps; k += 2) {
+            __m512i first =
+                _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) &taps_rows[k][i]));
+            __m512i second =
+                _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) &taps_rows[k + 1][i]));
+            __m512i weight_pair =
+                _mm512_set1_epi32(*(const int32_t *) &weights[k]);
+
+            low_sums =
+                _mm512_add_epi32(low_sums, _mm512_madd_epi16(_mm512_unpacklo_epi16(first, second), weight_pair));
+            high_sums =
+                _mm512_add_epi32(high_sums, _mm512_madd_epi16(_mm512_unpackhi_epi16(first, second), weight_pair));
+        }
+
+        __m512i channels =
+            _mm512_packs_epi32(
+                _mm512_srai_epi32(low_sums, FILTERS_RESIZE_WEIGHT_SHIFT),
+                _mm512_srai_epi32(high_sums, FILTERS_RESIZE_WEIGHT_SHIFT)
+            );
+        channels =
+            _mm512_max_epi16(channels, _mm512_setzero_si512());
+
+        _mm256_storeu_si256((__m256i *) &destination_row[i], _mm512_cvtusepi16_epi8(channels));
+    }
+
+#endif
+
+    for (; i < stride; ++i) {
+        int32_t sum =
+            rounding;
+        for (size_t k = 0; k < taps; ++k) {
+            sum +=
+                weights[k] * (int32_t) taps_rows[k][i];
+        }
+
+        destination_row[i] =
+            (uint8_t) UTILS_CLAMP(sum >> FILTERS_RESIZE_WEIGHT_SHIFT, 0, 255);
+    }
+}
+
+/* Histograms and Lookup Tables */
+
+/*
+    Counts the channel values of the pixels from the channel `start` to
+    `end`. Consecutive pixels go to four separate sets of counters, so
+    that runs of equal values do not stall every increment on the store
+    of the previous one.
+*/
+static inline void filters_accumulate_histogram(
+                       const uint8_t *pixels,
+                       size_t start,
+                       size_t end,
+                       filters_histogram_t *histogram
+                   )
+{
+    uint32_t counts[4][3][256];
+    memset(counts, 0, sizeof(counts));
+
+    size_t position = start;
+    for (; position + 16 <= end; position += 16) {
+        for (size_t set = 0; set < 4; ++set) {
+            const uint8_t *pixel =
+                &pixels[position + set * 4];
+
+            ++counts[set][0][pixel[0]];
+            ++counts[set][1][pixel[1]];
+            ++counts[set][2][pixel[2]];
+        }
+    }
+
+    for (; position < end; position += 4) {
+        ++counts[0][0][pixels[position]];
+        ++counts[0][1][pixels[position + 1]];
+        ++counts[0][2][pixels[position + 2]];
+    }
+
+    for (size_t channel = 0; channel < 3; ++channel) {
+        for (size_t value = 0; value < 256; ++value) {
+            histogram->counts[channel][value] +=
+                (uint64_t) counts[0][channel][value] + counts[1][channel][value] +
+                    counts[2][channel][value] + counts[3][channel][value];
+        }
+    }
+}
+
+static inline void filters_merge_histograms(
+                       filters_histogram_t *histogram,
+                       const filters_histogram_t *other
+                   )
+{
+    for (size_t channel = 0; channel < 3; ++channel) {
+        for (size_t value = 0; value < 256; ++value) {
+            histogram->counts[channel][value] +=
+                other->counts[channel][value];
+        }
+    }
+}
+
+static inline void _filters_lut_init_identity(uint8_t *values)
+{
+    for (size_t value = 0; value < 256; ++value) {
+        values[value] =
+            (uint8_t) value;
+    }
+}
+
+/*
+    Stretches every channel linearly so that the `clip` share of its
+    darkest values becomes 0 and the one of its brightest values 255.
+*/
+static inline void filters_lut_init_auto_levels(
+                       filters_lut_t *lut,
+                       const filters_histogram_t *histogram,
+                       float clip
+                   )
+{
+    for (size_t channel = 0; channel < 3; ++channel) {
+        const uint64_t *counts =
+            histogram->counts[channel];
+        uint8_t *values =
+            lut->values[channel];
+
+        uint64_t total =
+            0;
+        for (size_t value = 0; value < 256; ++value) {
+            total +=
+                counts[value];
+        }
+
+        uint64_t clipped =
+            (uint64_t) ((double) clip * (double) total);
+
+        size_t low = 0;
+        for (uint64_t sum = counts[0]; low < 255 && sum <= clipped; sum += counts[++low]) { }
+
+        size_t high = 255;
+        for (uint64_t sum = counts[255]; high > 0 && sum <= clipped; sum += counts[--high]) { }
+
+        if (high <= low) {
+            _filters_lut_init_identity(values);
+
+            continue;
+        }
+
+        /* Integer arithmetic rounds the halves exactly */
+        size_t range =
+            high - low;
+        for (size_t value = 0; value < 256; ++value) {
+            size_t level =
+                UTILS_CLAMP(value, low, high) - low;
+
+            values[value] =
+                (uint8_t) ((level * 255 * 2 + range) / (range * 2));
+        }
+    }
+}
+
+/* Maps every channel through its cumulative distribution, flattening its histogram */
+static inline void filters_lut_init_equalize(
+                       filters_lut_t *lut,
+                       const filters_histogram_t *histogram
+                   )
+{
+    for (size_t channel = 0; channel < 3; ++channel) {
+        const uint64_t *counts =
+            histogram->counts[channel];
+        uint8_t *values =
+            lut->values[channel];
+
+        uint64_t cumulative[256];
+        uint64_t total =
+            0;
+        for (size_t value = 0; value < 256; ++value) {
+            total +=
+                counts[value];
+            cumulative[value] =
+                total;
+        }
+
+        /* The darkest value present maps to 0 */
+        size_t first = 0;
+        for (; first < 255 && 0 == counts[first]; ++first) { }
+
+        uint64_t minimum =
+            cumulative[first];
+        if (total == minimum) {
+            _filters_lut_init_identity(values);
+
+            continue;
+        }
+
+        uint64_t range =
+            total - minimum;
+        for (size_t value = 0; value < 256; ++value) {
+            values[value] =
+                value < first ?
+                    0 :
+                    (uint8_t) (((cumulative[value] - minimum) * 255 * 2 + range) / (range * 2));
+        }
+    }
+}
+
+static inline void filters_lut_prepare(filters_lut_t *lut)
+{
+    for (size_t channel = 0; channel < 3; ++channel) {
+        for (size_t value = 0; value < 256; ++value) {
+            lut->shifted[channel][value] =
+                (uint32_t) lut->values[channel][value] << (channel * 8);
+        }
+    }
+}
+
+static inline void filters_apply_lut(
+                       uint8_t *pixels,
+                       size_t position,
+                       const filters_lut_t *lut
+                   )
+{
+#if !defined FILTERS_C_IMPLEMENTATION &&     \
+    !defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#define FILTERS_C_IMPLEMENTATION 1
+#endif
+
+#if defined FILTERS_C_IMPLEMENTATION
+
+    pixels[position] =
+        lut->values[0][pixels[position]];
+    pixels[position + 1] =
+        lut->values[1][pixels[position + 1]];
+    pixels[position + 2] =
+        lut->values[2][pixels[position + 2]];
+
+#elif defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    /*
+        Process 16 pixels at the same time. Every channel is looked up by
+        one gather from its shifted table, so the results only need to be
+        or-ed into the alpha channels.
+    */
+    __m512i source =
+        _mm512_loadu_si512((const void *) &pixels[position]);
+    __m512i channel_mask =
+        _mm512_set1_epi32(0xff);
+
+    __m512i result =
+        _mm512_andnot_si512(_mm512_set1_epi32(0x00ffffff), source);
+    result =
+        _mm512_or_si512(
+            result,
+            _mm512_i32gather_epi32(_mm512_and_si512(source, channel_mask), lut->shifted[0], 4)
+        );
+    result =
+        _mm512_or_si512(
+            result,
+            _mm512_i32gather_epi32(
+                _mm512_and_si512(_mm512_srli_epi32(source, 8), channel_mask),
+                lut->shifted[1],
+                4
+            )
+        );
+    result =
+        _mm512_or_si512(
+            result,
+            _mm512_i32gather_epi32(
+                _mm512_and_si512(_mm512_srli_epi32(source, 16), channel_mask),
+                lut->shifted[2],
+                4
+            )
+        );
+
+    _mm512_storeu_si512((void *) &pixels[position], result);
+
+#endif
+}
+
+/* Rotations and Flips */
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+/*
+    Transposes 16 rows of 16 pixels in registers: 32-bit and 64-bit unpacks
+    transpose the 4 by 4 blocks within the 128-bit lanes, two rounds of lane
+    shuffles then gather the blocks of every output row.
+*/
+static inline void _filters_transpose_tile(__m512i rows[16])
+{
+    __m512i pairs[16], quads[16];
+
+    for (size_t i = 0; i < 16; i += 2) {
+        pairs[i] =
+            _mm512_unpacklo_epi32(rows[i], rows[i + 1]);
+        pairs[i + 1] =
+            _mm512_unpackhi_epi32(rows[i], rows[i + 1]);
+    }
+
+    /* `quads[4 * g + k]` holds the columns `4 * lane + k` of the rows from `4 * g` */
+    for (size_t g = 0; g < 16; g += 4) {
+        quads[g] =
+            _mm512_unpacklo_epi64(pairs[g], pairs[g + 2]);
+        quads[g + 1] =
+            _mm512_unpackhi_epi64(pairs[g], pairs[g + 2]);
+        quads[g + 2] =
+            _mm512_unpacklo_epi64(pairs[g + 1], pairs[g + 3]);
+        quads[g + 3] =
+            _mm512_unpackhi_epi64(pairs[g + 1], pairs[g + 3]);
+    }
+
+    for (size_t k = 0; k < 4; ++k) {
+        __m512i low_first =
+            _mm512_shuffle_i32x4(quads[k], quads[4 + k], 0x44);
+        __m512i low_second =
+            _mm512_shuffle_i32x4(quads[8 + k], quads[12 + k], 0x44);
+        __m512i high_first =
+            _mm512_shuffle_i32x4(quads[k], quads[4 + k], 0xee);
+        __m512i high_second =
+            _mm512_shuffle_i32x4(quads[8 + k], quads[12 + k], 0xee);
+
+        rows[k] =
+            _mm512_shuffle_i32x4(low_first, low_second, 0x88);
+        rows[4 + k] =
+            _mm512_shuffle_i32x4(low_first, low_second, 0xdd);
+        rows[8 + k] =
+            _mm512_shuffle_i32x4(high_first, high_second, 0x88);
+        rows[12 + k] =
+            _mm512_shuffle_i32x4(high_first, high_second, 0xdd);
+    }
+}
+
+#endif
+
+/* Writes the pixels of `source_row` to `destination_row` in reverse order */
+static inline void _filters_reverse_row(
+                       const uint8_t *source_row,
+                       uint8_t *destination_row,
+                       size_t width
+                   )
+{
+    const uint32_t *source =
+        (const uint32_t *) source_row;
+    uint32_t *destination =
+        (uint32_t *) destination_row;
+
+    size_t x = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    const __m512i reverse =
+        _mm512_set_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    for (; x + 16 <= width; x += 16) {
+        _mm512_storeu_si512(
+            (void *) &destination[x],
+            _mm512_permutexvar_epi32(reverse, _mm512_loadu_si512((const void *) &source[width - 16 - x]))
+        );
+    }
+
+#endif
+
+    for (; x < width; ++x) {
+        destination[x] =
+            source[width - 1 - x];
+    }
+}
+
+/*
+    Writes the destination rows from `y_start` to `y_end`. Rotations by 90
+    and 270 degrees walk the destination in tiles of 16 by 16 pixels, so
+    that both the rows read and the rows written stay in the cache and in
+    the TLB while a tile is transposed.
+*/
+static inline void filters_apply_transform(
+                       const uint8_t *source_pixels,
+                       uint8_t *destination_pixels,
+                       size_t source_width,
+                       size_t source_height,
+                       int transform,
+                       size_t y_start,
+                       size_t y_end
+                   )
+{
+    const uint32_t *source =
+        (const uint32_t *) source_pixels;
+    uint32_t *destination =
+        (uint32_t *) destination_pixels;
+
+    if (FILTERS_TRANSFORM_FLIP_VERTICAL == transform) {
+        for (size_t y = y_start; y < y_end; ++y) {
+            memcpy(
+                &destination[y * source_width],
+                &source[(source_height - 1 - y) * source_width],
+                source_width * 4
+            );
+        }
+
+        return;
+    }
+
+    if (FILTERS_TRANSFORM_ROTATE_180 == transform || FILTERS_TRANSFORM_FLIP_HORIZONTAL == transform) {
+        for (size_t y = y_start; y < y_end; ++y) {
+            size_t source_y =
+                FILTERS_TRANSFORM_ROTATE_180 == transform ? source_height - 1 - y : y;
+
+            _filters_reverse_row(
+                (const uint8_t *) &source[source_y * source_width],
+                (uint8_t *) &destination[y * source_width],
+                source_width
+            );
+        }
+
+        return;
+    }
+
+    bool clockwise =
+        FILTERS_TRANSFORM_ROTATE_90 == transform;
+
+    /* The destination is `source_height` pixels wide */
+    size_t width =
+        source_height;
+
+    for (size_t tile_y = y_start; tile_y < y_end; tile_y += FILTERS_TRANSFORM_TILE) {
+        size_t tile_height =
+            UTILS_MIN(FILTERS_TRANSFORM_TILE, y_end - tile_y);
+
+        for (size_t tile_x = 0; tile_x < width; tile_x += FILTERS_TRANSFORM_TILE) {
+            size_t tile_width =
+                UTILS_MIN(FILTERS_TRANSFORM_TILE, width - tile_x);
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+            if (FILTERS_TRANSFORM_TILE == tile_height && FILTERS_TRANSFORM_TILE == tile_width) {
+                /*
+                    Clockwise, the row `tile_y + j` of the tile is the column
+                    `tile_y + j` of the source read upwards. Counterclockwise,
+                    it is the column `source_width - 1 - tile_y - j` read
+                    downwards.
+                */
+                __m512i rows[16];
+                for (size_t i = 0; i < 16; ++i) {
+                    const uint32_t *row =
+                        clockwise ?
+                            &source[(source_height - 1 - tile_x - i) * source_width + tile_y] :
+                            &source[(tile_x + i) * source_width + source_width - 16 - tile_y];
+
+                    rows[i] =
+                        _mm512_loadu_si512((const void *) row);
+                }
+
+                _filters_transpose_tile(rows);
+
+                for (size_t j = 0; j < 16; ++j) {
+                    size_t y =
+                        clockwise ? tile_y + j : tile_y + 15 - j;
+
+                    _mm512_storeu_si512((void *) &destination[y * width + tile_x], rows[j]);
+                }
+
+                continue;
+            }
+
+#endif
+
+            for (size_t y = tile_y; y < tile_y + tile_height; ++y) {
+                for (size_t x = tile_x; x < tile_x + tile_width; ++x) {
+                    destination[y * width + x] =
+                        clockwise ?
+                            source[(source_height - 1 - x) * source_width + y] :
+                            source[x * source_width + source_width - 1 - y];
+                }
+            }
+        }
+    }
+}
+
+/* Edge Detection */
+
+static inline void filters_edges_init(
+                       filters_edges_t *edges,
+                       int operator
+                   )
+{
+    edges->operator =
+        operator;
+
+    /* The weights of a derivative sum to 4 for Sobel and to 16 for Scharr */
+    if (FILTERS_EDGES_SCHARR == operator) {
+        edges->side_weight =
+            3;
+        edges->center_weight =
+            10;
+        edges->shift =
+            4;
+    } else {
+        edges->side_weight =
+            1;
+        edges->center_weight =
+            2;
+        edges->shift =
+            2;
+    }
+}
+
+static inline void _filters_edges_pixel(
+                       const filters_edges_t *edges,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x,
+                       size_t width,
+                       bool clamp
+                   )
+{
+    size_t left =
+        x - 1;
+    size_t right =
+        x + 1;
+    if (clamp) {
+        left =
+            0 < x ? x - 1 : 0;
+        right =
+            x + 1 < width ? x + 1 : width - 1;
+    }
+
+    int32_t side =
+        edges->side_weight;
+    int32_t center =
+        edges->center_weight;
+
+    for (size_t channel = 0; channel < 3; ++channel) {
+#define FILTERS_EDGES_CHANNEL(ROW, X) ((int32_t) rows[ROW][(X) * 4 + channel])
+        int32_t gradient_x =
+            side * (FILTERS_EDGES_CHANNEL(0, right) - FILTERS_EDGES_CHANNEL(0, left)) +
+            center * (FILTERS_EDGES_CHANNEL(1, right) - FILTERS_EDGES_CHANNEL(1, left)) +
+            side * (FILTERS_EDGES_CHANNEL(2, right) - FILTERS_EDGES_CHANNEL(2, left));
+        int32_t gradient_y =
+            side * (FILTERS_EDGES_CHANNEL(2, left) - FILTERS_EDGES_CHANNEL(0, left)) +
+            center * (FILTERS_EDGES_CHANNEL(2, x) - FILTERS_EDGES_CHANNEL(0, x)) +
+            side * (FILTERS_EDGES_CHANNEL(2, right) - FILTERS_EDGES_CHANNEL(0, right));
+#undef FILTERS_EDGES_CHANNEL
+
+        int32_t magnitude =
+            (abs(gradient_x) + abs(gradient_y) + (1 << (edges->shift - 1))) >> edges->shift;
+
+        destination_row[x * 4 + channel] =
+            (uint8_t) UTILS_MIN(magnitude, 255);
+    }
+    destination_row[x * 4 + 3] =
+        rows[1][x * 4 + 3];
+}
+
+/* The pixels from `x_start` to `x_end` near the left or right edge */
+static inline void filters_apply_edges(
+                       const filters_edges_t *edges,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end,
+                       size_t width
+                   )
+{
+    for (size_t x = x_start; x < x_end; ++x) {
+        _filters_edges_pixel(edges, rows, destination_row, x, width, true);
+    }
+}
+
+/*
+    The pixels from `x_start` to `x_end` with both horizontal neighbours
+    inside of the image. The SIMD implementation widens 8 pixels at a time
+    to 16 bits, where the gradients of both operators fit.
+*/
+static inline void filters_apply_edges_interior(
+                       const filters_edges_t *edges,
+                       uint8_t **rows,
+                       uint8_t *destination_row,
+                       size_t x_start,
+                       size_t x_end
+                   )
+{
+    size_t x =
+        x_start;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    const __m512i sides =
+        _mm512_set1_epi16(edges->side_weight);
+    const __m512i centers =
+        _mm512_set1_epi16(edges->center_weight);
+    const __m512i rounding =
+        _mm512_set1_epi16((int16_t) (1 << (edges->shift - 1)));
+    const __m128i shift =
+        _mm_cvtsi32_si128((int) edges->shift);
+    const __mmask64 alpha_mask =
+        0x8888888888888888ULL;
+
+    for (; x + 16 <= x_end; x += 16) {
+        __m256i halves[2];
+        for (size_t half = 0; half < 2; ++half) {
+            __m512i left[3], middle[3], right[3];
+            for (size_t k = 0; k < 3; ++k) {
+                const uint8_t *row =
+                    &rows[k][(x + half * 8) * 4];
+
+                left[k] =
+                    _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) (row - 4)));
+                middle[k] =
+                    _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) row));
+                right[k] =
+                    _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *) (row + 4)));
+            }
+
+            __m512i gradient_x =
+                _mm512_add_epi16(
+                    _mm512_mullo_epi16(
+                        _mm512_add_epi16(
+                            _mm512_sub_epi16(right[0], left[0]),
+                            _mm512_sub_epi16(right[2], left[2])
+                        ),
+                        sides
+                    ),
+                    _mm512_mullo_epi16(_mm512_sub_epi16(right[1], left[1]), centers)
+                );
+            __m512i gradient_y =
+                _mm512_add_epi16(
+                    _mm512_mullo_epi16(
+                        _mm512_add_epi16(
+                            _mm512_sub_epi16(left[2], left[0]),
+                            _mm512_sub_epi16(right[2], right[0])
+                        ),
+                        sides
+                    ),
+                    _mm512_mullo_epi16(_mm512_sub_epi16(middle[2], middle[0]), centers)
+                );
+
+            __m512i magnitude =
+                _mm512_srl_epi16(
+                    _mm512_add_epi16(
+                        _mm512_add_epi16(_mm512_abs_epi16(gradient_x), _mm512_abs_epi16(gradient_y)),
+                        rounding
+                    ),
+                    shift
+                );
+            halves[half] =
+                _mm512_cvtusepi16_epi8(magnitude);
+        }
+
+        __m512i result =
+            _mm512_inserti64x4(_mm512_castsi256_si512(halves[0]), halves[1], 1);
+        __m512i center =
+            _mm512_loadu_si512((const void *) &rows[1][x * 4]);
+        _mm512_storeu_si512(
+            (void *) &destination_row[x * 4],
+            _mm512_mask_blend_epi8(alpha_mask, result, center)
+        );
+    }
+
+#endif
+
+    for (; x < x_end; ++x) {
+        _filters_edges_pixel(edges, rows, destination_row, x, 0, false);
+    }
+}
+
+/* Morphology */
+
+static inline size_t filters_morphology_reach(const filters_morphology_t *morphology)
+{
+    bool fused =
+        FILTERS_MORPHOLOGY_OPEN == morphology->operation ||
+        FILTERS_MORPHOLOGY_CLOSE == morphology->operation;
+
+    return fused ? 2 * morphology->radius_y : morphology->radius_y;
+}
+
+/*
+    A line of n elements padded to whole windows needs at most n + 4 * radius
+    of them. Rows are filtered vertically in strips of
+    `FILTERS_MORPHOLOGY_COLUMN_BLOCK` bytes, horizontally as 16 rows
+    transposed to 64 bytes wide columns.
+*/
+static inline size_t filters_morphology_buffer_size(
+                         const filters_morphology_t *morphology,
+                         size_t width,
+                         size_t rows_count
+                     )
+{
+    return UTILS_MAX(
+               (rows_count + 4 * morphology->radius_y) * FILTERS_MORPHOLOGY_COLUMN_BLOCK,
+               (width + 4 * morphology->radius_x) * 64
+           );
+}
+
+/* `destination` gets the minimum or maximum of `first` and `second` byte by byte */
+static inline void _filters_morphology_combine(
+                       uint8_t *destination,
+                       const uint8_t *first,
+                       const uint8_t *second,
+                       size_t size,
+                       bool dilate
+                   )
+{
+    size_t i = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    if (dilate) {
+        for (; i + 64 <= size; i += 64) {
+            _mm512_storeu_si512(
+                (void *) &destination[i],
+                _mm512_max_epu8(
+                    _mm512_loadu_si512((const void *) &first[i]),
+                    _mm512_loadu_si512((const void *) &second[i])
+                )
+            );
+        }
+    } else {
+        for (; i + 64 <= size; i += 64) {
+            _mm512_storeu_si512(
+                (void *) &destination[i],
+                _mm512_min_epu8(
+                    _mm512_loadu_si512((const void *) &first[i]),
+                    _mm512_loadu_si512((const void *) &second[i])
+                )
+            );
+        }
+    }
+
+#endif
+
+    for (; i < size; ++i) {
+        destination[i] =
+            dilate ? UTILS_MAX(first[i], second[i]) : UTILS_MIN(first[i], second[i]);
+    }
+}
+
+/*
+    The van Herk/Gil-Werman running minimum or maximum over windows of
+    `2 * radius + 1` elements of a line of `count` elements, `size` bytes
+    wide and `source_step` bytes apart. Writes the elements from `start` to
+    `end` to `destination`, `destination_step` bytes apart, which may be the
+    source itself.
+
+    The line from `start - radius` is cut into blocks of one window, the
+    prefixes run from the start of every block, the suffixes to its end. A
+    window then spans the end of one block and the start of the next, so
+    its extremum is that of one suffix and one prefix. Elements outside of
+    the line are ignored, the same as replicating the edge ones.
+*/
+static inline void _filters_morphology_line(
+                       const uint8_t *source,
+                       size_t source_step,
+                       uint8_t *destination,
+                       size_t destination_step,
+                       size_t count,
+                       size_t start,
+                       size_t end,
+                       size_t radius,
+                       size_t size,
+                       bool dilate,
+                       uint8_t *prefixes,
+                       uint8_t *suffixes
+                   )
+{
+    size_t diameter =
+        2 * radius + 1;
+    size_t length =
+        (end - start + 2 * radius + diameter - 1) / diameter * diameter;
+    ssize_t first =
+        (ssize_t) start - (ssize_t) radius;
+    uint8_t identity =
+        dilate ? 0 : UINT8_MAX;
+
+    for (size_t t = 0; t < length; ++t) {
+        ssize_t j =
+            first + (ssize_t) t;
+        uint8_t *prefix =
+            &prefixes[t * size];
+
+        if (0 > j || (ssize_t) count <= j) {
+            if (0 == t % diameter) {
+                memset(prefix, identity, size);
+            } else {
+                memcpy(prefix, prefix - size, size);
+            }
+        } else if (0 == t % diameter) {
+            memcpy(prefix, &source[(size_t) j * source_step], size);
+        } else {
+            _filters_morphology_combine(prefix, prefix - size, &source[(size_t) j * source_step], size, dilate);
+        }
+    }
+
+    for (size_t t = length; t-- > 0;) {
+        ssize_t j =
+            first + (ssize_t) t;
+        uint8_t *suffix =
+            &suffixes[t * size];
+
+        if (0 > j || (ssize_t) count <= j) {
+            if (diameter - 1 == t % diameter) {
+                memset(suffix, identity, size);
+            } else {
+                memcpy(suffix, suffix + size, size);
+            }
+        } else if (diameter - 1 == t % diameter) {
+            memcpy(suffix, &source[(size_t) j * source_step], size);
+        } else {
+            _filters_morphology_combine(suffix, suffix + size, &source[(size_t) j * source_step], size, dilate);
+        }
+    }
+
+    for (size_t t = 0; t < end - start; ++t) {
+        _filters_morphology_combine(
+            &destination[t * destination_step],
+            &suffixes[t * size],
+            &prefixes[(t + 2 * radius) * size],
+            size,
+            dilate
+        );
+    }
+}
+
+/*
+    Writes the rows from `start` to `end` of `source_rows` to
+    `destination_rows`, the extremum of the column of every channel.
+    `vpminub` and `vpmaxub` handle 64 columns at a time.
+*/
+static inline void filters_apply_morphology_vertical(
+                       const uint8_t *source_rows,
+                       size_t rows_count,
+                       uint8_t *destination_rows,
+                       size_t start,
+                       size_t end,
+                       size_t width,
+                       size_t radius,
+                       bool dilate,
+                       uint8_t *prefixes,
+                       uint8_t *suffixes
+                   )
+{
+    size_t stride =
+        width * 4;
+
+    for (size_t offset = 0; offset < stride; offset += FILTERS_MORPHOLOGY_COLUMN_BLOCK) {
+        _filters_morphology_line(
+            &source_rows[offset], stride,
+            &destination_rows[offset], stride,
+            rows_count,
+            start, end,
+            radius,
+            UTILS_MIN(FILTERS_MORPHOLOGY_COLUMN_BLOCK, stride - offset),
+            dilate,
+            prefixes, suffixes
+        );
+    }
+}
+
+/*
+    Filters every row in place. The SIMD implementation transposes 16 rows
+    at a time into `columns`, `width` elements of 64 bytes, so that the
+    running extrema along the rows handle a pixel of each of the 16 rows
+    with one instruction. The rows left over go pixel by pixel.
+*/
+static inline void filters_apply_morphology_horizontal(
+                       uint8_t *rows,
+                       size_t rows_count,
+                       size_t width,
+                       size_t radius,
+                       bool dilate,
+                       uint8_t *prefixes,
+                       uint8_t *suffixes,
+                       uint8_t *columns
+                   )
+{
+    size_t stride =
+        width * 4;
+
+    size_t y = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+    uint32_t *transposed =
+        (uint32_t *) columns;
+
+    for (; y + 16 <= rows_count; y += 16) {
+        const uint32_t *source =
+            (const uint32_t *) &rows[y * stride];
+        uint32_t *destination =
+            (uint32_t *) &rows[y * stride];
+
+        size_t x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m512i tile[16];
+            for (size_t i = 0; i < 16; ++i) {
+                tile[i] =
+                    _mm512_loadu_si512((const void *) &source[i * width + x]);
+            }
+
+            _filters_transpose_tile(tile);
+
+            for (size_t j = 0; j < 16; ++j) {
+                _mm512_storeu_si512((void *) &transposed[(x + j) * 16], tile[j]);
+            }
+        }
+        for (; x < width; ++x) {
+            for (size_t i = 0; i < 16; ++i) {
+                transposed[x * 16 + i] =
+                    source[i * width + x];
+            }
+        }
+
+        _filters_morphology_line(
+            columns, 64,
+            columns, 64,
+            width,
+            0, width,
+            radius,
+            64,
+            dilate,
+            prefixes, suffixes
+        );
+
+        for (x = 0; x + 16 <= width; x += 16) {
+            __m512i tile[16];
+            for (size_t j = 0; j < 16; ++j) {
+                tile[j] =
+                    _mm512_loadu_si512((const void *) &transposed[(x + j) * 16]);
+            }
+
+            _filters_transpose_tile(tile);
+
+            for (size_t i = 0; i < 16; ++i) {
+                _mm512_storeu_si512((void *) &destination[i * width + x], tile[i]);
+            }
+        }
+        for (; x < width; ++x) {
+            for (size_t i = 0; i < 16; ++i) {
+                destination[i * width + x] =
+                    transposed[x * 16 + i];
+            }
+        }
+    }
+
+#else
+
+    (void) columns;
+
+#endif
+
+    for (; y < rows_count; ++y) {
+        uint8_t *row =
+            &rows[y * stride];
+
+        _filters_morphology_line(
+            row, 4,
+            row, 4,
+            width,
+            0, width,
+            radius,
+            4,
+            dilate,
+            prefixes, suffixes
+        );
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef FILTERS_COLORSPACE_H
+#define FILTERS_COLORSPACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "filters.h"
+
+/*
+    Full range YCbCr of BT.601 (the one of JPEG) in Q14 fixed point. The
+    weights of every forward row sum to exactly 1 or 0, so that grays keep
+    their value and get neutral chroma.
+*/
+#define FILTERS_COLORSPACE_SHIFT 14
+
+#define FILTERS_COLORSPACE_Y_BLUE    1868
+#define FILTERS_COLORSPACE_Y_GREEN   9617
+#define FILTERS_COLORSPACE_Y_RED     4899
+
+#define FILTERS_COLORSPACE_CB_BLUE   8192
+#define FILTERS_COLORSPACE_CB_GREEN (-5427)
+#define FILTERS_COLORSPACE_CB_RED   (-2765)
+
+#define FILTERS_COLORSPACE_CR_BLUE  (-1332)
+#define FILTERS_COLORSPACE_CR_GREEN (-6860)
+#define FILTERS_COLORSPACE_CR_RED    8192
+
+#define FILTERS_COLORSPACE_BLUE_CB   29032
+#define FILTERS_COLORSPACE_GREEN_CB (-5638)
+#define FILTERS_COLORSPACE_GREEN_CR (-11700)
+#define FILTERS_COLORSPACE_RED_CR    22970
+
+/*
+    Planes hold 8-bit samples or 16-bit ones with 8 fractional bits, the
+    latter keep the precision of filters that run on the planes between
+    the conversions.
+*/
+#define FILTERS_COLORSPACE_DEPTH_8  1
+#define FILTERS_COLORSPACE_DEPTH_16 2
+
+/*
+    The sums that sharpening the luma of `ROWS` rows needs: two copies of
+    the rows with the halo of the blur, the sums of the columns and two
+    rows of the horizontal passes.
+*/
+#define FILTERS_COLORSPACE_SHARPEN_SCRATCH_SIZE(WIDTH, ROWS, RADIUS) \
+    ((2 * ((ROWS) + 2 * (RADIUS)) + 3) * (WIDTH))
+
+/*
+    The Y, Cb and Cr planes of an image. Rows of every plane are `stride`
+    bytes apart, a multiple of 64. The alpha channel stays in the pixels.
+*/
+typedef struct _filters_planes
+{
+    size_t width, height;
+    size_t depth;                   /* bytes per sample                                */
+    size_t stride;
+    uint8_t *y, *cb, *cr;
+} filters_planes_t;
+
+static inline filters_planes_t *filters_planes_create(
+                                    size_t width,
+                                    size_t height,
+                                    size_t depth
+                                );
+
+static inline void filters_planes_destroy(
+                       filters_planes_t *planes
+                   );
+
+static inline void filters_colorspace_bgra_to_ycbcr_row(
+                       const uint8_t *pixels,
+                       uint8_t *y,
+                       uint8_t *cb,
+                       uint8_t *cr,
+                       size_t width
+                   );
+
+static inline void filters_colorspace_bgra_to_ycbcr16_row(
+                       const uint8_t *pixels,
+                       uint16_t *y,
+                       uint16_t *cb,
+                       uint16_t *cr,
+                       size_t width
+                   );
+
+static inline void filters_colorspace_ycbcr_to_bgra_row(
+                       const uint8_t *y,
+                       const uint8_t *cb,
+                       const uint8_t *cr,
+                       uint8_t *pixels,
+                       size_t width
+                   );
+
+static inline void filters_colorspace_ycbcr16_to_bgra_row(
+                       const uint16_t *y,
+                       const uint16_t *cb,
+                       const uint16_t *cr,
+                       uint8_t *pixels,
+                       size_t width
+                   );
+
+static inline void filters_colorspace_bgra_to_gray_row(
+                       const uint8_t *pixels,
+                       uint8_t *gray,
+                       size_t width
+                   );
+
+static inline void filters_colorspace_gray_to_bgra_row(
+                       const uint8_t *gray,
+                       uint8_t *pixels,
+                       size_t width
+                   );
+
+static inline void filters_colorspace_to_planes(
+                       const uint8_t *pixels,
+                       filters_planes_t *planes,
+                       size_t y_start,
+                       size_t y_end
+                   );
+
+static inline void filters_colorspace_from_planes(
+                       const filters_planes_t *planes,
+                       uint8_t *pixels,
+                       size_t y_start,
+                       size_t y_end
+                   );
+
+static inline void filters_colorspace_sharpen_luma(
+                       const filters_unsharp_mask_t *unsharp_mask,
+                       const filters_planes_t *planes,
+                       uint8_t *sharpened_y,
+                       size_t y_start,
+                       size_t y_end,
+                       uint32_t *scratch
+                   );
+
+#include "filters_colorspace.impl.h.c"
+
+#endif /* FILTERS_COLORSPACE_H */
@@ -0,0 +1,1122 @@
+#include "filters_colorspace.h"
+#include "utils.h"
+
+#include <immintrin.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Two 16-bit weights in one 32-bit lane, the order of the `vpmaddwd` operands */
+#define FILTERS_COLORSPACE_PAIR(LOW, HIGH) \
+    ((int32_t) (((uint32_t) (HIGH) << 16) | ((uint32_t) (LOW) & 0xffffu)))
+
+static inline filters_planes_t *filters_planes_create(
+                                    size_t width,
+                                    size_t height,
+                                    size_t depth
+                                )
+{
+    filters_planes_t *planes =
+        calloc(1, sizeof(*planes));
+
+    if (NULL == planes) {
+        return planes;
+    }
+
+    planes->width =
+        width;
+    planes->height =
+        height;
+    planes->depth =
+        depth;
+    planes->stride =
+        (width * depth + 63) / 64 * 64;
+
+    size_t plane_size =
+        planes->stride * height;
+
+    planes->y =
+        aligned_alloc(64, plane_size);
+    planes->cb =
+        aligned_alloc(64, plane_size);
+    planes->cr =
+        aligned_alloc(64, plane_size);
+
+    if (NULL == planes->y || NULL == planes->cb || NULL == planes->cr) {
+        filters_planes_destroy(planes);
+
+        return NULL;
+    }
+
+    return planes;
+}
+
+static inline void filters_planes_destroy(
+                       filters_planes_t *planes
+                   )
+{
+    if (NULL != planes) {
+        free(planes->y);
+        free(planes->cb);
+        free(planes->cr);
+        free(planes);
+    }
+}
+
+/*
+    The scalar conversions, also the reference of the SIMD ones: both use
+    the same integer arithmetic and produce identical samples.
+*/
+
+static inline void _filters_colorspace_forward(
+                       const uint8_t *pixel,
+                       int32_t *y,
+                       int32_t *cb,
+                       int32_t *cr
+                   )
+{
+    int32_t blue =
+        pixel[0];
+    int32_t green =
+        pixel[1];
+    int32_t red =
+        pixel[2];
+
+    *y =
+        FILTERS_COLORSPACE_Y_BLUE * blue + FILTERS_COLORSPACE_Y_GREEN * green +
+            FILTERS_COLORSPACE_Y_RED * red;
+    *cb =
+        FILTERS_COLORSPACE_CB_BLUE * blue + FILTERS_COLORSPACE_CB_GREEN * green +
+            FILTERS_COLORSPACE_CB_RED * red;
+    *cr =
+        FILTERS_COLORSPACE_CR_BLUE * blue + FILTERS_COLORSPACE_CR_GREEN * green +
+            FILTERS_COLORSPACE_CR_RED * red;
+}
+
+/* `luma` is in Q14 with the rounding term included, `cb` and `cr` are centered on 0 */
+static inline void _filters_colorspace_inverse(
+                       int32_t luma,
+                       int32_t cb,
+                       int32_t cr,
+                       int shift,
+                       uint8_t *pixel
+                   )
+{
+    pixel[0] =
+        (uint8_t) UTILS_CLAMP((luma + FILTERS_COLORSPACE_BLUE_CB * cb) >> shift, 0, 255);
+    pixel[1] =
+        (uint8_t) UTILS_CLAMP(
+                      (luma + FILTERS_COLORSPACE_GREEN_CB * cb + FILTERS_COLORSPACE_GREEN_CR * cr) >> shift,
+                      0,
+                      255
+                  );
+    pixel[2] =
+        (uint8_t) UTILS_CLAMP((luma + FILTERS_COLORSPACE_RED_CR * cr) >> shift, 0, 255);
+}
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+/*
+    The blue and red channels of a pixel are masked into the two 16-bit
+    halves of its lane and the green one into the low half, so that
+    `vpmaddwd` produces every dot product in two instructions. The inverse
+    pairs the centered Cb and Cr samples the same way.
+*/
+
+#if defined __AVX512BW__
+
+static inline void _filters_colorspace_forward_16(
+                       __m512i pixels,
+                       __m512i *y,
+                       __m512i *cb,
+                       __m512i *cr
+                   )
+{
+    __m512i blue_red =
+        _mm512_and_si512(pixels, _mm512_set1_epi32(0x00ff00ff));
+    __m512i green =
+        _mm512_and_si512(_mm512_srli_epi32(pixels, 8), _mm512_set1_epi32(0xff));
+
+    *y =
+        _mm512_add_epi32(
+            _mm512_madd_epi16(
+                blue_red,
+                _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_Y_BLUE, FILTERS_COLORSPACE_Y_RED))
+            ),
+            _mm512_madd_epi16(green, _mm512_set1_epi32(FILTERS_COLORSPACE_Y_GREEN))
+        );
+    *cb =
+        _mm512_add_epi32(
+            _mm512_madd_epi16(
+                blue_red,
+                _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_CB_BLUE, FILTERS_COLORSPACE_CB_RED))
+            ),
+            _mm512_madd_epi16(green, _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_CB_GREEN, 0)))
+        );
+    *cr =
+        _mm512_add_epi32(
+            _mm512_madd_epi16(
+                blue_red,
+                _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_CR_BLUE, FILTERS_COLORSPACE_CR_RED))
+            ),
+            _mm512_madd_epi16(green, _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_CR_GREEN, 0)))
+        );
+}
+
+/* Stores 16 pixels, keeping the alpha channels of the destination */
+static inline void _filters_colorspace_inverse_16(
+                       __m512i luma,
+                       __m512i cb,
+                       __m512i cr,
+                       int shift,
+                       uint8_t *pixels
+                   )
+{
+    __m512i chroma =
+        _mm512_or_si512(_mm512_and_si512(cb, _mm512_set1_epi32(0xffff)), _mm512_slli_epi32(cr, 16));
+    __m512i minimum =
+        _mm512_setzero_si512();
+    __m512i maximum =
+        _mm512_set1_epi32(255);
+
+    __m512i blue =
+        _mm512_madd_epi16(chroma, _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_BLUE_CB, 0)));
+    __m512i green =
+        _mm512_madd_epi16(
+            chroma,
+            _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_GREEN_CB, FILTERS_COLORSPACE_GREEN_CR))
+        );
+    __m512i red =
+        _mm512_madd_epi16(chroma, _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(0, FILTERS_COLORSPACE_RED_CR)));
+
+    blue =
+        _mm512_min_epi32(_mm512_max_epi32(_mm512_srai_epi32(_mm512_add_epi32(luma, blue), shift), minimum), maximum);
+    green =
+        _mm512_min_epi32(_mm512_max_epi32(_mm512_srai_epi32(_mm512_add_epi32(luma, green), shift), minimum), maximum);
+    red =
+        _mm512_min_epi32(_mm512_max_epi32(_mm512_srai_epi32(_mm512_add_epi32(luma, red), shift), minimum), maximum);
+
+    __m512i alpha =
+        _mm512_and_si512(_mm512_loadu_si512((const void *) pixels), _mm512_set1_epi32((int32_t) 0xff000000));
+
+    _mm512_storeu_si512(
+        (void *) pixels,
+        _mm512_or_si512(
+            _mm512_or_si512(blue, _mm512_slli_epi32(green, 8)),
+            _mm512_or_si512(_mm512_slli_epi32(red, 16), alpha)
+        )
+    );
+}
+
+#else
+
+static inline void _filters_colorspace_forward_8(
+                       __m256i pixels,
+                       __m256i *y,
+                       __m256i *cb,
+                       __m256i *cr
+                   )
+{
+    __m256i blue_red =
+        _mm256_and_si256(pixels, _mm256_set1_epi32(0x00ff00ff));
+    __m256i green =
+        _mm256_and_si256(_mm256_srli_epi32(pixels, 8), _mm256_set1_epi32(0xff));
+
+    *y =
+        _mm256_add_epi32(
+            _mm256_madd_epi16(
+                blue_red,
+                _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_Y_BLUE, FILTERS_COLORSPACE_Y_RED))
+            ),
+            _mm256_madd_epi16(green, _mm256_set1_epi32(FILTERS_COLORSPACE_Y_GREEN))
+        );
+    *cb =
+        _mm256_add_epi32(
+            _mm256_madd_epi16(
+                blue_red,
+                _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_CB_BLUE, FILTERS_COLORSPACE_CB_RED))
+            ),
+            _mm256_madd_epi16(green, _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_CB_GREEN, 0)))
+        );
+    *cr =
+        _mm256_add_epi32(
+            _mm256_madd_epi16(
+                blue_red,
+                _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_CR_BLUE, FILTERS_COLORSPACE_CR_RED))
+            ),
+            _mm256_madd_epi16(green, _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_CR_GREEN, 0)))
+        );
+}
+
+/* Stores 8 pixels, keeping the alpha channels of the destination */
+static inline void _filters_colorspace_inverse_8(
+                       __m256i luma,
+                       __m256i cb,
+                       __m256i cr,
+                       int shift,
+                       uint8_t *pixels
+                   )
+{
+    __m256i chroma =
+        _mm256_or_si256(_mm256_and_si256(cb, _mm256_set1_epi32(0xffff)), _mm256_slli_epi32(cr, 16));
+    __m256i minimum =
+        _mm256_setzero_si256();
+    __m256i maximum =
+        _mm256_set1_epi32(255);
+
+    __m256i blue =
+        _mm256_madd_epi16(chroma, _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_BLUE_CB, 0)));
+    __m256i green =
+        _mm256_madd_epi16(
+            chroma,
+            _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_GREEN_CB, FILTERS_COLORSPACE_GREEN_CR))
+        );
+    __m256i red =
+        _mm256_madd_epi16(chroma, _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(0, FILTERS_COLORSPACE_RED_CR)));
+
+    blue =
+        _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(_mm256_add_epi32(luma, blue), shift), minimum), maximum);
+    green =
+        _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(_mm256_add_epi32(luma, green), shift), minimum), maximum);
+    red =
+        _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(_mm256_add_epi32(luma, red), shift), minimum), maximum);
+
+    __m256i alpha =
+        _mm256_and_si256(_mm256_loadu_si256((const __m256i *) pixels), _mm256_set1_epi32((int32_t) 0xff000000));
+
+    _mm256_storeu_si256(
+        (__m256i *) pixels,
+        _mm256_or_si256(
+            _mm256_or_si256(blue, _mm256_slli_epi32(green, 8)),
+            _mm256_or_si256(_mm256_slli_epi32(red, 16), alpha)
+        )
+    );
+}
+
+/* Saturates 8 lanes to unsigned 16 bits in their original order */
+static inline __m128i _filters_colorspace_pack_words_8(__m256i values)
+{
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(values, values), 0x08));
+}
+
+#endif
+
+#endif
+
+static inline void filters_colorspace_bgra_to_ycbcr_row(
+                       const uint8_t *pixels,
+                       uint8_t *y,
+                       uint8_t *cb,
+                       uint8_t *cr,
+                       size_t width
+                   )
+{
+    const int32_t rounding =
+        1 << (FILTERS_COLORSPACE_SHIFT - 1);
+    const int32_t chroma_offset =
+        (128 << FILTERS_COLORSPACE_SHIFT) + rounding;
+
+    size_t x = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#if defined __AVX512BW__
+
+    for (; x + 16 <= width; x += 16) {
+        __m512i luma, blue_difference, red_difference;
+        _filters_colorspace_forward_16(
+            _mm512_loadu_si512((const void *) &pixels[x * 4]),
+            &luma, &blue_difference, &red_difference
+        );
+
+        _mm_storeu_si128(
+            (__m128i *) &y[x],
+            _mm512_cvtusepi32_epi8(
+                _mm512_srai_epi32(_mm512_add_epi32(luma, _mm512_set1_epi32(rounding)), FILTERS_COLORSPACE_SHIFT)
+            )
+        );
+        _mm_storeu_si128(
+            (__m128i *) &cb[x],
+            _mm512_cvtusepi32_epi8(
+                _mm512_srai_epi32(
+                    _mm512_add_epi32(blue_difference, _mm512_set1_epi32(chroma_offset)),
+                    FILTERS_COLORSPACE_SHIFT
+                )
+            )
+        );
+        _mm_storeu_si128(
+            (__m128i *) &cr[x],
+            _mm512_cvtusepi32_epi8(
+                _mm512_srai_epi32(
+                    _mm512_add_epi32(red_difference, _mm512_set1_epi32(chroma_offset)),
+                    FILTERS_COLORSPACE_SHIFT
+                )
+            )
+        );
+    }
+
+#else
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i luma, blue_difference, red_difference;
+        _filters_colorspace_forward_8(
+            _mm256_loadu_si256((const __m256i *) &pixels[x * 4]),
+            &luma, &blue_difference, &red_difference
+        );
+
+        __m128i words =
+            _filters_colorspace_pack_words_8(
+                _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_set1_epi32(rounding)), FILTERS_COLORSPACE_SHIFT)
+            );
+        _mm_storel_epi64((__m128i *) &y[x], _mm_packus_epi16(words, words));
+
+        words =
+            _filters_colorspace_pack_words_8(
+                _mm256_srai_epi32(
+                    _mm256_add_epi32(blue_difference, _mm256_set1_epi32(chroma_offset)),
+                    FILTERS_COLORSPACE_SHIFT
+                )
+            );
+        _mm_storel_epi64((__m128i *) &cb[x], _mm_packus_epi16(words, words));
+
+        words =
+            _filters_colorspace_pack_words_8(
+                _mm256_srai_epi32(
+                    _mm256_add_epi32(red_difference, _mm256_set1_epi32(chroma_offset)),
+                    FILTERS_COLORSPACE_SHIFT
+                )
+            );
+        _mm_storel_epi64((__m128i *) &cr[x], _mm_packus_epi16(words, words));
+    }
+
+#endif
+#endif
+
+    for (; x < width; ++x) {
+        int32_t luma, blue_difference, red_difference;
+        _filters_colorspace_forward(&pixels[x * 4], &luma, &blue_difference, &red_difference);
+
+        y[x] =
+            (uint8_t) UTILS_MIN((luma + rounding) >> FILTERS_COLORSPACE_SHIFT, 255);
+        cb[x] =
+            (uint8_t) UTILS_MIN((blue_difference + chroma_offset) >> FILTERS_COLORSPACE_SHIFT, 255);
+        cr[x] =
+            (uint8_t) UTILS_MIN((red_difference + chroma_offset) >> FILTERS_COLORSPACE_SHIFT, 255);
+    }
+}
+
+static inline void filters_colorspace_bgra_to_ycbcr16_row(
+                       const uint8_t *pixels,
+                       uint16_t *y,
+                       uint16_t *cb,
+                       uint16_t *cr,
+                       size_t width
+                   )
+{
+    /* From Q14 to samples with 8 fractional bits */
+    const int shift =
+        FILTERS_COLORSPACE_SHIFT - 8;
+    const int32_t rounding =
+        1 << (shift - 1);
+    const int32_t chroma_offset =
+        (128 << FILTERS_COLORSPACE_SHIFT) + rounding;
+
+    size_t x = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#if defined __AVX512BW__
+
+    for (; x + 16 <= width; x += 16) {
+        __m512i luma, blue_difference, red_difference;
+        _filters_colorspace_forward_16(
+            _mm512_loadu_si512((const void *) &pixels[x * 4]),
+            &luma, &blue_difference, &red_difference
+        );
+
+        _mm256_storeu_si256(
+            (__m256i *) &y[x],
+            _mm512_cvtusepi32_epi16(_mm512_srai_epi32(_mm512_add_epi32(luma, _mm512_set1_epi32(rounding)), shift))
+        );
+        _mm256_storeu_si256(
+            (__m256i *) &cb[x],
+            _mm512_cvtusepi32_epi16(
+                _mm512_srai_epi32(_mm512_add_epi32(blue_difference, _mm512_set1_epi32(chroma_offset)), shift)
+            )
+        );
+        _mm256_storeu_si256(
+            (__m256i *) &cr[x],
+            _mm512_cvtusepi32_epi16(
+                _mm512_srai_epi32(_mm512_add_epi32(red_difference, _mm512_set1_epi32(chroma_offset)), shift)
+            )
+        );
+    }
+
+#else
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i luma, blue_difference, red_difference;
+        _filters_colorspace_forward_8(
+            _mm256_loadu_si256((const __m256i *) &pixels[x * 4]),
+            &luma, &blue_difference, &red_difference
+        );
+
+        _mm_storeu_si128(
+            (__m128i *) &y[x],
+            _filters_colorspace_pack_words_8(
+                _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_set1_epi32(rounding)), shift)
+            )
+        );
+        _mm_storeu_si128(
+            (__m128i *) &cb[x],
+            _filters_colorspace_pack_words_8(
+                _mm256_srai_epi32(_mm256_add_epi32(blue_difference, _mm256_set1_epi32(chroma_offset)), shift)
+            )
+        );
+        _mm_storeu_si128(
+            (__m128i *) &cr[x],
+            _filters_colorspace_pack_words_8(
+                _mm256_srai_epi32(_mm256_add_epi32(red_difference, _mm256_set1_epi32(chroma_offset)), shift)
+            )
+        );
+    }
+
+#endif
+#endif
+
+    for (; x < width; ++x) {
+        int32_t luma, blue_difference, red_difference;
+        _filters_colorspace_forward(&pixels[x * 4], &luma, &blue_difference, &red_difference);
+
+        y[x] =
+            (uint16_t) UTILS_MIN((luma + rounding) >> shift, UINT16_MAX);
+        cb[x] =
+            (uint16_t) UTILS_MIN((blue_difference + chroma_offset) >> shift, UINT16_MAX);
+        cr[x] =
+            (uint16_t) UTILS_MIN((red_difference + chroma_offset) >> shift, UINT16_MAX);
+    }
+}
+
+/* Overwrites the color channels of `pixels`, the alpha channels are kept */
+static inline void filters_colorspace_ycbcr_to_bgra_row(
+                       const uint8_t *y,
+                       const uint8_t *cb,
+                       const uint8_t *cr,
+                       uint8_t *pixels,
+                       size_t width
+                   )
+{
+    const int32_t rounding =
+        1 << (FILTERS_COLORSPACE_SHIFT - 1);
+
+    size_t x = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#if defined __AVX512BW__
+
+    for (; x + 16 <= width; x += 16) {
+        __m512i luma =
+            _mm512_add_epi32(
+                _mm512_slli_epi32(
+                    _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) &y[x])),
+                    FILTERS_COLORSPACE_SHIFT
+                ),
+                _mm512_set1_epi32(rounding)
+            );
+        __m512i blue_difference =
+            _mm512_sub_epi32(
+                _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) &cb[x])),
+                _mm512_set1_epi32(128)
+            );
+        __m512i red_difference =
+            _mm512_sub_epi32(
+                _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) &cr[x])),
+                _mm512_set1_epi32(128)
+            );
+
+        _filters_colorspace_inverse_16(luma, blue_difference, red_difference, FILTERS_COLORSPACE_SHIFT, &pixels[x * 4]);
+    }
+
+#else
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i luma =
+            _mm256_add_epi32(
+                _mm256_slli_epi32(
+                    _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) &y[x])),
+                    FILTERS_COLORSPACE_SHIFT
+                ),
+                _mm256_set1_epi32(rounding)
+            );
+        __m256i blue_difference =
+            _mm256_sub_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) &cb[x])),
+                _mm256_set1_epi32(128)
+            );
+        __m256i red_difference =
+            _mm256_sub_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) &cr[x])),
+                _mm256_set1_epi32(128)
+            );
+
+        _filters_colorspace_inverse_8(luma, blue_difference, red_difference, FILTERS_COLORSPACE_SHIFT, &pixels[x * 4]);
+    }
+
+#endif
+#endif
+
+    for (; x < width; ++x) {
+        _filters_colorspace_inverse(
+            ((int32_t) y[x] << FILTERS_COLORSPACE_SHIFT) + rounding,
+            (int32_t) cb[x] - 128,
+            (int32_t) cr[x] - 128,
+            FILTERS_COLORSPACE_SHIFT,
+            &pixels[x * 4]
+        );
+    }
+}
+
+/*
+    The 16-bit samples are centered on 0 for the chroma weights, which keep
+    them in Q22. Luma is brought to the same scale, the final shift drops
+    the 22 fractional bits.
+*/
+static inline void filters_colorspace_ycbcr16_to_bgra_row(
+                       const uint16_t *y,
+                       const uint16_t *cb,
+                       const uint16_t *cr,
+                       uint8_t *pixels,
+                       size_t width
+                   )
+{
+    const int shift =
+        FILTERS_COLORSPACE_SHIFT + 8;
+    const int32_t rounding =
+        1 << (shift - 1);
+
+    size_t x = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#if defined __AVX512BW__
+
+    for (; x + 16 <= width; x += 16) {
+        __m512i luma =
+            _mm512_add_epi32(
+                _mm512_slli_epi32(
+                    _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) &y[x])),
+                    FILTERS_COLORSPACE_SHIFT
+                ),
+                _mm512_set1_epi32(rounding)
+            );
+        __m512i blue_difference =
+            _mm512_sub_epi32(
+                _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) &cb[x])),
+                _mm512_set1_epi32(32768)
+            );
+        __m512i red_difference =
+            _mm512_sub_epi32(
+                _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) &cr[x])),
+                _mm512_set1_epi32(32768)
+            );
+
+        _filters_colorspace_inverse_16(luma, blue_difference, red_difference, shift, &pixels[x * 4]);
+    }
+
+#else
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i luma =
+            _mm256_add_epi32(
+                _mm256_slli_epi32(
+                    _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) &y[x])),
+                    FILTERS_COLORSPACE_SHIFT
+                ),
+                _mm256_set1_epi32(rounding)
+            );
+        __m256i blue_difference =
+            _mm256_sub_epi32(
+                _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) &cb[x])),
+                _mm256_set1_epi32(32768)
+            );
+        __m256i red_difference =
+            _mm256_sub_epi32(
+                _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) &cr[x])),
+                _mm256_set1_epi32(32768)
+            );
+
+        _filters_colorspace_inverse_8(luma, blue_difference, red_difference, shift, &pixels[x * 4]);
+    }
+
+#endif
+#endif
+
+    for (; x < width; ++x) {
+        _filters_colorspace_inverse(
+            ((int32_t) y[x] << FILTERS_COLORSPACE_SHIFT) + rounding,
+            (int32_t) cb[x] - 32768,
+            (int32_t) cr[x] - 32768,
+            shift,
+            &pixels[x * 4]
+        );
+    }
+}
+
+static inline void filters_colorspace_bgra_to_gray_row(
+                       const uint8_t *pixels,
+                       uint8_t *gray,
+                       size_t width
+                   )
+{
+    const int32_t rounding =
+        1 << (FILTERS_COLORSPACE_SHIFT - 1);
+
+    size_t x = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#if defined __AVX512BW__
+
+    for (; x + 16 <= width; x += 16) {
+        __m512i source =
+            _mm512_loadu_si512((const void *) &pixels[x * 4]);
+        __m512i luma =
+            _mm512_add_epi32(
+                _mm512_madd_epi16(
+                    _mm512_and_si512(source, _mm512_set1_epi32(0x00ff00ff)),
+                    _mm512_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_Y_BLUE, FILTERS_COLORSPACE_Y_RED))
+                ),
+                _mm512_madd_epi16(
+                    _mm512_and_si512(_mm512_srli_epi32(source, 8), _mm512_set1_epi32(0xff)),
+                    _mm512_set1_epi32(FILTERS_COLORSPACE_Y_GREEN)
+                )
+            );
+
+        _mm_storeu_si128(
+            (__m128i *) &gray[x],
+            _mm512_cvtusepi32_epi8(
+                _mm512_srai_epi32(_mm512_add_epi32(luma, _mm512_set1_epi32(rounding)), FILTERS_COLORSPACE_SHIFT)
+            )
+        );
+    }
+
+#else
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i source =
+            _mm256_loadu_si256((const __m256i *) &pixels[x * 4]);
+        __m256i luma =
+            _mm256_add_epi32(
+                _mm256_madd_epi16(
+                    _mm256_and_si256(source, _mm256_set1_epi32(0x00ff00ff)),
+                    _mm256_set1_epi32(FILTERS_COLORSPACE_PAIR(FILTERS_COLORSPACE_Y_BLUE, FILTERS_COLORSPACE_Y_RED))
+                ),
+                _mm256_madd_epi16(
+                    _mm256_and_si256(_mm256_srli_epi32(source, 8), _mm256_set1_epi32(0xff)),
+                    _mm256_set1_epi32(FILTERS_COLORSPACE_Y_GREEN)
+                )
+            );
+
+        __m128i words =
+            _filters_colorspace_pack_words_8(
+                _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_set1_epi32(rounding)), FILTERS_COLORSPACE_SHIFT)
+            );
+        _mm_storel_epi64((__m128i *) &gray[x], _mm_packus_epi16(words, words));
+    }
+
+#endif
+#endif
+
+    for (; x < width; ++x) {
+        int32_t luma, blue_difference, red_difference;
+        _filters_colorspace_forward(&pixels[x * 4], &luma, &blue_difference, &red_difference);
+
+        gray[x] =
+            (uint8_t) UTILS_MIN((luma + rounding) >> FILTERS_COLORSPACE_SHIFT, 255);
+    }
+}
+
+/* Overwrites the color channels of `pixels` with `gray`, the alpha channels are kept */
+static inline void filters_colorspace_gray_to_bgra_row(
+                       const uint8_t *gray,
+                       uint8_t *pixels,
+                       size_t width
+                   )
+{
+    size_t x = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#if defined __AVX512BW__
+
+    for (; x + 16 <= width; x += 16) {
+        __m512i values =
+            _mm512_mullo_epi32(
+                _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) &gray[x])),
+                _mm512_set1_epi32(0x010101)
+            );
+        __m512i alpha =
+            _mm512_and_si512(
+                _mm512_loadu_si512((const void *) &pixels[x * 4]),
+                _mm512_set1_epi32((int32_t) 0xff000000)
+            );
+
+        _mm512_storeu_si512((void *) &pixels[x * 4], _mm512_or_si512(values, alpha));
+    }
+
+#else
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i values =
+            _mm256_mullo_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) &gray[x])),
+                _mm256_set1_epi32(0x010101)
+            );
+        __m256i alpha =
+            _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *) &pixels[x * 4]),
+                _mm256_set1_epi32((int32_t) 0xff000000)
+            );
+
+        _mm256_storeu_si256((__m256i *) &pixels[x * 4], _mm256_or_si256(values, alpha));
+    }
+
+#endif
+#endif
+
+    for (; x < width; ++x) {
+        pixels[x * 4] =
+            gray[x];
+        pixels[x * 4 + 1] =
+            gray[x];
+        pixels[x * 4 + 2] =
+            gray[x];
+    }
+}
+
+/* Converts the rows from `y_start` to `y_end` of an image into its planes */
+static inline void filters_colorspace_to_planes(
+                       const uint8_t *pixels,
+                       filters_planes_t *planes,
+                       size_t y_start,
+                       size_t y_end
+                   )
+{
+    size_t width =
+        planes->width;
+
+    for (size_t y = y_start; y < y_end; ++y) {
+        const uint8_t *row =
+            &pixels[y * width * 4];
+        size_t offset =
+            y * planes->stride;
+
+        if (FILTERS_COLORSPACE_DEPTH_16 == planes->depth) {
+            filters_colorspace_bgra_to_ycbcr16_row(
+                row,
+                (uint16_t *) &planes->y[offset],
+                (uint16_t *) &planes->cb[offset],
+                (uint16_t *) &planes->cr[offset],
+                width
+            );
+        } else {
+            filters_colorspace_bgra_to_ycbcr_row(
+                row,
+                &planes->y[offset],
+                &planes->cb[offset],
+                &planes->cr[offset],
+                width
+            );
+        }
+    }
+}
+
+/* Converts the rows from `y_start` to `y_end` of the planes back into the image */
+static inline void filters_colorspace_from_planes(
+                       const filters_planes_t *planes,
+                       uint8_t *pixels,
+                       size_t y_start,
+                       size_t y_end
+                   )
+{
+    size_t width =
+        planes->width;
+
+    for (size_t y = y_start; y < y_end; ++y) {
+        uint8_t *row =
+            &pixels[y * width * 4];
+        size_t offset =
+            y * planes->stride;
+
+        if (FILTERS_COLORSPACE_DEPTH_16 == planes->depth) {
+            filters_colorspace_ycbcr16_to_bgra_row(
+                (const uint16_t *) &planes->y[offset],
+                (const uint16_t *) &planes->cb[offset],
+                (const uint16_t *) &planes->cr[offset],
+                row,
+                width
+            );
+        } else {
+            filters_colorspace_ycbcr_to_bgra_row(
+                &planes->y[offset],
+                &planes->cb[offset],
+                &planes->cr[offset],
+                row,
+                width
+            );
+        }
+    }
+}
+
+/* Clamps a row or a column that may lie past an edge of the image into it */
+static inline size_t _filters_colorspace_clamp(ptrdiff_t index, size_t size)
+{
+    return (size_t) UTILS_CLAMP(index, 0, (ptrdiff_t) size - 1);
+}
+
+/* One box blur of a row of luma sums, the samples past the edges repeat the ones at the edges */
+static inline void _filters_colorspace_box_row(
+                       const uint32_t *source,
+                       uint32_t *destination,
+                       size_t width,
+                       size_t radius,
+                       uint32_t multiplier
+                   )
+{
+    uint64_t sum =
+        0;
+    for (ptrdiff_t i = -(ptrdiff_t) radius; i <= (ptrdiff_t) radius; ++i) {
+        sum +=
+            source[_filters_colorspace_clamp(i, width)];
+    }
+
+    for (size_t x = 0; x < width; ++x) {
+        destination[x] =
+            (uint32_t) ((sum * multiplier + (1u << (FILTERS_GAUSSIAN_BOX_SHIFT - 1))) >> FILTERS_GAUSSIAN_BOX_SHIFT);
+
+        sum +=
+            source[_filters_colorspace_clamp((ptrdiff_t) (x + radius + 1), width)];
+        sum -=
+            source[_filters_colorspace_clamp((ptrdiff_t) x - (ptrdiff_t) radius, width)];
+    }
+}
+
+/*
+    One vertical box blur of the rows from `y_start` to `y_end`. The rows
+    are indexed from `first_row` of the image, the ones past its edges
+    repeat the rows at the edges.
+*/
+static inline void _filters_colorspace_box_rows(
+                       const uint32_t *source,
+                       uint32_t *destination,
+                       uint32_t *sums,
+                       size_t width,
+                       size_t height,
+                       size_t first_row,
+                       size_t y_start,
+                       size_t y_end,
+                       size_t radius,
+                       uint32_t multiplier
+                   )
+{
+    memset(sums, 0, width * sizeof(*sums));
+    for (ptrdiff_t i = -(ptrdiff_t) radius; i <= (ptrdiff_t) radius; ++i) {
+        const uint32_t *row =
+            &source[(_filters_colorspace_clamp((ptrdiff_t) y_start + i, height) - first_row) * width];
+        for (size_t x = 0; x < width; ++x) {
+            sums[x] +=
+                row[x];
+        }
+    }
+
+    for (size_t y = y_start; y < y_end; ++y) {
+        uint32_t *destination_row =
+            &destination[(y - first_row) * width];
+        for (size_t x = 0; x < width; ++x) {
+            destination_row[x] =
+                (uint32_t) (((uint64_t) sums[x] * multiplier + (1u << (FILTERS_GAUSSIAN_BOX_SHIFT - 1))) >>
+                    FILTERS_GAUSSIAN_BOX_SHIFT);
+        }
+
+        if (y + 1 < y_end) {
+            const uint32_t *added_row =
+                &source[(_filters_colorspace_clamp((ptrdiff_t) (y + radius + 1), height) - first_row) * width];
+            const uint32_t *removed_row =
+                &source[(_filters_colorspace_clamp((ptrdiff_t) y - (ptrdiff_t) radius, height) - first_row) * width];
+            for (size_t x = 0; x < width; ++x) {
+                sums[x] +=
+                    added_row[x] - removed_row[x];
+            }
+        }
+    }
+}
+
+/*
+    Sharpens the luma of the rows from `y_start` to `y_end` of 16-bit
+    planes into `sharpened_y`, a plane with their stride. The luma is
+    blurred like the gaussian filter does, sampled kernel or three boxes,
+    and the difference to the blur is added like the unsharp mask does
+    to every channel of the pixels. The chroma is left alone, so edges
+    do not get colored fringes. `scratch` has room for
+    `FILTERS_COLORSPACE_SHARPEN_SCRATCH_SIZE` of the rows and the radius.
+*/
+static inline void filters_colorspace_sharpen_luma(
+                       const filters_unsharp_mask_t *unsharp_mask,
+                       const filters_planes_t *planes,
+                       uint8_t *sharpened_y,
+                       size_t y_start,
+                       size_t y_end,
+                       uint32_t *scratch
+                   )
+{
+    const filters_gaussian_t *gaussian =
+        &unsharp_mask->gaussian;
+    size_t width =
+        planes->width;
+    size_t height =
+        planes->height;
+    size_t radius =
+        gaussian->radius;
+
+    /* The rows of the halo inside of the image, the ones past its edges are not stored */
+    size_t first_row =
+        y_start > radius ? y_start - radius : 0;
+    size_t last_row =
+        UTILS_MIN(y_end + radius, height);
+    size_t rows_count =
+        y_end - y_start + 2 * radius;
+
+    uint32_t *blurred =
+        scratch;
+    uint32_t *spare =
+        &scratch[rows_count * width];
+    uint32_t *sums =
+        &spare[rows_count * width];
+    uint32_t *row_sums =
+        &sums[width];
+    uint32_t *spare_row_sums =
+        &row_sums[width];
+
+    for (size_t y = first_row; y < last_row; ++y) {
+        const uint16_t *luma =
+            (const uint16_t *) &planes->y[y * planes->stride];
+        uint32_t *blurred_row =
+            &blurred[(y - first_row) * width];
+
+        if (gaussian->box) {
+            for (size_t x = 0; x < width; ++x) {
+                row_sums[x] =
+                    luma[x];
+            }
+            for (size_t pass = 0; pass < FILTERS_GAUSSIAN_BOX_PASSES; ++pass) {
+                uint32_t *destination =
+                    FILTERS_GAUSSIAN_BOX_PASSES - 1 == pass ? blurred_row : spare_row_sums;
+                _filters_colorspace_box_row(
+                    row_sums, destination, width, gaussian->box_radii[pass], gaussian->box_multipliers[pass]
+                );
+
+                uint32_t *swapped =
+                    row_sums;
+                row_sums =
+                    spare_row_sums;
+                spare_row_sums =
+                    swapped;
+            }
+        } else {
+            ptrdiff_t kernel_radius =
+                (ptrdiff_t) gaussian->kernel_radius;
+            for (size_t x = 0; x < width; ++x) {
+                uint32_t sum =
+                    0;
+                for (ptrdiff_t k = -kernel_radius; k <= kernel_radius; ++k) {
+                    sum +=
+                        (uint32_t) luma[_filters_colorspace_clamp((ptrdiff_t) x + k, width)] *
+                            (uint32_t) gaussian->weights[k + kernel_radius];
+                }
+                blurred_row[x] =
+                    (sum + (1u << (FILTERS_GAUSSIAN_WEIGHT_SHIFT - 1))) >> FILTERS_GAUSSIAN_WEIGHT_SHIFT;
+            }
+        }
+    }
+
+    if (gaussian->box) {
+        /* Every pass blurs the rows that the passes after it still read */
+        size_t remaining_radius =
+            radius;
+        for (size_t pass = 0; pass < FILTERS_GAUSSIAN_BOX_PASSES; ++pass) {
+            remaining_radius -=
+                gaussian->box_radii[pass];
+            _filters_colorspace_box_rows(
+                blurred,
+                spare,
+                sums,
+                width,
+                height,
+                first_row,
+                y_start > remaining_radius ? y_start - remaining_radius : 0,
+                UTILS_MIN(y_end + remaining_radius, height),
+                gaussian->box_radii[pass],
+                gaussian->box_multipliers[pass]
+            );
+
+            uint32_t *swapped =
+                blurred;
+            blurred =
+                spare;
+            spare =
+                swapped;
+        }
+    } else {
+        ptrdiff_t kernel_radius =
+            (ptrdiff_t) gaussian->kernel_radius;
+        for (size_t y = y_start; y < y_end; ++y) {
+            uint32_t *destination_row =
+                &spare[(y - first_row) * width];
+            memset(destination_row, 0, width * sizeof(*destination_row));
+
+            for (ptrdiff_t k = -kernel_radius; k <= kernel_radius; ++k) {
+                const uint32_t *row =
+                    &blurred[(_filters_colorspace_clamp((ptrdiff_t) y + k, height) - first_row) * width];
+                uint32_t weight =
+                    (uint32_t) gaussian->weights[k + kernel_radius];
+                for (size_t x = 0; x < width; ++x) {
+                    destination_row[x] +=
+                        row[x] * weight;
+                }
+            }
+
+            for (size_t x = 0; x < width; ++x) {
+                destination_row[x] =
+                    (destination_row[x] + (1u << (FILTERS_GAUSSIAN_WEIGHT_SHIFT - 1))) >>
+                        FILTERS_GAUSSIAN_WEIGHT_SHIFT;
+            }
+        }
+
+        blurred =
+            spare;
+    }
+
+    /* The amount is in Q10 and the threshold in whole values, the samples have 8 fractional bits */
+    int32_t amount =
+        unsharp_mask->fixed_amount;
+    int32_t threshold =
+        (int32_t) unsharp_mask->threshold << 8;
+    for (size_t y = y_start; y < y_end; ++y) {
+        const uint16_t *luma =
+            (const uint16_t *) &planes->y[y * planes->stride];
+        const uint32_t *blurred_row =
+            &blurred[(y - first_row) * width];
+        uint16_t *sharpened_row =
+            (uint16_t *) &sharpened_y[y * planes->stride];
+
+        for (size_t x = 0; x < width; ++x) {
+            int32_t difference =
+                (int32_t) luma[x] - (int32_t) blurred_row[x];
+
+            sharpened_row[x] =
+                abs(difference) >= threshold ?
+                    (uint16_t) UTILS_CLAMP(
+                                   (int32_t) luma[x] +
+                                       ((difference * amount + (1 << (FILTERS_UNSHARP_MASK_AMOUNT_SHIFT - 1))) >>
+                                           FILTERS_UNSHARP_MASK_AMOUNT_SHIFT),
+                                   0,
+                                   255 << 8
+                               ) :
+                    luma[x];
+        }
+    }
+}
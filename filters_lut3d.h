@@ -0,0 +1,52 @@
+#ifndef FILTERS_LUT3D_H
+#define FILTERS_LUT3D_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    Lattice coordinates are in Q12, every node holds its blue, green and red
+    outputs in 10 bits each, Q2 of the channel range. The weighted sum of a
+    tetrahedron is then in Q14 and fits the 32-bit sums of `vpmaddwd`.
+*/
+#define FILTERS_LUT3D_FRACTION_SHIFT 12
+#define FILTERS_LUT3D_NODE_SHIFT     2
+#define FILTERS_LUT3D_NODE_BITS      10
+
+/*
+    A 3D LUT repacked for interpolation. The nodes of a 33 point LUT take
+    144 KiB instead of the 431 KiB of float triples, so that they stay in
+    the L2 cache while the gathers hop around the lattice.
+
+    `coordinates` maps every 8-bit value of the blue, green and red channels
+    to its lattice cell in the upper bits and the Q12 position within it in
+    the lower `FILTERS_LUT3D_FRACTION_SHIFT + 1` bits. Building it once in
+    floating point keeps the per pixel work in integers.
+*/
+typedef struct _filters_lut3d
+{
+    size_t size;
+    uint32_t coordinates[3][256];   /* blue, green and red                             */
+    uint32_t *nodes;                /* red changes fastest, then green, then blue      */
+} filters_lut3d_t;
+
+static inline filters_lut3d_t *filters_lut3d_create(
+                                   size_t size,
+                                   const float *table,
+                                   const float *domain_min,
+                                   const float *domain_max
+                               );
+
+static inline void filters_lut3d_destroy(
+                       filters_lut3d_t *lut
+                   );
+
+static inline void filters_apply_lut3d(
+                       const filters_lut3d_t *lut,
+                       uint8_t *pixels,
+                       size_t count
+                   );
+
+#include "filters_lut3d.impl.h.c"
+
+#endif /* FILTERS_LUT3D_H */
@@ -0,0 +1,555 @@
+#include "filters_lut3d.h"
+#include "utils.h"
+
+#include <immintrin.h>
+#include <math.h>
+#include <stdlib.h>
+
+#if !defined FILTERS_C_IMPLEMENTATION &&     \
+    !defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#define FILTERS_C_IMPLEMENTATION 1
+#endif
+
+#define FILTERS_LUT3D_FRACTION_ONE  (1u << FILTERS_LUT3D_FRACTION_SHIFT)
+#define FILTERS_LUT3D_FRACTION_MASK ((1u << (FILTERS_LUT3D_FRACTION_SHIFT + 1)) - 1)
+#define FILTERS_LUT3D_NODE_MASK     ((1u << FILTERS_LUT3D_NODE_BITS) - 1)
+#define FILTERS_LUT3D_SUM_SHIFT     (FILTERS_LUT3D_FRACTION_SHIFT + FILTERS_LUT3D_NODE_SHIFT)
+
+/*
+    `table` holds `size` cubed red, green and blue triples with red changing
+    fastest, the domains are in the same red, green and blue order.
+*/
+static inline filters_lut3d_t *filters_lut3d_create(
+                                   size_t size,
+                                   const float *table,
+                                   const float *domain_min,
+                                   const float *domain_max
+                               )
+{
+    filters_lut3d_t *lut =
+        malloc(sizeof(*lut));
+    if (NULL == lut) {
+        return lut;
+    }
+
+    size_t nodes_count =
+        size * size * size;
+
+    lut->size =
+        size;
+    lut->nodes =
+        aligned_alloc(64, (nodes_count * sizeof(*lut->nodes) / 64 + 1) * 64);
+    if (NULL == lut->nodes) {
+        free(lut);
+
+        return NULL;
+    }
+
+    for (size_t channel = 0; channel < 3; ++channel) {
+        size_t cube_channel =
+            2 - channel;
+        double minimum =
+            domain_min[cube_channel];
+        double maximum =
+            domain_max[cube_channel];
+
+        for (size_t value = 0; value < 256; ++value) {
+            double position =
+                ((double) value / 255.0 - minimum) / (maximum - minimum) * (double) (size - 1);
+            position =
+                UTILS_CLAMP(position, 0.0, (double) (size - 1));
+
+            /* The last node belongs to the cell below it, at its far end */
+            size_t cell =
+                UTILS_MIN((size_t) position, size - 2);
+            uint32_t fraction =
+                (uint32_t) lrint((position - (double) cell) * FILTERS_LUT3D_FRACTION_ONE);
+
+            lut->coordinates[channel][value] =
+                (uint32_t) cell << (FILTERS_LUT3D_FRACTION_SHIFT + 1) | fraction;
+        }
+    }
+
+    const uint32_t node_one =
+        255u << FILTERS_LUT3D_NODE_SHIFT;
+    for (size_t i = 0; i < nodes_count; ++i) {
+        uint32_t node =
+            0;
+        for (size_t channel = 0; channel < 3; ++channel) {
+            double value =
+                UTILS_CLAMP((double) table[i * 3 + 2 - channel], 0.0, 1.0);
+
+            node |=
+                (uint32_t) lrint(value * node_one) << (channel * FILTERS_LUT3D_NODE_BITS);
+        }
+
+        lut->nodes[i] =
+            node;
+    }
+
+    return lut;
+}
+
+static inline void filters_lut3d_destroy(
+                       filters_lut3d_t *lut
+                   )
+{
+    if (NULL != lut) {
+        free(lut->nodes);
+        free(lut);
+    }
+}
+
+/*
+    Tetrahedral interpolation. The cell of a pixel is split into six
+    tetrahedra along its main diagonal, the order of the fractions selects
+    the one that holds the pixel. Walking from the first node along the axes
+    of the largest, the middle and the smallest fraction visits its four
+    corners, weighted by the differences of the sorted fractions.
+*/
+static inline uint32_t _filters_lut3d_pixel(
+                           const filters_lut3d_t *lut,
+                           uint32_t pixel
+                       )
+{
+    size_t size =
+        lut->size;
+
+    uint32_t blue =
+        lut->coordinates[0][pixel & 0xff];
+    uint32_t green =
+        lut->coordinates[1][(pixel >> 8) & 0xff];
+    uint32_t red =
+        lut->coordinates[2][(pixel >> 16) & 0xff];
+
+    size_t base =
+        (red >> (FILTERS_LUT3D_FRACTION_SHIFT + 1)) +
+        size * ((green >> (FILTERS_LUT3D_FRACTION_SHIFT + 1)) +
+                size * (blue >> (FILTERS_LUT3D_FRACTION_SHIFT + 1)));
+
+    uint32_t fractions[3] = {
+        red & FILTERS_LUT3D_FRACTION_MASK,
+        green & FILTERS_LUT3D_FRACTION_MASK,
+        blue & FILTERS_LUT3D_FRACTION_MASK
+    };
+    size_t steps[3] = {
+        1, size, size * size
+    };
+
+    /* The same three compare and exchange steps as the vector code */
+#define FILTERS_LUT3D_SORT(A, B)                                            \
+    if (fractions[A] < fractions[B]) {                                      \
+        uint32_t fraction = fractions[A];                                   \
+        fractions[A] = fractions[B];                                        \
+        fractions[B] = fraction;                                            \
+        size_t step = steps[A];                                             \
+        steps[A] = steps[B];                                                \
+        steps[B] = step;                                                    \
+    }
+
+    FILTERS_LUT3D_SORT(0, 1)
+    FILTERS_LUT3D_SORT(1, 2)
+    FILTERS_LUT3D_SORT(0, 1)
+
+#undef FILTERS_LUT3D_SORT
+
+    uint32_t corners[4] = {
+        lut->nodes[base],
+        lut->nodes[base + steps[0]],
+        lut->nodes[base + steps[0] + steps[1]],
+        lut->nodes[base + 1 + size + size * size]
+    };
+    int32_t weights[4] = {
+        (int32_t) FILTERS_LUT3D_FRACTION_ONE - (int32_t) fractions[0],
+        (int32_t) fractions[0] - (int32_t) fractions[1],
+        (int32_t) fractions[1] - (int32_t) fractions[2],
+        (int32_t) fractions[2]
+    };
+
+    uint32_t result =
+        pixel & 0xff000000u;
+    for (size_t channel = 0; channel < 3; ++channel) {
+        int32_t sum =
+            1 << (FILTERS_LUT3D_SUM_SHIFT - 1);
+        for (size_t corner = 0; corner < 4; ++corner) {
+            sum +=
+                weights[corner] *
+                (int32_t) ((corners[corner] >> (channel * FILTERS_LUT3D_NODE_BITS)) & FILTERS_LUT3D_NODE_MASK);
+        }
+
+        result |=
+            (uint32_t) (sum >> FILTERS_LUT3D_SUM_SHIFT) << (channel * 8);
+    }
+
+    return result;
+}
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+
+/*
+    The vector code pairs the channel of two corners in the 16-bit halves of
+    a lane and their weights alike, so that `vpmaddwd` sums two corners at a
+    time. The channel at `low_shift` of `low` goes to the lower half, the one
+    of `high` is moved to the upper half by shifting it left by `high_left`
+    and right by `high_right` bits.
+*/
+
+#if defined __AVX512BW__
+
+static inline __m512i _filters_lut3d_pair_16(
+                          __m512i low,
+                          __m512i high,
+                          __m128i low_shift,
+                          __m128i high_left,
+                          __m128i high_right
+                      )
+{
+    return
+        _mm512_or_si512(
+            _mm512_and_si512(_mm512_srl_epi32(low, low_shift), _mm512_set1_epi32(FILTERS_LUT3D_NODE_MASK)),
+            _mm512_and_si512(
+                _mm512_srl_epi32(_mm512_sll_epi32(high, high_left), high_right),
+                _mm512_set1_epi32(FILTERS_LUT3D_NODE_MASK << 16)
+            )
+        );
+}
+
+static inline void _filters_lut3d_sort_16(
+                       __m512i *fraction_a,
+                       __m512i *step_a,
+                       __m512i *fraction_b,
+                       __m512i *step_b
+                   )
+{
+    __mmask16 swap =
+        _mm512_cmplt_epi32_mask(*fraction_a, *fraction_b);
+
+    __m512i fraction =
+        *fraction_a;
+    __m512i step =
+        *step_a;
+    *fraction_a =
+        _mm512_mask_blend_epi32(swap, fraction, *fraction_b);
+    *step_a =
+        _mm512_mask_blend_epi32(swap, step, *step_b);
+    *fraction_b =
+        _mm512_mask_blend_epi32(swap, *fraction_b, fraction);
+    *step_b =
+        _mm512_mask_blend_epi32(swap, *step_b, step);
+}
+
+static inline void _filters_lut3d_16(
+                       const filters_lut3d_t *lut,
+                       uint8_t *pixels
+                   )
+{
+    const __m512i byte_mask =
+        _mm512_set1_epi32(0xff);
+    const __m512i fraction_mask =
+        _mm512_set1_epi32(FILTERS_LUT3D_FRACTION_MASK);
+    const __m512i size =
+        _mm512_set1_epi32((int32_t) lut->size);
+
+    __m512i source =
+        _mm512_loadu_si512((const void *) pixels);
+
+    __m512i blue =
+        _mm512_i32gather_epi32(
+            _mm512_and_si512(source, byte_mask), (const void *) lut->coordinates[0], 4
+        );
+    __m512i green =
+        _mm512_i32gather_epi32(
+            _mm512_and_si512(_mm512_srli_epi32(source, 8), byte_mask), (const void *) lut->coordinates[1], 4
+        );
+    __m512i red =
+        _mm512_i32gather_epi32(
+            _mm512_and_si512(_mm512_srli_epi32(source, 16), byte_mask), (const void *) lut->coordinates[2], 4
+        );
+
+    __m512i base =
+        _mm512_add_epi32(
+            _mm512_srli_epi32(red, FILTERS_LUT3D_FRACTION_SHIFT + 1),
+            _mm512_mullo_epi32(
+                size,
+                _mm512_add_epi32(
+                    _mm512_srli_epi32(green, FILTERS_LUT3D_FRACTION_SHIFT + 1),
+                    _mm512_mullo_epi32(size, _mm512_srli_epi32(blue, FILTERS_LUT3D_FRACTION_SHIFT + 1))
+                )
+            )
+        );
+
+    __m512i fractions[3] = {
+        _mm512_and_si512(red, fraction_mask),
+        _mm512_and_si512(green, fraction_mask),
+        _mm512_and_si512(blue, fraction_mask)
+    };
+    __m512i steps[3] = {
+        _mm512_set1_epi32(1),
+        size,
+        _mm512_mullo_epi32(size, size)
+    };
+    __m512i diagonal =
+        _mm512_add_epi32(_mm512_add_epi32(steps[0], steps[1]), steps[2]);
+
+    _filters_lut3d_sort_16(&fractions[0], &steps[0], &fractions[1], &steps[1]);
+    _filters_lut3d_sort_16(&fractions[1], &steps[1], &fractions[2], &steps[2]);
+    _filters_lut3d_sort_16(&fractions[0], &steps[0], &fractions[1], &steps[1]);
+
+    __m512i second =
+        _mm512_add_epi32(base, steps[0]);
+    __m512i corners[4] = {
+        _mm512_i32gather_epi32(base, (const void *) lut->nodes, 4),
+        _mm512_i32gather_epi32(second, (const void *) lut->nodes, 4),
+        _mm512_i32gather_epi32(_mm512_add_epi32(second, steps[1]), (const void *) lut->nodes, 4),
+        _mm512_i32gather_epi32(_mm512_add_epi32(base, diagonal), (const void *) lut->nodes, 4)
+    };
+
+    __m512i first_weights =
+        _mm512_or_si512(
+            _mm512_sub_epi32(_mm512_set1_epi32(FILTERS_LUT3D_FRACTION_ONE), fractions[0]),
+            _mm512_slli_epi32(_mm512_sub_epi32(fractions[0], fractions[1]), 16)
+        );
+    __m512i second_weights =
+        _mm512_or_si512(
+            _mm512_sub_epi32(fractions[1], fractions[2]),
+            _mm512_slli_epi32(fractions[2], 16)
+        );
+
+    __m512i result =
+        _mm512_and_si512(source, _mm512_set1_epi32((int32_t) 0xff000000u));
+    for (size_t channel = 0; channel < 3; ++channel) {
+        int shift =
+            (int) (channel * FILTERS_LUT3D_NODE_BITS);
+        __m128i low_shift =
+            _mm_cvtsi32_si128(shift);
+        __m128i high_left =
+            _mm_cvtsi32_si128(16 > shift ? 16 - shift : 0);
+        __m128i high_right =
+            _mm_cvtsi32_si128(16 < shift ? shift - 16 : 0);
+
+        __m512i sum =
+            _mm512_add_epi32(
+                _mm512_add_epi32(
+                    _mm512_madd_epi16(
+                        _filters_lut3d_pair_16(corners[0], corners[1], low_shift, high_left, high_right),
+                        first_weights
+                    ),
+                    _mm512_madd_epi16(
+                        _filters_lut3d_pair_16(corners[2], corners[3], low_shift, high_left, high_right),
+                        second_weights
+                    )
+                ),
+                _mm512_set1_epi32(1 << (FILTERS_LUT3D_SUM_SHIFT - 1))
+            );
+
+        result =
+            _mm512_or_si512(
+                result,
+                _mm512_sll_epi32(
+                    _mm512_srli_epi32(sum, FILTERS_LUT3D_SUM_SHIFT),
+                    _mm_cvtsi32_si128((int) channel * 8)
+                )
+            );
+    }
+
+    _mm512_storeu_si512((void *) pixels, result);
+}
+
+#else
+
+static inline __m256i _filters_lut3d_pair_8(
+                          __m256i low,
+                          __m256i high,
+                          __m128i low_shift,
+                          __m128i high_left,
+                          __m128i high_right
+                      )
+{
+    return
+        _mm256_or_si256(
+            _mm256_and_si256(_mm256_srl_epi32(low, low_shift), _mm256_set1_epi32(FILTERS_LUT3D_NODE_MASK)),
+            _mm256_and_si256(
+                _mm256_srl_epi32(_mm256_sll_epi32(high, high_left), high_right),
+                _mm256_set1_epi32(FILTERS_LUT3D_NODE_MASK << 16)
+            )
+        );
+}
+
+static inline void _filters_lut3d_sort_8(
+                       __m256i *fraction_a,
+                       __m256i *step_a,
+                       __m256i *fraction_b,
+                       __m256i *step_b
+                   )
+{
+    __m256i swap =
+        _mm256_cmpgt_epi32(*fraction_b, *fraction_a);
+
+    __m256i fraction =
+        *fraction_a;
+    __m256i step =
+        *step_a;
+    *fraction_a =
+        _mm256_blendv_epi8(fraction, *fraction_b, swap);
+    *step_a =
+        _mm256_blendv_epi8(step, *step_b, swap);
+    *fraction_b =
+        _mm256_blendv_epi8(*fraction_b, fraction, swap);
+    *step_b =
+        _mm256_blendv_epi8(*step_b, step, swap);
+}
+
+static inline void _filters_lut3d_8(
+                       const filters_lut3d_t *lut,
+                       uint8_t *pixels
+                   )
+{
+    const __m256i byte_mask =
+        _mm256_set1_epi32(0xff);
+    const __m256i fraction_mask =
+        _mm256_set1_epi32(FILTERS_LUT3D_FRACTION_MASK);
+    const __m256i size =
+        _mm256_set1_epi32((int32_t) lut->size);
+
+    __m256i source =
+        _mm256_loadu_si256((const __m256i *) pixels);
+
+    __m256i blue =
+        _mm256_i32gather_epi32(
+            (const int *) lut->coordinates[0], _mm256_and_si256(source, byte_mask), 4
+        );
+    __m256i green =
+        _mm256_i32gather_epi32(
+            (const int *) lut->coordinates[1], _mm256_and_si256(_mm256_srli_epi32(source, 8), byte_mask), 4
+        );
+    __m256i red =
+        _mm256_i32gather_epi32(
+            (const int *) lut->coordinates[2], _mm256_and_si256(_mm256_srli_epi32(source, 16), byte_mask), 4
+        );
+
+    __m256i base =
+        _mm256_add_epi32(
+            _mm256_srli_epi32(red, FILTERS_LUT3D_FRACTION_SHIFT + 1),
+            _mm256_mullo_epi32(
+                size,
+                _mm256_add_epi32(
+                    _mm256_srli_epi32(green, FILTERS_LUT3D_FRACTION_SHIFT + 1),
+                    _mm256_mullo_epi32(size, _mm256_srli_epi32(blue, FILTERS_LUT3D_FRACTION_SHIFT + 1))
+                )
+            )
+        );
+
+    __m256i fractions[3] = {
+        _mm256_and_si256(red, fraction_mask),
+        _mm256_and_si256(green, fraction_mask),
+        _mm256_and_si256(blue, fraction_mask)
+    };
+    __m256i steps[3] = {
+        _mm256_set1_epi32(1),
+        size,
+        _mm256_mullo_epi32(size, size)
+    };
+    __m256i diagonal =
+        _mm256_add_epi32(_mm256_add_epi32(steps[0], steps[1]), steps[2]);
+
+    _filters_lut3d_sort_8(&fractions[0], &steps[0], &fractions[1], &steps[1]);
+    _filters_lut3d_sort_8(&fractions[1], &steps[1], &fractions[2], &steps[2]);
+    _filters_lut3d_sort_8(&fractions[0], &steps[0], &fractions[1], &steps[1]);
+
+    const int *nodes =
+        (const int *) lut->nodes;
+    __m256i second =
+        _mm256_add_epi32(base, steps[0]);
+    __m256i corners[4] = {
+        _mm256_i32gather_epi32(nodes, base, 4),
+        _mm256_i32gather_epi32(nodes, second, 4),
+        _mm256_i32gather_epi32(nodes, _mm256_add_epi32(second, steps[1]), 4),
+        _mm256_i32gather_epi32(nodes, _mm256_add_epi32(base, diagonal), 4)
+    };
+
+    __m256i first_weights =
+        _mm256_or_si256(
+            _mm256_sub_epi32(_mm256_set1_epi32(FILTERS_LUT3D_FRACTION_ONE), fractions[0]),
+            _mm256_slli_epi32(_mm256_sub_epi32(fractions[0], fractions[1]), 16)
+        );
+    __m256i second_weights =
+        _mm256_or_si256(
+            _mm256_sub_epi32(fractions[1], fractions[2]),
+            _mm256_slli_epi32(fractions[2], 16)
+        );
+
+    __m256i result =
+        _mm256_and_si256(source, _mm256_set1_epi32((int32_t) 0xff000000u));
+    for (size_t channel = 0; channel < 3; ++channel) {
+        int shift =
+            (int) (channel * FILTERS_LUT3D_NODE_BITS);
+        __m128i low_shift =
+            _mm_cvtsi32_si128(shift);
+        __m128i high_left =
+            _mm_cvtsi32_si128(16 > shift ? 16 - shift : 0);
+        __m128i high_right =
+            _mm_cvtsi32_si128(16 < shift ? shift - 16 : 0);
+
+        __m256i sum =
+            _mm256_add_epi32(
+                _mm256_add_epi32(
+                    _mm256_madd_epi16(
+                        _filters_lut3d_pair_8(corners[0], corners[1], low_shift, high_left, high_right),
+                        first_weights
+                    ),
+                    _mm256_madd_epi16(
+                        _filters_lut3d_pair_8(corners[2], corners[3], low_shift, high_left, high_right),
+                        second_weights
+                    )
+                ),
+                _mm256_set1_epi32(1 << (FILTERS_LUT3D_SUM_SHIFT - 1))
+            );
+
+        result =
+            _mm256_or_si256(
+                result,
+                _mm256_sll_epi32(
+                    _mm256_srli_epi32(sum, FILTERS_LUT3D_SUM_SHIFT),
+                    _mm_cvtsi32_si128((int) channel * 8)
+                )
+            );
+    }
+
+    _mm256_storeu_si256((__m256i *) pixels, result);
+}
+
+#endif
+#endif
+
+/* Maps `count` pixels through the LUT, the alpha channel is passed through */
+static inline void filters_apply_lut3d(
+                       const filters_lut3d_t *lut,
+                       uint8_t *pixels,
+                       size_t count
+                   )
+{
+    size_t x = 0;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#if defined __AVX512BW__
+
+    for (; x + 16 <= count; x += 16) {
+        _filters_lut3d_16(lut, &pixels[x * 4]);
+    }
+
+#else
+
+    for (; x + 8 <= count; x += 8) {
+        _filters_lut3d_8(lut, &pixels[x * 4]);
+    }
+
+#endif
+#endif
+
+    uint32_t *words =
+        (uint32_t *) pixels;
+    for (; x < count; ++x) {
+        words[x] =
+            _filters_lut3d_pixel(lut, words[x]);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef FILTERS_NEIGHBORHOOD_H
+#define FILTERS_NEIGHBORHOOD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FILTERS_NEIGHBORHOOD_MAX_RADIUS 64
+
+/*
+    Row kernels compute the pixels from `x_start` to `x_end` of one
+    destination row. `rows` holds the `2 * radius_y + 1` source rows around
+    it, rows above or below the image are replicated from the nearest edge.
+
+    The border kernel must clamp columns to the image. The interior kernel is
+    only called for columns that have `radius_x` neighbours on both sides and
+    can address them with plain pointer arithmetic.
+*/
+typedef void (*filters_neighborhood_kernel_t)(
+                  void *context,
+                  uint8_t **rows,
+                  uint8_t *destination_row,
+                  size_t x_start,
+                  size_t x_end,
+                  size_t width
+              );
+
+/* Optional, called once for every row before its kernels */
+typedef void (*filters_neighborhood_row_callback_t)(
+                  void *context,
+                  uint8_t **rows,
+                  size_t y
+              );
+
+/*
+    Source rows of one band of an image that is filtered in place.
+
+    The rows just above and below the band belong to the neighbouring bands
+    and are copied before any of them starts. The rows of the band itself are
+    copied into a ring as the window reaches them, before the band overwrites
+    them.
+*/
+typedef struct _filters_neighborhood_row_buffer
+{
+    size_t width, height;
+    size_t radius;
+    size_t y_start, y_end;
+    size_t stride;                  /* bytes between rows, a multiple of 64            */
+    size_t ring_size;               /* `2 * radius + 2` rows                          */
+    uint8_t *rows_above;            /* rows from `y_start - radius` to `y_start - 1`  */
+    uint8_t *rows_below;            /* rows from `y_end` to `y_end + radius - 1`      */
+    uint8_t *ring;
+} filters_neighborhood_row_buffer_t;
+
+typedef struct _filters_neighborhood
+{
+    size_t radius_x, radius_y;
+    filters_neighborhood_row_callback_t begin_row;
+    filters_neighborhood_kernel_t border_kernel;
+    filters_neighborhood_kernel_t interior_kernel;
+    void *context;
+} filters_neighborhood_t;
+
+static inline void filters_neighborhood_process(
+                       const filters_neighborhood_t *neighborhood,
+                       uint8_t *source_pixels,
+                       uint8_t *destination_pixels,
+                       size_t width,
+                       size_t height,
+                       size_t y_start,
+                       size_t y_end
+                   );
+
+static inline filters_neighborhood_row_buffer_t *filters_neighborhood_row_buffer_create(
+                                                     const uint8_t *pixels,
+                                                     size_t width,
+                                                     size_t height,
+                                                     size_t radius,
+                                                     size_t y_start,
+                                                     size_t y_end
+                                                 );
+
+static inline void filters_neighborhood_row_buffer_destroy(
+                       filters_neighborhood_row_buffer_t *buffer
+                   );
+
+static inline void filters_neighborhood_process_in_place(
+                       const filters_neighborhood_t *neighborhood,
+                       filters_neighborhood_row_buffer_t *buffer,
+                       uint8_t *pixels
+                   );
+
+#include "filters_neighborhood.impl.h.c"
+
+#endif /* FILTERS_NEIGHBORHOOD_H */
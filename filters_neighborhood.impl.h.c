@@ -0,0 +1,293 @@
+#include "filters_neighborhood.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/*
+    Runs a neighborhood filter over the rows from `y_start` to `y_end`.
+
+    The vertical border is handled once per row by replicating edge rows in
+    the table of row pointers. Every row is then split into the left frame,
+    the interior and the right frame of `radius_x` pixels, so that the
+    clamping of columns is only paid by the few pixels near the left and
+    right edges.
+*/
+static inline void filters_neighborhood_process(
+                       const filters_neighborhood_t *neighborhood,
+                       uint8_t *source_pixels,
+                       uint8_t *destination_pixels,
+                       size_t width,
+                       size_t height,
+                       size_t y_start,
+                       size_t y_end
+                   )
+{
+    size_t stride =
+        width * 4;
+    size_t radius_x =
+        neighborhood->radius_x;
+    size_t radius_y =
+        neighborhood->radius_y;
+    size_t diameter_y =
+        2 * radius_y + 1;
+
+    size_t interior_start =
+        UTILS_MIN(radius_x, width);
+    size_t interior_end =
+        width > 2 * radius_x ? width - radius_x : interior_start;
+
+    uint8_t *rows[2 * FILTERS_NEIGHBORHOOD_MAX_RADIUS + 1];
+    for (size_t y = y_start; y < y_end; ++y) {
+        for (size_t wy = 0; wy < diameter_y; ++wy) {
+            ssize_t adjusted_y =
+                UTILS_CLAMP((ssize_t) y - (ssize_t) radius_y + (ssize_t) wy, 0, (ssize_t) height - 1);
+
+            rows[wy] =
+                &source_pixels[(size_t) adjusted_y * stride];
+        }
+
+        if (NULL != neighborhood->begin_row) {
+            neighborhood->begin_row(neighborhood->context, rows, y);
+        }
+
+        uint8_t *destination_row =
+            &destination_pixels[y * stride];
+
+        if (0 < interior_start) {
+            neighborhood->border_kernel(
+                neighborhood->context,
+                rows, destination_row,
+                0, interior_start,
+                width
+            );
+        }
+
+        if (interior_start < interior_end) {
+            neighborhood->interior_kernel(
+                neighborhood->context,
+                rows, destination_row,
+                interior_start, interior_end,
+                width
+            );
+        }
+
+        if (interior_end < width) {
+            neighborhood->border_kernel(
+                neighborhood->context,
+                rows, destination_row,
+                interior_end, width,
+                width
+            );
+        }
+    }
+}
+
+/*
+    Snapshots the rows around the band from `y_start` to `y_end`. It has to
+    be called for every band before any of them is processed.
+*/
+static inline filters_neighborhood_row_buffer_t *filters_neighborhood_row_buffer_create(
+                                                     const uint8_t *pixels,
+                                                     size_t width,
+                                                     size_t height,
+                                                     size_t radius,
+                                                     size_t y_start,
+                                                     size_t y_end
+                                                 )
+{
+    filters_neighborhood_row_buffer_t *buffer =
+        malloc(sizeof(*buffer));
+
+    if (NULL == buffer) {
+        return buffer;
+    }
+
+    size_t row_size =
+        width * 4;
+
+    buffer->width =
+        width;
+    buffer->height =
+        height;
+    buffer->radius =
+        radius;
+    buffer->y_start =
+        y_start;
+    buffer->y_end =
+        y_end;
+    buffer->stride =
+        ((row_size + 63) / 64) * 64;
+
+    /*
+        One row more than the window, so that the row that has just left it
+        stays intact for kernels that update their state incrementally.
+    */
+    buffer->ring_size =
+        2 * radius + 2;
+
+    buffer->rows_above =
+        aligned_alloc(64, (2 * radius + buffer->ring_size) * buffer->stride);
+    if (NULL == buffer->rows_above) {
+        free(buffer);
+
+        return NULL;
+    }
+
+    buffer->rows_below =
+        buffer->rows_above + radius * buffer->stride;
+    buffer->ring =
+        buffer->rows_below + radius * buffer->stride;
+
+    for (size_t i = 0; i < radius; ++i) {
+        if (y_start >= radius - i) {
+            memcpy(
+                &buffer->rows_above[i * buffer->stride],
+                &pixels[(y_start - radius + i) * row_size],
+                row_size
+            );
+        }
+
+        if (y_end + i < height) {
+            memcpy(
+                &buffer->rows_below[i * buffer->stride],
+                &pixels[(y_end + i) * row_size],
+                row_size
+            );
+        }
+    }
+
+    return buffer;
+}
+
+static inline void filters_neighborhood_row_buffer_destroy(
+                       filters_neighborhood_row_buffer_t *buffer
+                   )
+{
+    if (NULL != buffer) {
+        free(buffer->rows_above);
+        free(buffer);
+    }
+}
+
+/* Copies the source row `y`, replicated at the image edges, into its ring slot */
+static inline uint8_t *_filters_neighborhood_row_buffer_load(
+                           filters_neighborhood_row_buffer_t *buffer,
+                           const uint8_t *pixels,
+                           ssize_t y
+                       )
+{
+    size_t row_size =
+        buffer->width * 4;
+    size_t source_y =
+        (size_t) UTILS_CLAMP(y, 0, (ssize_t) buffer->height - 1);
+
+    const uint8_t *source_row;
+    if (source_y < buffer->y_start) {
+        source_row =
+            &buffer->rows_above[(source_y + buffer->radius - buffer->y_start) * buffer->stride];
+    } else if (source_y >= buffer->y_end) {
+        source_row =
+            &buffer->rows_below[(source_y - buffer->y_end) * buffer->stride];
+    } else {
+        source_row =
+            &pixels[source_y * row_size];
+    }
+
+    uint8_t *slot =
+        &buffer->ring[
+            ((size_t) (y - (ssize_t) buffer->y_start + (ssize_t) buffer->radius) % buffer->ring_size) *
+                buffer->stride
+        ];
+
+    memcpy(slot, source_row, row_size);
+
+    return slot;
+}
+
+/*
+    Runs a neighborhood filter over the band of `buffer` and writes the
+    result back into `pixels`.
+
+    Every source row enters the ring before the output row with the same
+    index is written, so the rows of the band that are not in the ring yet
+    still hold source pixels. A band costs `4 * radius + 2` rows of memory
+    instead of a copy of the whole image.
+*/
+static inline void filters_neighborhood_process_in_place(
+                       const filters_neighborhood_t *neighborhood,
+                       filters_neighborhood_row_buffer_t *buffer,
+                       uint8_t *pixels
+                   )
+{
+    size_t width =
+        buffer->width;
+    size_t stride =
+        width * 4;
+    size_t radius_x =
+        neighborhood->radius_x;
+    ssize_t radius =
+        (ssize_t) buffer->radius;
+    size_t diameter =
+        2 * buffer->radius + 1;
+
+    size_t interior_start =
+        UTILS_MIN(radius_x, width);
+    size_t interior_end =
+        width > 2 * radius_x ? width - radius_x : interior_start;
+
+    uint8_t *rows[2 * FILTERS_NEIGHBORHOOD_MAX_RADIUS + 1];
+    for (size_t y = buffer->y_start; y < buffer->y_end; ++y) {
+        if (buffer->y_start == y) {
+            for (size_t wy = 0; wy < diameter; ++wy) {
+                rows[wy] =
+                    _filters_neighborhood_row_buffer_load(
+                        buffer, pixels,
+                        (ssize_t) y - radius + (ssize_t) wy
+                    );
+            }
+        } else {
+            memmove(&rows[0], &rows[1], (diameter - 1) * sizeof(rows[0]));
+            rows[diameter - 1] =
+                _filters_neighborhood_row_buffer_load(
+                    buffer, pixels,
+                    (ssize_t) y + radius
+                );
+        }
+
+        if (NULL != neighborhood->begin_row) {
+            neighborhood->begin_row(neighborhood->context, rows, y);
+        }
+
+        uint8_t *destination_row =
+            &pixels[y * stride];
+
+        if (0 < interior_start) {
+            neighborhood->border_kernel(
+                neighborhood->context,
+                rows, destination_row,
+                0, interior_start,
+                width
+            );
+        }
+
+        if (interior_start < interior_end) {
+            neighborhood->interior_kernel(
+                neighborhood->context,
+                rows, destination_row,
+                interior_start, interior_end,
+                width
+            );
+        }
+
+        if (interior_end < width) {
+            neighborhood->border_kernel(
+                neighborhood->context,
+                rows, destination_row,
+                interior_end, width,
+                width
+            );
+        }
+    }
+}
@@ -5,6 +5,11 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "filters.h"
+#include "filters_neighborhood.h"
+#include "filters_colorspace.h"
+#include "filters_lut3d.h"
+
 typedef struct _filters_brightness_contrast_data
 {
     size_t linear_position;
@@ -29,12 +34,169 @@ typedef struct _filters_median_data
     size_t linear_position;
     size_t channels_to_process;
     size_t image_width, image_height;
+    size_t radius;
     uint8_t *source_pixels;
     uint8_t *destination_pixels;
+    filters_neighborhood_row_buffer_t *row_buffer;  /* only for in place processing */
     volatile ssize_t *channels_left;
     volatile bool *barrier_sense;
 } filters_median_data_t;
 
+typedef struct _filters_color_matrix_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    uint8_t *pixels;
+    const filters_color_matrix_t *matrix;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_color_matrix_data_t;
+
+typedef struct _filters_gaussian_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    size_t image_width, image_height;
+    uint8_t *pixels;
+    const filters_gaussian_t *gaussian;
+    const filters_unsharp_mask_t *unsharp_mask; /* only for unsharp masks */
+    size_t first_row;               /* the image row of the first row of `rows`        */
+    uint8_t *rows;                  /* the band and the rows around it, see `_create`  */
+    uint8_t *padded_row;
+    uint8_t *strip;                 /* only for box blurs and unsharp masks            */
+    uint32_t *sums;                 /* only for box blurs                              */
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_gaussian_data_t;
+
+typedef struct _filters_convolution_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    size_t image_width, image_height;
+    uint8_t *pixels;
+    const filters_convolution_t *convolution;
+    filters_neighborhood_row_buffer_t *row_buffer;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_convolution_data_t;
+
+typedef struct _filters_edges_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    size_t image_width, image_height;
+    uint8_t *pixels;
+    const filters_edges_t *edges;
+    filters_neighborhood_row_buffer_t *row_buffer;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_edges_data_t;
+
+typedef struct _filters_resize_data
+{
+    size_t linear_position;         /* in the resized image                            */
+    size_t channels_to_process;
+    const uint8_t *source_pixels;
+    uint8_t *destination_pixels;
+    const filters_resize_t *resize;
+    uint8_t *rows;                  /* the horizontally resampled source rows          */
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_resize_data_t;
+
+typedef struct _filters_histogram_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    const uint8_t *pixels;
+    filters_histogram_t *histogram; /* the slot of the task, merged by the caller      */
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_histogram_data_t;
+
+typedef struct _filters_lut_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    uint8_t *pixels;
+    const filters_lut_t *lut;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_lut_data_t;
+
+#define FILTERS_COLORSPACE_TO_PLANES    0
+#define FILTERS_COLORSPACE_FROM_PLANES  1
+#define FILTERS_COLORSPACE_SHARPEN_LUMA 2
+
+/*
+    A band of whole rows converted between the pixels and the planes of an
+    image, or whose luma is sharpened from the planes into `sharpened_y`.
+*/
+typedef struct _filters_colorspace_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    uint8_t *pixels;
+    filters_planes_t *planes;
+    int direction;
+    const filters_unsharp_mask_t *unsharp_mask; /* only to sharpen the luma         */
+    uint8_t *sharpened_y;
+    uint32_t *scratch;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_colorspace_data_t;
+
+/* Pixels converted at a time by the grayscale tasks, their luma stays in the L1 cache */
+#define FILTERS_GRAYSCALE_CHUNK 1024
+
+typedef struct _filters_grayscale_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    uint8_t *pixels;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_grayscale_data_t;
+
+typedef struct _filters_transform_data
+{
+    size_t linear_position;         /* in the transformed image                        */
+    size_t channels_to_process;
+    const uint8_t *source_pixels;
+    uint8_t *destination_pixels;
+    size_t source_width, source_height;
+    int transform;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_transform_data_t;
+
+typedef struct _filters_lut3d_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    uint8_t *pixels;
+    const filters_lut3d_t *lut;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_lut3d_data_t;
+
+typedef struct _filters_morphology_data
+{
+    size_t linear_position;
+    size_t channels_to_process;
+    size_t image_width, image_height;
+    uint8_t *pixels;
+    const filters_morphology_t *morphology;
+    size_t first_row;               /* the image row of the first row of `rows`        */
+    uint8_t *rows;                  /* the band and the rows around it, see `_create`  */
+    uint8_t *intermediate;          /* only for openings and closings                  */
+    uint8_t *prefixes, *suffixes;
+    uint8_t *columns;
+    volatile ssize_t *channels_left;
+    volatile bool *barrier_sense;
+} filters_morphology_data_t;
+
 static inline filters_brightness_contrast_data_t *filters_brightness_contrast_data_create(
                                                        size_t linear_position,
                                                        size_t channels_to_process,
@@ -66,6 +228,7 @@ static inline filters_median_data_t *filters_median_data_create(
                                          size_t channels_to_process,
                                          size_t image_width,
                                          size_t image_height,
+                                         size_t radius,
                                          uint8_t *source_pixels,
                                          uint8_t *destination_pixels,
                                          volatile ssize_t *channels_left,
@@ -76,6 +239,187 @@ static inline void filters_median_data_destroy(
                        filters_median_data_t *data
                    );
 
+static inline filters_color_matrix_data_t *filters_color_matrix_data_create(
+                                               size_t linear_position,
+                                               size_t channels_to_process,
+                                               uint8_t *pixels,
+                                               const filters_color_matrix_t *matrix,
+                                               volatile ssize_t *channels_left,
+                                               volatile bool *barrier_sense
+                                           );
+
+static inline void filters_color_matrix_data_destroy(
+                       filters_color_matrix_data_t *data
+                   );
+
+static inline filters_gaussian_data_t *filters_gaussian_data_create(
+                                           size_t linear_position,
+                                           size_t channels_to_process,
+                                           size_t image_width,
+                                           size_t image_height,
+                                           uint8_t *pixels,
+                                           const filters_gaussian_t *gaussian,
+                                           volatile ssize_t *channels_left,
+                                           volatile bool *barrier_sense
+                                       );
+
+static inline void filters_gaussian_data_destroy(
+                       filters_gaussian_data_t *data
+                   );
+
+static inline filters_convolution_data_t *filters_convolution_data_create(
+                                              size_t linear_position,
+                                              size_t channels_to_process,
+                                              size_t image_width,
+                                              size_t image_height,
+                                              uint8_t *pixels,
+                                              const filters_convolution_t *convolution,
+                                              volatile ssize_t *channels_left,
+                                              volatile bool *barrier_sense
+                                          );
+
+static inline void filters_convolution_data_destroy(
+                       filters_convolution_data_t *data
+                   );
+
+static inline filters_resize_data_t *filters_resize_data_create(
+                                         size_t linear_position,
+                                         size_t channels_to_process,
+                                         const uint8_t *source_pixels,
+                                         uint8_t *destination_pixels,
+                                         const filters_resize_t *resize,
+                                         volatile ssize_t *channels_left,
+                                         volatile bool *barrier_sense
+                                     );
+
+static inline void filters_resize_data_destroy(
+                       filters_resize_data_t *data
+                   );
+
+static inline filters_histogram_data_t *filters_histogram_data_create(
+                                            size_t linear_position,
+                                            size_t channels_to_process,
+                                            const uint8_t *pixels,
+                                            filters_histogram_t *histogram,
+                                            volatile ssize_t *channels_left,
+                                            volatile bool *barrier_sense
+                                        );
+
+static inline void filters_histogram_data_destroy(
+                       filters_histogram_data_t *data
+                   );
+
+static inline filters_lut_data_t *filters_lut_data_create(
+                                      size_t linear_position,
+                                      size_t channels_to_process,
+                                      uint8_t *pixels,
+                                      const filters_lut_t *lut,
+                                      volatile ssize_t *channels_left,
+                                      volatile bool *barrier_sense
+                                  );
+
+static inline void filters_lut_data_destroy(
+                       filters_lut_data_t *data
+                   );
+
+static inline filters_colorspace_data_t *filters_colorspace_data_create(
+                                             size_t linear_position,
+                                             size_t channels_to_process,
+                                             uint8_t *pixels,
+                                             filters_planes_t *planes,
+                                             int direction,
+                                             const filters_unsharp_mask_t *unsharp_mask,
+                                             uint8_t *sharpened_y,
+                                             volatile ssize_t *channels_left,
+                                             volatile bool *barrier_sense
+                                         );
+
+static inline void filters_colorspace_data_destroy(
+                       filters_colorspace_data_t *data
+                   );
+
+static inline filters_grayscale_data_t *filters_grayscale_data_create(
+                                            size_t linear_position,
+                                            size_t channels_to_process,
+                                            uint8_t *pixels,
+                                            volatile ssize_t *channels_left,
+                                            volatile bool *barrier_sense
+                                        );
+
+static inline void filters_grayscale_data_destroy(
+                       filters_grayscale_data_t *data
+                   );
+
+static inline filters_transform_data_t *filters_transform_data_create(
+                                            size_t linear_position,
+                                            size_t channels_to_process,
+                                            const uint8_t *source_pixels,
+                                            uint8_t *destination_pixels,
+                                            size_t source_width,
+                                            size_t source_height,
+                                            int transform,
+                                            volatile ssize_t *channels_left,
+                                            volatile bool *barrier_sense
+                                        );
+
+static inline void filters_transform_data_destroy(
+                       filters_transform_data_t *data
+                   );
+
+static inline filters_gaussian_data_t *filters_unsharp_mask_data_create(
+                                           size_t linear_position,
+                                           size_t channels_to_process,
+                                           size_t image_width,
+                                           size_t image_height,
+                                           uint8_t *pixels,
+                                           const filters_unsharp_mask_t *unsharp_mask,
+                                           volatile ssize_t *channels_left,
+                                           volatile bool *barrier_sense
+                                       );
+
+static inline filters_edges_data_t *filters_edges_data_create(
+                                        size_t linear_position,
+                                        size_t channels_to_process,
+                                        size_t image_width,
+                                        size_t image_height,
+                                        uint8_t *pixels,
+                                        const filters_edges_t *edges,
+                                        volatile ssize_t *channels_left,
+                                        volatile bool *barrier_sense
+                                    );
+
+static inline void filters_edges_data_destroy(
+                       filters_edges_data_t *data
+                   );
+
+static inline filters_lut3d_data_t *filters_lut3d_data_create(
+                                        size_t linear_position,
+                                        size_t channels_to_process,
+                                        uint8_t *pixels,
+                                        const filters_lut3d_t *lut,
+                                        volatile ssize_t *channels_left,
+                                        volatile bool *barrier_sense
+                                    );
+
+static inline void filters_lut3d_data_destroy(
+                       filters_lut3d_data_t *data
+                   );
+
+static inline filters_morphology_data_t *filters_morphology_data_create(
+                                             size_t linear_position,
+                                             size_t channels_to_process,
+                                             size_t image_width,
+                                             size_t image_height,
+                                             uint8_t *pixels,
+                                             const filters_morphology_t *morphology,
+                                             volatile ssize_t *channels_left,
+                                             volatile bool *barrier_sense
+                                         );
+
+static inline void filters_morphology_data_destroy(
+                       filters_morphology_data_t *data
+                   );
+
 /* Threading Tasks */
 
 static void filters_brightness_contrast_processing_task(
@@ -93,7 +437,71 @@ static void filters_median_processing_task(
                 void (*result_callback)(void *result)
             );
 
+static void filters_color_matrix_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_gaussian_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_convolution_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_resize_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_histogram_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_lut_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_colorspace_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_grayscale_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_transform_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_unsharp_mask_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_edges_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_lut3d_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
+static void filters_morphology_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            );
+
 #include "filters_threading.impl.h.c"
 
 #endif /* FILTERS_THREADING_H */
-
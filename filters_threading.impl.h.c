@@ -1,7 +1,9 @@
 #include "filters_threading.h"
 #include "filters.h"
+#include "filters_neighborhood.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 static inline filters_brightness_contrast_data_t *filters_brightness_contrast_data_create(
                                                       size_t linear_position,
@@ -88,6 +90,7 @@ static inline filters_median_data_t *filters_median_data_create(
                                          size_t channels_to_process,
                                          size_t image_width,
                                          size_t image_height,
+                                         size_t radius,
                                          uint8_t *source_pixels,
                                          uint8_t *destination_pixels,
                                          volatile ssize_t *channels_left,
@@ -108,33 +111,1112 @@ static inline filters_median_data_t *filters_median_data_create(
         image_width;
     data->image_height =
         image_height;
+    data->radius =
+        radius;
     data->source_pixels =
         source_pixels;
     data->destination_pixels =
         destination_pixels;
+    data->row_buffer =
+        NULL;
     data->channels_left =
         channels_left;
     data->barrier_sense =
         barrier_sense;
 
+    /*
+        Filtering in place, the task keeps its own copy of the source rows it
+        needs. The rows of the neighbouring bands are copied here, so all the
+        tasks have to be created before the first one is started.
+    */
+    if (source_pixels == destination_pixels) {
+        size_t stride =
+            image_width * 4;
+
+        data->row_buffer =
+            filters_neighborhood_row_buffer_create(
+                source_pixels,
+                image_width, image_height,
+                radius,
+                linear_position / stride,
+                (linear_position + channels_to_process + stride - 1) / stride
+            );
+
+        if (NULL == data->row_buffer) {
+            free(data);
+
+            return NULL;
+        }
+    }
+
+    return data;
+}
+
+static inline void filters_median_data_destroy(
+                       filters_median_data_t *data
+                   )
+{
+    if (NULL != data) {
+        filters_neighborhood_row_buffer_destroy(data->row_buffer);
+        free(data);
+    }
+}
+
+static inline filters_color_matrix_data_t *filters_color_matrix_data_create(
+                                               size_t linear_position,
+                                               size_t channels_to_process,
+                                               uint8_t *pixels,
+                                               const filters_color_matrix_t *matrix,
+                                               volatile ssize_t *channels_left,
+                                               volatile bool *barrier_sense
+                                           ) {
+    filters_color_matrix_data_t *data =
+        malloc(sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->pixels =
+        pixels;
+    data->matrix =
+        matrix;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    return data;
+}
+
+static inline void filters_color_matrix_data_destroy(
+                       filters_color_matrix_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data);
+    }
+}
+
+static inline filters_gaussian_data_t *filters_gaussian_data_create(
+                                           size_t linear_position,
+                                           size_t channels_to_process,
+                                           size_t image_width,
+                                           size_t image_height,
+                                           uint8_t *pixels,
+                                           const filters_gaussian_t *gaussian,
+                                           volatile ssize_t *channels_left,
+                                           volatile bool *barrier_sense
+                                       ) {
+    filters_gaussian_data_t *data =
+        calloc(1, sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    size_t stride =
+        image_width * 4;
+    size_t y_start =
+        linear_position / stride;
+    size_t y_end =
+        (linear_position + channels_to_process + stride - 1) / stride;
+    size_t first_row =
+        y_start > gaussian->radius ? y_start - gaussian->radius : 0;
+    size_t last_row =
+        UTILS_MIN(y_end + gaussian->radius, image_height);
+    size_t rows_count =
+        last_row - first_row;
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->image_width =
+        image_width;
+    data->image_height =
+        image_height;
+    data->pixels =
+        pixels;
+    data->gaussian =
+        gaussian;
+    data->first_row =
+        first_row;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    data->rows =
+        aligned_alloc(64, ((rows_count * stride + 64) / 64 + 1) * 64);
+    data->padded_row =
+        malloc(filters_gaussian_padded_row_size(gaussian, image_width));
+    if (gaussian->box) {
+        data->strip =
+            aligned_alloc(64, rows_count * FILTERS_GAUSSIAN_COLUMN_BLOCK);
+        data->sums =
+            aligned_alloc(64, FILTERS_GAUSSIAN_COLUMN_BLOCK * sizeof(*data->sums));
+    }
+
+    if (NULL == data->rows || NULL == data->padded_row ||
+        (gaussian->box && (NULL == data->strip || NULL == data->sums))) {
+        filters_gaussian_data_destroy(data);
+
+        return NULL;
+    }
+
+    /*
+        The filter runs in place. The rows around the band belong to the
+        neighbouring tasks, so they are copied here, before any task starts,
+        and filtered horizontally by the task itself.
+    */
+    memcpy(data->rows, &pixels[first_row * stride], (y_start - first_row) * stride);
+    memcpy(
+        &data->rows[(y_end - first_row) * stride],
+        &pixels[y_end * stride],
+        (last_row - y_end) * stride
+    );
+
+    return data;
+}
+
+static inline void filters_gaussian_data_destroy(
+                       filters_gaussian_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data->rows);
+        free(data->padded_row);
+        free(data->strip);
+        free(data->sums);
+        free(data);
+    }
+}
+
+static inline filters_gaussian_data_t *filters_unsharp_mask_data_create(
+                                           size_t linear_position,
+                                           size_t channels_to_process,
+                                           size_t image_width,
+                                           size_t image_height,
+                                           uint8_t *pixels,
+                                           const filters_unsharp_mask_t *unsharp_mask,
+                                           volatile ssize_t *channels_left,
+                                           volatile bool *barrier_sense
+                                       ) {
+    filters_gaussian_data_t *data =
+        filters_gaussian_data_create(
+            linear_position,
+            channels_to_process,
+            image_width, image_height,
+            pixels,
+            &unsharp_mask->gaussian,
+            channels_left,
+            barrier_sense
+        );
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->unsharp_mask =
+        unsharp_mask;
+
+    /* The blurred rows of the sampled kernel need a strip as well, a single row of it */
+    if (NULL == data->strip) {
+        data->strip =
+            aligned_alloc(64, FILTERS_GAUSSIAN_COLUMN_BLOCK);
+        if (NULL == data->strip) {
+            filters_gaussian_data_destroy(data);
+
+            return NULL;
+        }
+    }
+
+    return data;
+}
+
+static inline filters_convolution_data_t *filters_convolution_data_create(
+                                              size_t linear_position,
+                                              size_t channels_to_process,
+                                              size_t image_width,
+                                              size_t image_height,
+                                              uint8_t *pixels,
+                                              const filters_convolution_t *convolution,
+                                              volatile ssize_t *channels_left,
+                                              volatile bool *barrier_sense
+                                          ) {
+    filters_convolution_data_t *data =
+        malloc(sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    size_t stride =
+        image_width * 4;
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->image_width =
+        image_width;
+    data->image_height =
+        image_height;
+    data->pixels =
+        pixels;
+    data->convolution =
+        convolution;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    /* The filter runs in place like the median, see `filters_median_data_create` */
+    data->row_buffer =
+        filters_neighborhood_row_buffer_create(
+            pixels,
+            image_width, image_height,
+            convolution->height / 2,
+            linear_position / stride,
+            (linear_position + channels_to_process + stride - 1) / stride
+        );
+
+    if (NULL == data->row_buffer) {
+        free(data);
+
+        return NULL;
+    }
+
+    return data;
+}
+
+static inline void filters_convolution_data_destroy(
+                       filters_convolution_data_t *data
+                   )
+{
+    if (NULL != data) {
+        filters_neighborhood_row_buffer_destroy(data->row_buffer);
+        free(data);
+    }
+}
+
+/* The source rows that the output rows of the band are resampled from */
+static inline void _filters_resize_source_rows(
+                       const filters_resize_t *resize,
+                       size_t linear_position,
+                       size_t channels_to_process,
+                       size_t *first_row,
+                       size_t *last_row
+                   )
+{
+    size_t stride =
+        resize->width * 4;
+    size_t y_start =
+        linear_position / stride;
+    size_t y_end =
+        (linear_position + channels_to_process + stride - 1) / stride;
+
+    *first_row =
+        resize->vertical.starts[y_start];
+    *last_row =
+        UTILS_MIN(resize->vertical.starts[y_end - 1] + resize->vertical.taps, resize->source_height);
+}
+
+static inline filters_resize_data_t *filters_resize_data_create(
+                                         size_t linear_position,
+                                         size_t channels_to_process,
+                                         const uint8_t *source_pixels,
+                                         uint8_t *destination_pixels,
+                                         const filters_resize_t *resize,
+                                         volatile ssize_t *channels_left,
+                                         volatile bool *barrier_sense
+                                     ) {
+    filters_resize_data_t *data =
+        calloc(1, sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->source_pixels =
+        source_pixels;
+    data->destination_pixels =
+        destination_pixels;
+    data->resize =
+        resize;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    size_t first_row, last_row;
+    _filters_resize_source_rows(resize, linear_position, channels_to_process, &first_row, &last_row);
+
+    data->rows =
+        aligned_alloc(64, (((last_row - first_row) * resize->width * 4 + 64) / 64 + 1) * 64);
+
+    if (NULL == data->rows) {
+        free(data);
+
+        return NULL;
+    }
+
+    return data;
+}
+
+static inline void filters_resize_data_destroy(
+                       filters_resize_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data->rows);
+        free(data);
+    }
+}
+
+static inline filters_histogram_data_t *filters_histogram_data_create(
+                                            size_t linear_position,
+                                            size_t channels_to_process,
+                                            const uint8_t *pixels,
+                                            filters_histogram_t *histogram,
+                                            volatile ssize_t *channels_left,
+                                            volatile bool *barrier_sense
+                                        ) {
+    filters_histogram_data_t *data =
+        malloc(sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->pixels =
+        pixels;
+    data->histogram =
+        histogram;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    return data;
+}
+
+static inline void filters_histogram_data_destroy(
+                       filters_histogram_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data);
+    }
+}
+
+static inline filters_lut_data_t *filters_lut_data_create(
+                                      size_t linear_position,
+                                      size_t channels_to_process,
+                                      uint8_t *pixels,
+                                      const filters_lut_t *lut,
+                                      volatile ssize_t *channels_left,
+                                      volatile bool *barrier_sense
+                                  ) {
+    filters_lut_data_t *data =
+        malloc(sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->pixels =
+        pixels;
+    data->lut =
+        lut;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    return data;
+}
+
+static inline void filters_lut_data_destroy(
+                       filters_lut_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data);
+    }
+}
+
+static inline filters_colorspace_data_t *filters_colorspace_data_create(
+                                             size_t linear_position,
+                                             size_t channels_to_process,
+                                             uint8_t *pixels,
+                                             filters_planes_t *planes,
+                                             int direction,
+                                             const filters_unsharp_mask_t *unsharp_mask,
+                                             uint8_t *sharpened_y,
+                                             volatile ssize_t *channels_left,
+                                             volatile bool *barrier_sense
+                                         ) {
+    filters_colorspace_data_t *data =
+        calloc(1, sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->pixels =
+        pixels;
+    data->planes =
+        planes;
+    data->direction =
+        direction;
+    data->unsharp_mask =
+        unsharp_mask;
+    data->sharpened_y =
+        sharpened_y;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    if (FILTERS_COLORSPACE_SHARPEN_LUMA == direction) {
+        size_t stride =
+            planes->width * 4;
+        size_t y_start =
+            linear_position / stride;
+        size_t y_end =
+            (linear_position + channels_to_process + stride - 1) / stride;
+
+        data->scratch =
+            malloc(
+                FILTERS_COLORSPACE_SHARPEN_SCRATCH_SIZE(
+                    planes->width, y_end - y_start, unsharp_mask->gaussian.radius
+                ) * sizeof(*data->scratch)
+            );
+        if (NULL == data->scratch) {
+            filters_colorspace_data_destroy(data);
+
+            return NULL;
+        }
+    }
+
+    return data;
+}
+
+static inline void filters_colorspace_data_destroy(
+                       filters_colorspace_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data->scratch);
+        free(data);
+    }
+}
+
+static inline filters_grayscale_data_t *filters_grayscale_data_create(
+                                            size_t linear_position,
+                                            size_t channels_to_process,
+                                            uint8_t *pixels,
+                                            volatile ssize_t *channels_left,
+                                            volatile bool *barrier_sense
+                                        ) {
+    filters_grayscale_data_t *data =
+        malloc(sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->pixels =
+        pixels;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    return data;
+}
+
+static inline void filters_grayscale_data_destroy(
+                       filters_grayscale_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data);
+    }
+}
+
+static inline filters_transform_data_t *filters_transform_data_create(
+                                            size_t linear_position,
+                                            size_t channels_to_process,
+                                            const uint8_t *source_pixels,
+                                            uint8_t *destination_pixels,
+                                            size_t source_width,
+                                            size_t source_height,
+                                            int transform,
+                                            volatile ssize_t *channels_left,
+                                            volatile bool *barrier_sense
+                                        ) {
+    filters_transform_data_t *data =
+        malloc(sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->source_pixels =
+        source_pixels;
+    data->destination_pixels =
+        destination_pixels;
+    data->source_width =
+        source_width;
+    data->source_height =
+        source_height;
+    data->transform =
+        transform;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    return data;
+}
+
+static inline void filters_transform_data_destroy(
+                       filters_transform_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data);
+    }
+}
+
+static inline filters_edges_data_t *filters_edges_data_create(
+                                        size_t linear_position,
+                                        size_t channels_to_process,
+                                        size_t image_width,
+                                        size_t image_height,
+                                        uint8_t *pixels,
+                                        const filters_edges_t *edges,
+                                        volatile ssize_t *channels_left,
+                                        volatile bool *barrier_sense
+                                    ) {
+    filters_edges_data_t *data =
+        malloc(sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    size_t stride =
+        image_width * 4;
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->image_width =
+        image_width;
+    data->image_height =
+        image_height;
+    data->pixels =
+        pixels;
+    data->edges =
+        edges;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    /* The filter runs in place like the median, see `filters_median_data_create` */
+    data->row_buffer =
+        filters_neighborhood_row_buffer_create(
+            pixels,
+            image_width, image_height,
+            1,
+            linear_position / stride,
+            (linear_position + channels_to_process + stride - 1) / stride
+        );
+
+    if (NULL == data->row_buffer) {
+        free(data);
+
+        return NULL;
+    }
+
+    return data;
+}
+
+static inline void filters_edges_data_destroy(
+                       filters_edges_data_t *data
+                   )
+{
+    if (NULL != data) {
+        filters_neighborhood_row_buffer_destroy(data->row_buffer);
+        free(data);
+    }
+}
+
+static inline filters_lut3d_data_t *filters_lut3d_data_create(
+                                        size_t linear_position,
+                                        size_t channels_to_process,
+                                        uint8_t *pixels,
+                                        const filters_lut3d_t *lut,
+                                        volatile ssize_t *channels_left,
+                                        volatile bool *barrier_sense
+                                    ) {
+    filters_lut3d_data_t *data =
+        malloc(sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->pixels =
+        pixels;
+    data->lut =
+        lut;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    return data;
+}
+
+static inline void filters_lut3d_data_destroy(
+                       filters_lut3d_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data);
+    }
+}
+
+static inline filters_morphology_data_t *filters_morphology_data_create(
+                                             size_t linear_position,
+                                             size_t channels_to_process,
+                                             size_t image_width,
+                                             size_t image_height,
+                                             uint8_t *pixels,
+                                             const filters_morphology_t *morphology,
+                                             volatile ssize_t *channels_left,
+                                             volatile bool *barrier_sense
+                                         ) {
+    filters_morphology_data_t *data =
+        calloc(1, sizeof(*data));
+
+    if (NULL == data) {
+        return data;
+    }
+
+    size_t stride =
+        image_width * 4;
+    size_t y_start =
+        linear_position / stride;
+    size_t y_end =
+        (linear_position + channels_to_process + stride - 1) / stride;
+    bool fused =
+        FILTERS_MORPHOLOGY_OPEN == morphology->operation ||
+        FILTERS_MORPHOLOGY_CLOSE == morphology->operation;
+    size_t reach =
+        filters_morphology_reach(morphology);
+    size_t first_row =
+        y_start > reach ? y_start - reach : 0;
+    size_t last_row =
+        UTILS_MIN(y_end + reach, image_height);
+    size_t rows_count =
+        last_row - first_row;
+    size_t buffer_size =
+        filters_morphology_buffer_size(morphology, image_width, rows_count);
+
+    data->linear_position =
+        linear_position;
+    data->channels_to_process =
+        channels_to_process;
+    data->image_width =
+        image_width;
+    data->image_height =
+        image_height;
+    data->pixels =
+        pixels;
+    data->morphology =
+        morphology;
+    data->first_row =
+        first_row;
+    data->channels_left =
+        channels_left;
+    data->barrier_sense =
+        barrier_sense;
+
+    data->rows =
+        aligned_alloc(64, ((rows_count * stride + 64) / 64 + 1) * 64);
+    if (fused) {
+        data->intermediate =
+            aligned_alloc(64, ((rows_count * stride + 64) / 64 + 1) * 64);
+    }
+    data->prefixes =
+        aligned_alloc(64, (buffer_size / 64 + 1) * 64);
+    data->suffixes =
+        aligned_alloc(64, (buffer_size / 64 + 1) * 64);
+    data->columns =
+        aligned_alloc(64, (image_width + 1) * 64);
+
+    if (NULL == data->rows || NULL == data->prefixes || NULL == data->suffixes || NULL == data->columns ||
+        (fused && NULL == data->intermediate)) {
+        filters_morphology_data_destroy(data);
+
+        return NULL;
+    }
+
+    /*
+        The filter runs in place. The rows around the band belong to the
+        neighbouring tasks, so they are copied here, before any task starts.
+    */
+    memcpy(data->rows, &pixels[first_row * stride], (y_start - first_row) * stride);
+    memcpy(
+        &data->rows[(y_end - first_row) * stride],
+        &pixels[y_end * stride],
+        (last_row - y_end) * stride
+    );
+
     return data;
 }
 
-static inline void filters_median_data_destroy(
-                       filters_median_data_t *data
-                   )
-{
-    if (NULL != data) {
-        free(data);
+static inline void filters_morphology_data_destroy(
+                       filters_morphology_data_t *data
+                   )
+{
+    if (NULL != data) {
+        free(data->rows);
+        free(data->intermediate);
+        free(data->prefixes);
+        free(data->suffixes);
+        free(data->columns);
+        free(data);
+    }
+}
+
+static void filters_brightness_contrast_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_brightness_contrast_data_t *data =
+        task_data;
+
+    size_t linear_position =
+        data->linear_position;
+    size_t channels_to_process =
+        data->channels_to_process;
+    size_t end =
+        linear_position + channels_to_process;
+    uint8_t *pixels =
+        data->pixels;
+    float brightness =
+        data->brightness;
+    float contrast =
+        data->contrast;
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+    size_t step =
+        16;
+#else
+    size_t step =
+        4;
+#endif
+
+    for (; linear_position < end; linear_position += step) {
+        filters_apply_brightness_contrast(
+            pixels, linear_position,
+            brightness, contrast
+        );
+    }
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_brightness_contrast_data_destroy(data);
+}
+
+static void filters_sepia_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_sepia_data_t *data =
+        task_data;
+
+    size_t linear_position =
+        data->linear_position;
+    size_t channels_to_process =
+        data->channels_to_process;
+    size_t end =
+        linear_position + channels_to_process;
+    uint8_t *pixels =
+        data->pixels;
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+    size_t step =
+        16;
+#else
+    size_t step =
+        4;
+#endif
+
+    for (; linear_position < end; linear_position += step) {
+        filters_apply_sepia(pixels, linear_position);
+    }
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_sepia_data_destroy(data);
+}
+
+/* Median Row Kernels */
+
+static void _filters_median_network_border_kernel(
+                void *context __attribute__((unused)),
+                uint8_t **rows,
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width
+            )
+{
+    for (size_t x = x_start; x < x_end; ++x) {
+        filters_apply_median(rows, destination_row, x, width);
+    }
+}
+
+static void _filters_median_network_interior_kernel(
+                void *context __attribute__((unused)),
+                uint8_t **rows,
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width __attribute__((unused))
+            )
+{
+    size_t x =
+        x_start;
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+    for (; x + FILTERS_MEDIAN_BLOCK_SIZE <= x_end; x += FILTERS_MEDIAN_BLOCK_SIZE) {
+        filters_apply_median_block(rows, destination_row, x);
+    }
+#endif
+
+    for (; x < x_end; ++x) {
+        filters_apply_median_interior(rows, destination_row, x);
+    }
+}
+
+static void _filters_median_huang_border_kernel(
+                void *context,
+                uint8_t **rows,
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width
+            )
+{
+    filters_apply_median_huang(
+        rows, destination_row,
+        x_start, x_end,
+        width,
+        *(size_t *) context,
+        true
+    );
+}
+
+static void _filters_median_huang_interior_kernel(
+                void *context,
+                uint8_t **rows,
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width
+            )
+{
+    filters_apply_median_huang(
+        rows, destination_row,
+        x_start, x_end,
+        width,
+        *(size_t *) context,
+        false
+    );
+}
+
+static void _filters_median_constant_time_begin_row(
+                void *context,
+                uint8_t **rows,
+                size_t y __attribute__((unused))
+            )
+{
+    filters_median_histograms_begin_row(context, rows);
+}
+
+static void _filters_median_constant_time_border_kernel(
+                void *context,
+                uint8_t **rows __attribute__((unused)),
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width __attribute__((unused))
+            )
+{
+    filters_apply_median_constant_time(context, destination_row, x_start, x_end, true);
+}
+
+static void _filters_median_constant_time_interior_kernel(
+                void *context,
+                uint8_t **rows __attribute__((unused)),
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width __attribute__((unused))
+            )
+{
+    filters_apply_median_constant_time(context, destination_row, x_start, x_end, false);
+}
+
+static void filters_median_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_median_data_t *data =
+        task_data;
+
+    size_t linear_position =
+        data->linear_position;
+    size_t channels_to_process =
+        data->channels_to_process;
+    size_t image_height =
+        data->image_height;
+    size_t image_width =
+        data->image_width;
+    size_t end =
+        linear_position + channels_to_process;
+    uint8_t *source_pixels =
+        data->source_pixels;
+    uint8_t *destination_pixels =
+        data->destination_pixels;
+    size_t radius =
+        data->radius;
+
+    size_t stride =
+        image_width * 4;
+    size_t y_start =
+        linear_position / stride;
+    size_t y_end =
+        (end + stride - 1) / stride;
+
+    filters_neighborhood_t neighborhood = {
+        .radius_x = radius,
+        .radius_y = radius,
+        .begin_row = NULL,
+        .border_kernel = _filters_median_huang_border_kernel,
+        .interior_kernel = _filters_median_huang_interior_kernel,
+        .context = &radius
+    };
+
+    filters_median_histograms_t *histograms =
+        NULL;
+
+    if (1 == radius) {
+        neighborhood.border_kernel =
+            _filters_median_network_border_kernel;
+        neighborhood.interior_kernel =
+            _filters_median_network_interior_kernel;
+    } else if (radius > FILTERS_MEDIAN_HUANG_MAX_RADIUS) {
+        histograms =
+            filters_median_histograms_create(image_width, radius);
+
+        /* Without memory for the column histograms fall back to Huang */
+        if (NULL != histograms) {
+            neighborhood.begin_row =
+                _filters_median_constant_time_begin_row;
+            neighborhood.border_kernel =
+                _filters_median_constant_time_border_kernel;
+            neighborhood.interior_kernel =
+                _filters_median_constant_time_interior_kernel;
+            neighborhood.context =
+                histograms;
+        }
+    }
+
+    if (NULL != data->row_buffer) {
+        filters_neighborhood_process_in_place(
+            &neighborhood,
+            data->row_buffer,
+            destination_pixels
+        );
+    } else {
+        filters_neighborhood_process(
+            &neighborhood,
+            source_pixels,
+            destination_pixels,
+            image_width,
+            image_height,
+            y_start,
+            y_end
+        );
+    }
+
+    filters_median_histograms_destroy(histograms);
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
     }
+
+    filters_median_data_destroy(data);
 }
 
-static void filters_brightness_contrast_processing_task(
+static void filters_color_matrix_processing_task(
                 void *task_data,
                 void (*result_callback)(void *result) __attribute__((unused))
             )
 {
-    filters_brightness_contrast_data_t *data =
+    filters_color_matrix_data_t *data =
         task_data;
 
     size_t linear_position =
@@ -145,39 +1227,298 @@ static void filters_brightness_contrast_processing_task(
         linear_position + channels_to_process;
     uint8_t *pixels =
         data->pixels;
-    float brightness =
-        data->brightness;
-    float contrast =
-        data->contrast;
+    const filters_color_matrix_t *matrix =
+        data->matrix;
 #if defined FILTERS_SIMD_ASM_IMPLEMENTATION
     size_t step =
-        16;
+        64;
 #else
     size_t step =
         4;
 #endif
 
     for (; linear_position < end; linear_position += step) {
-        filters_apply_brightness_contrast(
-            pixels, linear_position,
-            brightness, contrast
+        filters_apply_color_matrix(pixels, linear_position, matrix);
+    }
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_color_matrix_data_destroy(data);
+}
+
+static void filters_gaussian_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_gaussian_data_t *data =
+        task_data;
+
+    size_t channels_to_process =
+        data->channels_to_process;
+    size_t image_width =
+        data->image_width;
+    size_t image_height =
+        data->image_height;
+    uint8_t *pixels =
+        data->pixels;
+    const filters_gaussian_t *gaussian =
+        data->gaussian;
+    size_t first_row =
+        data->first_row;
+
+    size_t stride =
+        image_width * 4;
+    size_t y_start =
+        data->linear_position / stride;
+    size_t y_end =
+        (data->linear_position + channels_to_process + stride - 1) / stride;
+    size_t last_row =
+        UTILS_MIN(y_end + gaussian->radius, image_height);
+
+    for (size_t y = first_row; y < last_row; ++y) {
+        uint8_t *row =
+            &data->rows[(y - first_row) * stride];
+
+        filters_apply_gaussian_horizontal(
+            gaussian,
+            y_start <= y && y < y_end ? &pixels[y * stride] : row,
+            row,
+            image_width,
+            data->padded_row
         );
     }
 
+    filters_apply_gaussian_vertical(
+        gaussian,
+        data->rows,
+        first_row,
+        pixels,
+        image_width,
+        image_height,
+        y_start,
+        y_end,
+        data->strip,
+        data->sums,
+        data->unsharp_mask
+    );
+
     ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) channels_to_process);
     if (0 >= channels_left) {
         (void) __sync_lock_test_and_set(data->barrier_sense, true);
     }
 
-    filters_brightness_contrast_data_destroy(data);
+    filters_gaussian_data_destroy(data);
 }
 
-static void filters_sepia_processing_task(
+/* Sharpens instead of blurring, see `filters_apply_gaussian_vertical` */
+static void filters_unsharp_mask_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result)
+            )
+{
+    filters_gaussian_processing_task(task_data, result_callback);
+}
+
+/* Convolution Row Kernels */
+
+static void _filters_convolution_border_kernel(
+                void *context,
+                uint8_t **rows,
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width
+            )
+{
+    filters_apply_convolution(context, rows, destination_row, x_start, x_end, width);
+}
+
+static void _filters_convolution_interior_kernel(
+                void *context,
+                uint8_t **rows,
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width __attribute__((unused))
+            )
+{
+    filters_apply_convolution_interior(context, rows, destination_row, x_start, x_end);
+}
+
+static void filters_convolution_processing_task(
                 void *task_data,
                 void (*result_callback)(void *result) __attribute__((unused))
             )
 {
-    filters_sepia_data_t *data =
+    filters_convolution_data_t *data =
+        task_data;
+
+    const filters_convolution_t *convolution =
+        data->convolution;
+
+    filters_neighborhood_t neighborhood = {
+        .radius_x = convolution->width / 2,
+        .radius_y = convolution->height / 2,
+        .begin_row = NULL,
+        .border_kernel = _filters_convolution_border_kernel,
+        .interior_kernel = _filters_convolution_interior_kernel,
+        .context = (void *) convolution
+    };
+
+    filters_neighborhood_process_in_place(
+        &neighborhood,
+        data->row_buffer,
+        data->pixels
+    );
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) data->channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_convolution_data_destroy(data);
+}
+
+/* Edge Detection Row Kernels */
+
+static void _filters_edges_border_kernel(
+                void *context,
+                uint8_t **rows,
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width
+            )
+{
+    filters_apply_edges(context, rows, destination_row, x_start, x_end, width);
+}
+
+static void _filters_edges_interior_kernel(
+                void *context,
+                uint8_t **rows,
+                uint8_t *destination_row,
+                size_t x_start,
+                size_t x_end,
+                size_t width __attribute__((unused))
+            )
+{
+    filters_apply_edges_interior(context, rows, destination_row, x_start, x_end);
+}
+
+static void filters_edges_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_edges_data_t *data =
+        task_data;
+
+    filters_neighborhood_t neighborhood = {
+        .radius_x = 1,
+        .radius_y = 1,
+        .begin_row = NULL,
+        .border_kernel = _filters_edges_border_kernel,
+        .interior_kernel = _filters_edges_interior_kernel,
+        .context = (void *) data->edges
+    };
+
+    filters_neighborhood_process_in_place(
+        &neighborhood,
+        data->row_buffer,
+        data->pixels
+    );
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) data->channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_edges_data_destroy(data);
+}
+
+static void filters_resize_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_resize_data_t *data =
+        task_data;
+
+    const filters_resize_t *resize =
+        data->resize;
+
+    size_t source_stride =
+        resize->source_width * 4;
+    size_t stride =
+        resize->width * 4;
+    size_t y_start =
+        data->linear_position / stride;
+    size_t y_end =
+        (data->linear_position + data->channels_to_process + stride - 1) / stride;
+
+    size_t first_row, last_row;
+    _filters_resize_source_rows(resize, data->linear_position, data->channels_to_process, &first_row, &last_row);
+
+    /* Neighbouring bands share some source rows, each resamples them on its own */
+    for (size_t y = first_row; y < last_row; ++y) {
+        filters_apply_resize_horizontal(
+            resize,
+            &data->source_pixels[y * source_stride],
+            &data->rows[(y - first_row) * stride]
+        );
+    }
+
+    for (size_t y = y_start; y < y_end; ++y) {
+        filters_apply_resize_vertical(
+            resize,
+            data->rows,
+            first_row,
+            &data->destination_pixels[y * stride],
+            y
+        );
+    }
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) data->channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_resize_data_destroy(data);
+}
+
+static void filters_histogram_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_histogram_data_t *data =
+        task_data;
+
+    filters_accumulate_histogram(
+        data->pixels,
+        data->linear_position,
+        data->linear_position + data->channels_to_process,
+        data->histogram
+    );
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) data->channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_histogram_data_destroy(data);
+}
+
+static void filters_lut_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_lut_data_t *data =
         task_data;
 
     size_t linear_position =
@@ -188,16 +1529,18 @@ static void filters_sepia_processing_task(
         linear_position + channels_to_process;
     uint8_t *pixels =
         data->pixels;
+    const filters_lut_t *lut =
+        data->lut;
 #if defined FILTERS_SIMD_ASM_IMPLEMENTATION
     size_t step =
-        16;
+        64;
 #else
     size_t step =
         4;
 #endif
 
     for (; linear_position < end; linear_position += step) {
-        filters_apply_sepia(pixels, linear_position);
+        filters_apply_lut(pixels, linear_position, lut);
     }
 
     ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) channels_to_process);
@@ -205,54 +1548,230 @@ static void filters_sepia_processing_task(
         (void) __sync_lock_test_and_set(data->barrier_sense, true);
     }
 
-    filters_sepia_data_destroy(data);
+    filters_lut_data_destroy(data);
 }
 
-static void filters_median_processing_task(
+static void filters_colorspace_processing_task(
                 void *task_data,
                 void (*result_callback)(void *result) __attribute__((unused))
             )
 {
-    filters_median_data_t *data =
+    filters_colorspace_data_t *data =
+        task_data;
+
+    size_t stride =
+        data->planes->width * 4;
+    size_t y_start =
+        data->linear_position / stride;
+    size_t y_end =
+        (data->linear_position + data->channels_to_process + stride - 1) / stride;
+
+    if (FILTERS_COLORSPACE_TO_PLANES == data->direction) {
+        filters_colorspace_to_planes(data->pixels, data->planes, y_start, y_end);
+    } else if (FILTERS_COLORSPACE_SHARPEN_LUMA == data->direction) {
+        filters_colorspace_sharpen_luma(
+            data->unsharp_mask, data->planes, data->sharpened_y, y_start, y_end, data->scratch
+        );
+    } else {
+        filters_colorspace_from_planes(data->planes, data->pixels, y_start, y_end);
+    }
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) data->channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_colorspace_data_destroy(data);
+}
+
+static void filters_grayscale_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_grayscale_data_t *data =
+        task_data;
+
+    uint8_t gray[FILTERS_GRAYSCALE_CHUNK];
+
+    /* The rows of the image are contiguous, so the band is converted like one long row */
+    uint8_t *pixels =
+        &data->pixels[data->linear_position];
+    size_t pixels_count =
+        data->channels_to_process / 4;
+    for (size_t x = 0; x < pixels_count; x += FILTERS_GRAYSCALE_CHUNK) {
+        size_t count =
+            UTILS_MIN(FILTERS_GRAYSCALE_CHUNK, pixels_count - x);
+
+        filters_colorspace_bgra_to_gray_row(&pixels[x * 4], gray, count);
+        filters_colorspace_gray_to_bgra_row(gray, &pixels[x * 4], count);
+    }
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) data->channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_grayscale_data_destroy(data);
+}
+
+static void filters_transform_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_transform_data_t *data =
+        task_data;
+
+    size_t width =
+        FILTERS_TRANSFORM_ROTATE_90 == data->transform || FILTERS_TRANSFORM_ROTATE_270 == data->transform ?
+            data->source_height :
+            data->source_width;
+    size_t stride =
+        width * 4;
+
+    filters_apply_transform(
+        data->source_pixels,
+        data->destination_pixels,
+        data->source_width,
+        data->source_height,
+        data->transform,
+        data->linear_position / stride,
+        (data->linear_position + data->channels_to_process + stride - 1) / stride
+    );
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) data->channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_transform_data_destroy(data);
+}
+
+static void filters_lut3d_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_lut3d_data_t *data =
+        task_data;
+
+    filters_apply_lut3d(
+        data->lut,
+        &data->pixels[data->linear_position],
+        data->channels_to_process / 4
+    );
+
+    ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) data->channels_to_process);
+    if (0 >= channels_left) {
+        (void) __sync_lock_test_and_set(data->barrier_sense, true);
+    }
+
+    filters_lut3d_data_destroy(data);
+}
+
+static void filters_morphology_processing_task(
+                void *task_data,
+                void (*result_callback)(void *result) __attribute__((unused))
+            )
+{
+    filters_morphology_data_t *data =
         task_data;
 
-    size_t linear_position =
-        data->linear_position;
     size_t channels_to_process =
         data->channels_to_process;
-    size_t image_height =
-        data->image_height;
     size_t image_width =
         data->image_width;
-    size_t end =
-        linear_position + channels_to_process;
-    uint8_t *source_pixels =
-        data->source_pixels;
-    uint8_t *destination_pixels =
-        data->destination_pixels;
-    size_t step =
-        4;
+    size_t image_height =
+        data->image_height;
+    uint8_t *pixels =
+        data->pixels;
+    const filters_morphology_t *morphology =
+        data->morphology;
+    size_t first_row =
+        data->first_row;
 
-    for (; linear_position < end; linear_position += step) {
-        size_t x =
-            (linear_position / 4) % image_width;
-        size_t y =
-            (linear_position / 4) / image_width;
+    size_t stride =
+        image_width * 4;
+    size_t y_start =
+        data->linear_position / stride;
+    size_t y_end =
+        (data->linear_position + channels_to_process + stride - 1) / stride;
+    size_t last_row =
+        UTILS_MIN(y_end + filters_morphology_reach(morphology), image_height);
 
-        filters_apply_median(
-            source_pixels,
-            destination_pixels,
-            linear_position,
-            x, y,
-            image_width, image_height
+    memcpy(&data->rows[(y_start - first_row) * stride], &pixels[y_start * stride], (y_end - y_start) * stride);
+
+    bool dilate =
+        FILTERS_MORPHOLOGY_DILATE == morphology->operation ||
+        FILTERS_MORPHOLOGY_CLOSE == morphology->operation;
+
+    /* The first operation of a pair also produces the rows that the second one reads around the band */
+    const uint8_t *source_rows =
+        data->rows;
+    size_t source_first =
+        first_row;
+    size_t source_count =
+        last_row - first_row;
+    if (FILTERS_MORPHOLOGY_OPEN == morphology->operation ||
+        FILTERS_MORPHOLOGY_CLOSE == morphology->operation) {
+        size_t radius =
+            morphology->radius_y;
+        size_t start =
+            y_start > radius ? y_start - radius : 0;
+        size_t end =
+            UTILS_MIN(y_end + radius, image_height);
+
+        filters_apply_morphology_vertical(
+            data->rows, last_row - first_row,
+            data->intermediate,
+            start - first_row, end - first_row,
+            image_width,
+            radius,
+            dilate,
+            data->prefixes, data->suffixes
+        );
+        filters_apply_morphology_horizontal(
+            data->intermediate, end - start,
+            image_width,
+            morphology->radius_x,
+            dilate,
+            data->prefixes, data->suffixes,
+            data->columns
         );
+
+        dilate =
+            !dilate;
+        source_rows =
+            data->intermediate;
+        source_first =
+            start;
+        source_count =
+            end - start;
     }
 
+    filters_apply_morphology_vertical(
+        source_rows, source_count,
+        &pixels[y_start * stride],
+        y_start - source_first, y_end - source_first,
+        image_width,
+        morphology->radius_y,
+        dilate,
+        data->prefixes, data->suffixes
+    );
+    filters_apply_morphology_horizontal(
+        &pixels[y_start * stride], y_end - y_start,
+        image_width,
+        morphology->radius_x,
+        dilate,
+        data->prefixes, data->suffixes,
+        data->columns
+    );
+
     ssize_t channels_left = __sync_sub_and_fetch(data->channels_left, (ssize_t) channels_to_process);
     if (0 >= channels_left) {
         (void) __sync_lock_test_and_set(data->barrier_sense, true);
     }
 
-    filters_median_data_destroy(data);
+    filters_morphology_data_destroy(data);
 }
-
@@ -0,0 +1,63 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    Synthetic images for profiling and benchmarks. Every pixel is a function
+    of the seed and its coordinates in integer arithmetic only, so that a
+    pattern comes out byte for byte the same on any host, with any compiler
+    and for any row order of the file.
+
+    Noise is uniform in all four channels, the worst case for the median and
+    the histogram filters. Gradients are smooth ramps that show banding and
+    rounding. Photos have a sky with clouds over a textured landscape with
+    hard-edged objects and film grain, the mix of flat areas, edges and
+    detail of real pictures.
+*/
+#define GENERATOR_NOISE    0
+#define GENERATOR_GRADIENT 1
+#define GENERATOR_PHOTO    2
+
+#define GENERATOR_DEFAULT_SEED 1
+
+#define GENERATOR_PHOTO_OBJECTS 12
+#define GENERATOR_PHOTO_OCTAVES 7
+
+typedef struct _generator_object
+{
+    int64_t x, y;                   /* center                                          */
+    int64_t radius_x, radius_y;
+    int is_disc;                    /* a shaded disc, otherwise a rectangle            */
+    uint8_t color[3];               /* blue, green and red                             */
+} generator_object_t;
+
+typedef struct _generator
+{
+    int pattern;
+    size_t width, height;
+    uint32_t seed;
+
+    size_t noise_cells[GENERATOR_PHOTO_OCTAVES];
+    generator_object_t objects[GENERATOR_PHOTO_OBJECTS];
+} generator_t;
+
+static inline void generator_init(
+                       generator_t *generator,
+                       int pattern,
+                       size_t width,
+                       size_t height,
+                       uint32_t seed
+                   );
+
+/* Fills the BGRA pixels of the row `y` counted from the top of the picture */
+static inline void generator_fill_row(
+                       const generator_t *generator,
+                       size_t y,
+                       uint8_t *pixels
+                   );
+
+#include "generator.impl.h.c"
+
+#endif /* GENERATOR_H */
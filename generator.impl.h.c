@@ -0,0 +1,354 @@
+#include "generator.h"
+#include "utils.h"
+
+#include <string.h>
+
+/* The finalizer of MurmurHash3, every input bit flips about half the output bits */
+static inline uint32_t _generator_mix(uint32_t hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+static inline uint32_t _generator_hash(uint32_t seed, uint32_t x, uint32_t y)
+{
+    return _generator_mix(_generator_mix(seed ^ (y * 0x9E3779B1u)) + x * 0x85EBCA77u);
+}
+
+/* 3t^2 - 2t^3 of a Q8 fraction */
+static inline uint32_t _generator_smoothstep(uint32_t fraction)
+{
+    return fraction * fraction * (3 * 256 - 2 * fraction) >> 16;
+}
+
+/* Random values at the corners of square cells of `cell` pixels, interpolated smoothly in between */
+static inline uint32_t _generator_value_noise(uint32_t seed, size_t x, size_t y, size_t cell)
+{
+    uint32_t cell_x =
+        (uint32_t) (x / cell);
+    uint32_t cell_y =
+        (uint32_t) (y / cell);
+    uint32_t fraction_x =
+        _generator_smoothstep((uint32_t) (x % cell * 256 / cell));
+    uint32_t fraction_y =
+        _generator_smoothstep((uint32_t) (y % cell * 256 / cell));
+
+    uint32_t top_left =
+        _generator_hash(seed, cell_x, cell_y) >> 24;
+    uint32_t top_right =
+        _generator_hash(seed, cell_x + 1, cell_y) >> 24;
+    uint32_t bottom_left =
+        _generator_hash(seed, cell_x, cell_y + 1) >> 24;
+    uint32_t bottom_right =
+        _generator_hash(seed, cell_x + 1, cell_y + 1) >> 24;
+
+    uint32_t top =
+        top_left * (256 - fraction_x) + top_right * fraction_x;
+    uint32_t bottom =
+        bottom_left * (256 - fraction_x) + bottom_right * fraction_x;
+
+    return (top * (256 - fraction_y) + bottom * fraction_y) >> 16;
+}
+
+/* Octaves of value noise, every one at half the cell size and half the weight of the previous one */
+static inline uint32_t _generator_fractal_noise(
+                           const generator_t *generator,
+                           uint32_t seed,
+                           size_t x,
+                           size_t y
+                       )
+{
+    uint32_t sum =
+        0;
+    uint32_t weights =
+        0;
+    uint32_t weight =
+        1u << GENERATOR_PHOTO_OCTAVES;
+
+    for (size_t octave = 0; octave < GENERATOR_PHOTO_OCTAVES; ++octave) {
+        sum +=
+            weight * _generator_value_noise(seed + (uint32_t) octave, x, y, generator->noise_cells[octave]);
+        weights +=
+            weight;
+        weight >>= 1;
+    }
+
+    return sum / weights;
+}
+
+/* Stretches the contrast of noise that averaging octaves pulled towards the middle */
+static inline uint32_t _generator_stretch(uint32_t value, int32_t factor)
+{
+    int32_t stretched =
+        ((int32_t) value - 128) * factor + 128;
+
+    return (uint32_t) UTILS_CLAMP(stretched, 0, 255);
+}
+
+static inline uint32_t _generator_blend(uint32_t from, uint32_t to, uint32_t amount)
+{
+    return (from * (256 - amount) + to * amount) >> 8;
+}
+
+static inline void generator_init(
+                       generator_t *generator,
+                       int pattern,
+                       size_t width,
+                       size_t height,
+                       uint32_t seed
+                   )
+{
+    memset(generator, 0, sizeof(*generator));
+
+    generator->pattern =
+        pattern;
+    generator->width =
+        width;
+    generator->height =
+        height;
+    generator->seed =
+        seed;
+
+    size_t cell =
+        UTILS_MAX(width, height) / 4;
+    for (size_t octave = 0; octave < GENERATOR_PHOTO_OCTAVES; ++octave) {
+        generator->noise_cells[octave] =
+            UTILS_MAX(cell >> octave, 1);
+    }
+
+    /* Objects stand in the lower part of the picture and take 3 to 12 percent of its shorter side */
+    size_t shorter_side =
+        UTILS_MIN(width, height);
+    size_t landscape_top =
+        height * 35 / 100;
+    for (size_t i = 0; i < GENERATOR_PHOTO_OBJECTS; ++i) {
+        generator_object_t *object =
+            &generator->objects[i];
+        uint32_t object_seed =
+            seed ^ 0x4F424A45u;
+
+        uint32_t shape =
+            _generator_hash(object_seed, (uint32_t) i, 0);
+        uint32_t position =
+            _generator_hash(object_seed, (uint32_t) i, 1);
+        uint32_t color =
+            _generator_hash(object_seed, (uint32_t) i, 2);
+
+        object->is_disc =
+            (int) (shape & 1);
+        object->radius_x =
+            (int64_t) (shorter_side * (3 + (shape >> 8) % 10) / 100 + 1);
+        object->radius_y =
+            object->is_disc ?
+                object->radius_x :
+                (int64_t) (shorter_side * (3 + (shape >> 16) % 10) / 100 + 1);
+        object->x =
+            (int64_t) ((position & 0xFFFF) * width >> 16);
+        object->y =
+            (int64_t) (landscape_top + ((position >> 16) * (height - landscape_top) >> 16));
+
+        for (size_t channel = 0; channel < 3; ++channel) {
+            object->color[channel] =
+                (uint8_t) (color >> (channel * 8));
+        }
+    }
+}
+
+static inline void _generator_fill_noise_row(
+                       const generator_t *generator,
+                       size_t y,
+                       uint8_t *pixels
+                   )
+{
+    for (size_t x = 0; x < generator->width; ++x) {
+        uint32_t value =
+            _generator_hash(generator->seed, (uint32_t) x, (uint32_t) y);
+
+        for (size_t channel = 0; channel < 4; ++channel) {
+            pixels[x * 4 + channel] =
+                (uint8_t) (value >> (channel * 8));
+        }
+    }
+}
+
+/* Blue grows to the right, green to the bottom and red falls along the diagonal */
+static inline void _generator_fill_gradient_row(
+                       const generator_t *generator,
+                       size_t y,
+                       uint8_t *pixels
+                   )
+{
+    uint64_t last_x =
+        UTILS_MAX(generator->width - 1, 1);
+    uint64_t last_y =
+        UTILS_MAX(generator->height - 1, 1);
+    uint64_t last_diagonal =
+        last_x + last_y;
+
+    uint8_t green =
+        (uint8_t) (y * 255 / last_y);
+    for (size_t x = 0; x < generator->width; ++x) {
+        pixels[x * 4] =
+            (uint8_t) (x * 255 / last_x);
+        pixels[x * 4 + 1] =
+            green;
+        pixels[x * 4 + 2] =
+            (uint8_t) (255 - (x + y) * 255 / last_diagonal);
+        pixels[x * 4 + 3] =
+            255;
+    }
+}
+
+static inline void _generator_fill_photo_row(
+                       const generator_t *generator,
+                       size_t y,
+                       uint8_t *pixels
+                   )
+{
+    static const uint32_t Sky_Top[3] =
+                              { 190, 110,  50 },
+                          Sky_Horizon[3] =
+                              { 235, 205, 180 },
+                          Grass[3] =
+                              {  50, 130,  70 },
+                          Soil[3] =
+                              {  60, 100, 140 };
+
+    size_t width =
+        generator->width;
+    size_t height =
+        generator->height;
+    uint32_t seed =
+        generator->seed;
+
+    for (size_t x = 0; x < width; ++x) {
+        uint32_t color[3];
+
+        /* Hills of two scales along the horizon */
+        int64_t hills =
+            ((int64_t) _generator_value_noise(seed + 10, x, 0, UTILS_MAX(width / 6, 1)) - 128) *
+                (int64_t) height / 1536 +
+            ((int64_t) _generator_value_noise(seed + 11, x, 0, UTILS_MAX(width / 24, 1)) - 128) *
+                (int64_t) height / 5120;
+        int64_t horizon =
+            (int64_t) (height * 45 / 100) + hills;
+
+        if ((int64_t) y < horizon) {
+            uint32_t height_in_sky =
+                (uint32_t) ((int64_t) y * 256 / horizon);
+
+            /* Clouds are flattened by sampling the noise at thrice the rows */
+            uint32_t clouds =
+                _generator_fractal_noise(generator, seed + 20, x, y * 3);
+            uint32_t cloud_cover =
+                clouds > 132 ? UTILS_MIN((clouds - 132) * 8, 230) : 0;
+
+            for (size_t channel = 0; channel < 3; ++channel) {
+                color[channel] =
+                    _generator_blend(
+                        _generator_blend(Sky_Top[channel], Sky_Horizon[channel], height_in_sky),
+                        250,
+                        cloud_cover
+                    );
+            }
+        } else {
+            int64_t ground_height =
+                UTILS_MAX((int64_t) height - horizon, 1);
+            uint32_t depth =
+                (uint32_t) UTILS_MIN(((int64_t) y - horizon) * 256 / ground_height, 256);
+
+            uint32_t texture =
+                _generator_stretch(_generator_fractal_noise(generator, seed + 30, x, y), 3);
+            uint32_t vegetation =
+                _generator_stretch(_generator_value_noise(seed + 40, x, y, generator->noise_cells[1]), 2);
+
+            /* Closer ground is brighter, the distance fades into the haze of the horizon */
+            uint32_t shade =
+                96 + texture * 160 / 255 + depth / 4;
+            uint32_t haze =
+                (256 - depth) / 3;
+
+            for (size_t channel = 0; channel < 3; ++channel) {
+                uint32_t ground =
+                    _generator_blend(Grass[channel], Soil[channel], vegetation) * shade >> 8;
+
+                color[channel] =
+                    _generator_blend(UTILS_MIN(ground, 255), Sky_Horizon[channel], haze);
+            }
+        }
+
+        /* Later objects cover earlier ones, discs are lit from the center, rectangles from the top */
+        for (size_t i = 0; i < GENERATOR_PHOTO_OBJECTS; ++i) {
+            const generator_object_t *object =
+                &generator->objects[i];
+
+            int64_t dx =
+                (int64_t) x - object->x;
+            int64_t dy =
+                (int64_t) y - object->y;
+            if (dx < -object->radius_x || dx > object->radius_x ||
+                dy < -object->radius_y || dy > object->radius_y) {
+                continue;
+            }
+
+            uint32_t shade;
+            if (object->is_disc) {
+                int64_t radius_squared =
+                    object->radius_x * object->radius_x;
+                int64_t distance_squared =
+                    dx * dx + dy * dy;
+                if (distance_squared > radius_squared) {
+                    continue;
+                }
+
+                shade =
+                    (uint32_t) (288 - distance_squared * 128 / radius_squared);
+            } else {
+                shade =
+                    (uint32_t) (160 + (object->radius_y - dy) * 64 / (2 * object->radius_y + 1));
+            }
+
+            for (size_t channel = 0; channel < 3; ++channel) {
+                color[channel] =
+                    UTILS_MIN(object->color[channel] * shade >> 8, 255);
+            }
+        }
+
+        /* Film grain of -8 to +7 in every channel */
+        uint32_t grain =
+            _generator_hash(seed + 50, (uint32_t) x, (uint32_t) y);
+        for (size_t channel = 0; channel < 3; ++channel) {
+            int32_t value =
+                (int32_t) color[channel] + (int32_t) ((grain >> (channel * 8)) & 15) - 8;
+
+            pixels[x * 4 + channel] =
+                (uint8_t) UTILS_CLAMP(value, 0, 255);
+        }
+        pixels[x * 4 + 3] =
+            255;
+    }
+}
+
+static inline void generator_fill_row(
+                       const generator_t *generator,
+                       size_t y,
+                       uint8_t *pixels
+                   )
+{
+    switch (generator->pattern) {
+        case GENERATOR_NOISE:
+            _generator_fill_noise_row(generator, y, pixels);
+            break;
+        case GENERATOR_GRADIENT:
+            _generator_fill_gradient_row(generator, y, pixels);
+            break;
+        default:
+            _generator_fill_photo_row(generator, y, pixels);
+            break;
+    }
+}
@@ -1,61 +1,22 @@
 #include <stddef.h>
-#include <stdint.h>
-#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <string.h>
 
-#include "bmp.h"
+#include "ips.h"
 #include "utils.h"
 #include "threadpool.h"
-#include "filters_threading.h"
 #include "profiler.h"
-
-static const char IPS_Usage[] =
-                    "Usage: ips "                                                       \
-                        "<filter name (brightness-contrast | sepia | median)> "         \
-                        "[<brightness> <contrast> for brightness and contrast filter] " \
-                        "<source bitmap image file> <destination bitmap image file>",
-                  IPS_Brightness_Contrast_Filter_Name[] =
-                    "brightness-contrast",
-                  IPS_Sepia_Filter_Name[] =
-                    "sepia",
-                  IPS_Median_Filter_Name[] =
-                    "median",
-                  IPS_Error_Illegal_Parameters[] =
-                    "Illegal parameters",
-                  IPS_Error_Failed_to_Open_Image[] =
-                    "Failed to open the source image",
-                  IPS_Error_Failed_to_Create_Image[] =
-                    "Failed to create the image",
-                  IPS_Error_Failed_to_Process_Image[] =
-                    "Error processing the image",
-                  IPS_Error_Failed_to_Create_Threadpool[] =
-                    "Error trying to create a threadpool",
-                  IPS_Error_Failed_to_Duplicate_the_Image[] =
-                    "Error duplicating the image";
+#include "metrics.h"
 
 int main(int argc, char *argv[])
 {
     int result =
         EXIT_FAILURE;
 
-    int filter_id =
-        -1;
-    void (*task)(void *task_data, void (*result_callback)(void *result)) =
-        NULL;
-
-    char *source_file_name =
-        NULL;
-    char *destination_file_name =
-        NULL;
-
-    float brightness =
-        0.0f;
-    float contrast =
-        0.0f;
+    ips_job_t job;
+    ips_init_job_structure(&job);
 
-    if (3 > argc) {
+    if (!ips_parse_arguments(&job, argc, argv)) {
         fprintf(
             stderr,
             "%s\n"
@@ -66,149 +27,18 @@ int main(int argc, char *argv[])
         return result;
     }
 
-    if (0 == strncmp(
-            argv[1],
-            IPS_Brightness_Contrast_Filter_Name,
-            UTILS_COUNT_OF(IPS_Brightness_Contrast_Filter_Name)
-        )) {
-        if (6 > argc) {
-            fprintf(
-                stderr,
-                "%s\n"
-                "\t%s\n",
-                IPS_Error_Illegal_Parameters, IPS_Usage
-            );
-
-            return result;
-        }
-
-        filter_id =
-            FILTERS_BRIGHTNESS_CONTRAST_ID;
-        task =
-            filters_brightness_contrast_processing_task;
-        brightness =
-            strtof(argv[2], NULL);
-        contrast =
-            strtof(argv[3], NULL);
-        source_file_name =
-            argv[4];
-        destination_file_name =
-            argv[5];
-    } else if (0 == strncmp(
-                        argv[1],
-                        IPS_Sepia_Filter_Name,
-                        UTILS_COUNT_OF(IPS_Sepia_Filter_Name)
-                    )) {
-        filter_id =
-            FILTERS_SEPIA_ID;
-        task =
-            filters_sepia_processing_task;
-        source_file_name =
-            argv[2];
-        destination_file_name =
-            argv[3];
-    } else if (0 == strncmp(
-                        argv[1],
-                        IPS_Median_Filter_Name,
-                        UTILS_COUNT_OF(IPS_Median_Filter_Name)
-                    )) {
-        filter_id =
-            FILTERS_MEDIAN_ID;
-        task =
-            filters_median_processing_task;
-        source_file_name =
-            argv[2];
-        destination_file_name =
-            argv[3];
-    } else {
-        fprintf(
-            stderr,
-            "%s\n"
-            "\t%s\n",
-            IPS_Error_Illegal_Parameters, IPS_Usage
-        );
-
-        return result;
-    }
-
-    bmp_image image;
-    bmp_init_image_structure(&image);
-
-    FILE *source_descriptor =
-        NULL;
-    FILE *destination_descriptor =
-        NULL;
-
-    source_descriptor = fopen(source_file_name, "r");
-    if (NULL == source_descriptor) {
-        fprintf(
-            stderr,
-            "%s '%s'\n",
-            IPS_Error_Failed_to_Open_Image,
-            source_file_name
-        );
-
-        goto cleanup;
-    }
-
-    const char *error_message;
-
-    bmp_open_image_headers(source_descriptor, &image, &error_message);
-    if (NULL != error_message) {
-        fprintf(
-            stderr,
-            "%s '%s':\n"
-            "\t%s\n",
-            IPS_Error_Failed_to_Process_Image,
-            source_file_name,
-            error_message
-        );
-
-        goto cleanup;
-    }
-
-    bmp_read_image_data(source_descriptor, &image, &error_message);
-    if (NULL != error_message) {
-        fprintf(
-            stderr,
-            "%s '%s':\n"
-            "\t%s\n",
-            IPS_Error_Failed_to_Process_Image,
-            source_file_name,
-            error_message
-        );
-
-        goto cleanup;
-    }
-
-    destination_descriptor = fopen(destination_file_name, "w");
-    if (NULL == destination_descriptor) {
-        fprintf(
-            stderr,
-            "%s '%s'\n",
-            IPS_Error_Failed_to_Create_Image,
-            destination_file_name
-        );
+    char *executable_path =
+        utils_get_executable_path(argv[0]);
+    ips_tune_job(&job, NULL != executable_path ? executable_path : argv[0]);
+    free(executable_path);
 
-        goto cleanup;
-    }
-
-    bmp_write_image_headers(destination_descriptor, &image, &error_message);
-    if (NULL != error_message) {
-        fprintf(
-            stderr,
-            "%s '%s':\n"
-            "\t%s\n",
-            IPS_Error_Failed_to_Process_Image,
-            destination_file_name,
-            error_message
-        );
+METRICS_START();
 
+    if (!ips_prepare_images(&job)) {
         goto cleanup;
     }
 
-    size_t pool_size = utils_get_number_of_cpu_cores() * 2;
-    threadpool_t *threadpool = threadpool_create(pool_size);
+    threadpool_t *threadpool = threadpool_create(job.threads_count);
     if (NULL == threadpool) {
         fprintf(
             stderr,
@@ -219,152 +49,18 @@ int main(int argc, char *argv[])
         goto cleanup;
     }
 
-    /* Main Image Processing Loop */
-    {
-        static volatile ssize_t channels_left =
-            0;
-        static volatile bool barrier_sense =
-            false;
-        uint8_t *pixels =
-            image.pixels;
-
-        uint8_t *original_pixels = NULL;
-        if (filter_id == FILTERS_MEDIAN_ID) {
-            original_pixels = (uint8_t *) aligned_alloc(64, image.aligned_image_size);
-            if (NULL == original_pixels) {
-                fprintf(
-                    stderr,
-                    "%s.\n",
-                    IPS_Error_Failed_to_Duplicate_the_Image
-                );
-
-                goto cleanup;
-            }
-
-            memcpy(original_pixels, pixels, image.aligned_image_size);
-        }
-
-        size_t width =
-            image.absolute_image_width;
-        size_t height =
-            image.absolute_image_height;
-        size_t channels_count =
-            width * height * 4;
-        size_t channels_per_thread =
-            channels_count / pool_size;
-#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
-        channels_per_thread =
-            ((channels_per_thread - 1) / 16 + 1) * 16;
-#else
-        channels_per_thread =
-            ((channels_per_thread - 1) / 4 + 1) * 4;
-#endif
-
-PROFILER_START(1)
-        channels_left =
-            (ssize_t) channels_count;
-        barrier_sense =
-            false;
-
-        for (
-            size_t linear_position = 0;
-            linear_position < channels_count;
-            linear_position += channels_per_thread
-        ) {
-            size_t channels_to_process =
-                linear_position + channels_per_thread > channels_count ?
-                    channels_count - linear_position :
-                    channels_per_thread;
-
-            void *task_data;
-            switch (filter_id) {
-                case FILTERS_BRIGHTNESS_CONTRAST_ID:
-                    task_data =
-                        filters_brightness_contrast_data_create(
-                            linear_position,
-                            channels_to_process,
-                            pixels,
-                            brightness, contrast,
-                            &channels_left,
-                            &barrier_sense
-                        );
-                    break;
-                case FILTERS_SEPIA_ID:
-                    task_data =
-                        filters_sepia_data_create(
-                            linear_position,
-                            channels_to_process,
-                            pixels,
-                            &channels_left,
-                            &barrier_sense
-                        );
-                    break;
-                case FILTERS_MEDIAN_ID:
-                    task_data =
-                        filters_median_data_create(
-                            linear_position,
-                            channels_to_process,
-                            width, height,
-                            original_pixels,
-                            pixels,
-                            &channels_left,
-                            &barrier_sense
-                        );
-                    break;
-                default:
-                    task_data =
-                        NULL;
-            }
-
-            if (NULL != task_data) {
-                threadpool_enqueue_task(
-                    threadpool,
-                    task,
-                    task_data,
-                    NULL
-                );
-            }
-        }
-
-        while (!barrier_sense) { }
-PROFILER_STOP();
-
-        if (NULL != original_pixels) {
-            free(original_pixels);
-            original_pixels = NULL;
-        }
-    }
-
-    bmp_write_image_data(destination_descriptor, &image, &error_message);
-    if (NULL != error_message) {
-        fprintf(
-            stderr,
-            "%s '%s':\n"
-            "\t%s\n",
-            IPS_Error_Failed_to_Process_Image,
-            destination_file_name,
-            error_message
-        );
-
+    if (!ips_process_image(&job, threadpool) || !ips_write_image(&job)) {
         goto cleanup;
     }
 
+PROFILER_REPORT();
+
     result =
         EXIT_SUCCESS;
 
 cleanup:
-    bmp_free_image_structure(&image);
-
-    if (NULL != source_descriptor) {
-        fclose(source_descriptor);
-        source_descriptor = NULL;
-    }
-
-    if (NULL != destination_descriptor) {
-        fclose(destination_descriptor);
-        destination_descriptor = NULL;
-    }
+METRICS_STOP();
+    ips_free_job_structure(&job);
 
     return result;
 }
-
@@ -0,0 +1,254 @@
+#ifndef IPS_H
+#define IPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "bmp.h"
+#include "cube.h"
+#include "threadpool.h"
+#include "filters_threading.h"
+
+static const char IPS_Usage[] =
+                    "Usage: ips "                                                                 \
+                        "[--threads <count>] [--tasks <count of bands of the image>] "            \
+                        "[--roi <x>,<y>,<width>,<height> "                                        \
+                            "(from the top left, not for resize, "                                \
+                            "square to rotate by 90 or 270)] "                                    \
+                        "<filter name (brightness-contrast | sepia | median | color-matrix | "    \
+                            "gaussian | convolution | resize | auto-levels | equalize | "         \
+                            "grayscale | rotate | flip | morphology | edges | "                   \
+                            "unsharp-mask | lut3d)> "                                             \
+                        "[<brightness> <contrast> for brightness and contrast filter] "           \
+                        "[[--source-copy] [<radius (1-30)>] for median filter] "                  \
+                        "[<matrix (sepia | grayscale | channel-swap | saturation <saturation> | " \
+                            "white-balance <red> <green> <blue> | custom <b0,g0,r0,o0,...,o2>)> " \
+                            "for color matrix filter] "                                           \
+                        "[<sigma (0.5-100)> for gaussian filter] "                                \
+                        "[<kernel (sharpen | emboss | edge | blur | motion-blur | "               \
+                            "custom <width>x<height> <w0,w1,...>)> for convolution filter] "      \
+                        "[<method (bilinear | bicubic | lanczos3)> <width> <height> "             \
+                            "for resize filter] "                                                 \
+                        "[<clip (0-25)%> for auto-levels filter] "                                \
+                        "[<angle (90 | 180 | 270)> for rotate filter] "                           \
+                        "[<direction (horizontal | vertical)> for flip filter] "                  \
+                        "[<operation (erode | dilate | open | close)> "                           \
+                            "[<width>x<height> (odd, 1-61)] for morphology filter] "              \
+                        "[<operator (sobel | scharr)> for edges filter] "                         \
+                        "[[--luma] <sigma (0.5-100)> [<amount (0-10)> [<threshold (0-255)>]] "    \
+                            "for unsharp-mask filter] "                                           \
+                        "[<LUT file (.cube)> for lut3d filter] "                                  \
+                        "<source bitmap image file> <destination bitmap image file>",
+                  IPS_Threads_Option_Name[] =
+                    "--threads",
+                  IPS_Tasks_Option_Name[] =
+                    "--tasks",
+                  IPS_Tuning_Variable_Name[] =
+                    "IPS_TUNING",
+                  IPS_Tuning_File_Extension[] =
+                    ".tuning",
+                  IPS_Region_of_Interest_Option_Name[] =
+                    "--roi",
+                  IPS_Brightness_Contrast_Filter_Name[] =
+                    "brightness-contrast",
+                  IPS_Sepia_Filter_Name[] =
+                    "sepia",
+                  IPS_Median_Filter_Name[] =
+                    "median",
+                  IPS_Source_Copy_Option_Name[] =
+                    "--source-copy",
+                  IPS_Color_Matrix_Filter_Name[] =
+                    "color-matrix",
+                  IPS_Gaussian_Filter_Name[] =
+                    "gaussian",
+                  IPS_Convolution_Filter_Name[] =
+                    "convolution",
+                  IPS_Sharpen_Kernel_Name[] =
+                    "sharpen",
+                  IPS_Emboss_Kernel_Name[] =
+                    "emboss",
+                  IPS_Edge_Kernel_Name[] =
+                    "edge",
+                  IPS_Blur_Kernel_Name[] =
+                    "blur",
+                  IPS_Motion_Blur_Kernel_Name[] =
+                    "motion-blur",
+                  IPS_Custom_Kernel_Name[] =
+                    "custom",
+                  IPS_Resize_Filter_Name[] =
+                    "resize",
+                  IPS_Bilinear_Method_Name[] =
+                    "bilinear",
+                  IPS_Bicubic_Method_Name[] =
+                    "bicubic",
+                  IPS_Lanczos3_Method_Name[] =
+                    "lanczos3",
+                  IPS_Auto_Levels_Filter_Name[] =
+                    "auto-levels",
+                  IPS_Equalize_Filter_Name[] =
+                    "equalize",
+                  IPS_Grayscale_Filter_Name[] =
+                    "grayscale",
+                  IPS_Rotate_Filter_Name[] =
+                    "rotate",
+                  IPS_Flip_Filter_Name[] =
+                    "flip",
+                  IPS_Horizontal_Flip_Name[] =
+                    "horizontal",
+                  IPS_Vertical_Flip_Name[] =
+                    "vertical",
+                  IPS_Morphology_Filter_Name[] =
+                    "morphology",
+                  IPS_Erode_Operation_Name[] =
+                    "erode",
+                  IPS_Dilate_Operation_Name[] =
+                    "dilate",
+                  IPS_Open_Operation_Name[] =
+                    "open",
+                  IPS_Close_Operation_Name[] =
+                    "close",
+                  IPS_Edges_Filter_Name[] =
+                    "edges",
+                  IPS_Sobel_Operator_Name[] =
+                    "sobel",
+                  IPS_Scharr_Operator_Name[] =
+                    "scharr",
+                  IPS_Unsharp_Mask_Filter_Name[] =
+                    "unsharp-mask",
+                  IPS_Luma_Option_Name[] =
+                    "--luma",
+                  IPS_LUT3D_Filter_Name[] =
+                    "lut3d",
+                  IPS_Sepia_Matrix_Name[] =
+                    "sepia",
+                  IPS_Grayscale_Matrix_Name[] =
+                    "grayscale",
+                  IPS_Channel_Swap_Matrix_Name[] =
+                    "channel-swap",
+                  IPS_Saturation_Matrix_Name[] =
+                    "saturation",
+                  IPS_White_Balance_Matrix_Name[] =
+                    "white-balance",
+                  IPS_Custom_Matrix_Name[] =
+                    "custom",
+                  IPS_Error_Illegal_Parameters[] =
+                    "Illegal parameters",
+                  IPS_Error_Failed_to_Open_Image[] =
+                    "Failed to open the source image",
+                  IPS_Error_Failed_to_Create_Image[] =
+                    "Failed to create the image",
+                  IPS_Error_Failed_to_Process_Image[] =
+                    "Error processing the image",
+                  IPS_Error_Failed_to_Create_Threadpool[] =
+                    "Error trying to create a threadpool",
+                  IPS_Error_Failed_to_Duplicate_the_Image[] =
+                    "Error duplicating the image",
+                  IPS_Error_Failed_to_Create_Tasks[] =
+                    "Error creating the processing tasks",
+                  IPS_Error_Failed_to_Create_Resampler[] =
+                    "Error computing the resampling weights",
+                  IPS_Error_Failed_to_Open_LUT[] =
+                    "Failed to open the LUT",
+                  IPS_Error_Failed_to_Process_LUT[] =
+                    "Error processing the LUT",
+                  IPS_Error_Failed_to_Create_LUT[] =
+                    "Error repacking the LUT",
+                  IPS_Error_Failed_to_Create_Planes[] =
+                    "Error creating the YCbCr planes",
+                  IPS_Error_Invalid_Region[] =
+                    "The region of interest does not fit the image",
+                  IPS_Error_Rotated_Region_Not_Square[] =
+                    "A region of interest rotated by 90 or 270 degrees must be square";
+
+#define IPS_MAX_THREADS 1024
+#define IPS_MAX_TASKS   65536
+
+/*
+    One run of a filter: the parameters parsed from the command line, the
+    images and the files. `ips` processes a job once, `ips_bench` many
+    times over the same images.
+*/
+typedef struct _ips_job
+{
+    char *filter_name;
+    int filter_id;
+    void (*task)(void *task_data, void (*result_callback)(void *result));
+
+    char *source_file_name;
+    char *destination_file_name;
+
+    float brightness, contrast;
+
+    size_t median_radius;
+    bool median_in_place;
+
+    filters_color_matrix_t color_matrix;
+
+    filters_gaussian_t gaussian;
+
+    filters_convolution_t convolution;
+
+    int resize_method;
+    size_t resize_width, resize_height;
+
+    float auto_levels_clip;
+
+    int transform;
+
+    filters_edges_t edges;
+
+    filters_unsharp_mask_t unsharp_mask;
+    /* Sharpens the luma alone, through 16-bit YCbCr planes of the output image */
+    bool unsharp_mask_luma;
+    filters_planes_t *planes;
+    uint8_t *sharpened_luma;
+
+    char *lut_file_name;
+
+    filters_morphology_t morphology;
+
+    /* Zero until given on the command line or by `ips_tune_job` */
+    size_t threads_count;
+    size_t tasks_count;
+
+    /* The region of interest counts from the top left corner of the image */
+    bool region_of_interest;
+    size_t roi_x, roi_y, roi_width, roi_height;
+
+    bmp_image image;
+    /* The resize and the transforms write to an image of their own, the others to the source one */
+    bmp_image destination_image;
+    bmp_image *output_image;
+
+    /* A region of interest is read into an image of its own, the filters read from it */
+    bmp_image region;
+    bmp_image *input_image;
+    size_t region_x, region_y;
+
+    filters_resize_t *resize;
+
+    cube_lut cube;
+    filters_lut3d_t *lut3d;
+
+    FILE *source_descriptor;
+    FILE *destination_descriptor;
+} ips_job_t;
+
+static void ips_init_job_structure(ips_job_t *job);
+static void ips_free_job_structure(ips_job_t *job);
+
+static bool ips_parse_arguments(ips_job_t *job, int argc, char *argv[]);
+
+static void ips_tune_job(ips_job_t *job, const char *executable_name);
+
+static bool ips_prepare_images(ips_job_t *job);
+
+static bool ips_process_image(ips_job_t *job, threadpool_t *threadpool);
+
+static bool ips_write_image(ips_job_t *job);
+
+#include "ips.impl.h.c"
+
+#endif /* IPS_H */
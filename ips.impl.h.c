@@ -0,0 +1,1693 @@
+#include "ips.h"
+#include "utils.h"
+#include "profiler.h"
+#include "metrics.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void ips_init_job_structure(ips_job_t *job)
+{
+    if (NULL == job) {
+        return;
+    }
+
+    memset(job, 0, sizeof(*job));
+
+    job->filter_id =
+        -1;
+    job->median_radius =
+        FILTERS_MEDIAN_DEFAULT_RADIUS;
+    job->median_in_place =
+        true;
+    job->resize_method =
+        -1;
+    job->auto_levels_clip =
+        FILTERS_AUTO_LEVELS_DEFAULT_CLIP;
+    job->transform =
+        -1;
+    job->morphology.operation =
+        -1;
+    job->morphology.radius_x =
+        FILTERS_MORPHOLOGY_DEFAULT_RADIUS;
+    job->morphology.radius_y =
+        FILTERS_MORPHOLOGY_DEFAULT_RADIUS;
+
+    bmp_init_image_structure(&job->image);
+    bmp_init_image_structure(&job->destination_image);
+    bmp_init_image_structure(&job->region);
+    job->input_image = job->output_image =
+        &job->image;
+
+    cube_init_lut_structure(&job->cube);
+}
+
+static void ips_free_job_structure(ips_job_t *job)
+{
+    if (NULL == job) {
+        return;
+    }
+
+    bmp_free_image_structure(&job->image);
+    bmp_free_image_structure(&job->destination_image);
+    bmp_free_image_structure(&job->region);
+    filters_resize_destroy(job->resize);
+    cube_free_lut_structure(&job->cube);
+    filters_lut3d_destroy(job->lut3d);
+    filters_planes_destroy(job->planes);
+    free(job->sharpened_luma);
+
+    if (NULL != job->source_descriptor) {
+        fclose(job->source_descriptor);
+        job->source_descriptor = NULL;
+    }
+
+    if (NULL != job->destination_descriptor) {
+        fclose(job->destination_descriptor);
+        job->destination_descriptor = NULL;
+    }
+}
+
+/* Parses exactly `count` comma separated numbers */
+static bool ips_parse_values(const char *text, float *values, size_t count)
+{
+    const char *cursor =
+        text;
+    size_t i = 0;
+    for (; i < count; ++i) {
+        char *end;
+        values[i] =
+            strtof(cursor, &end);
+        if (end == cursor) {
+            break;
+        }
+
+        cursor =
+            end;
+        if (',' == *cursor) {
+            ++cursor;
+        } else {
+            ++i;
+            break;
+        }
+    }
+
+    return i == count && '\0' == *cursor;
+}
+
+/* Fills the parameters of `job` from the arguments of `ips`, false if they are illegal */
+/* Parses a count from 1 to `maximum` */
+static bool ips_parse_count(const char *text, size_t maximum, size_t *count)
+{
+    char *end;
+    long value =
+        strtol(text, &end, 10);
+    if (end == text || '\0' != *end || 1 > value || (long) maximum < value) {
+        return false;
+    }
+
+    *count =
+        (size_t) value;
+
+    return true;
+}
+
+static bool ips_parse_arguments(ips_job_t *job, int argc, char *argv[])
+{
+    /* The filters parse their arguments as if the options were not there */
+    while (3 < argc) {
+        if (0 == strncmp(
+                     argv[1],
+                     IPS_Threads_Option_Name,
+                     UTILS_COUNT_OF(IPS_Threads_Option_Name)
+                 )) {
+            if (!ips_parse_count(argv[2], IPS_MAX_THREADS, &job->threads_count)) {
+                return false;
+            }
+        } else if (0 == strncmp(
+                            argv[1],
+                            IPS_Tasks_Option_Name,
+                            UTILS_COUNT_OF(IPS_Tasks_Option_Name)
+                        )) {
+            if (!ips_parse_count(argv[2], IPS_MAX_TASKS, &job->tasks_count)) {
+                return false;
+            }
+        } else if (0 == strncmp(
+                            argv[1],
+                            IPS_Region_of_Interest_Option_Name,
+                            UTILS_COUNT_OF(IPS_Region_of_Interest_Option_Name)
+                        )) {
+            char separator;
+
+            if (4 != sscanf(argv[2], "%zu,%zu,%zu,%zu%c", &job->roi_x, &job->roi_y, &job->roi_width, &job->roi_height, &separator) ||
+                0 == job->roi_width || 0 == job->roi_height) {
+                return false;
+            }
+
+            job->region_of_interest =
+                true;
+        } else {
+            break;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (3 > argc) {
+        return false;
+    }
+
+    job->filter_name =
+        argv[1];
+
+    if (0 == strncmp(
+            argv[1],
+            IPS_Brightness_Contrast_Filter_Name,
+            UTILS_COUNT_OF(IPS_Brightness_Contrast_Filter_Name)
+        )) {
+        if (6 > argc) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_BRIGHTNESS_CONTRAST_ID;
+        job->task =
+            filters_brightness_contrast_processing_task;
+        job->brightness =
+            strtof(argv[2], NULL);
+        job->contrast =
+            strtof(argv[3], NULL);
+        job->source_file_name =
+            argv[4];
+        job->destination_file_name =
+            argv[5];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Sepia_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Sepia_Filter_Name)
+                    )) {
+        job->filter_id =
+            FILTERS_SEPIA_ID;
+        job->task =
+            filters_sepia_processing_task;
+        job->source_file_name =
+            argv[2];
+        job->destination_file_name =
+            argv[3];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Median_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Median_Filter_Name)
+                    )) {
+        int argument =
+            2;
+
+        if (argument < argc - 2 && 0 == strncmp(
+                                           argv[argument],
+                                           IPS_Source_Copy_Option_Name,
+                                           UTILS_COUNT_OF(IPS_Source_Copy_Option_Name)
+                                       )) {
+            job->median_in_place =
+                false;
+            ++argument;
+        }
+
+        if (4 > argc || argument + 3 < argc) {
+            return false;
+        }
+
+        if (argument + 3 == argc) {
+            char *end;
+            long value =
+                strtol(argv[argument], &end, 10);
+            if (end == argv[argument] || '\0' != *end ||
+                1 > value || FILTERS_MEDIAN_MAX_RADIUS < value) {
+                return false;
+            }
+
+            job->median_radius =
+                (size_t) value;
+        }
+
+        job->filter_id =
+            FILTERS_MEDIAN_ID;
+        job->task =
+            filters_median_processing_task;
+        job->source_file_name =
+            argv[argc - 2];
+        job->destination_file_name =
+            argv[argc - 1];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Color_Matrix_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Color_Matrix_Filter_Name)
+                    )) {
+        bool matrix_is_valid =
+            false;
+
+        if (5 == argc) {
+            matrix_is_valid =
+                true;
+
+            if (0 == strncmp(
+                         argv[2],
+                         IPS_Sepia_Matrix_Name,
+                         UTILS_COUNT_OF(IPS_Sepia_Matrix_Name)
+                     )) {
+                filters_color_matrix_init_sepia(&job->color_matrix);
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Grayscale_Matrix_Name,
+                                UTILS_COUNT_OF(IPS_Grayscale_Matrix_Name)
+                            )) {
+                filters_color_matrix_init_grayscale(&job->color_matrix);
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Channel_Swap_Matrix_Name,
+                                UTILS_COUNT_OF(IPS_Channel_Swap_Matrix_Name)
+                            )) {
+                filters_color_matrix_init_channel_swap(&job->color_matrix);
+            } else {
+                matrix_is_valid =
+                    false;
+            }
+        } else if (6 == argc && 0 == strncmp(
+                                         argv[2],
+                                         IPS_Saturation_Matrix_Name,
+                                         UTILS_COUNT_OF(IPS_Saturation_Matrix_Name)
+                                     )) {
+            filters_color_matrix_init_saturation(
+                &job->color_matrix,
+                strtof(argv[3], NULL)
+            );
+
+            matrix_is_valid =
+                true;
+        } else if (8 == argc && 0 == strncmp(
+                                         argv[2],
+                                         IPS_White_Balance_Matrix_Name,
+                                         UTILS_COUNT_OF(IPS_White_Balance_Matrix_Name)
+                                     )) {
+            filters_color_matrix_init_white_balance(
+                &job->color_matrix,
+                strtof(argv[3], NULL),
+                strtof(argv[4], NULL),
+                strtof(argv[5], NULL)
+            );
+
+            matrix_is_valid =
+                true;
+        } else if (6 == argc && 0 == strncmp(
+                                         argv[2],
+                                         IPS_Custom_Matrix_Name,
+                                         UTILS_COUNT_OF(IPS_Custom_Matrix_Name)
+                                     )) {
+            float *coefficients =
+                &job->color_matrix.coefficients[0][0];
+            size_t coefficients_count =
+                UTILS_COUNT_OF(job->color_matrix.coefficients) *
+                    UTILS_COUNT_OF(job->color_matrix.coefficients[0]);
+
+            matrix_is_valid =
+                ips_parse_values(argv[3], coefficients, coefficients_count);
+        }
+
+        if (!matrix_is_valid) {
+            return false;
+        }
+
+        filters_color_matrix_prepare(&job->color_matrix);
+
+        job->filter_id =
+            FILTERS_COLOR_MATRIX_ID;
+        job->task =
+            filters_color_matrix_processing_task;
+        job->source_file_name =
+            argv[argc - 2];
+        job->destination_file_name =
+            argv[argc - 1];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Gaussian_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Gaussian_Filter_Name)
+                    )) {
+        char *end =
+            NULL;
+        float sigma =
+            5 == argc ? strtof(argv[2], &end) : 0.0f;
+        if (5 != argc || end == argv[2] || '\0' != *end ||
+            !(FILTERS_GAUSSIAN_MIN_SIGMA <= sigma && FILTERS_GAUSSIAN_MAX_SIGMA >= sigma)) {
+            return false;
+        }
+
+        filters_gaussian_init(&job->gaussian, sigma);
+
+        job->filter_id =
+            FILTERS_GAUSSIAN_ID;
+        job->task =
+            filters_gaussian_processing_task;
+        job->source_file_name =
+            argv[3];
+        job->destination_file_name =
+            argv[4];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Convolution_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Convolution_Filter_Name)
+                    )) {
+        bool kernel_is_valid =
+            false;
+
+        if (5 == argc) {
+            kernel_is_valid =
+                true;
+
+            if (0 == strncmp(
+                         argv[2],
+                         IPS_Sharpen_Kernel_Name,
+                         UTILS_COUNT_OF(IPS_Sharpen_Kernel_Name)
+                     )) {
+                filters_convolution_init_sharpen(&job->convolution);
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Emboss_Kernel_Name,
+                                UTILS_COUNT_OF(IPS_Emboss_Kernel_Name)
+                            )) {
+                filters_convolution_init_emboss(&job->convolution);
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Edge_Kernel_Name,
+                                UTILS_COUNT_OF(IPS_Edge_Kernel_Name)
+                            )) {
+                filters_convolution_init_edge(&job->convolution);
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Blur_Kernel_Name,
+                                UTILS_COUNT_OF(IPS_Blur_Kernel_Name)
+                            )) {
+                filters_convolution_init_blur(&job->convolution);
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Motion_Blur_Kernel_Name,
+                                UTILS_COUNT_OF(IPS_Motion_Blur_Kernel_Name)
+                            )) {
+                filters_convolution_init_motion_blur(&job->convolution);
+            } else {
+                kernel_is_valid =
+                    false;
+            }
+        } else if (7 == argc && 0 == strncmp(
+                                         argv[2],
+                                         IPS_Custom_Kernel_Name,
+                                         UTILS_COUNT_OF(IPS_Custom_Kernel_Name)
+                                     )) {
+            unsigned int kernel_width = 0, kernel_height = 0;
+            char separator;
+            float weights[FILTERS_CONVOLUTION_MAX_SIZE * FILTERS_CONVOLUTION_MAX_SIZE];
+
+            kernel_is_valid =
+                2 == sscanf(argv[3], "%ux%u%c", &kernel_width, &kernel_height, &separator) &&
+                FILTERS_CONVOLUTION_MAX_SIZE >= kernel_width &&
+                FILTERS_CONVOLUTION_MAX_SIZE >= kernel_height &&
+                ips_parse_values(argv[4], weights, kernel_width * kernel_height) &&
+                filters_convolution_init(&job->convolution, kernel_width, kernel_height, weights, 0.0f);
+        }
+
+        if (!kernel_is_valid) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_CONVOLUTION_ID;
+        job->task =
+            filters_convolution_processing_task;
+        job->source_file_name =
+            argv[argc - 2];
+        job->destination_file_name =
+            argv[argc - 1];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Resize_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Resize_Filter_Name)
+                    )) {
+        if (7 == argc) {
+            if (0 == strncmp(
+                         argv[2],
+                         IPS_Bilinear_Method_Name,
+                         UTILS_COUNT_OF(IPS_Bilinear_Method_Name)
+                     )) {
+                job->resize_method =
+                    FILTERS_RESIZE_BILINEAR;
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Bicubic_Method_Name,
+                                UTILS_COUNT_OF(IPS_Bicubic_Method_Name)
+                            )) {
+                job->resize_method =
+                    FILTERS_RESIZE_BICUBIC;
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Lanczos3_Method_Name,
+                                UTILS_COUNT_OF(IPS_Lanczos3_Method_Name)
+                            )) {
+                job->resize_method =
+                    FILTERS_RESIZE_LANCZOS3;
+            }
+
+            char *width_end, *height_end;
+            long width =
+                strtol(argv[3], &width_end, 10);
+            long height =
+                strtol(argv[4], &height_end, 10);
+            if (width_end == argv[3] || '\0' != *width_end || 1 > width ||
+                height_end == argv[4] || '\0' != *height_end || 1 > height) {
+                job->resize_method =
+                    -1;
+            }
+
+            job->resize_width =
+                (size_t) width;
+            job->resize_height =
+                (size_t) height;
+        }
+
+        if (-1 == job->resize_method) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_RESIZE_ID;
+        job->task =
+            filters_resize_processing_task;
+        job->source_file_name =
+            argv[5];
+        job->destination_file_name =
+            argv[6];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Auto_Levels_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Auto_Levels_Filter_Name)
+                    )) {
+        if (5 == argc) {
+            char *end;
+            float percentage =
+                strtof(argv[2], &end);
+            job->auto_levels_clip =
+                percentage / 100.0f;
+            if (end == argv[2] || '\0' != *end ||
+                !(0.0f <= job->auto_levels_clip && FILTERS_AUTO_LEVELS_MAX_CLIP >= job->auto_levels_clip)) {
+                return false;
+            }
+        } else if (4 != argc) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_AUTO_LEVELS_ID;
+        job->task =
+            filters_histogram_processing_task;
+        job->source_file_name =
+            argv[argc - 2];
+        job->destination_file_name =
+            argv[argc - 1];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Grayscale_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Grayscale_Filter_Name)
+                    )) {
+        if (4 != argc) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_GRAYSCALE_ID;
+        job->task =
+            filters_grayscale_processing_task;
+        job->source_file_name =
+            argv[2];
+        job->destination_file_name =
+            argv[3];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Rotate_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Rotate_Filter_Name)
+                    )) {
+        if (5 == argc) {
+            if (0 == strcmp(argv[2], "90")) {
+                job->transform =
+                    FILTERS_TRANSFORM_ROTATE_90;
+            } else if (0 == strcmp(argv[2], "180")) {
+                job->transform =
+                    FILTERS_TRANSFORM_ROTATE_180;
+            } else if (0 == strcmp(argv[2], "270")) {
+                job->transform =
+                    FILTERS_TRANSFORM_ROTATE_270;
+            }
+        }
+
+        if (-1 == job->transform) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_TRANSFORM_ID;
+        job->task =
+            filters_transform_processing_task;
+        job->source_file_name =
+            argv[3];
+        job->destination_file_name =
+            argv[4];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Flip_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Flip_Filter_Name)
+                    )) {
+        if (5 == argc) {
+            if (0 == strncmp(
+                         argv[2],
+                         IPS_Horizontal_Flip_Name,
+                         UTILS_COUNT_OF(IPS_Horizontal_Flip_Name)
+                     )) {
+                job->transform =
+                    FILTERS_TRANSFORM_FLIP_HORIZONTAL;
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Vertical_Flip_Name,
+                                UTILS_COUNT_OF(IPS_Vertical_Flip_Name)
+                            )) {
+                job->transform =
+                    FILTERS_TRANSFORM_FLIP_VERTICAL;
+            }
+        }
+
+        if (-1 == job->transform) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_TRANSFORM_ID;
+        job->task =
+            filters_transform_processing_task;
+        job->source_file_name =
+            argv[3];
+        job->destination_file_name =
+            argv[4];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Equalize_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Equalize_Filter_Name)
+                    )) {
+        if (4 != argc) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_EQUALIZE_ID;
+        job->task =
+            filters_histogram_processing_task;
+        job->source_file_name =
+            argv[2];
+        job->destination_file_name =
+            argv[3];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Morphology_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Morphology_Filter_Name)
+                    )) {
+        if (5 == argc || 6 == argc) {
+            if (0 == strncmp(
+                         argv[2],
+                         IPS_Erode_Operation_Name,
+                         UTILS_COUNT_OF(IPS_Erode_Operation_Name)
+                     )) {
+                job->morphology.operation =
+                    FILTERS_MORPHOLOGY_ERODE;
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Dilate_Operation_Name,
+                                UTILS_COUNT_OF(IPS_Dilate_Operation_Name)
+                            )) {
+                job->morphology.operation =
+                    FILTERS_MORPHOLOGY_DILATE;
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Open_Operation_Name,
+                                UTILS_COUNT_OF(IPS_Open_Operation_Name)
+                            )) {
+                job->morphology.operation =
+                    FILTERS_MORPHOLOGY_OPEN;
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Close_Operation_Name,
+                                UTILS_COUNT_OF(IPS_Close_Operation_Name)
+                            )) {
+                job->morphology.operation =
+                    FILTERS_MORPHOLOGY_CLOSE;
+            }
+        }
+
+        if (6 == argc) {
+            unsigned int element_width = 0, element_height = 0;
+            char separator;
+
+            if (2 == sscanf(argv[3], "%ux%u%c", &element_width, &element_height, &separator) &&
+                1 == element_width % 2 && 2 * FILTERS_MORPHOLOGY_MAX_RADIUS + 1 >= element_width &&
+                1 == element_height % 2 && 2 * FILTERS_MORPHOLOGY_MAX_RADIUS + 1 >= element_height) {
+                job->morphology.radius_x =
+                    element_width / 2;
+                job->morphology.radius_y =
+                    element_height / 2;
+            } else {
+                job->morphology.operation =
+                    -1;
+            }
+        }
+
+        if (-1 == job->morphology.operation) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_MORPHOLOGY_ID;
+        job->task =
+            filters_morphology_processing_task;
+        job->source_file_name =
+            argv[argc - 2];
+        job->destination_file_name =
+            argv[argc - 1];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Edges_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Edges_Filter_Name)
+                    )) {
+        int operator =
+            -1;
+
+        if (5 == argc) {
+            if (0 == strncmp(
+                         argv[2],
+                         IPS_Sobel_Operator_Name,
+                         UTILS_COUNT_OF(IPS_Sobel_Operator_Name)
+                     )) {
+                operator =
+                    FILTERS_EDGES_SOBEL;
+            } else if (0 == strncmp(
+                                argv[2],
+                                IPS_Scharr_Operator_Name,
+                                UTILS_COUNT_OF(IPS_Scharr_Operator_Name)
+                            )) {
+                operator =
+                    FILTERS_EDGES_SCHARR;
+            }
+        }
+
+        if (-1 == operator) {
+            return false;
+        }
+
+        filters_edges_init(&job->edges, operator);
+
+        job->filter_id =
+            FILTERS_EDGES_ID;
+        job->task =
+            filters_edges_processing_task;
+        job->source_file_name =
+            argv[3];
+        job->destination_file_name =
+            argv[4];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_Unsharp_Mask_Filter_Name,
+                        UTILS_COUNT_OF(IPS_Unsharp_Mask_Filter_Name)
+                    )) {
+        int argument =
+            2;
+
+        if (argument < argc - 2 && 0 == strncmp(
+                                           argv[argument],
+                                           IPS_Luma_Option_Name,
+                                           UTILS_COUNT_OF(IPS_Luma_Option_Name)
+                                       )) {
+            job->unsharp_mask_luma =
+                true;
+            ++argument;
+        }
+
+        /* The sigma, the amount and the threshold, the last two are optional */
+        int values_count =
+            argc - 2 - argument;
+        char *sigma_end =
+            NULL;
+        char *amount_end =
+            NULL;
+        char *threshold_end =
+            NULL;
+        float sigma =
+            1 <= values_count ? strtof(argv[argument], &sigma_end) : 0.0f;
+        float amount =
+            2 <= values_count ? strtof(argv[argument + 1], &amount_end) : FILTERS_UNSHARP_MASK_DEFAULT_AMOUNT;
+        long threshold =
+            3 <= values_count ?
+                strtol(argv[argument + 2], &threshold_end, 10) : FILTERS_UNSHARP_MASK_DEFAULT_THRESHOLD;
+        if (1 > values_count || 3 < values_count ||
+            sigma_end == argv[argument] || '\0' != *sigma_end ||
+            !(FILTERS_GAUSSIAN_MIN_SIGMA <= sigma && FILTERS_GAUSSIAN_MAX_SIGMA >= sigma) ||
+            (2 <= values_count && (amount_end == argv[argument + 1] || '\0' != *amount_end)) ||
+            !(0.0f <= amount && FILTERS_UNSHARP_MASK_MAX_AMOUNT >= amount) ||
+            (3 <= values_count && (threshold_end == argv[argument + 2] || '\0' != *threshold_end)) ||
+            0 > threshold || 255 < threshold) {
+            return false;
+        }
+
+        filters_unsharp_mask_init(&job->unsharp_mask, sigma, amount, (uint8_t) threshold);
+
+        job->filter_id =
+            FILTERS_UNSHARP_MASK_ID;
+        job->task =
+            job->unsharp_mask_luma ? filters_colorspace_processing_task : filters_unsharp_mask_processing_task;
+        job->source_file_name =
+            argv[argc - 2];
+        job->destination_file_name =
+            argv[argc - 1];
+    } else if (0 == strncmp(
+                        argv[1],
+                        IPS_LUT3D_Filter_Name,
+                        UTILS_COUNT_OF(IPS_LUT3D_Filter_Name)
+                    )) {
+        if (5 != argc) {
+            return false;
+        }
+
+        job->filter_id =
+            FILTERS_LUT3D_ID;
+        job->task =
+            filters_lut3d_processing_task;
+        job->lut_file_name =
+            argv[2];
+        job->source_file_name =
+            argv[3];
+        job->destination_file_name =
+            argv[4];
+    } else {
+        return false;
+    }
+
+    /* The resize has no place for its output in the source image */
+    if (job->region_of_interest && job->filter_id == FILTERS_RESIZE_ID) {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+    Reads the source image, or the region of interest of it, prepares the
+    images and the tables the filter writes to and reads from, and opens
+    the destination.
+*/
+/*
+    Threads and tasks that the command line leaves out come from the line
+    of the filter in the tuning file, `<filter> <threads> <tasks>` with `#`
+    for comments, that `ips_bench --sweep --tune` writes. The file is named
+    by the `IPS_TUNING` environment variable, or else after the executable
+    with `.tuning` appended, next to the executable that runs even when it
+    was started through `PATH` or a symbolic link. Without a line for the filter, or with only
+    the threads given, the pool has twice as many threads as there are
+    cores and the image is cut into as many tasks as there are threads.
+*/
+static void ips_tune_job(ips_job_t *job, const char *executable_name)
+{
+    size_t tuned_threads_count =
+        0;
+    size_t tuned_tasks_count =
+        0;
+
+    char *tuning_file_name =
+        getenv(IPS_Tuning_Variable_Name);
+    char *default_file_name =
+        NULL;
+    if (NULL == tuning_file_name || '\0' == *tuning_file_name) {
+        default_file_name =
+            malloc(strlen(executable_name) + UTILS_COUNT_OF(IPS_Tuning_File_Extension));
+        if (NULL != default_file_name) {
+            strcpy(default_file_name, executable_name);
+            strcat(default_file_name, IPS_Tuning_File_Extension);
+        }
+        tuning_file_name =
+            default_file_name;
+    }
+
+    FILE *tuning_file =
+        NULL != tuning_file_name && 0 == job->threads_count ? fopen(tuning_file_name, "r") : NULL;
+    if (NULL != tuning_file) {
+        char line[256];
+        while (NULL != fgets(line, sizeof(line), tuning_file)) {
+            char filter_name[64];
+            size_t threads_count, tasks_count;
+            if ('#' != line[0] &&
+                3 == sscanf(line, "%63s %zu %zu", filter_name, &threads_count, &tasks_count) &&
+                0 == strcmp(filter_name, job->filter_name) &&
+                0 < threads_count && IPS_MAX_THREADS >= threads_count &&
+                0 < tasks_count && IPS_MAX_TASKS >= tasks_count) {
+                tuned_threads_count =
+                    threads_count;
+                tuned_tasks_count =
+                    tasks_count;
+            }
+        }
+
+        fclose(tuning_file);
+    }
+    free(default_file_name);
+
+    if (0 == job->threads_count) {
+        job->threads_count =
+            0 < tuned_threads_count ? tuned_threads_count : utils_get_number_of_cpu_cores() * 2;
+    }
+    if (0 == job->tasks_count) {
+        job->tasks_count =
+            0 < tuned_tasks_count ? tuned_tasks_count : job->threads_count;
+    }
+}
+
+static bool ips_prepare_images(ips_job_t *job)
+{
+PROFILER_SCOPE_BEGIN("open");
+    job->source_descriptor = fopen(job->source_file_name, "r");
+    if (NULL == job->source_descriptor) {
+        fprintf(
+            stderr,
+            "%s '%s'\n",
+            IPS_Error_Failed_to_Open_Image,
+            job->source_file_name
+        );
+
+        return false;
+    }
+
+    const char *error_message;
+
+    bmp_open_image_headers(job->source_descriptor, &job->image, &error_message);
+PROFILER_SCOPE_END();
+    if (NULL != error_message) {
+        fprintf(
+            stderr,
+            "%s '%s':\n"
+            "\t%s\n",
+            IPS_Error_Failed_to_Process_Image,
+            job->source_file_name,
+            error_message
+        );
+
+        return false;
+    }
+
+    if (job->region_of_interest) {
+        size_t width =
+            job->image.absolute_image_width;
+        size_t height =
+            job->image.absolute_image_height;
+
+        if (job->roi_x >= width || job->roi_width > width - job->roi_x ||
+            job->roi_y >= height || job->roi_height > height - job->roi_y) {
+            fprintf(
+                stderr,
+                "%s '%s'\n",
+                IPS_Error_Invalid_Region,
+                job->source_file_name
+            );
+
+            return false;
+        }
+
+        /* A quarter turn writes the region transposed, it only fits back in place if it is square */
+        if (job->filter_id == FILTERS_TRANSFORM_ID && job->roi_width != job->roi_height &&
+            (FILTERS_TRANSFORM_ROTATE_90 == job->transform || FILTERS_TRANSFORM_ROTATE_270 == job->transform)) {
+            fprintf(
+                stderr,
+                "%s '%s'\n",
+                IPS_Error_Rotated_Region_Not_Square,
+                job->source_file_name
+            );
+
+            return false;
+        }
+
+        /* The rows of bottom-up images are stored from the bottom one on */
+        if (0 < job->image.dib_header.image_height) {
+            job->roi_y =
+                height - job->roi_y - job->roi_height;
+        }
+
+        /*
+            The neighborhood filters read a halo of pixels around the region,
+            so that its pixels come out as when the whole image is filtered.
+            Only the pixels of the region are written back.
+        */
+        size_t halo_x = 0, halo_y = 0;
+        if (job->filter_id == FILTERS_MEDIAN_ID) {
+            halo_x = halo_y =
+                job->median_radius;
+        } else if (job->filter_id == FILTERS_GAUSSIAN_ID) {
+            halo_x = halo_y =
+                job->gaussian.radius;
+        } else if (job->filter_id == FILTERS_UNSHARP_MASK_ID) {
+            halo_x = halo_y =
+                job->unsharp_mask.gaussian.radius;
+        } else if (job->filter_id == FILTERS_CONVOLUTION_ID) {
+            halo_x =
+                job->convolution.width / 2;
+            halo_y =
+                job->convolution.height / 2;
+        } else if (job->filter_id == FILTERS_EDGES_ID) {
+            halo_x = halo_y =
+                1;
+        } else if (job->filter_id == FILTERS_MORPHOLOGY_ID) {
+            size_t stages =
+                FILTERS_MORPHOLOGY_OPEN == job->morphology.operation ||
+                FILTERS_MORPHOLOGY_CLOSE == job->morphology.operation ? 2 : 1;
+            halo_x =
+                stages * job->morphology.radius_x;
+            halo_y =
+                stages * job->morphology.radius_y;
+        }
+
+        job->region_x =
+            job->roi_x - UTILS_MIN(job->roi_x, halo_x);
+        job->region_y =
+            job->roi_y - UTILS_MIN(job->roi_y, halo_y);
+
+PROFILER_SCOPE_BEGIN("load");
+        bmp_read_image_region(
+            job->source_descriptor,
+            &job->image,
+            &job->region,
+            job->region_x,
+            job->region_y,
+            UTILS_MIN(job->roi_x + job->roi_width + halo_x, width) - job->region_x,
+            UTILS_MIN(job->roi_y + job->roi_height + halo_y, height) - job->region_y,
+            &error_message
+        );
+PROFILER_SCOPE_END();
+
+        job->input_image = job->output_image =
+            &job->region;
+    } else {
+PROFILER_SCOPE_BEGIN("load");
+        bmp_read_image_data(job->source_descriptor, &job->image, &error_message);
+PROFILER_SCOPE_END();
+    }
+
+    if (NULL != error_message) {
+        fprintf(
+            stderr,
+            "%s '%s':\n"
+            "\t%s\n",
+            IPS_Error_Failed_to_Process_Image,
+            job->source_file_name,
+            error_message
+        );
+
+        return false;
+    }
+
+PROFILER_SCOPE_BEGIN("setup");
+    if (job->filter_id == FILTERS_RESIZE_ID) {
+        bmp_create_resized_image(&job->image, &job->destination_image, job->resize_width, job->resize_height, &error_message);
+        if (NULL != error_message) {
+            fprintf(
+                stderr,
+                "%s '%s':\n"
+                "\t%s\n",
+                IPS_Error_Failed_to_Process_Image,
+                job->destination_file_name,
+                error_message
+            );
+
+            return false;
+        }
+
+        job->resize =
+            filters_resize_create(
+                job->resize_method,
+                job->image.absolute_image_width, job->image.absolute_image_height,
+                job->resize_width, job->resize_height
+            );
+        if (NULL == job->resize) {
+            fprintf(
+                stderr,
+                "%s.\n",
+                IPS_Error_Failed_to_Create_Resampler
+            );
+
+            return false;
+        }
+
+        job->output_image =
+            &job->destination_image;
+    } else if (job->filter_id == FILTERS_LUT3D_ID) {
+        FILE *lut_descriptor =
+            fopen(job->lut_file_name, "r");
+        if (NULL == lut_descriptor) {
+            fprintf(
+                stderr,
+                "%s '%s'\n",
+                IPS_Error_Failed_to_Open_LUT,
+                job->lut_file_name
+            );
+
+            return false;
+        }
+
+        cube_read_lut(lut_descriptor, &job->cube, &error_message);
+        fclose(lut_descriptor);
+        if (NULL != error_message) {
+            fprintf(
+                stderr,
+                "%s '%s':\n"
+                "\t%s\n",
+                IPS_Error_Failed_to_Process_LUT,
+                job->lut_file_name,
+                error_message
+            );
+
+            return false;
+        }
+
+        job->lut3d =
+            filters_lut3d_create(job->cube.size, job->cube.table, job->cube.domain_min, job->cube.domain_max);
+        if (NULL == job->lut3d) {
+            fprintf(
+                stderr,
+                "%s.\n",
+                IPS_Error_Failed_to_Create_LUT
+            );
+
+            return false;
+        }
+    } else if (job->filter_id == FILTERS_UNSHARP_MASK_ID && job->unsharp_mask_luma) {
+        job->planes =
+            filters_planes_create(
+                job->output_image->absolute_image_width,
+                job->output_image->absolute_image_height,
+                FILTERS_COLORSPACE_DEPTH_16
+            );
+        if (NULL != job->planes) {
+            job->sharpened_luma =
+                aligned_alloc(64, job->planes->stride * job->planes->height);
+        }
+        if (NULL == job->planes || NULL == job->sharpened_luma) {
+            fprintf(
+                stderr,
+                "%s.\n",
+                IPS_Error_Failed_to_Create_Planes
+            );
+
+            return false;
+        }
+    } else if (job->filter_id == FILTERS_TRANSFORM_ID) {
+        if (FILTERS_TRANSFORM_FLIP_VERTICAL == job->transform && !job->region_of_interest) {
+            /* The rows are kept in the order of the file, so the sign of the height flips them */
+            job->image.dib_header.image_height =
+                -job->image.dib_header.image_height;
+        } else {
+            bool transposed =
+                FILTERS_TRANSFORM_ROTATE_90 == job->transform || FILTERS_TRANSFORM_ROTATE_270 == job->transform;
+
+            /* The rotations are in the row order of the memory, bottom-up images turn the other way */
+            if (transposed && 0 < job->image.dib_header.image_height) {
+                job->transform =
+                    FILTERS_TRANSFORM_ROTATE_90 == job->transform ?
+                        FILTERS_TRANSFORM_ROTATE_270 :
+                        FILTERS_TRANSFORM_ROTATE_90;
+            }
+
+            /* Regions of interest of the rotations by 90 and 270 degrees are square */
+            if (job->region_of_interest) {
+                bmp_create_region_image(
+                    &job->region,
+                    &job->destination_image,
+                    job->region.absolute_image_width,
+                    job->region.absolute_image_height,
+                    &error_message
+                );
+            } else {
+                bmp_create_resized_image(
+                    &job->image,
+                    &job->destination_image,
+                    transposed ? job->image.absolute_image_height : job->image.absolute_image_width,
+                    transposed ? job->image.absolute_image_width : job->image.absolute_image_height,
+                    &error_message
+                );
+            }
+            if (NULL != error_message) {
+                fprintf(
+                    stderr,
+                    "%s '%s':\n"
+                    "\t%s\n",
+                    IPS_Error_Failed_to_Process_Image,
+                    job->destination_file_name,
+                    error_message
+                );
+
+                return false;
+            }
+
+            job->output_image =
+                &job->destination_image;
+        }
+    }
+
+PROFILER_SCOPE_END();
+
+    /*
+        The region of interest is written over a copy of the source, which
+        may be the destination itself, so an existing file is not truncated.
+    */
+PROFILER_SCOPE_BEGIN("open");
+    if (job->region_of_interest) {
+        job->destination_descriptor = fopen(job->destination_file_name, "r+");
+    }
+    if (NULL == job->destination_descriptor) {
+        job->destination_descriptor = fopen(job->destination_file_name, "w");
+    }
+    if (NULL == job->destination_descriptor) {
+        fprintf(
+            stderr,
+            "%s '%s'\n",
+            IPS_Error_Failed_to_Create_Image,
+            job->destination_file_name
+        );
+
+        return false;
+    }
+
+    if (!job->region_of_interest) {
+        bmp_write_image_headers(job->destination_descriptor, job->output_image, &error_message);
+    }
+PROFILER_SCOPE_END();
+    if (NULL != error_message) {
+        fprintf(
+            stderr,
+            "%s '%s':\n"
+            "\t%s\n",
+            IPS_Error_Failed_to_Process_Image,
+            job->destination_file_name,
+            error_message
+        );
+
+        return false;
+    }
+
+    return true;
+}
+
+/* Runs the tasks of the filter over the image once */
+static bool ips_process_image(ips_job_t *job, threadpool_t *threadpool)
+{
+    static volatile ssize_t channels_left =
+        0;
+    static volatile bool barrier_sense =
+        false;
+    uint8_t *pixels =
+        job->output_image->pixels;
+
+METRICS_IMAGE_BEGIN();
+
+    /*
+        By default the median filters the image in place and every task
+        keeps a few source rows of its own. With `--source-copy` the
+        tasks read from a full copy of the image.
+    */
+    uint8_t *original_pixels = pixels;
+    if (job->filter_id == FILTERS_MEDIAN_ID && !job->median_in_place) {
+        original_pixels = (uint8_t *) aligned_alloc(64, job->input_image->aligned_image_size);
+        if (NULL == original_pixels) {
+            fprintf(
+                stderr,
+                "%s.\n",
+                IPS_Error_Failed_to_Duplicate_the_Image
+            );
+
+            return false;
+        }
+
+        memcpy(original_pixels, pixels, job->input_image->aligned_image_size);
+    }
+
+    size_t width =
+        job->output_image->absolute_image_width;
+    size_t height =
+        job->output_image->absolute_image_height;
+    size_t channels_count =
+        width * height * 4;
+    size_t channels_per_thread =
+        UTILS_MAX(channels_count / job->tasks_count, 1);
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+    channels_per_thread =
+        ((channels_per_thread - 1) / 64 + 1) * 64;
+#else
+    channels_per_thread =
+        ((channels_per_thread - 1) / 4 + 1) * 4;
+#endif
+    if (job->filter_id == FILTERS_MEDIAN_ID      ||
+        job->filter_id == FILTERS_GAUSSIAN_ID    ||
+        job->filter_id == FILTERS_CONVOLUTION_ID ||
+        job->filter_id == FILTERS_RESIZE_ID      ||
+        job->filter_id == FILTERS_TRANSFORM_ID   ||
+        job->filter_id == FILTERS_MORPHOLOGY_ID  ||
+        job->filter_id == FILTERS_EDGES_ID       ||
+        job->filter_id == FILTERS_UNSHARP_MASK_ID) {
+        /* Neighborhood filters, the resize and the transforms work on whole rows */
+        size_t stride =
+            width * 4;
+        channels_per_thread =
+            ((channels_per_thread - 1) / stride + 1) * stride;
+
+        /* Transposes on whole tiles */
+        if (job->filter_id == FILTERS_TRANSFORM_ID || job->filter_id == FILTERS_MORPHOLOGY_ID) {
+            size_t tile_stride =
+                stride * FILTERS_TRANSFORM_TILE;
+            channels_per_thread =
+                ((channels_per_thread - 1) / tile_stride + 1) * tile_stride;
+        }
+    }
+
+    size_t tasks_count =
+        (channels_count + channels_per_thread - 1) / channels_per_thread;
+    void **tasks_data =
+        calloc(tasks_count, sizeof(*tasks_data));
+    if (NULL == tasks_data) {
+        fprintf(
+            stderr,
+            "%s.\n",
+            IPS_Error_Failed_to_Create_Tasks
+        );
+
+        return false;
+    }
+
+    /* Every histogram task counts into a slot of its own, so none of them share counters */
+    filters_histogram_t *histograms =
+        NULL;
+    filters_lut_t lut;
+    if (job->filter_id == FILTERS_AUTO_LEVELS_ID || job->filter_id == FILTERS_EQUALIZE_ID) {
+        histograms =
+            calloc(tasks_count, sizeof(*histograms));
+        if (NULL == histograms) {
+            fprintf(
+                stderr,
+                "%s.\n",
+                IPS_Error_Failed_to_Create_Tasks
+            );
+
+            free(tasks_data);
+
+            return false;
+        }
+    }
+
+    /* The planes read back with the sharpened luma in place of the original one */
+    filters_planes_t sharpened_planes;
+    if (NULL != job->planes) {
+        sharpened_planes =
+            *job->planes;
+        sharpened_planes.y =
+            job->sharpened_luma;
+    }
+
+    bool tasks_failed =
+        false;
+
+PROFILER_START(1)
+PROFILER_SCOPE_BEGIN("compute");
+    /*
+        The histogram filters make two passes over the image: the first
+        one counts the values of every band into a histogram of its own,
+        the second one applies the lookup table built from their sum. The
+        unsharp mask of the luma makes three: to the planes, the sharpening
+        of their luma and back to the pixels with the sharpened one.
+    */
+    size_t passes_count =
+        job->filter_id == FILTERS_AUTO_LEVELS_ID || job->filter_id == FILTERS_EQUALIZE_ID ? 2 : 1;
+    if (job->filter_id == FILTERS_UNSHARP_MASK_ID && job->unsharp_mask_luma) {
+        passes_count =
+            3;
+    }
+    if (FILTERS_TRANSFORM_FLIP_VERTICAL == job->transform && !job->region_of_interest) {
+        passes_count =
+            0;
+    }
+    for (size_t pass = 0; pass < passes_count; ++pass) {
+        PROFILER_TASKS_ADD_BYTES(channels_count);
+
+        channels_left =
+            (ssize_t) channels_count;
+        barrier_sense =
+            false;
+
+        if (1 == pass && NULL != histograms) {
+PROFILER_SCOPE_BEGIN("histogram");
+            filters_histogram_t histogram;
+            memset(&histogram, 0, sizeof(histogram));
+            for (size_t task_index = 0; task_index < tasks_count; ++task_index) {
+                filters_merge_histograms(&histogram, &histograms[task_index]);
+            }
+
+            if (job->filter_id == FILTERS_AUTO_LEVELS_ID) {
+                filters_lut_init_auto_levels(&lut, &histogram, job->auto_levels_clip);
+            } else {
+                filters_lut_init_equalize(&lut, &histogram);
+            }
+            filters_lut_prepare(&lut);
+PROFILER_SCOPE_END();
+        }
+
+PROFILER_SCOPE_BEGIN("dispatch");
+        /*
+            All the tasks are created before the first one is started, as
+            the neighborhood filter tasks copy the rows of their neighbours
+            on creation.
+        */
+        for (size_t task_index = 0; task_index < tasks_count; ++task_index) {
+            size_t linear_position =
+                task_index * channels_per_thread;
+            size_t channels_to_process =
+                linear_position + channels_per_thread > channels_count ?
+                    channels_count - linear_position :
+                    channels_per_thread;
+
+            void *task_data;
+            switch (job->filter_id) {
+                case FILTERS_BRIGHTNESS_CONTRAST_ID:
+                    task_data =
+                        filters_brightness_contrast_data_create(
+                            linear_position,
+                            channels_to_process,
+                            pixels,
+                            job->brightness, job->contrast,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_SEPIA_ID:
+                    task_data =
+                        filters_sepia_data_create(
+                            linear_position,
+                            channels_to_process,
+                            pixels,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_MEDIAN_ID:
+                    task_data =
+                        filters_median_data_create(
+                            linear_position,
+                            channels_to_process,
+                            width, height,
+                            job->median_radius,
+                            original_pixels,
+                            pixels,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_COLOR_MATRIX_ID:
+                    task_data =
+                        filters_color_matrix_data_create(
+                            linear_position,
+                            channels_to_process,
+                            pixels,
+                            &job->color_matrix,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_GAUSSIAN_ID:
+                    task_data =
+                        filters_gaussian_data_create(
+                            linear_position,
+                            channels_to_process,
+                            width, height,
+                            pixels,
+                            &job->gaussian,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_CONVOLUTION_ID:
+                    task_data =
+                        filters_convolution_data_create(
+                            linear_position,
+                            channels_to_process,
+                            width, height,
+                            pixels,
+                            &job->convolution,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_AUTO_LEVELS_ID:
+                case FILTERS_EQUALIZE_ID:
+                    task_data =
+                        0 == pass ?
+                            (void *) filters_histogram_data_create(
+                                         linear_position,
+                                         channels_to_process,
+                                         pixels,
+                                         &histograms[task_index],
+                                         &channels_left,
+                                         &barrier_sense
+                                     ) :
+                            (void *) filters_lut_data_create(
+                                         linear_position,
+                                         channels_to_process,
+                                         pixels,
+                                         &lut,
+                                         &channels_left,
+                                         &barrier_sense
+                                     );
+                    break;
+                case FILTERS_GRAYSCALE_ID:
+                    task_data =
+                        filters_grayscale_data_create(
+                            linear_position,
+                            channels_to_process,
+                            pixels,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_TRANSFORM_ID:
+                    task_data =
+                        filters_transform_data_create(
+                            linear_position,
+                            channels_to_process,
+                            job->input_image->pixels,
+                            pixels,
+                            job->input_image->absolute_image_width,
+                            job->input_image->absolute_image_height,
+                            job->transform,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_EDGES_ID:
+                    task_data =
+                        filters_edges_data_create(
+                            linear_position,
+                            channels_to_process,
+                            width, height,
+                            pixels,
+                            &job->edges,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_UNSHARP_MASK_ID:
+                    if (job->unsharp_mask_luma) {
+                        task_data =
+                            filters_colorspace_data_create(
+                                linear_position,
+                                channels_to_process,
+                                pixels,
+                                2 == pass ? &sharpened_planes : job->planes,
+                                0 == pass ?
+                                    FILTERS_COLORSPACE_TO_PLANES :
+                                    1 == pass ? FILTERS_COLORSPACE_SHARPEN_LUMA : FILTERS_COLORSPACE_FROM_PLANES,
+                                &job->unsharp_mask,
+                                job->sharpened_luma,
+                                &channels_left,
+                                &barrier_sense
+                            );
+                        break;
+                    }
+
+                    task_data =
+                        filters_unsharp_mask_data_create(
+                            linear_position,
+                            channels_to_process,
+                            width, height,
+                            pixels,
+                            &job->unsharp_mask,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_LUT3D_ID:
+                    task_data =
+                        filters_lut3d_data_create(
+                            linear_position,
+                            channels_to_process,
+                            pixels,
+                            job->lut3d,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_MORPHOLOGY_ID:
+                    task_data =
+                        filters_morphology_data_create(
+                            linear_position,
+                            channels_to_process,
+                            width, height,
+                            pixels,
+                            &job->morphology,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                case FILTERS_RESIZE_ID:
+                    task_data =
+                        filters_resize_data_create(
+                            linear_position,
+                            channels_to_process,
+                            job->input_image->pixels,
+                            pixels,
+                            job->resize,
+                            &channels_left,
+                            &barrier_sense
+                        );
+                    break;
+                default:
+                    task_data =
+                        NULL;
+            }
+
+            tasks_data[task_index] =
+                task_data;
+
+            /* A task that could not be created counts as done, so that the wait ends, and fails the run */
+            if (NULL == task_data) {
+                tasks_failed =
+                    true;
+
+                ssize_t channels_left_after = __sync_sub_and_fetch(&channels_left, (ssize_t) channels_to_process);
+                if (0 >= channels_left_after) {
+                    (void) __sync_lock_test_and_set(&barrier_sense, true);
+                }
+            }
+        }
+
+        for (size_t task_index = 0; task_index < tasks_count; ++task_index) {
+            if (NULL != tasks_data[task_index]) {
+                threadpool_enqueue_task(
+                    threadpool,
+                    0 == pass || job->filter_id == FILTERS_UNSHARP_MASK_ID ? job->task : filters_lut_processing_task,
+                    tasks_data[task_index],
+                    NULL
+                );
+            }
+        }
+
+PROFILER_SCOPE_END();
+
+PROFILER_SCOPE_BEGIN("wait");
+        while (!barrier_sense) { }
+PROFILER_SCOPE_END();
+
+        if (tasks_failed) {
+            break;
+        }
+    }
+PROFILER_SCOPE_END();
+PROFILER_STOP();
+
+    free(tasks_data);
+    tasks_data = NULL;
+
+    free(histograms);
+    histograms = NULL;
+
+    if (pixels != original_pixels) {
+        free(original_pixels);
+    }
+    original_pixels = NULL;
+
+    if (tasks_failed) {
+        fprintf(
+            stderr,
+            "%s.\n",
+            IPS_Error_Failed_to_Create_Tasks
+        );
+
+        return false;
+    }
+
+METRICS_IMAGE_END(
+    job->filter_id,
+    job->filter_name,
+    job->input_image->absolute_image_width * job->input_image->absolute_image_height * job->input_image->channels,
+    width * height * job->output_image->channels
+);
+
+    return true;
+}
+
+static bool ips_write_image(ips_job_t *job)
+{
+    const char *error_message;
+
+    /* The pixels of the region of interest lie past the halo of the region read */
+PROFILER_SCOPE_BEGIN("store");
+    if (job->region_of_interest) {
+PROFILER_SCOPE_BEGIN("copy");
+        bmp_copy_image_file(job->source_descriptor, job->destination_descriptor, &job->image, &error_message);
+PROFILER_SCOPE_END();
+        if (NULL == error_message) {
+PROFILER_SCOPE_BEGIN("write");
+            bmp_write_image_region(
+                job->destination_descriptor,
+                &job->image,
+                job->output_image,
+                job->roi_x - job->region_x,
+                job->roi_y - job->region_y,
+                job->roi_x,
+                job->roi_y,
+                job->roi_width,
+                job->roi_height,
+                &error_message
+            );
+PROFILER_SCOPE_END();
+        }
+    } else {
+        bmp_write_image_data(job->destination_descriptor, job->output_image, &error_message);
+    }
+PROFILER_SCOPE_END();
+    if (NULL != error_message) {
+        fprintf(
+            stderr,
+            "%s '%s':\n"
+            "\t%s\n",
+            IPS_Error_Failed_to_Process_Image,
+            job->destination_file_name,
+            error_message
+        );
+
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,784 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ips.h"
+#include "utils.h"
+#include "threadpool.h"
+#include "metrics.h"
+
+static const char IPS_Bench_Usage[] =
+                    "Usage: ips_bench "                                                       \
+                        "[--warmup <count (default 3)>] [--passes <count (default 20)>] "     \
+                        "[--sweep [--tune <tuning file>]] "                                   \
+                        "[--baseline <JSON Lines file> [--threshold <percent (default 10)>]] " \
+                        "<arguments of ips>",
+                  IPS_Bench_Warmup_Option_Name[] =
+                    "--warmup",
+                  IPS_Bench_Passes_Option_Name[] =
+                    "--passes",
+                  IPS_Bench_Sweep_Option_Name[] =
+                    "--sweep",
+                  IPS_Bench_Tune_Option_Name[] =
+                    "--tune",
+                  IPS_Bench_Baseline_Option_Name[] =
+                    "--baseline",
+                  IPS_Bench_Threshold_Option_Name[] =
+                    "--threshold",
+                  IPS_Bench_Median_Key[] =
+                    "\"median\":",
+                  IPS_Bench_Executable_Prefix[] =
+                    "ips_bench_",
+                  IPS_Bench_Error_Failed_to_Copy_the_Image[] =
+                    "Error keeping a copy of the source image",
+                  IPS_Bench_Error_Failed_to_Write_Tuning[] =
+                    "Error writing the tuning file";
+
+#define IPS_BENCH_DEFAULT_WARMUP 3
+#define IPS_BENCH_DEFAULT_PASSES 20
+#define IPS_BENCH_MAX_PASSES     100000
+
+#define IPS_BENCH_DEFAULT_THRESHOLD 10
+
+/* Tasks per thread that a sweep tries for every count of threads */
+static const size_t IPS_Bench_Sweep_Tasks_per_Thread[] = { 1, 2, 4, 8, 16 };
+
+#define IPS_BENCH_MAX_SWEEP_THREADS 32
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION && defined INTRINSICS
+#define IPS_BENCH_BACKEND "simd-intrinsics"
+#elif defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#define IPS_BENCH_BACKEND "simd-asm"
+#elif defined FILTERS_X87_ASM_IMPLEMENTATION
+#define IPS_BENCH_BACKEND "x87-asm"
+#else
+#define IPS_BENCH_BACKEND "c"
+#endif
+
+#if defined __OPTIMIZE__
+#define IPS_BENCH_OPTIMIZED true
+#else
+#define IPS_BENCH_OPTIMIZED false
+#endif
+
+/* Nanoseconds of a clock that NTP neither steps nor slews */
+static inline uint64_t ips_bench_get_time(void)
+{
+    struct timespec time;
+#if defined CLOCK_MONOTONIC_RAW
+    clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &time);
+#endif
+
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+static int ips_bench_compare_times(const void *first, const void *second)
+{
+    uint64_t a =
+        *(const uint64_t *) first;
+    uint64_t b =
+        *(const uint64_t *) second;
+
+    return (a > b) - (a < b);
+}
+
+/* The nearest-rank percentile of sorted times */
+static inline uint64_t ips_bench_percentile(const uint64_t *times, size_t count, size_t percent)
+{
+    size_t rank =
+        (percent * count + 99) / 100;
+
+    return times[rank > 0 ? rank - 1 : 0];
+}
+
+static void ips_bench_print_json_string(FILE *file, const char *text)
+{
+    fputc('"', file);
+    for (; '\0' != *text; ++text) {
+        unsigned char character =
+            (unsigned char) *text;
+        if ('"' == character || '\\' == character) {
+            fprintf(file, "\\%c", character);
+        } else if (0x20 > character) {
+            fprintf(file, "\\u%04x", character);
+        } else {
+            fputc(character, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/*
+    The start of the JSON object of a run, what identifies it in a baseline:
+    the filter and its arguments, the image and the build.
+*/
+static void ips_bench_print_run_key(
+                FILE *file,
+                const ips_job_t *job,
+                int argc,
+                char *argv[]
+            )
+{
+    fprintf(file, "{\"filter\":");
+    ips_bench_print_json_string(file, job->filter_name);
+    fprintf(file, ",\"arguments\":[");
+    for (int argument = 1; argument < argc && argv[argument] != job->source_file_name; ++argument) {
+        if (1 < argument) {
+            fputc(',', file);
+        }
+        ips_bench_print_json_string(file, argv[argument]);
+    }
+    fprintf(file, "],\"image\":");
+    ips_bench_print_json_string(file, job->source_file_name);
+    fprintf(
+        file,
+        ",\"width\":%zu,\"height\":%zu"
+        ",\"backend\":\"%s\",\"optimized\":%s",
+        job->input_image->absolute_image_width,
+        job->input_image->absolute_image_height,
+        IPS_BENCH_BACKEND,
+        IPS_BENCH_OPTIMIZED ? "true" : "false"
+    );
+}
+
+/*
+    Finds the median time of the last run in the baseline, a JSON Lines
+    file written by earlier runs, whose object starts with `key`.
+*/
+static bool ips_bench_find_baseline(
+                const char *baseline_file_name,
+                const char *key,
+                uint64_t *median_time
+            )
+{
+    FILE *baseline_file =
+        fopen(baseline_file_name, "r");
+    if (NULL == baseline_file) {
+        return false;
+    }
+
+    bool is_found =
+        false;
+    size_t key_length =
+        strlen(key);
+    char *line =
+        NULL;
+    size_t line_size =
+        0;
+    while (-1 != getline(&line, &line_size, baseline_file)) {
+        const char *median =
+            strstr(line, IPS_Bench_Median_Key);
+        if (0 != strncmp(line, key, key_length) || ',' != line[key_length] || NULL == median) {
+            continue;
+        }
+
+        *median_time =
+            strtoull(median + UTILS_COUNT_OF(IPS_Bench_Median_Key) - 1, NULL, 10);
+        is_found =
+            0 < *median_time;
+    }
+
+    free(line);
+    fclose(baseline_file);
+
+    return is_found;
+}
+
+/* Parses a count of at least `minimum` and at most `IPS_BENCH_MAX_PASSES` */
+static bool ips_bench_parse_count(const char *text, size_t minimum, size_t *count)
+{
+    char *end;
+    long value =
+        strtol(text, &end, 10);
+    if (end == text || '\0' != *end ||
+        (long) minimum > value || IPS_BENCH_MAX_PASSES < value) {
+        return false;
+    }
+
+    *count =
+        (size_t) value;
+
+    return true;
+}
+
+/*
+    `ips_bench_<build>` reads the tuning file of `ips_<build>`, the build
+    that it times, from the directory of the running executable.
+*/
+static char *ips_bench_get_ips_executable_name(const char *executable_name)
+{
+    char *name =
+        utils_get_executable_path(executable_name);
+    if (NULL == name) {
+        return name;
+    }
+
+    char *base_name =
+        strrchr(name, '/');
+    base_name =
+        NULL != base_name ? base_name + 1 : name;
+
+    size_t prefix_length =
+        UTILS_COUNT_OF(IPS_Bench_Executable_Prefix) - 1;
+    if (0 == strncmp(base_name, IPS_Bench_Executable_Prefix, prefix_length)) {
+        /* Keeps the `ips_` of the prefix */
+        memmove(&base_name[4], &base_name[prefix_length], strlen(&base_name[prefix_length]) + 1);
+    }
+
+    return name;
+}
+
+/*
+    Runs the warmup and the passes, every one from the source pixels, and
+    sorts the times of the passes.
+*/
+static bool ips_bench_run(
+                ips_job_t *job,
+                threadpool_t *threadpool,
+                const uint8_t *source_pixels,
+                size_t warmup,
+                size_t passes,
+                uint64_t *times
+            )
+{
+    bmp_image *input_image =
+        job->input_image;
+
+    for (size_t pass = 0; pass < warmup + passes; ++pass) {
+        memcpy(input_image->pixels, source_pixels, input_image->aligned_image_size);
+
+        uint64_t start_time =
+            ips_bench_get_time();
+        if (!ips_process_image(job, threadpool)) {
+            return false;
+        }
+        uint64_t end_time =
+            ips_bench_get_time();
+
+        if (pass >= warmup) {
+            times[pass - warmup] =
+                end_time - start_time;
+        }
+    }
+
+    qsort(times, passes, sizeof(*times), ips_bench_compare_times);
+
+    return true;
+}
+
+/*
+    Replaces the line of the filter in the tuning file, the lines of the
+    other filters are kept. The file is written aside and renamed over the
+    old one, so that `ips` never reads half of it.
+*/
+static bool ips_bench_write_tuning(
+                const char *tuning_file_name,
+                const char *filter_name,
+                size_t threads_count,
+                size_t tasks_count
+            )
+{
+    bool result =
+        false;
+
+    char *temporary_file_name =
+        malloc(strlen(tuning_file_name) + 5);
+    if (NULL == temporary_file_name) {
+        return result;
+    }
+    sprintf(temporary_file_name, "%s.tmp", tuning_file_name);
+
+    FILE *temporary_file =
+        fopen(temporary_file_name, "w");
+    if (NULL == temporary_file) {
+        free(temporary_file_name);
+
+        return result;
+    }
+
+    fprintf(
+        temporary_file,
+        "# Written by ips_bench --sweep --tune\n"
+        "# <filter> <threads> <tasks>\n"
+    );
+
+    FILE *tuning_file =
+        fopen(tuning_file_name, "r");
+    if (NULL != tuning_file) {
+        char line[256];
+        while (NULL != fgets(line, sizeof(line), tuning_file)) {
+            char name[64];
+            if ('#' == line[0] ||
+                (1 == sscanf(line, "%63s", name) && 0 == strcmp(name, filter_name))) {
+                continue;
+            }
+
+            fputs(line, temporary_file);
+        }
+
+        fclose(tuning_file);
+    }
+
+    fprintf(temporary_file, "%s %zu %zu\n", filter_name, threads_count, tasks_count);
+
+    result =
+        0 == fclose(temporary_file) && 0 == rename(temporary_file_name, tuning_file_name);
+    if (!result) {
+        remove(temporary_file_name);
+    }
+    free(temporary_file_name);
+
+    return result;
+}
+
+/*
+    Times the filter for a grid of counts of threads, the powers of two up
+    to twice the cores and the count of cores itself, and of tasks per
+    thread. The speedups and the efficiencies are relative to one thread
+    with one task. Every count of threads runs on a pool of its own, which
+    is destroyed before the next one is created.
+*/
+static bool ips_bench_sweep(
+                ips_job_t *job,
+                const uint8_t *source_pixels,
+                size_t warmup,
+                size_t passes,
+                uint64_t *times,
+                const char *tuning_file_name
+            )
+{
+    size_t cores_count =
+        utils_get_number_of_cpu_cores();
+    size_t maximum_threads_count =
+        UTILS_MIN(cores_count * 2, IPS_MAX_THREADS);
+
+    size_t threads_counts[IPS_BENCH_MAX_SWEEP_THREADS];
+    size_t threads_counts_count =
+        0;
+    for (size_t threads_count = 1;
+         threads_count <= maximum_threads_count && IPS_BENCH_MAX_SWEEP_THREADS - 2 > threads_counts_count;
+         threads_count *= 2) {
+        if (cores_count < threads_count && cores_count > threads_count / 2) {
+            threads_counts[threads_counts_count++] =
+                cores_count;
+        }
+        threads_counts[threads_counts_count++] =
+            threads_count;
+    }
+    if (maximum_threads_count != threads_counts[threads_counts_count - 1]) {
+        threads_counts[threads_counts_count++] =
+            maximum_threads_count;
+    }
+
+    fprintf(
+        stderr,
+        "%s (%s%s): sweep, median of %zu passes\n"
+        "%8s %8s %12s %8s %11s\n",
+        job->filter_name,
+        IPS_BENCH_BACKEND,
+        IPS_BENCH_OPTIMIZED ? ", optimized" : "",
+        passes,
+        "threads", "tasks", "median ms", "speedup", "efficiency"
+    );
+
+    uint64_t baseline_time =
+        0;
+    uint64_t best_time =
+        UINT64_MAX;
+    size_t best_threads_count =
+        1;
+    size_t best_tasks_count =
+        1;
+    for (size_t i = 0; i < threads_counts_count; ++i) {
+        size_t threads_count =
+            threads_counts[i];
+        threadpool_t *threadpool =
+            threadpool_create(threads_count);
+        if (NULL == threadpool) {
+            fprintf(
+                stderr,
+                "%s.\n",
+                IPS_Error_Failed_to_Create_Threadpool
+            );
+
+            return false;
+        }
+
+        for (size_t j = 0; j < UTILS_COUNT_OF(IPS_Bench_Sweep_Tasks_per_Thread); ++j) {
+            size_t tasks_count =
+                threads_count * IPS_Bench_Sweep_Tasks_per_Thread[j];
+            if (IPS_MAX_TASKS < tasks_count) {
+                break;
+            }
+
+            job->threads_count =
+                threads_count;
+            job->tasks_count =
+                tasks_count;
+            if (!ips_bench_run(job, threadpool, source_pixels, warmup, passes, times)) {
+                threadpool_destroy(threadpool);
+
+                return false;
+            }
+
+            uint64_t median_time =
+                UTILS_MAX(ips_bench_percentile(times, passes, 50), 1);
+            if (0 == baseline_time) {
+                baseline_time =
+                    median_time;
+            }
+            if (median_time < best_time) {
+                best_time =
+                    median_time;
+                best_threads_count =
+                    threads_count;
+                best_tasks_count =
+                    tasks_count;
+            }
+
+            double speedup =
+                (double) baseline_time / (double) median_time;
+            fprintf(
+                stderr,
+                "%8zu %8zu %12.3f %8.2f %10.1f%%\n",
+                threads_count,
+                tasks_count,
+                (double) median_time / 1e6,
+                speedup,
+                100.0 * speedup / (double) threads_count
+            );
+
+            printf("{\"filter\":");
+            ips_bench_print_json_string(stdout, job->filter_name);
+            printf(
+                ",\"backend\":\"%s\",\"optimized\":%s"
+                ",\"threads\":%zu,\"tasks\":%zu,\"passes\":%zu"
+                ",\"median_nanoseconds\":%llu,\"speedup\":%.4f,\"efficiency\":%.4f}\n",
+                IPS_BENCH_BACKEND,
+                IPS_BENCH_OPTIMIZED ? "true" : "false",
+                threads_count,
+                tasks_count,
+                passes,
+                (unsigned long long) median_time,
+                speedup,
+                speedup / (double) threads_count
+            );
+        }
+
+        /* The workers of the last count stop before the next one is measured */
+        threadpool_destroy(threadpool);
+    }
+
+    fprintf(
+        stderr,
+        "%s: best %zu threads, %zu tasks, %.3f ms, speedup %.2f\n",
+        job->filter_name,
+        best_threads_count,
+        best_tasks_count,
+        (double) best_time / 1e6,
+        (double) baseline_time / (double) best_time
+    );
+
+    if (NULL != tuning_file_name &&
+        !ips_bench_write_tuning(tuning_file_name, job->filter_name, best_threads_count, best_tasks_count)) {
+        fprintf(
+            stderr,
+            "%s '%s'.\n",
+            IPS_Bench_Error_Failed_to_Write_Tuning,
+            tuning_file_name
+        );
+
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int result =
+        EXIT_FAILURE;
+
+    size_t warmup =
+        IPS_BENCH_DEFAULT_WARMUP;
+    size_t passes =
+        IPS_BENCH_DEFAULT_PASSES;
+    bool sweep =
+        false;
+    const char *tuning_file_name =
+        NULL;
+    const char *baseline_file_name =
+        NULL;
+    size_t threshold =
+        IPS_BENCH_DEFAULT_THRESHOLD;
+
+    char *ips_executable_name =
+        ips_bench_get_ips_executable_name(argv[0]);
+
+    /* The options of the bench come first, the arguments of `ips` follow as if they were not there */
+    bool options_are_valid =
+        NULL != ips_executable_name;
+    while (options_are_valid && 3 < argc) {
+        if (0 == strncmp(
+                     argv[1],
+                     IPS_Bench_Sweep_Option_Name,
+                     UTILS_COUNT_OF(IPS_Bench_Sweep_Option_Name)
+                 )) {
+            sweep =
+                true;
+
+            --argc;
+            ++argv;
+
+            continue;
+        }
+
+        if (0 == strncmp(
+                     argv[1],
+                     IPS_Bench_Tune_Option_Name,
+                     UTILS_COUNT_OF(IPS_Bench_Tune_Option_Name)
+                 )) {
+            tuning_file_name =
+                argv[2];
+        } else if (0 == strncmp(
+                            argv[1],
+                            IPS_Bench_Baseline_Option_Name,
+                            UTILS_COUNT_OF(IPS_Bench_Baseline_Option_Name)
+                        )) {
+            baseline_file_name =
+                argv[2];
+        } else if (0 == strncmp(
+                            argv[1],
+                            IPS_Bench_Threshold_Option_Name,
+                            UTILS_COUNT_OF(IPS_Bench_Threshold_Option_Name)
+                        )) {
+            options_are_valid =
+                ips_bench_parse_count(argv[2], 0, &threshold);
+        } else if (0 == strncmp(
+                            argv[1],
+                            IPS_Bench_Warmup_Option_Name,
+                            UTILS_COUNT_OF(IPS_Bench_Warmup_Option_Name)
+                        )) {
+            options_are_valid =
+                ips_bench_parse_count(argv[2], 0, &warmup);
+        } else if (0 == strncmp(
+                            argv[1],
+                            IPS_Bench_Passes_Option_Name,
+                            UTILS_COUNT_OF(IPS_Bench_Passes_Option_Name)
+                        )) {
+            options_are_valid =
+                ips_bench_parse_count(argv[2], 1, &passes);
+        } else {
+            break;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    ips_job_t job;
+    ips_init_job_structure(&job);
+
+    if (!options_are_valid || (NULL != tuning_file_name && !sweep) ||
+        (NULL != baseline_file_name && sweep) ||
+        !ips_parse_arguments(&job, argc, argv)) {
+        fprintf(
+            stderr,
+            "%s\n"
+            "\t%s\n"
+            "\t%s\n",
+            IPS_Error_Illegal_Parameters, IPS_Bench_Usage, IPS_Usage
+        );
+
+        free(ips_executable_name);
+
+        return result;
+    }
+
+    uint64_t *times =
+        NULL;
+    uint8_t *source_pixels =
+        NULL;
+
+    ips_tune_job(&job, ips_executable_name);
+
+METRICS_START();
+
+    if (!ips_prepare_images(&job)) {
+        goto cleanup;
+    }
+
+    /*
+        Most filters work in place, so every pass starts from a copy of the
+        source pixels. Restoring them is not timed, but it leaves as much of
+        the image in the caches as they hold.
+    */
+    bmp_image *input_image =
+        job.input_image;
+    source_pixels =
+        malloc(input_image->aligned_image_size);
+    times =
+        calloc(passes, sizeof(*times));
+    if (NULL == source_pixels || NULL == times) {
+        fprintf(
+            stderr,
+            "%s.\n",
+            IPS_Bench_Error_Failed_to_Copy_the_Image
+        );
+
+        goto cleanup;
+    }
+
+    memcpy(source_pixels, input_image->pixels, input_image->aligned_image_size);
+
+    if (sweep) {
+        if (!ips_bench_sweep(&job, source_pixels, warmup, passes, times, tuning_file_name) ||
+            !ips_write_image(&job)) {
+            goto cleanup;
+        }
+
+        result =
+            EXIT_SUCCESS;
+
+        goto cleanup;
+    }
+
+    threadpool_t *threadpool =
+        threadpool_create(job.threads_count);
+    if (NULL == threadpool) {
+        fprintf(
+            stderr,
+            "%s.\n",
+            IPS_Error_Failed_to_Create_Threadpool
+        );
+
+        goto cleanup;
+    }
+
+    /* The last pass is written, so that its result can be checked */
+    if (!ips_bench_run(&job, threadpool, source_pixels, warmup, passes, times) ||
+        !ips_write_image(&job)) {
+        goto cleanup;
+    }
+
+    uint64_t total_time =
+        0;
+    for (size_t pass = 0; pass < passes; ++pass) {
+        total_time +=
+            times[pass];
+    }
+
+    uint64_t median_time =
+        ips_bench_percentile(times, passes, 50);
+    double pixels_count =
+        (double) input_image->absolute_image_width * (double) input_image->absolute_image_height;
+    double median_seconds =
+        (double) UTILS_MAX(median_time, 1) / 1e9;
+    double megabytes_per_second =
+        pixels_count * 4.0 / 1e6 / median_seconds;
+    double pixels_per_second =
+        pixels_count / median_seconds;
+
+    fprintf(
+        stderr,
+        "%s (%s%s): %zu passes, min %.3f ms, median %.3f ms, p95 %.3f ms, p99 %.3f ms, "
+        "%.1f MB/s, %.1f Mpixels/s\n",
+        job.filter_name,
+        IPS_BENCH_BACKEND,
+        IPS_BENCH_OPTIMIZED ? ", optimized" : "",
+        passes,
+        (double) times[0] / 1e6,
+        (double) median_time / 1e6,
+        (double) ips_bench_percentile(times, passes, 95) / 1e6,
+        (double) ips_bench_percentile(times, passes, 99) / 1e6,
+        megabytes_per_second,
+        pixels_per_second / 1e6
+    );
+
+    /* One object per line, runs can be appended to a JSON Lines file */
+    ips_bench_print_run_key(stdout, &job, argc, argv);
+    printf(
+        ",\"threads\":%zu,\"tasks\":%zu"
+        ",\"warmup\":%zu,\"passes\":%zu"
+        ",\"nanoseconds\":{\"min\":%llu,\"median\":%llu,\"mean\":%llu"
+        ",\"p95\":%llu,\"p99\":%llu,\"max\":%llu}"
+        ",\"megabytes_per_second\":%.3f,\"pixels_per_second\":%.1f}\n",
+        job.threads_count,
+        job.tasks_count,
+        warmup,
+        passes,
+        (unsigned long long) times[0],
+        (unsigned long long) median_time,
+        (unsigned long long) (total_time / passes),
+        (unsigned long long) ips_bench_percentile(times, passes, 95),
+        (unsigned long long) ips_bench_percentile(times, passes, 99),
+        (unsigned long long) times[passes - 1],
+        megabytes_per_second,
+        pixels_per_second
+    );
+
+    result =
+        EXIT_SUCCESS;
+
+    /* A missing baseline or a run that is not in it passes, the first runs make the baseline */
+    if (NULL != baseline_file_name) {
+        char *key =
+            NULL;
+        size_t key_size =
+            0;
+        FILE *key_file =
+            open_memstream(&key, &key_size);
+        if (NULL != key_file) {
+            ips_bench_print_run_key(key_file, &job, argc, argv);
+            fclose(key_file);
+        }
+
+        uint64_t baseline_time;
+        if (NULL == key || !ips_bench_find_baseline(baseline_file_name, key, &baseline_time)) {
+            fprintf(
+                stderr,
+                "%s: no baseline in '%s'\n",
+                job.filter_name,
+                baseline_file_name
+            );
+        } else {
+            double change =
+                100.0 * ((double) median_time / (double) baseline_time - 1.0);
+            bool has_regressed =
+                change > (double) threshold;
+
+            fprintf(
+                stderr,
+                "%s: median %.3f ms, baseline %.3f ms, %+.1f%% (threshold %zu%%)%s\n",
+                job.filter_name,
+                (double) median_time / 1e6,
+                (double) baseline_time / 1e6,
+                change,
+                threshold,
+                has_regressed ? ", regressed" : ""
+            );
+
+            if (has_regressed) {
+                result =
+                    EXIT_FAILURE;
+            }
+        }
+
+        free(key);
+    }
+
+cleanup:
+METRICS_STOP();
+    free(ips_executable_name);
+    free(times);
+    free(source_pixels);
+    ips_free_job_structure(&job);
+
+    return result;
+}
@@ -0,0 +1,220 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "bmp.h"
+#include "utils.h"
+
+/*
+    Compares an image with a reference image of the same size and depth,
+    channel by channel, alpha included for 32-bit images. Prints the
+    largest and the mean absolute difference of the channels and the peak
+    signal to noise ratio, infinite for identical pixels. Fails when the
+    images cannot be compared or when one of the limits is passed.
+*/
+static const char IPS_Compare_Usage[] =
+                    "Usage: ips_compare "                                                     \
+                        "[--max-error <largest difference allowed (0-255)>] "                 \
+                        "[--min-psnr <lowest PSNR allowed in dB>] "                           \
+                        "<reference bitmap image file> <bitmap image file>",
+                  IPS_Compare_Max_Error_Option_Name[] =
+                    "--max-error",
+                  IPS_Compare_Min_PSNR_Option_Name[] =
+                    "--min-psnr",
+                  IPS_Compare_Error_Illegal_Parameters[] =
+                    "Illegal parameters",
+                  IPS_Compare_Error_Failed_to_Open_Image[] =
+                    "Failed to open the image",
+                  IPS_Compare_Error_Failed_to_Read_Image[] =
+                    "Error reading the image",
+                  IPS_Compare_Error_Different_Images[] =
+                    "The images differ in size or depth";
+
+static bool ips_compare_read_image(const char *file_name, bmp_image *image)
+{
+    FILE *descriptor =
+        fopen(file_name, "r");
+    if (NULL == descriptor) {
+        fprintf(
+            stderr,
+            "%s '%s'\n",
+            IPS_Compare_Error_Failed_to_Open_Image,
+            file_name
+        );
+
+        return false;
+    }
+
+    const char *error_message;
+    bmp_open_image_headers(descriptor, image, &error_message);
+    if (NULL == error_message) {
+        bmp_read_image_data(descriptor, image, &error_message);
+    }
+    fclose(descriptor);
+
+    if (NULL != error_message) {
+        fprintf(
+            stderr,
+            "%s '%s':\n"
+            "\t%s\n",
+            IPS_Compare_Error_Failed_to_Read_Image,
+            file_name,
+            error_message
+        );
+
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int result =
+        EXIT_FAILURE;
+
+    long maximum_error =
+        255;
+    double minimum_psnr =
+        0.0;
+
+    bool arguments_are_valid =
+        true;
+    while (arguments_are_valid && 4 < argc) {
+        char *end;
+        if (0 == strncmp(
+                     argv[1],
+                     IPS_Compare_Max_Error_Option_Name,
+                     UTILS_COUNT_OF(IPS_Compare_Max_Error_Option_Name)
+                 )) {
+            maximum_error =
+                strtol(argv[2], &end, 10);
+            arguments_are_valid =
+                end != argv[2] && '\0' == *end && 0 <= maximum_error && 255 >= maximum_error;
+        } else if (0 == strncmp(
+                            argv[1],
+                            IPS_Compare_Min_PSNR_Option_Name,
+                            UTILS_COUNT_OF(IPS_Compare_Min_PSNR_Option_Name)
+                        )) {
+            minimum_psnr =
+                strtod(argv[2], &end);
+            arguments_are_valid =
+                end != argv[2] && '\0' == *end && 0.0 <= minimum_psnr;
+        } else {
+            break;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (!arguments_are_valid || 3 != argc) {
+        fprintf(
+            stderr,
+            "%s\n"
+            "\t%s\n",
+            IPS_Compare_Error_Illegal_Parameters, IPS_Compare_Usage
+        );
+
+        return result;
+    }
+
+    char *reference_file_name =
+        argv[1];
+    char *file_name =
+        argv[2];
+
+    bmp_image reference, image;
+    bmp_init_image_structure(&reference);
+    bmp_init_image_structure(&image);
+
+    if (!ips_compare_read_image(reference_file_name, &reference) ||
+        !ips_compare_read_image(file_name, &image)) {
+        goto cleanup;
+    }
+
+    if (reference.absolute_image_width  != image.absolute_image_width  ||
+        reference.absolute_image_height != image.absolute_image_height ||
+        reference.channels              != image.channels) {
+        fprintf(
+            stderr,
+            "%s '%s' '%s'\n",
+            IPS_Compare_Error_Different_Images,
+            reference_file_name,
+            file_name
+        );
+
+        goto cleanup;
+    }
+
+    /* The decoded pixels of both images are BGRA rows in the order of the file */
+    size_t width =
+        image.absolute_image_width;
+    size_t height =
+        image.absolute_image_height;
+    size_t channels =
+        image.channels;
+
+    uint64_t error_sum =
+        0;
+    uint64_t squared_error_sum =
+        0;
+    long largest_error =
+        0;
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            const uint8_t *reference_pixel =
+                &reference.pixels[(y * width + x) * 4];
+            const uint8_t *pixel =
+                &image.pixels[(y * width + x) * 4];
+
+            for (size_t channel = 0; channel < channels; ++channel) {
+                long error =
+                    labs((long) pixel[channel] - (long) reference_pixel[channel]);
+
+                error_sum +=
+                    (uint64_t) error;
+                squared_error_sum +=
+                    (uint64_t) (error * error);
+                largest_error =
+                    UTILS_MAX(largest_error, error);
+            }
+        }
+    }
+
+    double values_count =
+        (double) width * (double) height * (double) channels;
+    double mean_error =
+        (double) error_sum / values_count;
+    double mean_squared_error =
+        (double) squared_error_sum / values_count;
+    double psnr =
+        0 < squared_error_sum ? 10.0 * log10(255.0 * 255.0 / mean_squared_error) : INFINITY;
+
+    bool within_limits =
+        largest_error <= maximum_error && psnr >= minimum_psnr;
+
+    printf(
+        "%s: max error %ld, mean error %.4f, PSNR %.2f dB%s\n",
+        file_name,
+        largest_error,
+        mean_error,
+        psnr,
+        within_limits ? "" : ", out of limits"
+    );
+
+    if (within_limits) {
+        result =
+            EXIT_SUCCESS;
+    }
+
+cleanup:
+    bmp_free_image_structure(&image);
+    bmp_free_image_structure(&reference);
+
+    return result;
+}
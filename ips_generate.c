@@ -0,0 +1,248 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bmp.h"
+#include "generator.h"
+#include "utils.h"
+
+static const char IPS_Generate_Usage[] =
+                    "Usage: ips_generate "                                                    \
+                        "[--bits <24 | 32 (default 24)>] [--top-down] "                       \
+                        "[--seed <seed (default 1)>] "                                        \
+                        "<pattern (noise | gradient | photo)> <width>x<height> "              \
+                        "<destination bitmap image file>",
+                  IPS_Generate_Bits_Option_Name[] =
+                    "--bits",
+                  IPS_Generate_Top_Down_Option_Name[] =
+                    "--top-down",
+                  IPS_Generate_Seed_Option_Name[] =
+                    "--seed",
+                  IPS_Generate_Noise_Pattern_Name[] =
+                    "noise",
+                  IPS_Generate_Gradient_Pattern_Name[] =
+                    "gradient",
+                  IPS_Generate_Photo_Pattern_Name[] =
+                    "photo",
+                  IPS_Generate_Error_Illegal_Parameters[] =
+                    "Illegal parameters",
+                  IPS_Generate_Error_Failed_to_Create_Image[] =
+                    "Failed to create the image",
+                  IPS_Generate_Error_Failed_to_Generate_Image[] =
+                    "Error generating the image";
+
+static bool ips_generate_parse_number(const char *text, unsigned long *value)
+{
+    char *end;
+    *value =
+        strtoul(text, &end, 10);
+
+    return end != text && '\0' == *end && '-' != *text;
+}
+
+int main(int argc, char *argv[])
+{
+    int result =
+        EXIT_FAILURE;
+
+    size_t bits_per_pixel =
+        24;
+    bool top_down =
+        false;
+    uint32_t seed =
+        GENERATOR_DEFAULT_SEED;
+
+    bool arguments_are_valid =
+        true;
+    while (arguments_are_valid && 4 < argc) {
+        if (0 == strncmp(
+                     argv[1],
+                     IPS_Generate_Top_Down_Option_Name,
+                     UTILS_COUNT_OF(IPS_Generate_Top_Down_Option_Name)
+                 )) {
+            top_down =
+                true;
+
+            --argc;
+            ++argv;
+
+            continue;
+        }
+
+        unsigned long value;
+        if (0 == strncmp(
+                     argv[1],
+                     IPS_Generate_Bits_Option_Name,
+                     UTILS_COUNT_OF(IPS_Generate_Bits_Option_Name)
+                 )) {
+            arguments_are_valid =
+                ips_generate_parse_number(argv[2], &value) && (24 == value || 32 == value);
+            bits_per_pixel =
+                (size_t) value;
+        } else if (0 == strncmp(
+                            argv[1],
+                            IPS_Generate_Seed_Option_Name,
+                            UTILS_COUNT_OF(IPS_Generate_Seed_Option_Name)
+                        )) {
+            arguments_are_valid =
+                ips_generate_parse_number(argv[2], &value) && UINT32_MAX >= value;
+            seed =
+                (uint32_t) value;
+        } else {
+            break;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    int pattern =
+        -1;
+    size_t width =
+        0;
+    size_t height =
+        0;
+    if (arguments_are_valid && 4 == argc) {
+        if (0 == strcmp(argv[1], IPS_Generate_Noise_Pattern_Name)) {
+            pattern =
+                GENERATOR_NOISE;
+        } else if (0 == strcmp(argv[1], IPS_Generate_Gradient_Pattern_Name)) {
+            pattern =
+                GENERATOR_GRADIENT;
+        } else if (0 == strcmp(argv[1], IPS_Generate_Photo_Pattern_Name)) {
+            pattern =
+                GENERATOR_PHOTO;
+        }
+
+        char separator;
+        arguments_are_valid =
+            -1 != pattern &&
+            2 == sscanf(argv[2], "%zux%zu%c", &width, &height, &separator) &&
+            0 < width && 0 < height;
+    } else {
+        arguments_are_valid =
+            false;
+    }
+
+    if (!arguments_are_valid) {
+        fprintf(
+            stderr,
+            "%s\n"
+            "\t%s\n",
+            IPS_Generate_Error_Illegal_Parameters, IPS_Generate_Usage
+        );
+
+        return result;
+    }
+
+    char *destination_file_name =
+        argv[3];
+
+    FILE *destination_descriptor =
+        NULL;
+    uint8_t *pixels =
+        NULL;
+    uint8_t *row =
+        NULL;
+
+    const char *error_message;
+
+    bmp_image image;
+    bmp_create_image_headers(&image, width, height, bits_per_pixel, top_down, &error_message);
+    if (NULL != error_message) {
+        goto error;
+    }
+
+    /* Rows are generated and written one at a time, the largest images never are in memory */
+    size_t channels =
+        image.channels;
+    size_t row_size =
+        width * channels + image.pixel_row_padding;
+    pixels =
+        malloc(width * 4);
+    row =
+        calloc(row_size, 1);
+    if (NULL == pixels || NULL == row) {
+        error_message =
+            BMP_Error_Not_Enough_Memory_to_Read;
+
+        goto error;
+    }
+
+    destination_descriptor =
+        fopen(destination_file_name, "w");
+    if (NULL == destination_descriptor) {
+        fprintf(
+            stderr,
+            "%s '%s'\n",
+            IPS_Generate_Error_Failed_to_Create_Image,
+            destination_file_name
+        );
+
+        goto cleanup;
+    }
+
+    bmp_write_image_headers(destination_descriptor, &image, &error_message);
+    if (NULL != error_message) {
+        goto error;
+    }
+
+    generator_t generator;
+    generator_init(&generator, pattern, width, height, seed);
+
+    /* The picture is the same in both row orders, bottom-up files start with its last row */
+    for (size_t file_row = 0; file_row < height; ++file_row) {
+        size_t y =
+            top_down ? file_row : height - 1 - file_row;
+        generator_fill_row(&generator, y, pixels);
+
+        for (size_t x = 0; x < width; ++x) {
+            memcpy(&row[x * channels], &pixels[x * 4], channels);
+        }
+
+        if (!fwrite(row, row_size, 1, destination_descriptor)) {
+            error_message =
+                BMP_Error_Failed_to_Write_Image_Data;
+
+            goto error;
+        }
+    }
+
+    if (0 != fclose(destination_descriptor)) {
+        destination_descriptor =
+            NULL;
+        error_message =
+            BMP_Error_Failed_to_Write_Image_Data;
+
+        goto error;
+    }
+    destination_descriptor =
+        NULL;
+
+    result =
+        EXIT_SUCCESS;
+
+    goto cleanup;
+
+error:
+    fprintf(
+        stderr,
+        "%s '%s':\n"
+        "\t%s\n",
+        IPS_Generate_Error_Failed_to_Generate_Image,
+        destination_file_name,
+        error_message
+    );
+
+cleanup:
+    if (NULL != destination_descriptor) {
+        fclose(destination_descriptor);
+    }
+    free(row);
+    free(pixels);
+
+    return result;
+}
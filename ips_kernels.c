@@ -0,0 +1,653 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined __x86_64__ || defined __i386__
+#include <x86intrin.h>
+#endif
+
+#include "filters.h"
+#include "generator.h"
+#include "utils.h"
+
+/*
+    Times the kernels of the filters alone, on one thread and without any
+    file I/O, over buffers sized to stay in each level of the cache and in
+    DRAM. The copy of a buffer of the same size by `memcpy` is the bandwidth
+    ceiling of the level: a kernel close to it is bound by memory, a kernel
+    far above it by computation.
+
+    Cycles are those of the time stamp counter, at a constant rate whatever
+    the clock of the core.
+*/
+static const char IPS_Kernels_Usage[] =
+                    "Usage: ips_kernels "                                                     \
+                        "[--time <milliseconds per measurement (default 100)>] "              \
+                        "[<kernel (brightness-contrast | sepia | color-matrix | lut | "       \
+                            "histogram | median | convolution | gaussian)> ...]",
+                  IPS_Kernels_Time_Option_Name[] =
+                    "--time",
+                  IPS_Kernels_Error_Illegal_Parameters[] =
+                    "Illegal parameters",
+                  IPS_Kernels_Error_Not_Enough_Memory[] =
+                    "Not enough memory for the buffers";
+
+#define IPS_KERNELS_DEFAULT_TIME    100
+#define IPS_KERNELS_MAX_TIME        60000
+#define IPS_KERNELS_MAX_REPETITIONS 1000000
+
+/* Rows of 1 KiB, small enough for a few of them to fit half of an L1 cache */
+#define IPS_KERNELS_ROW_WIDTH 256
+
+/* Rows of the picture that is repeated over the larger buffers */
+#define IPS_KERNELS_PATTERN_HEIGHT 1024
+
+#define IPS_KERNELS_LEVELS        4
+#define IPS_KERNELS_MIN_DRAM_SIZE ((size_t) 64 << 20)
+#define IPS_KERNELS_MAX_DRAM_SIZE ((size_t) 512 << 20)
+
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION && defined INTRINSICS
+#define IPS_KERNELS_BACKEND "simd-intrinsics"
+#elif defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#define IPS_KERNELS_BACKEND "simd-asm"
+#elif defined FILTERS_X87_ASM_IMPLEMENTATION
+#define IPS_KERNELS_BACKEND "x87-asm"
+#else
+#define IPS_KERNELS_BACKEND "c"
+#endif
+
+#if defined __OPTIMIZE__
+#define IPS_KERNELS_OPTIMIZED true
+#else
+#define IPS_KERNELS_OPTIMIZED false
+#endif
+
+/* Bytes that the pointwise kernels handle per call, as in `filters_threading` */
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+#define IPS_KERNELS_PIXEL_STEP  16
+#define IPS_KERNELS_MATRIX_STEP 64
+#else
+#define IPS_KERNELS_PIXEL_STEP  4
+#define IPS_KERNELS_MATRIX_STEP 4
+#endif
+
+typedef struct _ips_kernels_context
+{
+    uint8_t *source;                /* the pixels of the in place kernels              */
+    uint8_t *destination;           /* NULL for the in place kernels                   */
+    size_t width, height;
+
+    float brightness, contrast;
+    filters_color_matrix_t matrix;
+    filters_lut_t lut;
+    filters_histogram_t histogram;
+    filters_convolution_t convolution;
+    filters_gaussian_t gaussian;
+    uint8_t *padded_row;
+} ips_kernels_context_t;
+
+typedef struct _ips_kernels_kernel
+{
+    const char *name;
+    bool in_place;
+    size_t bytes_per_pixel;         /* read and written, the traffic of the floor      */
+    size_t (*run)(ips_kernels_context_t *context); /* returns the pixels computed     */
+} ips_kernels_kernel_t;
+
+typedef struct _ips_kernels_level
+{
+    const char *name;
+    size_t size;                    /* bytes of all the buffers a kernel touches       */
+    double copy_bytes_per_cycle;
+} ips_kernels_level_t;
+
+static inline uint64_t ips_kernels_get_cycles(void)
+{
+#if defined __x86_64__ || defined __i386__
+    return __rdtsc();
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+#endif
+}
+
+static inline uint64_t ips_kernels_get_nanoseconds(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/* Cycles of the counter per nanosecond, measured against the monotonic clock */
+static double ips_kernels_calibrate(void)
+{
+    uint64_t start_time =
+        ips_kernels_get_nanoseconds();
+    uint64_t start_cycles =
+        ips_kernels_get_cycles();
+
+    uint64_t end_time;
+    do {
+        end_time =
+            ips_kernels_get_nanoseconds();
+    } while (end_time - start_time < 50000000u);
+
+    uint64_t end_cycles =
+        ips_kernels_get_cycles();
+
+    return (double) (end_cycles - start_cycles) / (double) (end_time - start_time);
+}
+
+static size_t ips_kernels_run_brightness_contrast(ips_kernels_context_t *context)
+{
+    size_t end =
+        context->width * context->height * 4;
+    for (size_t position = 0; position < end; position += IPS_KERNELS_PIXEL_STEP) {
+        filters_apply_brightness_contrast(
+            context->source, position,
+            context->brightness, context->contrast
+        );
+    }
+
+    return context->width * context->height;
+}
+
+static size_t ips_kernels_run_sepia(ips_kernels_context_t *context)
+{
+    size_t end =
+        context->width * context->height * 4;
+    for (size_t position = 0; position < end; position += IPS_KERNELS_PIXEL_STEP) {
+        filters_apply_sepia(context->source, position);
+    }
+
+    return context->width * context->height;
+}
+
+static size_t ips_kernels_run_color_matrix(ips_kernels_context_t *context)
+{
+    size_t end =
+        context->width * context->height * 4;
+    for (size_t position = 0; position < end; position += IPS_KERNELS_MATRIX_STEP) {
+        filters_apply_color_matrix(context->source, position, &context->matrix);
+    }
+
+    return context->width * context->height;
+}
+
+static size_t ips_kernels_run_lut(ips_kernels_context_t *context)
+{
+    size_t end =
+        context->width * context->height * 4;
+    for (size_t position = 0; position < end; position += IPS_KERNELS_MATRIX_STEP) {
+        filters_apply_lut(context->source, position, &context->lut);
+    }
+
+    return context->width * context->height;
+}
+
+static size_t ips_kernels_run_histogram(ips_kernels_context_t *context)
+{
+    memset(&context->histogram, 0, sizeof(context->histogram));
+    filters_accumulate_histogram(
+        context->source,
+        0, context->width * context->height * 4,
+        &context->histogram
+    );
+
+    return context->width * context->height;
+}
+
+/* The 3x3 median network of the interior, the borders are left out */
+static size_t ips_kernels_run_median(ips_kernels_context_t *context)
+{
+    size_t stride =
+        context->width * 4;
+
+    uint8_t *rows[3];
+    for (size_t y = 1; y + 1 < context->height; ++y) {
+        for (size_t row = 0; row < 3; ++row) {
+            rows[row] =
+                &context->source[(y + row - 1) * stride];
+        }
+        uint8_t *destination_row =
+            &context->destination[y * stride];
+
+        size_t x =
+            1;
+#if defined FILTERS_SIMD_ASM_IMPLEMENTATION
+        for (; x + FILTERS_MEDIAN_BLOCK_SIZE <= context->width - 1; x += FILTERS_MEDIAN_BLOCK_SIZE) {
+            filters_apply_median_block(rows, destination_row, x);
+        }
+#endif
+        for (; x < context->width - 1; ++x) {
+            filters_apply_median_interior(rows, destination_row, x);
+        }
+    }
+
+    return (context->width - 2) * (context->height - 2);
+}
+
+static size_t ips_kernels_run_convolution(ips_kernels_context_t *context)
+{
+    size_t stride =
+        context->width * 4;
+
+    uint8_t *rows[3];
+    for (size_t y = 1; y + 1 < context->height; ++y) {
+        for (size_t row = 0; row < 3; ++row) {
+            rows[row] =
+                &context->source[(y + row - 1) * stride];
+        }
+
+        filters_apply_convolution_interior(
+            &context->convolution,
+            rows, &context->destination[y * stride],
+            1, context->width - 1
+        );
+    }
+
+    return (context->width - 2) * (context->height - 2);
+}
+
+/* The horizontal pass alone, the vertical one works on bands of rows and not on single rows */
+static size_t ips_kernels_run_gaussian(ips_kernels_context_t *context)
+{
+    size_t stride =
+        context->width * 4;
+
+    for (size_t y = 0; y < context->height; ++y) {
+        filters_apply_gaussian_horizontal(
+            &context->gaussian,
+            &context->source[y * stride],
+            &context->destination[y * stride],
+            context->width,
+            context->padded_row
+        );
+    }
+
+    return context->width * context->height;
+}
+
+static const ips_kernels_kernel_t IPS_Kernels_Kernels[] = {
+    { "brightness-contrast", true,  8, ips_kernels_run_brightness_contrast },
+    { "sepia",               true,  8, ips_kernels_run_sepia               },
+    { "color-matrix",        true,  8, ips_kernels_run_color_matrix        },
+    { "lut",                 true,  8, ips_kernels_run_lut                 },
+    { "histogram",           true,  4, ips_kernels_run_histogram           },
+    { "median",              false, 8, ips_kernels_run_median              },
+    { "convolution",         false, 8, ips_kernels_run_convolution         },
+    { "gaussian",            false, 8, ips_kernels_run_gaussian            }
+};
+
+static size_t ips_kernels_get_cache_size(int name, size_t fallback)
+{
+    long size =
+        sysconf(name);
+
+    return 0 < size ? (size_t) size : fallback;
+}
+
+/*
+    Half of every cache level, the other half is left to the tables, the
+    stack and the neighbours of the buffers. DRAM gets twice the last level.
+*/
+static void ips_kernels_init_levels(ips_kernels_level_t *levels)
+{
+#if defined _SC_LEVEL1_DCACHE_SIZE && defined _SC_LEVEL2_CACHE_SIZE && defined _SC_LEVEL3_CACHE_SIZE
+    size_t l1_size =
+        ips_kernels_get_cache_size(_SC_LEVEL1_DCACHE_SIZE, 32 << 10);
+    size_t l2_size =
+        ips_kernels_get_cache_size(_SC_LEVEL2_CACHE_SIZE, 1 << 20);
+    size_t l3_size =
+        ips_kernels_get_cache_size(_SC_LEVEL3_CACHE_SIZE, 8 << 20);
+#else
+    size_t l1_size =
+        32 << 10;
+    size_t l2_size =
+        1 << 20;
+    size_t l3_size =
+        8 << 20;
+#endif
+
+    static const char *Names[IPS_KERNELS_LEVELS] = { "L1", "L2", "L3", "DRAM" };
+    size_t sizes[IPS_KERNELS_LEVELS] = {
+        l1_size / 2,
+        l2_size / 2,
+        l3_size / 2,
+        UTILS_CLAMP(l3_size * 2, IPS_KERNELS_MIN_DRAM_SIZE, IPS_KERNELS_MAX_DRAM_SIZE)
+    };
+
+    /* Whole rows in both halves of the out of place kernels, three of them at least */
+    size_t granularity =
+        2 * IPS_KERNELS_ROW_WIDTH * 4;
+    for (size_t level = 0; level < IPS_KERNELS_LEVELS; ++level) {
+        levels[level].name =
+            Names[level];
+        levels[level].size =
+            UTILS_MAX(sizes[level] / granularity, 3) * granularity;
+        levels[level].copy_bytes_per_cycle =
+            0.0;
+    }
+}
+
+/*
+    The fewest cycles of the repetitions that fit the time given, after a
+    first run that warms the buffers up. In place kernels start every run
+    from the same pixels, some branch on their values.
+*/
+static uint64_t ips_kernels_measure(
+                    const ips_kernels_kernel_t *kernel,
+                    ips_kernels_context_t *context,
+                    const uint8_t *original,
+                    uint64_t time_cycles,
+                    size_t *pixels
+                )
+{
+    size_t in_place_size =
+        context->width * context->height * 4;
+
+    if (kernel->in_place) {
+        memcpy(context->source, original, in_place_size);
+    }
+    uint64_t start_cycles =
+        ips_kernels_get_cycles();
+    *pixels =
+        kernel->run(context);
+    uint64_t best_cycles =
+        UTILS_MAX(ips_kernels_get_cycles() - start_cycles, 1);
+
+    size_t repetitions =
+        UTILS_CLAMP(time_cycles / best_cycles, 1, IPS_KERNELS_MAX_REPETITIONS);
+    for (size_t repetition = 0; repetition < repetitions; ++repetition) {
+        if (kernel->in_place) {
+            memcpy(context->source, original, in_place_size);
+        }
+
+        start_cycles =
+            ips_kernels_get_cycles();
+        kernel->run(context);
+        uint64_t cycles =
+            ips_kernels_get_cycles() - start_cycles;
+
+        best_cycles =
+            UTILS_MIN(best_cycles, UTILS_MAX(cycles, 1));
+    }
+
+    return best_cycles;
+}
+
+/* The bytes per cycle of copying one half of the level to the other, both read and written */
+static double ips_kernels_measure_copy(uint8_t *buffer, size_t size, uint64_t time_cycles)
+{
+    size_t half =
+        size / 2;
+
+    uint64_t start_cycles =
+        ips_kernels_get_cycles();
+    memcpy(&buffer[half], buffer, half);
+    uint64_t best_cycles =
+        UTILS_MAX(ips_kernels_get_cycles() - start_cycles, 1);
+
+    size_t repetitions =
+        UTILS_CLAMP(time_cycles / best_cycles, 1, IPS_KERNELS_MAX_REPETITIONS);
+    for (size_t repetition = 0; repetition < repetitions; ++repetition) {
+        start_cycles =
+            ips_kernels_get_cycles();
+        memcpy(&buffer[half], buffer, half);
+        __asm__ __volatile__ ("" : : "r" (buffer) : "memory");
+        uint64_t cycles =
+            ips_kernels_get_cycles() - start_cycles;
+
+        best_cycles =
+            UTILS_MIN(best_cycles, UTILS_MAX(cycles, 1));
+    }
+
+    return (double) (2 * half) / (double) best_cycles;
+}
+
+int main(int argc, char *argv[])
+{
+    int result =
+        EXIT_FAILURE;
+
+    unsigned long time_milliseconds =
+        IPS_KERNELS_DEFAULT_TIME;
+
+    bool arguments_are_valid =
+        true;
+    if (2 < argc && 0 == strncmp(
+                             argv[1],
+                             IPS_Kernels_Time_Option_Name,
+                             UTILS_COUNT_OF(IPS_Kernels_Time_Option_Name)
+                         )) {
+        char *end;
+        time_milliseconds =
+            strtoul(argv[2], &end, 10);
+        arguments_are_valid =
+            end != argv[2] && '\0' == *end && '-' != *argv[2] &&
+            0 < time_milliseconds && IPS_KERNELS_MAX_TIME >= time_milliseconds;
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    /* The kernels named on the command line, all of them by default */
+    bool selected[UTILS_COUNT_OF(IPS_Kernels_Kernels)];
+    memset(selected, 1 == argc, sizeof(selected));
+    for (int argument = 1; arguments_are_valid && argument < argc; ++argument) {
+        arguments_are_valid =
+            false;
+        for (size_t kernel = 0; kernel < UTILS_COUNT_OF(IPS_Kernels_Kernels); ++kernel) {
+            if (0 == strcmp(argv[argument], IPS_Kernels_Kernels[kernel].name)) {
+                selected[kernel] =
+                    true;
+                arguments_are_valid =
+                    true;
+            }
+        }
+    }
+
+    if (!arguments_are_valid) {
+        fprintf(
+            stderr,
+            "%s\n"
+            "\t%s\n",
+            IPS_Kernels_Error_Illegal_Parameters, IPS_Kernels_Usage
+        );
+
+        return result;
+    }
+
+    ips_kernels_level_t levels[IPS_KERNELS_LEVELS];
+    ips_kernels_init_levels(levels);
+    size_t maximum_size =
+        levels[IPS_KERNELS_LEVELS - 1].size;
+
+    ips_kernels_context_t context;
+    memset(&context, 0, sizeof(context));
+
+    uint8_t *buffer =
+        aligned_alloc(64, maximum_size);
+    uint8_t *original =
+        aligned_alloc(64, maximum_size);
+
+    context.brightness =
+        10.0f;
+    context.contrast =
+        1.2f;
+    filters_color_matrix_init_sepia(&context.matrix);
+    filters_color_matrix_prepare(&context.matrix);
+    filters_convolution_init_sharpen(&context.convolution);
+    filters_gaussian_init(&context.gaussian, 2.0f);
+    size_t padded_row_size =
+        (filters_gaussian_padded_row_size(&context.gaussian, IPS_KERNELS_ROW_WIDTH) + 63) / 64 * 64;
+    context.padded_row =
+        aligned_alloc(64, padded_row_size);
+
+    if (NULL == buffer || NULL == original || NULL == context.padded_row) {
+        fprintf(
+            stderr,
+            "%s.\n",
+            IPS_Kernels_Error_Not_Enough_Memory
+        );
+
+        goto cleanup;
+    }
+
+    /*
+        A synthetic photo, with the flat areas, edges and grain the kernels
+        meet in real images. It is generated once and tiled over the larger
+        buffers, the unoptimized builds would take minutes to generate them.
+    */
+    size_t stride =
+        IPS_KERNELS_ROW_WIDTH * 4;
+    size_t rows_count =
+        maximum_size / stride;
+    size_t pattern_rows_count =
+        UTILS_MIN(rows_count, IPS_KERNELS_PATTERN_HEIGHT);
+    generator_t generator;
+    generator_init(
+        &generator,
+        GENERATOR_PHOTO,
+        IPS_KERNELS_ROW_WIDTH, pattern_rows_count,
+        GENERATOR_DEFAULT_SEED
+    );
+    for (size_t y = 0; y < rows_count; ++y) {
+        if (y < pattern_rows_count) {
+            generator_fill_row(&generator, y, &original[y * stride]);
+        } else {
+            memcpy(&original[y * stride], &original[(y % pattern_rows_count) * stride], stride);
+        }
+    }
+    memcpy(buffer, original, maximum_size);
+
+    filters_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    filters_accumulate_histogram(original, 0, maximum_size, &histogram);
+    filters_lut_init_equalize(&context.lut, &histogram);
+    filters_lut_prepare(&context.lut);
+
+    double cycles_per_nanosecond =
+        ips_kernels_calibrate();
+    uint64_t time_cycles =
+        (uint64_t) ((double) time_milliseconds * 1e6 * cycles_per_nanosecond);
+
+    fprintf(
+        stderr,
+        "Kernels (%s%s), %.3f GHz counter\n",
+        IPS_KERNELS_BACKEND,
+        IPS_KERNELS_OPTIMIZED ? ", optimized" : "",
+        cycles_per_nanosecond
+    );
+
+    for (size_t level = 0; level < IPS_KERNELS_LEVELS; ++level) {
+        levels[level].copy_bytes_per_cycle =
+            ips_kernels_measure_copy(buffer, levels[level].size, time_cycles);
+
+        fprintf(
+            stderr,
+            "%-20s %-5s %10zu KiB %8.3f bytes/cycle %8.2f GB/s\n",
+            "memcpy",
+            levels[level].name,
+            levels[level].size >> 10,
+            levels[level].copy_bytes_per_cycle,
+            levels[level].copy_bytes_per_cycle * cycles_per_nanosecond
+        );
+    }
+
+    fprintf(
+        stderr,
+        "%-20s %-5s %14s %12s %12s %10s %9s %s\n",
+        "kernel", "level", "size", "cycles/px", "floor c/px", "GB/s", "of copy", "bound"
+    );
+
+    for (size_t kernel = 0; kernel < UTILS_COUNT_OF(IPS_Kernels_Kernels); ++kernel) {
+        if (!selected[kernel]) {
+            continue;
+        }
+
+        const ips_kernels_kernel_t *current_kernel =
+            &IPS_Kernels_Kernels[kernel];
+
+        for (size_t level = 0; level < IPS_KERNELS_LEVELS; ++level) {
+            size_t size =
+                levels[level].size;
+
+            context.source =
+                buffer;
+            context.destination =
+                current_kernel->in_place ? NULL : &buffer[size / 2];
+            context.width =
+                IPS_KERNELS_ROW_WIDTH;
+            context.height =
+                (current_kernel->in_place ? size : size / 2) / stride;
+
+            size_t pixels;
+            uint64_t cycles =
+                ips_kernels_measure(current_kernel, &context, original, time_cycles, &pixels);
+
+            /*
+                The floor is the time of moving the pixels at the bandwidth
+                of `memcpy`, a kernel near it has nothing left to gain from
+                fewer instructions.
+            */
+            double cycles_per_pixel =
+                (double) cycles / (double) pixels;
+            double floor_cycles_per_pixel =
+                (double) current_kernel->bytes_per_pixel / levels[level].copy_bytes_per_cycle;
+            double copy_share =
+                floor_cycles_per_pixel / cycles_per_pixel;
+            double gigabytes_per_second =
+                (double) current_kernel->bytes_per_pixel / cycles_per_pixel * cycles_per_nanosecond;
+
+            fprintf(
+                stderr,
+                "%-20s %-5s %10zu KiB %12.3f %12.3f %10.2f %8.1f%% %s\n",
+                current_kernel->name,
+                levels[level].name,
+                size >> 10,
+                cycles_per_pixel,
+                floor_cycles_per_pixel,
+                gigabytes_per_second,
+                100.0 * copy_share,
+                0.7 <= copy_share ? "memory" : "compute"
+            );
+
+            printf(
+                "{\"kernel\":\"%s\",\"backend\":\"%s\",\"optimized\":%s"
+                ",\"level\":\"%s\",\"bytes\":%zu,\"pixels\":%zu"
+                ",\"cycles_per_pixel\":%.4f,\"floor_cycles_per_pixel\":%.4f"
+                ",\"gigabytes_per_second\":%.3f,\"copy_gigabytes_per_second\":%.3f"
+                ",\"counter_gigahertz\":%.4f}\n",
+                current_kernel->name,
+                IPS_KERNELS_BACKEND,
+                IPS_KERNELS_OPTIMIZED ? "true" : "false",
+                levels[level].name,
+                size,
+                pixels,
+                cycles_per_pixel,
+                floor_cycles_per_pixel,
+                gigabytes_per_second,
+                levels[level].copy_bytes_per_cycle * cycles_per_nanosecond,
+                cycles_per_nanosecond
+            );
+        }
+    }
+
+    result =
+        EXIT_SUCCESS;
+
+cleanup:
+    free(context.padded_row);
+    free(original);
+    free(buffer);
+
+    return result;
+}
@@ -0,0 +1,101 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifndef METRICS
+#define METRICS_START()
+#define METRICS_STOP()
+#define METRICS_THREAD_START()
+#define METRICS_THREAD_STOP()
+#define METRICS_TASK_ENQUEUE()
+#define METRICS_TASK_BEGIN()
+#define METRICS_TASK_END()
+#define METRICS_IMAGE_BEGIN()
+#define METRICS_IMAGE_END(METRICS_FILTER_ID, METRICS_FILTER_NAME, METRICS_BYTES_IN, METRICS_BYTES_OUT)
+#else
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+    Live metrics of a long running process in the text format of
+    Prometheus. Nothing is counted unless the `IPS_METRICS` environment
+    variable names the file to write them to, every `IPS_METRICS_INTERVAL`
+    milliseconds and once more on `METRICS_STOP`. The file is written
+    under a temporary name and renamed over the last one, so a scraper
+    never reads half of it.
+
+    Every thread counts into a slot of its own, a cache line apart from
+    the others, with relaxed atomic additions and no lock. The thread that
+    writes the file sums the slots on its own time. Past
+    `METRICS_MAX_THREADS` threads the slots are shared, the counts stay
+    right but the workers that share a slot are reported as one.
+*/
+#define METRICS_MAX_THREADS 64
+
+/* The filters are counted by their identifier, the ones past the limit are not */
+#define METRICS_MAX_FILTERS 16
+
+/* The upper bounds of the latency histograms in nanoseconds, one more bucket counts the rest */
+#define METRICS_LATENCY_BUCKETS 14
+
+#define METRICS_DEFAULT_INTERVAL 1000
+
+typedef struct _metrics_slot
+{
+    uint64_t images[METRICS_MAX_FILTERS];
+    uint64_t latency_buckets[METRICS_MAX_FILTERS][METRICS_LATENCY_BUCKETS + 1];
+    uint64_t latency_sum[METRICS_MAX_FILTERS];  /* nanoseconds                            */
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t tasks_enqueued;
+    uint64_t tasks_started;
+    uint64_t tasks_completed;
+    uint64_t busy_time;             /* nanoseconds the tasks of the thread ran         */
+    uint64_t task_start_time;       /* of the running task, 0 between the tasks        */
+    bool is_worker;                 /* a worker of a pool, reported with its usage     */
+} __attribute__((aligned(64))) metrics_slot_t;
+
+static inline uint64_t metrics_get_nanoseconds(void);
+
+/* Starts the thread that writes the file if `IPS_METRICS` is set, the counters stay off otherwise */
+static inline void metrics_start(void);
+
+/* Writes the file a last time and stops the thread */
+static inline void metrics_stop(void);
+
+static inline void metrics_thread_start(void);
+
+static inline void metrics_thread_stop(void);
+
+static inline void metrics_task_enqueue(void);
+
+static inline void metrics_task_begin(void);
+
+static inline void metrics_task_end(void);
+
+static inline void metrics_image_begin(void);
+
+static inline void metrics_image_end(
+                       int filter_id,
+                       const char *filter_name,
+                       uint64_t bytes_in,
+                       uint64_t bytes_out
+                   );
+
+#define METRICS_START() metrics_start()
+#define METRICS_STOP() metrics_stop()
+#define METRICS_THREAD_START() metrics_thread_start()
+#define METRICS_THREAD_STOP() metrics_thread_stop()
+#define METRICS_TASK_ENQUEUE() metrics_task_enqueue()
+#define METRICS_TASK_BEGIN() metrics_task_begin()
+#define METRICS_TASK_END() metrics_task_end()
+#define METRICS_IMAGE_BEGIN() metrics_image_begin()
+#define METRICS_IMAGE_END(METRICS_FILTER_ID, METRICS_FILTER_NAME, METRICS_BYTES_IN, METRICS_BYTES_OUT) \
+            metrics_image_end(METRICS_FILTER_ID, METRICS_FILTER_NAME, METRICS_BYTES_IN, METRICS_BYTES_OUT)
+
+#include "metrics.impl.h.c"
+
+#endif
+
+#endif /* METRICS_H */
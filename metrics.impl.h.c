@@ -0,0 +1,536 @@
+#include "metrics.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+static const char Metrics_File_Variable_Name[] =
+                    "IPS_METRICS",
+                  Metrics_Interval_Variable_Name[] =
+                    "IPS_METRICS_INTERVAL",
+                  Metrics_Temporary_File_Extension[] =
+                    ".tmp";
+
+static const uint64_t Metrics_Latency_Bounds[METRICS_LATENCY_BUCKETS] = {
+    500000, 1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 500000000, 1000000000, 2500000000, 5000000000, 10000000000
+};
+
+static const char *Metrics_Latency_Bound_Names[METRICS_LATENCY_BUCKETS] = {
+    "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05",
+    "0.1", "0.25", "0.5", "1", "2.5", "5", "10"
+};
+
+static metrics_slot_t metrics_slots[METRICS_MAX_THREADS];
+static size_t metrics_threads_count =
+    0;
+static __thread metrics_slot_t *metrics_current_slot =
+    NULL;
+
+static __thread uint64_t metrics_image_start_time =
+    0;
+
+/* The name of the first image of every filter, the label of its counters */
+static const char *metrics_filter_names[METRICS_MAX_FILTERS];
+
+static bool metrics_enabled =
+    false;
+
+static struct
+{
+    char *file_name;
+    char *temporary_file_name;
+    uint64_t interval;              /* nanoseconds                                     */
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t stop_condition;
+    bool stopping;
+    bool failed;                    /* the file could not be written once already      */
+
+    uint64_t last_time;
+    uint64_t last_busy_time[METRICS_MAX_THREADS];
+} metrics_writer = {
+    .mutex          = PTHREAD_MUTEX_INITIALIZER,
+    .stop_condition = PTHREAD_COND_INITIALIZER
+};
+
+static inline uint64_t metrics_get_nanoseconds(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+}
+
+static inline bool _metrics_is_enabled(void)
+{
+    return __atomic_load_n(&metrics_enabled, __ATOMIC_RELAXED);
+}
+
+static inline metrics_slot_t *_metrics_get_slot(void)
+{
+    if (NULL == metrics_current_slot) {
+        metrics_current_slot =
+            &metrics_slots[
+                __atomic_fetch_add(&metrics_threads_count, 1, __ATOMIC_RELAXED) % METRICS_MAX_THREADS
+            ];
+    }
+
+    return metrics_current_slot;
+}
+
+/* Relaxed, a slot has a single writer unless there are more threads than slots */
+static inline void _metrics_count(uint64_t *counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t _metrics_read(const uint64_t *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/* Called by every worker of the pool when it starts, so that the idle ones are reported too */
+static inline void metrics_thread_start(void)
+{
+    if (!_metrics_is_enabled()) {
+        return;
+    }
+
+    __atomic_store_n(&_metrics_get_slot()->is_worker, true, __ATOMIC_RELAXED);
+}
+
+/* Called by a worker of the pool when it exits, its counts stay in the totals */
+static inline void metrics_thread_stop(void)
+{
+    if (!_metrics_is_enabled()) {
+        return;
+    }
+
+    __atomic_store_n(&_metrics_get_slot()->is_worker, false, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_task_enqueue(void)
+{
+    if (!_metrics_is_enabled()) {
+        return;
+    }
+
+    _metrics_count(&_metrics_get_slot()->tasks_enqueued, 1);
+}
+
+/* Called by the workers of the pool around every task */
+static inline void metrics_task_begin(void)
+{
+    if (!_metrics_is_enabled()) {
+        return;
+    }
+
+    metrics_slot_t *slot =
+        _metrics_get_slot();
+    if (!__atomic_load_n(&slot->is_worker, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&slot->is_worker, true, __ATOMIC_RELAXED);
+    }
+
+    _metrics_count(&slot->tasks_started, 1);
+    __atomic_store_n(&slot->task_start_time, metrics_get_nanoseconds(), __ATOMIC_RELAXED);
+}
+
+static inline void metrics_task_end(void)
+{
+    if (!_metrics_is_enabled()) {
+        return;
+    }
+
+    metrics_slot_t *slot =
+        _metrics_get_slot();
+    uint64_t start_time =
+        __atomic_exchange_n(&slot->task_start_time, 0, __ATOMIC_RELAXED);
+    if (0 == start_time) {
+        return;
+    }
+
+    _metrics_count(&slot->busy_time, metrics_get_nanoseconds() - start_time);
+    _metrics_count(&slot->tasks_completed, 1);
+}
+
+/* The time the tasks of a slot ran, the running one included */
+static inline uint64_t _metrics_get_busy_time(const metrics_slot_t *slot, uint64_t time)
+{
+    uint64_t start_time =
+        __atomic_load_n(&slot->task_start_time, __ATOMIC_RELAXED);
+
+    return _metrics_read(&slot->busy_time) + (0 < start_time ? time - UTILS_MIN(start_time, time) : 0);
+}
+
+static inline void metrics_image_begin(void)
+{
+    if (!_metrics_is_enabled()) {
+        return;
+    }
+
+    metrics_image_start_time =
+        metrics_get_nanoseconds();
+}
+
+static inline void metrics_image_end(
+                       int filter_id,
+                       const char *filter_name,
+                       uint64_t bytes_in,
+                       uint64_t bytes_out
+                   )
+{
+    if (!_metrics_is_enabled() || 0 == metrics_image_start_time ||
+        0 > filter_id || METRICS_MAX_FILTERS <= filter_id) {
+        return;
+    }
+
+    uint64_t latency =
+        metrics_get_nanoseconds() - metrics_image_start_time;
+    metrics_image_start_time =
+        0;
+
+    if (NULL == __atomic_load_n(&metrics_filter_names[filter_id], __ATOMIC_ACQUIRE)) {
+        const char *no_name =
+            NULL;
+        __atomic_compare_exchange_n(
+            &metrics_filter_names[filter_id],
+            &no_name,
+            filter_name,
+            false,
+            __ATOMIC_RELEASE,
+            __ATOMIC_RELAXED
+        );
+    }
+
+    size_t bucket =
+        0;
+    while (METRICS_LATENCY_BUCKETS > bucket && Metrics_Latency_Bounds[bucket] < latency) {
+        ++bucket;
+    }
+
+    metrics_slot_t *slot =
+        _metrics_get_slot();
+    _metrics_count(&slot->latency_buckets[filter_id][bucket], 1);
+    _metrics_count(&slot->latency_sum[filter_id], latency);
+    _metrics_count(&slot->bytes_in, bytes_in);
+    _metrics_count(&slot->bytes_out, bytes_out);
+
+    /* The count last, a snapshot never holds more images than latencies */
+    __atomic_fetch_add(&slot->images[filter_id], 1, __ATOMIC_RELEASE);
+}
+
+static inline void _metrics_print_header(FILE *file, const char *name, const char *type, const char *help)
+{
+    fprintf(file, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* Sums the slots into the file, the threads keep counting meanwhile */
+static inline bool _metrics_write(FILE *file, uint64_t time)
+{
+    size_t slots_count =
+        UTILS_MIN(__atomic_load_n(&metrics_threads_count, __ATOMIC_RELAXED), METRICS_MAX_THREADS);
+
+    _metrics_print_header(file, "ips_images_processed_total", "counter", "Images processed by each filter.");
+    for (size_t filter = 0; filter < METRICS_MAX_FILTERS; ++filter) {
+        const char *filter_name =
+            __atomic_load_n(&metrics_filter_names[filter], __ATOMIC_ACQUIRE);
+        if (NULL == filter_name) {
+            continue;
+        }
+
+        uint64_t images =
+            0;
+        for (size_t slot = 0; slot < slots_count; ++slot) {
+            images +=
+                __atomic_load_n(&metrics_slots[slot].images[filter], __ATOMIC_ACQUIRE);
+        }
+        fprintf(file, "ips_images_processed_total{filter=\"%s\"} %llu\n", filter_name, (unsigned long long) images);
+    }
+
+    _metrics_print_header(
+        file, "ips_filter_latency_seconds", "histogram", "Time to process an image with each filter."
+    );
+    for (size_t filter = 0; filter < METRICS_MAX_FILTERS; ++filter) {
+        const char *filter_name =
+            __atomic_load_n(&metrics_filter_names[filter], __ATOMIC_ACQUIRE);
+        if (NULL == filter_name) {
+            continue;
+        }
+
+        uint64_t buckets[METRICS_LATENCY_BUCKETS + 1] = { 0 };
+        uint64_t latency_sum =
+            0;
+        for (size_t slot = 0; slot < slots_count; ++slot) {
+            for (size_t bucket = 0; bucket <= METRICS_LATENCY_BUCKETS; ++bucket) {
+                buckets[bucket] +=
+                    _metrics_read(&metrics_slots[slot].latency_buckets[filter][bucket]);
+            }
+            latency_sum +=
+                _metrics_read(&metrics_slots[slot].latency_sum[filter]);
+        }
+
+        uint64_t cumulative_count =
+            0;
+        for (size_t bucket = 0; bucket <= METRICS_LATENCY_BUCKETS; ++bucket) {
+            cumulative_count +=
+                buckets[bucket];
+            fprintf(
+                file,
+                "ips_filter_latency_seconds_bucket{filter=\"%s\",le=\"%s\"} %llu\n",
+                filter_name,
+                METRICS_LATENCY_BUCKETS > bucket ? Metrics_Latency_Bound_Names[bucket] : "+Inf",
+                (unsigned long long) cumulative_count
+            );
+        }
+        fprintf(
+            file,
+            "ips_filter_latency_seconds_sum{filter=\"%s\"} %.9f\n"
+            "ips_filter_latency_seconds_count{filter=\"%s\"} %llu\n",
+            filter_name,
+            (double) latency_sum / 1e9,
+            filter_name,
+            (unsigned long long) cumulative_count
+        );
+    }
+
+    uint64_t bytes_in =
+        0;
+    uint64_t bytes_out =
+        0;
+    uint64_t tasks_enqueued =
+        0;
+    uint64_t tasks_started =
+        0;
+    uint64_t tasks_completed =
+        0;
+    for (size_t slot = 0; slot < slots_count; ++slot) {
+        bytes_in +=
+            _metrics_read(&metrics_slots[slot].bytes_in);
+        bytes_out +=
+            _metrics_read(&metrics_slots[slot].bytes_out);
+        tasks_enqueued +=
+            _metrics_read(&metrics_slots[slot].tasks_enqueued);
+        tasks_started +=
+            _metrics_read(&metrics_slots[slot].tasks_started);
+        tasks_completed +=
+            _metrics_read(&metrics_slots[slot].tasks_completed);
+    }
+
+    _metrics_print_header(file, "ips_bytes_in_total", "counter", "Bytes of pixels read by the filters.");
+    fprintf(file, "ips_bytes_in_total %llu\n", (unsigned long long) bytes_in);
+    _metrics_print_header(file, "ips_bytes_out_total", "counter", "Bytes of pixels written by the filters.");
+    fprintf(file, "ips_bytes_out_total %llu\n", (unsigned long long) bytes_out);
+
+    _metrics_print_header(file, "ips_tasks_total", "counter", "Tasks run by the workers of the pools.");
+    fprintf(file, "ips_tasks_total %llu\n", (unsigned long long) tasks_completed);
+
+    /* The slots are read one after the other, a task may be seen started and not yet enqueued */
+    _metrics_print_header(file, "ips_queue_depth", "gauge", "Tasks waiting in the queues of the pools.");
+    fprintf(
+        file,
+        "ips_queue_depth %llu\n",
+        (unsigned long long) (tasks_enqueued - UTILS_MIN(tasks_started, tasks_enqueued))
+    );
+
+    size_t workers_count =
+        0;
+    for (size_t slot = 0; slot < slots_count; ++slot) {
+        if (__atomic_load_n(&metrics_slots[slot].is_worker, __ATOMIC_RELAXED)) {
+            ++workers_count;
+        }
+    }
+    _metrics_print_header(file, "ips_workers", "gauge", "Workers of the pools.");
+    fprintf(file, "ips_workers %zu\n", workers_count);
+
+    uint64_t interval =
+        time - UTILS_MIN(metrics_writer.last_time, time);
+    _metrics_print_header(
+        file, "ips_worker_busy_seconds_total", "counter", "Time each worker spent running tasks."
+    );
+    for (size_t slot = 0; slot < slots_count; ++slot) {
+        if (__atomic_load_n(&metrics_slots[slot].is_worker, __ATOMIC_RELAXED)) {
+            fprintf(
+                file,
+                "ips_worker_busy_seconds_total{worker=\"%zu\"} %.9f\n",
+                slot,
+                (double) _metrics_get_busy_time(&metrics_slots[slot], time) / 1e9
+            );
+        }
+    }
+
+    /* A task that ends between the reads of its slot may count a little twice, hence the clamp */
+    _metrics_print_header(
+        file, "ips_worker_utilization", "gauge", "Share of the last interval each worker spent running tasks."
+    );
+    for (size_t slot = 0; slot < slots_count; ++slot) {
+        uint64_t busy_time =
+            _metrics_get_busy_time(&metrics_slots[slot], time);
+        if (__atomic_load_n(&metrics_slots[slot].is_worker, __ATOMIC_RELAXED)) {
+            uint64_t interval_busy_time =
+                busy_time - UTILS_MIN(metrics_writer.last_busy_time[slot], busy_time);
+            fprintf(
+                file,
+                "ips_worker_utilization{worker=\"%zu\"} %.4f\n",
+                slot,
+                0 < interval ? UTILS_MIN((double) interval_busy_time / (double) interval, 1.0) : 0.0
+            );
+        }
+
+        metrics_writer.last_busy_time[slot] =
+            busy_time;
+    }
+    metrics_writer.last_time =
+        time;
+
+    return !ferror(file);
+}
+
+/* Replaces the file with a new one, reports the first failure only */
+static inline void _metrics_write_file(void)
+{
+    uint64_t time =
+        metrics_get_nanoseconds();
+
+    bool is_written =
+        false;
+    FILE *file =
+        fopen(metrics_writer.temporary_file_name, "w");
+    if (NULL != file) {
+        is_written =
+            _metrics_write(file, time);
+        is_written =
+            0 == fclose(file) && is_written &&
+            0 == rename(metrics_writer.temporary_file_name, metrics_writer.file_name);
+    }
+
+    if (!is_written && !metrics_writer.failed) {
+        fprintf(stderr, "Metrics: failed to write '%s'\n", metrics_writer.file_name);
+        metrics_writer.failed =
+            true;
+    }
+}
+
+static void *_metrics_writer_start(void *args)
+{
+    (void) args;
+
+    pthread_mutex_lock(&metrics_writer.mutex);
+    while (!metrics_writer.stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        uint64_t nanoseconds =
+            (uint64_t) deadline.tv_nsec + metrics_writer.interval;
+        deadline.tv_sec +=
+            (time_t) (nanoseconds / 1000000000);
+        deadline.tv_nsec =
+            (long) (nanoseconds % 1000000000);
+
+        int result =
+            0;
+        while (!metrics_writer.stopping && ETIMEDOUT != result) {
+            result =
+                pthread_cond_timedwait(&metrics_writer.stop_condition, &metrics_writer.mutex, &deadline);
+        }
+
+        if (!metrics_writer.stopping) {
+            _metrics_write_file();
+        }
+    }
+    pthread_mutex_unlock(&metrics_writer.mutex);
+
+    return NULL;
+}
+
+static inline void metrics_start(void)
+{
+    const char *file_name =
+        getenv(Metrics_File_Variable_Name);
+    if (NULL == file_name || '\0' == *file_name || _metrics_is_enabled()) {
+        return;
+    }
+
+    unsigned long interval =
+        METRICS_DEFAULT_INTERVAL;
+    const char *interval_text =
+        getenv(Metrics_Interval_Variable_Name);
+    if (NULL != interval_text) {
+        char *end;
+        unsigned long value =
+            strtoul(interval_text, &end, 10);
+        if (end != interval_text && '\0' == *end && 0 < value) {
+            interval =
+                value;
+        }
+    }
+
+    size_t file_name_length =
+        strlen(file_name);
+    metrics_writer.file_name =
+        strdup(file_name);
+    metrics_writer.temporary_file_name =
+        malloc(file_name_length + UTILS_COUNT_OF(Metrics_Temporary_File_Extension));
+    if (NULL == metrics_writer.file_name || NULL == metrics_writer.temporary_file_name) {
+        goto error;
+    }
+    memcpy(metrics_writer.temporary_file_name, file_name, file_name_length);
+    memcpy(
+        &metrics_writer.temporary_file_name[file_name_length],
+        Metrics_Temporary_File_Extension,
+        UTILS_COUNT_OF(Metrics_Temporary_File_Extension)
+    );
+
+    metrics_writer.interval =
+        (uint64_t) interval * 1000000;
+    metrics_writer.last_time =
+        metrics_get_nanoseconds();
+
+    __atomic_store_n(&metrics_enabled, true, __ATOMIC_RELAXED);
+    if (0 != pthread_create(&metrics_writer.thread, NULL, _metrics_writer_start, NULL)) {
+        __atomic_store_n(&metrics_enabled, false, __ATOMIC_RELAXED);
+
+        goto error;
+    }
+
+    return;
+
+error:
+    fprintf(stderr, "Metrics: failed to start writing '%s'\n", file_name);
+
+    free(metrics_writer.temporary_file_name);
+    metrics_writer.temporary_file_name =
+        NULL;
+    free(metrics_writer.file_name);
+    metrics_writer.file_name =
+        NULL;
+}
+
+static inline void metrics_stop(void)
+{
+    if (!_metrics_is_enabled()) {
+        return;
+    }
+
+    pthread_mutex_lock(&metrics_writer.mutex);
+    metrics_writer.stopping =
+        true;
+    pthread_cond_signal(&metrics_writer.stop_condition);
+    pthread_mutex_unlock(&metrics_writer.mutex);
+
+    pthread_join(metrics_writer.thread, NULL);
+
+    _metrics_write_file();
+    __atomic_store_n(&metrics_enabled, false, __ATOMIC_RELAXED);
+
+    free(metrics_writer.temporary_file_name);
+    metrics_writer.temporary_file_name =
+        NULL;
+    free(metrics_writer.file_name);
+    metrics_writer.file_name =
+        NULL;
+}
@@ -4,10 +4,121 @@
 #ifndef PROFILE
 #define PROFILER_START(PROFILER_PASSES)
 #define PROFILER_STOP()
+#define PROFILER_SCOPE_BEGIN(PROFILER_SCOPE_NAME)
+#define PROFILER_SCOPE_END()
+#define PROFILER_SCOPE_ADD_BYTES(PROFILER_BYTES)
+#define PROFILER_THREAD_START()
+#define PROFILER_TASK_ENQUEUE(PROFILER_ENQUEUE_TIME)
+#define PROFILER_TASK_BEGIN(PROFILER_ENQUEUE_TIME)
+#define PROFILER_TASK_END()
+#define PROFILER_TASKS_ADD_BYTES(PROFILER_BYTES)
+#define PROFILER_REPORT()
 #else
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <time.h>
 
+/*
+    Named scopes nest into a tree, a scope entered under different parents
+    is counted apart under each of them. The scopes time the thread that
+    runs the job, not the tasks of the pool, and are printed as a table
+    with `PROFILER_REPORT`. Scopes past the limits below are skipped.
+*/
+#define PROFILER_MAX_SCOPES      64
+#define PROFILER_MAX_SCOPE_DEPTH 16
+
+/* The workers of the pool past this many are not profiled */
+#define PROFILER_MAX_THREADS 256
+
+/*
+    With `PROFILER_TIMELINE` every worker also records when each of its
+    tasks was enqueued, started and ended, up to the limit below. The
+    report then dumps them as a Chrome trace to the file named by the
+    `PROFILER_TRACE` environment variable, if it is set.
+*/
+#define PROFILER_MAX_THREAD_TASKS 4096
+
+/*
+    With `PROFILER_COUNTERS` on Linux every scope and every task of the pool
+    also reads a group of hardware counters through `perf_event_open`. The
+    vector instruction counts are the FP_ARITH_INST_RETIRED events of Intel
+    processors, other counters missing from the processor or the kernel
+    are left out. When the group cannot be opened at all, in a virtual
+    machine without a PMU or with a `perf_event_paranoid` that forbids it,
+    the times are reported alone.
+*/
+#if defined PROFILER_COUNTERS && defined __linux__
+#define PROFILER_HAS_COUNTERS 1
+#endif
+
+#define PROFILER_COUNTER_CYCLES           0
+#define PROFILER_COUNTER_INSTRUCTIONS     1
+#define PROFILER_COUNTER_CACHE_REFERENCES 2
+#define PROFILER_COUNTER_CACHE_MISSES     3
+#define PROFILER_COUNTER_FP_256           4
+#define PROFILER_COUNTER_FP_512           5
+#define PROFILER_COUNTERS_COUNT           6
+
+/*
+    Other modules print their own statistics with the report through the
+    functions they add, in the order they were added. Functions past the
+    limit below are not called.
+*/
+#define PROFILER_MAX_REPORTS 16
+
+typedef void (*profiler_report_function_t)(void *data);
+
+typedef struct _profiler_counter_group
+{
+    int state;                      /* 0 before opening, 1 if open, -1 if it failed   */
+    int leader;
+    int descriptors[PROFILER_COUNTERS_COUNT];
+    size_t positions[PROFILER_COUNTERS_COUNT]; /* in the group read, or PROFILER_COUNTERS_COUNT */
+    size_t members;
+} profiler_counter_group_t;
+
+typedef struct _profiler_scope
+{
+    const char *name;
+    size_t parent;                  /* PROFILER_MAX_SCOPES for the scopes at the top   */
+    size_t depth;
+    uint64_t calls;
+    uint64_t total_time;            /* nanoseconds                                     */
+    uint64_t maximum_time;
+    uint64_t bytes;
+    uint64_t counted_calls;         /* the calls the counters were read for            */
+    uint64_t counters[PROFILER_COUNTERS_COUNT];
+} profiler_scope_t;
+
+typedef struct _profiler_task
+{
+    uint64_t enqueue_time;          /* nanoseconds of the monotonic clock              */
+    uint64_t start_time;
+    uint64_t end_time;
+} profiler_task_t;
+
+/* The tasks a worker of the pool ran, the worker alone writes its slot */
+typedef struct _profiler_thread
+{
+    uint64_t tasks;
+    uint64_t busy_time;             /* nanoseconds                                     */
+    uint64_t queue_time;            /* from the enqueue to the start of the tasks      */
+    uint64_t maximum_queue_time;
+    uint64_t counted_tasks;
+    uint64_t counters[PROFILER_COUNTERS_COUNT];
+
+    profiler_task_t *timeline;      /* PROFILER_MAX_THREAD_TASKS tasks at most         */
+    size_t timeline_length;
+
+    uint64_t enqueue_time;
+    uint64_t start_time;
+    bool counting;
+    uint64_t start_counters[PROFILER_COUNTERS_COUNT];
+    profiler_counter_group_t counter_group;
+} profiler_thread_t;
+
 static inline void profiler_init_time(struct timespec *time);
 
 static inline void profiler_get_time(struct timespec *result);
@@ -30,6 +141,43 @@ static inline void profiler_divide_time(
                        struct timespec *result
                    );
 
+static inline uint64_t profiler_get_nanoseconds(void);
+
+static inline bool profiler_read_counters(
+                       profiler_counter_group_t *group,
+                       uint64_t *values
+                   );
+
+static inline void profiler_scope_begin(const char *name);
+
+static inline void profiler_scope_end(void);
+
+static inline void profiler_scope_add_bytes(uint64_t bytes);
+
+static inline void profiler_thread_start(void);
+
+static inline void profiler_task_begin(uint64_t enqueue_time);
+
+static inline void profiler_task_end(void);
+
+static inline void profiler_tasks_add_bytes(uint64_t bytes);
+
+static inline void profiler_add_report(profiler_report_function_t function, void *data);
+
+static inline void profiler_remove_report(profiler_report_function_t function, void *data);
+
+static inline void profiler_report(void);
+
+#define PROFILER_SCOPE_BEGIN(PROFILER_SCOPE_NAME) profiler_scope_begin(PROFILER_SCOPE_NAME)
+#define PROFILER_SCOPE_END() profiler_scope_end()
+#define PROFILER_SCOPE_ADD_BYTES(PROFILER_BYTES) profiler_scope_add_bytes(PROFILER_BYTES)
+#define PROFILER_THREAD_START() profiler_thread_start()
+#define PROFILER_TASK_ENQUEUE(PROFILER_ENQUEUE_TIME) ((PROFILER_ENQUEUE_TIME) = profiler_get_nanoseconds())
+#define PROFILER_TASK_BEGIN(PROFILER_ENQUEUE_TIME) profiler_task_begin(PROFILER_ENQUEUE_TIME)
+#define PROFILER_TASK_END() profiler_task_end()
+#define PROFILER_TASKS_ADD_BYTES(PROFILER_BYTES) profiler_tasks_add_bytes(PROFILER_BYTES)
+#define PROFILER_REPORT() profiler_report()
+
 #include "profiler.impl.h.c"
 
 #endif
@@ -1,7 +1,21 @@
 #include "profiler.h"
+#include "utils.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <math.h>
+#include <sched.h>
+#include <pthread.h>
+#if defined PROFILER_HAS_COUNTERS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined __x86_64__ || defined __i386__
+#include <cpuid.h>
+#endif
+#endif
 #ifdef __MACH__
 #include <mach/clock.h>
 #include <mach/mach.h>
@@ -85,6 +99,832 @@ static inline void profiler_divide_time(
     result->tv_nsec = (long) nanoseconds;
 }
 
+static profiler_scope_t profiler_scopes[PROFILER_MAX_SCOPES];
+static size_t profiler_scopes_count =
+    0;
+
+/* The open scopes, PROFILER_MAX_SCOPES for the ones that did not fit the table */
+static struct
+{
+    size_t scope;
+    uint64_t start_time;
+    bool counting;
+    uint64_t start_counters[PROFILER_COUNTERS_COUNT];
+} profiler_scope_stack[PROFILER_MAX_SCOPE_DEPTH];
+static size_t profiler_scope_depth =
+    0;
+static size_t profiler_skipped_scope_depth =
+    0;
+static profiler_counter_group_t profiler_scope_counter_group;
+
+/*
+    Every worker claims a slot of its own on its first task, the slots are
+    read once no task is running anymore.
+*/
+static profiler_thread_t profiler_threads[PROFILER_MAX_THREADS];
+static size_t profiler_threads_count =
+    0;
+static __thread profiler_thread_t *profiler_current_thread =
+    NULL;
+static size_t profiler_tasks_running =
+    0;
+static uint64_t profiler_tasks_bytes =
+    0;
+
+static struct
+{
+    profiler_report_function_t function;
+    void *data;
+} profiler_reports[PROFILER_MAX_REPORTS];
+static size_t profiler_reports_count =
+    0;
+static pthread_mutex_t profiler_reports_mutex =
+    PTHREAD_MUTEX_INITIALIZER;
+
+/* The error of the first counter group that failed to open */
+static int profiler_counters_error =
+    0;
+
+/* The monotonic clock is read in the vDSO without a system call on Linux */
+static inline uint64_t profiler_get_nanoseconds(void)
+{
+    struct timespec time;
+#ifdef __MACH__
+    profiler_get_time(&time);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &time);
+#endif
+
+    return (uint64_t) time.tv_sec * (uint64_t) Profiler_Nanoseconds_in_Seconds + (uint64_t) time.tv_nsec;
+}
+
+#if defined PROFILER_HAS_COUNTERS
+static inline bool _profiler_is_intel_processor(void)
+{
+#if defined __x86_64__ || defined __i386__
+    unsigned int highest_leaf, vendor[3];
+    if (!__get_cpuid(0, &highest_leaf, &vendor[0], &vendor[2], &vendor[1])) {
+        return false;
+    }
+
+    return 0 == memcmp(vendor, "GenuineIntel", sizeof(vendor));
+#else
+    return false;
+#endif
+}
+
+/* Opens the counters of the calling thread, the cycles lead the group, the others are optional */
+static inline void _profiler_open_counters(profiler_counter_group_t *group)
+{
+    static const struct
+    {
+        uint32_t type;
+        uint64_t config;
+        bool intel_only;
+    } Events[PROFILER_COUNTERS_COUNT] = {
+        [PROFILER_COUNTER_CYCLES]           = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       false },
+        [PROFILER_COUNTER_INSTRUCTIONS]     = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     false },
+        [PROFILER_COUNTER_CACHE_REFERENCES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES, false },
+        [PROFILER_COUNTER_CACHE_MISSES]     = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     false },
+        /* FP_ARITH_INST_RETIRED, the packed single and double precision umasks of a width together */
+        [PROFILER_COUNTER_FP_256]           = { PERF_TYPE_RAW,      0x30C7,                         true  },
+        [PROFILER_COUNTER_FP_512]           = { PERF_TYPE_RAW,      0xC0C7,                         true  }
+    };
+
+    bool is_intel_processor =
+        _profiler_is_intel_processor();
+
+    group->state =
+        -1;
+    group->leader =
+        -1;
+    group->members =
+        0;
+
+    for (size_t counter = 0; counter < PROFILER_COUNTERS_COUNT; ++counter) {
+        group->descriptors[counter] =
+            -1;
+        group->positions[counter] =
+            PROFILER_COUNTERS_COUNT;
+
+        if (Events[counter].intel_only && !is_intel_processor) {
+            continue;
+        }
+
+        struct perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size =
+            sizeof(attributes);
+        attributes.type =
+            Events[counter].type;
+        attributes.config =
+            Events[counter].config;
+        attributes.read_format =
+            PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attributes.exclude_kernel =
+            1;
+        attributes.exclude_hv =
+            1;
+
+        int descriptor =
+            (int) syscall(SYS_perf_event_open, &attributes, 0, -1, group->leader, 0);
+        if (0 > descriptor) {
+            if (PROFILER_COUNTER_CYCLES == counter) {
+                int no_error =
+                    0;
+                __atomic_compare_exchange_n(
+                    &profiler_counters_error, &no_error, errno, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+                );
+
+                return;
+            }
+
+            continue;
+        }
+
+        if (PROFILER_COUNTER_CYCLES == counter) {
+            group->leader =
+                descriptor;
+        }
+        group->descriptors[counter] =
+            descriptor;
+        group->positions[counter] =
+            group->members;
+        ++group->members;
+    }
+
+    group->state =
+        1;
+}
+#endif
+
+/*
+    Reads the counters of the group of the calling thread, opening it on
+    the first call. Counts are scaled up when the kernel had to multiplex
+    the group, counters that are not part of it read 0.
+*/
+static inline bool profiler_read_counters(
+                       profiler_counter_group_t *group,
+                       uint64_t *values
+                   )
+{
+#if defined PROFILER_HAS_COUNTERS
+    if (0 == group->state) {
+        _profiler_open_counters(group);
+    }
+    if (1 != group->state) {
+        return false;
+    }
+
+    /* The number of counters, the times the group was enabled and running, the counts */
+    uint64_t buffer[3 + PROFILER_COUNTERS_COUNT];
+    ssize_t size =
+        read(group->leader, buffer, sizeof(buffer));
+    if ((ssize_t) ((3 + group->members) * sizeof(*buffer)) > size || 0 == buffer[2]) {
+        return false;
+    }
+
+    double scale =
+        (double) buffer[1] / (double) buffer[2];
+    for (size_t counter = 0; counter < PROFILER_COUNTERS_COUNT; ++counter) {
+        values[counter] =
+            PROFILER_COUNTERS_COUNT == group->positions[counter] ?
+                0 :
+                (uint64_t) ((double) buffer[3 + group->positions[counter]] * scale);
+    }
+
+    return true;
+#else
+    (void) group;
+    (void) values;
+
+    return false;
+#endif
+}
+
+static inline void profiler_scope_begin(const char *name)
+{
+    if (PROFILER_MAX_SCOPE_DEPTH == profiler_scope_depth) {
+        ++profiler_skipped_scope_depth;
+
+        return;
+    }
+
+    size_t parent =
+        0 < profiler_scope_depth ?
+            profiler_scope_stack[profiler_scope_depth - 1].scope :
+            PROFILER_MAX_SCOPES;
+
+    size_t scope =
+        PROFILER_MAX_SCOPES;
+    if (0 == profiler_scope_depth || PROFILER_MAX_SCOPES != parent) {
+        for (scope = 0; scope < profiler_scopes_count; ++scope) {
+            if (parent == profiler_scopes[scope].parent &&
+                (name == profiler_scopes[scope].name || 0 == strcmp(name, profiler_scopes[scope].name))) {
+                break;
+            }
+        }
+
+        if (scope == profiler_scopes_count) {
+            if (PROFILER_MAX_SCOPES == profiler_scopes_count) {
+                scope =
+                    PROFILER_MAX_SCOPES;
+            } else {
+                profiler_scopes[scope].name =
+                    name;
+                profiler_scopes[scope].parent =
+                    parent;
+                profiler_scopes[scope].depth =
+                    profiler_scope_depth;
+                ++profiler_scopes_count;
+            }
+        }
+    }
+
+    profiler_scope_stack[profiler_scope_depth].scope =
+        scope;
+    ++profiler_scope_depth;
+
+    /* Read last, so that the search is not part of the scope */
+    profiler_scope_stack[profiler_scope_depth - 1].counting =
+        PROFILER_MAX_SCOPES != scope &&
+        profiler_read_counters(
+            &profiler_scope_counter_group,
+            profiler_scope_stack[profiler_scope_depth - 1].start_counters
+        );
+    profiler_scope_stack[profiler_scope_depth - 1].start_time =
+        profiler_get_nanoseconds();
+}
+
+static inline void profiler_scope_end(void)
+{
+    uint64_t end_time =
+        profiler_get_nanoseconds();
+
+    if (0 < profiler_skipped_scope_depth) {
+        --profiler_skipped_scope_depth;
+
+        return;
+    }
+
+    if (0 == profiler_scope_depth) {
+        return;
+    }
+
+    --profiler_scope_depth;
+    size_t scope =
+        profiler_scope_stack[profiler_scope_depth].scope;
+    if (PROFILER_MAX_SCOPES == scope) {
+        return;
+    }
+
+    uint64_t end_counters[PROFILER_COUNTERS_COUNT];
+    if (profiler_scope_stack[profiler_scope_depth].counting &&
+        profiler_read_counters(&profiler_scope_counter_group, end_counters)) {
+        profiler_scopes[scope].counted_calls +=
+            1;
+        for (size_t counter = 0; counter < PROFILER_COUNTERS_COUNT; ++counter) {
+            profiler_scopes[scope].counters[counter] +=
+                end_counters[counter] - profiler_scope_stack[profiler_scope_depth].start_counters[counter];
+        }
+    }
+
+    uint64_t delta_time =
+        end_time - profiler_scope_stack[profiler_scope_depth].start_time;
+
+    profiler_scopes[scope].calls +=
+        1;
+    profiler_scopes[scope].total_time +=
+        delta_time;
+    if (delta_time > profiler_scopes[scope].maximum_time) {
+        profiler_scopes[scope].maximum_time =
+            delta_time;
+    }
+}
+
+/* Counts the bytes the innermost open scope went through, for its bytes per cycle */
+static inline void profiler_scope_add_bytes(uint64_t bytes)
+{
+    if (0 < profiler_skipped_scope_depth || 0 == profiler_scope_depth) {
+        return;
+    }
+
+    size_t scope =
+        profiler_scope_stack[profiler_scope_depth - 1].scope;
+    if (PROFILER_MAX_SCOPES != scope) {
+        profiler_scopes[scope].bytes +=
+            bytes;
+    }
+}
+
+/* Called by every worker of the pool when it starts, so that the idle ones are reported too */
+static inline void profiler_thread_start(void)
+{
+    if (NULL != profiler_current_thread) {
+        return;
+    }
+
+    size_t index =
+        __atomic_fetch_add(&profiler_threads_count, 1, __ATOMIC_RELAXED);
+    if (PROFILER_MAX_THREADS <= index) {
+        return;
+    }
+
+    profiler_current_thread =
+        &profiler_threads[index];
+
+#if defined PROFILER_TIMELINE
+    profiler_current_thread->timeline =
+        malloc(PROFILER_MAX_THREAD_TASKS * sizeof(*profiler_current_thread->timeline));
+#endif
+}
+
+/* Called by the workers of the pool around every task */
+static inline void profiler_task_begin(uint64_t enqueue_time)
+{
+    __atomic_add_fetch(&profiler_tasks_running, 1, __ATOMIC_RELAXED);
+
+    if (NULL == profiler_current_thread) {
+        profiler_thread_start();
+    }
+
+    profiler_thread_t *thread =
+        profiler_current_thread;
+    if (NULL == thread) {
+        return;
+    }
+
+    thread->enqueue_time =
+        enqueue_time;
+    thread->counting =
+        profiler_read_counters(&thread->counter_group, thread->start_counters);
+    thread->start_time =
+        profiler_get_nanoseconds();
+}
+
+static inline void profiler_task_end(void)
+{
+    uint64_t end_time =
+        profiler_get_nanoseconds();
+
+    profiler_thread_t *thread =
+        profiler_current_thread;
+    if (NULL != thread) {
+        uint64_t end_counters[PROFILER_COUNTERS_COUNT];
+        if (thread->counting && profiler_read_counters(&thread->counter_group, end_counters)) {
+            thread->counted_tasks +=
+                1;
+            for (size_t counter = 0; counter < PROFILER_COUNTERS_COUNT; ++counter) {
+                thread->counters[counter] +=
+                    end_counters[counter] - thread->start_counters[counter];
+            }
+        }
+
+        uint64_t queue_time =
+            thread->start_time - UTILS_MIN(thread->enqueue_time, thread->start_time);
+
+        thread->tasks +=
+            1;
+        thread->busy_time +=
+            end_time - thread->start_time;
+        thread->queue_time +=
+            queue_time;
+        thread->maximum_queue_time =
+            UTILS_MAX(thread->maximum_queue_time, queue_time);
+
+        if (NULL != thread->timeline && PROFILER_MAX_THREAD_TASKS > thread->timeline_length) {
+            profiler_task_t *task =
+                &thread->timeline[thread->timeline_length];
+            task->enqueue_time =
+                thread->enqueue_time;
+            task->start_time =
+                thread->start_time;
+            task->end_time =
+                end_time;
+            ++thread->timeline_length;
+        }
+    }
+
+    /* Publishes the counts of the thread to the report */
+    __atomic_sub_fetch(&profiler_tasks_running, 1, __ATOMIC_RELEASE);
+}
+
+/* Counts the bytes the tasks of the pool went through, for their bytes per cycle */
+static inline void profiler_tasks_add_bytes(uint64_t bytes)
+{
+    profiler_tasks_bytes +=
+        bytes;
+}
+
+/* Prints a count right aligned in `width` characters, a dash if it was not counted */
+static inline void _profiler_print_count(int width, bool is_counted, double value, int precision)
+{
+    if (is_counted) {
+        fprintf(stderr, " %*.*f", width, precision, value);
+    } else {
+        fprintf(stderr, " %*s", width, "-");
+    }
+}
+
+/* Instructions per cycle, bytes per cycle, last level cache miss rate and vector instructions */
+static inline void _profiler_print_counters(
+                       bool is_counted,
+                       const profiler_counter_group_t *group,
+                       const uint64_t *counters,
+                       uint64_t bytes
+                   )
+{
+    double cycles =
+        (double) counters[PROFILER_COUNTER_CYCLES];
+
+    _profiler_print_count(14, is_counted, cycles, 0);
+    _profiler_print_count(14, is_counted, (double) counters[PROFILER_COUNTER_INSTRUCTIONS], 0);
+    _profiler_print_count(
+        6,
+        is_counted && 0 < cycles,
+        (double) counters[PROFILER_COUNTER_INSTRUCTIONS] / cycles,
+        2
+    );
+    _profiler_print_count(8, is_counted && 0 < cycles && 0 < bytes, (double) bytes / cycles, 2);
+    _profiler_print_count(
+        9,
+        is_counted &&
+            PROFILER_COUNTERS_COUNT != group->positions[PROFILER_COUNTER_CACHE_MISSES] &&
+            0 < counters[PROFILER_COUNTER_CACHE_REFERENCES],
+        100.0 * (double) counters[PROFILER_COUNTER_CACHE_MISSES] /
+            (double) counters[PROFILER_COUNTER_CACHE_REFERENCES],
+        1
+    );
+    _profiler_print_count(
+        12,
+        is_counted && PROFILER_COUNTERS_COUNT != group->positions[PROFILER_COUNTER_FP_256],
+        (double) counters[PROFILER_COUNTER_FP_256],
+        0
+    );
+    _profiler_print_count(
+        12,
+        is_counted && PROFILER_COUNTERS_COUNT != group->positions[PROFILER_COUNTER_FP_512],
+        (double) counters[PROFILER_COUNTER_FP_512],
+        0
+    );
+    fputc('\n', stderr);
+}
+
+/* Prints the children of `parent` in the order they were first entered, each one followed by its own */
+static inline void _profiler_report_scopes(size_t parent, uint64_t parent_time, bool with_counters)
+{
+    for (size_t scope = 0; scope < profiler_scopes_count; ++scope) {
+        const profiler_scope_t *entry =
+            &profiler_scopes[scope];
+        if (parent != entry->parent) {
+            continue;
+        }
+
+        int indentation =
+            (int) entry->depth * 2;
+        if (with_counters) {
+            fprintf(stderr, "Profiler: %*s%-*s", indentation, "", 24 - indentation, entry->name);
+            _profiler_print_counters(
+                0 < entry->counted_calls,
+                &profiler_scope_counter_group,
+                entry->counters,
+                entry->bytes
+            );
+        } else {
+            fprintf(
+                stderr,
+                "Profiler: %*s%-*s %8llu %14.3f %14.3f %14.3f %8.1f%%\n",
+                indentation, "",
+                24 - indentation, entry->name,
+                (unsigned long long) entry->calls,
+                (double) entry->total_time / 1e6,
+                (double) entry->total_time / 1e6 / (double) (entry->calls > 0 ? entry->calls : 1),
+                (double) entry->maximum_time / 1e6,
+                0 < parent_time ? 100.0 * (double) entry->total_time / (double) parent_time : 0.0
+            );
+        }
+
+        _profiler_report_scopes(scope, entry->total_time, with_counters);
+    }
+}
+
+#if defined PROFILER_TIMELINE
+/*
+    Writes the tasks of the workers in the Trace Event Format of Chrome's
+    about:tracing and Perfetto, one track per worker, in microseconds from
+    the first enqueue.
+*/
+static inline void _profiler_write_trace(const char *file_name, size_t threads_count)
+{
+    uint64_t origin =
+        UINT64_MAX;
+    size_t tasks_count =
+        0;
+    uint64_t dropped_tasks =
+        0;
+    for (size_t thread = 0; thread < threads_count; ++thread) {
+        const profiler_thread_t *entry =
+            &profiler_threads[thread];
+        for (size_t task = 0; task < entry->timeline_length; ++task) {
+            origin =
+                UTILS_MIN(origin, entry->timeline[task].enqueue_time);
+        }
+
+        tasks_count +=
+            entry->timeline_length;
+        dropped_tasks +=
+            entry->tasks - entry->timeline_length;
+    }
+
+    FILE *trace_file =
+        fopen(file_name, "w");
+    if (NULL == trace_file) {
+        fprintf(stderr, "Profiler: failed to create the trace '%s'\n", file_name);
+
+        return;
+    }
+
+    fprintf(trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (size_t thread = 0; thread < threads_count; ++thread) {
+        fprintf(
+            trace_file,
+            "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"worker %zu\"}}",
+            0 < thread ? "," : "",
+            thread,
+            thread
+        );
+    }
+
+    for (size_t thread = 0; thread < threads_count; ++thread) {
+        const profiler_thread_t *entry =
+            &profiler_threads[thread];
+        for (size_t task = 0; task < entry->timeline_length; ++task) {
+            const profiler_task_t *timing =
+                &entry->timeline[task];
+            fprintf(
+                trace_file,
+                ",\n{\"name\":\"task\",\"cat\":\"pool\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu"
+                ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"queue_wait_us\":%.3f}}",
+                thread,
+                (double) (timing->start_time - origin) / 1e3,
+                (double) (timing->end_time - timing->start_time) / 1e3,
+                (double) (timing->start_time - UTILS_MIN(timing->enqueue_time, timing->start_time)) / 1e3
+            );
+        }
+    }
+    fprintf(trace_file, "\n]}\n");
+
+    if (0 != fclose(trace_file)) {
+        fprintf(stderr, "Profiler: failed to write the trace '%s'\n", file_name);
+
+        return;
+    }
+
+    fprintf(stderr, "Profiler: wrote %zu tasks to the trace '%s'", tasks_count, file_name);
+    if (0 < dropped_tasks) {
+        fprintf(
+            stderr,
+            ", %llu more did not fit %d per worker",
+            (unsigned long long) dropped_tasks,
+            PROFILER_MAX_THREAD_TASKS
+        );
+    }
+    fputc('\n', stderr);
+}
+#endif
+
+static inline void _profiler_report_counters_error(void)
+{
+    int error =
+        __atomic_load_n(&profiler_counters_error, __ATOMIC_RELAXED);
+    if (0 == error) {
+        return;
+    }
+
+    int paranoid =
+        -1;
+    FILE *paranoid_file =
+        fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+    if (NULL != paranoid_file) {
+        if (1 != fscanf(paranoid_file, "%d", &paranoid)) {
+            paranoid =
+                -1;
+        }
+        fclose(paranoid_file);
+    }
+
+    fprintf(
+        stderr,
+        "Profiler: hardware counters are not available: %s",
+        strerror(error)
+    );
+    if (-1 != paranoid) {
+        fprintf(stderr, " (perf_event_paranoid is %d)", paranoid);
+    }
+    fputc('\n', stderr);
+}
+
+/*
+    The scopes with their share of the parent scope, the ones at the top of
+    all the top scopes together, then the workers of the pool. The report
+    waits for the tasks that signaled their barrier but did not return yet.
+*/
+static inline void profiler_add_report(profiler_report_function_t function, void *data)
+{
+    pthread_mutex_lock(&profiler_reports_mutex);
+    if (PROFILER_MAX_REPORTS > profiler_reports_count) {
+        profiler_reports[profiler_reports_count].function =
+            function;
+        profiler_reports[profiler_reports_count].data =
+            data;
+        ++profiler_reports_count;
+    }
+    pthread_mutex_unlock(&profiler_reports_mutex);
+}
+
+static inline void profiler_remove_report(profiler_report_function_t function, void *data)
+{
+    pthread_mutex_lock(&profiler_reports_mutex);
+    for (size_t report = 0; report < profiler_reports_count; ++report) {
+        if (function == profiler_reports[report].function && data == profiler_reports[report].data) {
+            memmove(
+                &profiler_reports[report],
+                &profiler_reports[report + 1],
+                (profiler_reports_count - report - 1) * sizeof(profiler_reports[0])
+            );
+            --profiler_reports_count;
+
+            break;
+        }
+    }
+    pthread_mutex_unlock(&profiler_reports_mutex);
+}
+
+static inline void profiler_report(void)
+{
+    while (0 < __atomic_load_n(&profiler_tasks_running, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+
+    bool is_counted =
+        false;
+    uint64_t total_time =
+        0;
+    for (size_t scope = 0; scope < profiler_scopes_count; ++scope) {
+        if (PROFILER_MAX_SCOPES == profiler_scopes[scope].parent) {
+            total_time +=
+                profiler_scopes[scope].total_time;
+        }
+        is_counted =
+            is_counted || 0 < profiler_scopes[scope].counted_calls;
+    }
+
+    size_t threads_count =
+        UTILS_MIN(__atomic_load_n(&profiler_threads_count, __ATOMIC_RELAXED), PROFILER_MAX_THREADS);
+    for (size_t thread = 0; thread < threads_count; ++thread) {
+        is_counted =
+            is_counted || 0 < profiler_threads[thread].counted_tasks;
+    }
+
+    if (0 < profiler_scopes_count) {
+        fprintf(
+            stderr,
+            "Profiler: %-24s %8s %14s %14s %14s %9s\n",
+            "scope", "calls", "total ms", "mean ms", "max ms", "share"
+        );
+        _profiler_report_scopes(PROFILER_MAX_SCOPES, total_time, false);
+        fprintf(
+            stderr,
+            "Profiler: %-24s %8s %14.3f\n"
+            "---\n",
+            "total", "", (double) total_time / 1e6
+        );
+    }
+
+    static const char Counters_Header[] =
+        " %14s %14s %6s %8s %9s %12s %12s\n";
+
+    if (is_counted && 0 < profiler_scopes_count) {
+        fprintf(stderr, "Profiler: %-24s", "scope");
+        fprintf(stderr, Counters_Header, "cycles", "instructions", "IPC", "B/cycle", "LLC miss%", "256-bit FP", "512-bit FP");
+        _profiler_report_scopes(PROFILER_MAX_SCOPES, total_time, true);
+        fprintf(stderr, "---\n");
+    }
+
+    if (0 < threads_count) {
+        profiler_thread_t workers;
+        memset(&workers, 0, sizeof(workers));
+
+        fprintf(stderr, "Profiler: %-10s %6s %12s", "worker", "tasks", "busy ms");
+        if (is_counted) {
+            fprintf(stderr, Counters_Header, "cycles", "instructions", "IPC", "B/cycle", "LLC miss%", "256-bit FP", "512-bit FP");
+        } else {
+            fputc('\n', stderr);
+        }
+
+        for (size_t thread = 0; thread < threads_count; ++thread) {
+            const profiler_thread_t *entry =
+                &profiler_threads[thread];
+
+            fprintf(
+                stderr,
+                "Profiler: %-10zu %6llu %12.3f",
+                thread,
+                (unsigned long long) entry->tasks,
+                (double) entry->busy_time / 1e6
+            );
+            if (is_counted) {
+                _profiler_print_counters(0 < entry->counted_tasks, &entry->counter_group, entry->counters, 0);
+            } else {
+                fputc('\n', stderr);
+            }
+
+            workers.tasks +=
+                entry->tasks;
+            workers.busy_time +=
+                entry->busy_time;
+            workers.queue_time +=
+                entry->queue_time;
+            workers.counted_tasks +=
+                entry->counted_tasks;
+            for (size_t counter = 0; counter < PROFILER_COUNTERS_COUNT; ++counter) {
+                workers.counters[counter] +=
+                    entry->counters[counter];
+            }
+            if (0 < entry->counted_tasks) {
+                workers.counter_group =
+                    entry->counter_group;
+            }
+        }
+
+        /* The bytes are the ones of the image, of all the tasks together */
+        fprintf(
+            stderr,
+            "Profiler: %-10s %6llu %12.3f",
+            "all",
+            (unsigned long long) workers.tasks,
+            (double) workers.busy_time / 1e6
+        );
+        if (is_counted) {
+            _profiler_print_counters(
+                0 < workers.counted_tasks,
+                &workers.counter_group,
+                workers.counters,
+                profiler_tasks_bytes
+            );
+        } else {
+            fputc('\n', stderr);
+        }
+
+        /*
+            The slowest worker sets the pace, with a balanced load every one
+            would be busy for the mean. Idle is the share of the workers'
+            time that the imbalance wastes.
+        */
+        uint64_t maximum_busy_time =
+            0;
+        uint64_t maximum_queue_time =
+            0;
+        for (size_t thread = 0; thread < threads_count; ++thread) {
+            maximum_busy_time =
+                UTILS_MAX(maximum_busy_time, profiler_threads[thread].busy_time);
+            maximum_queue_time =
+                UTILS_MAX(maximum_queue_time, profiler_threads[thread].maximum_queue_time);
+        }
+
+        double mean_busy_time =
+            (double) workers.busy_time / (double) threads_count;
+        fprintf(
+            stderr,
+            "Profiler: busy max %.3f ms, mean %.3f ms, max/mean %.2f, idle %.1f%%\n"
+            "Profiler: queue wait mean %.3f ms, max %.3f ms\n"
+            "---\n",
+            (double) maximum_busy_time / 1e6,
+            mean_busy_time / 1e6,
+            0 < mean_busy_time ? (double) maximum_busy_time / mean_busy_time : 0.0,
+            0 < maximum_busy_time ? 100.0 * (1.0 - mean_busy_time / (double) maximum_busy_time) : 0.0,
+            0 < workers.tasks ? (double) workers.queue_time / 1e6 / (double) workers.tasks : 0.0,
+            (double) maximum_queue_time / 1e6
+        );
+
+#if defined PROFILER_TIMELINE
+        const char *trace_file_name =
+            getenv("PROFILER_TRACE");
+        if (NULL != trace_file_name && '\0' != *trace_file_name) {
+            _profiler_write_trace(trace_file_name, threads_count);
+        }
+#endif
+    }
+
+    pthread_mutex_lock(&profiler_reports_mutex);
+    for (size_t report = 0; report < profiler_reports_count; ++report) {
+        profiler_reports[report].function(profiler_reports[report].data);
+    }
+    pthread_mutex_unlock(&profiler_reports_mutex);
+
+    _profiler_report_counters_error();
+}
+
 #define PROFILER_START(PROFILER_PASSES)                                       \
 do {                                                                          \
     struct timespec start_time, end_time,                                     \
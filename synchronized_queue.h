@@ -2,15 +2,55 @@
 #define SYNCHRONIZED_QUEUE_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <pthread.h>
 
 #include "queue.h"
 
+#if defined PROFILE && defined PROFILER_QUEUE
+#define SYNCHRONIZED_QUEUE_STATISTICS 1
+#endif
+
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+/*
+    With `PROFILER_QUEUE` every queue counts how its lock and its condition
+    are used. Each thread counts into a slot of its own, a cache line apart
+    from the others, so that the counters neither contend nor share lines. Past
+    `SYNCHRONIZED_QUEUE_STATISTICS_SLOTS` threads the slots are shared, the
+    counts stay right but cost more.
+*/
+#define SYNCHRONIZED_QUEUE_STATISTICS_SLOTS 64
+
+typedef struct _synchronized_queue_statistics
+{
+    uint64_t lock_acquisitions;
+    uint64_t contended_acquisitions;    /* the lock was taken when tried                */
+    uint64_t lock_wait_time;            /* nanoseconds spent waiting for a taken lock    */
+    uint64_t wakeups;                   /* returns from the wait for an item             */
+    uint64_t spurious_wakeups;          /* wakeups that found the queue empty            */
+    size_t maximum_size;                /* the most items the queue held at once         */
+    size_t threads;                     /* the threads that used the queue               */
+} synchronized_queue_statistics_t;
+
+typedef struct _synchronized_queue_statistics_slot
+{
+    uint64_t lock_acquisitions;
+    uint64_t contended_acquisitions;
+    uint64_t lock_wait_time;
+    uint64_t wakeups;
+    uint64_t spurious_wakeups;
+} __attribute__((aligned(64))) synchronized_queue_statistics_slot_t;
+#endif
+
 typedef struct _synchronized_queue
 {
     pthread_mutex_t access_mutex;
     pthread_cond_t not_empty_condition;
     queue_t implementation;
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+    size_t maximum_size;                /* written under the lock                        */
+    synchronized_queue_statistics_slot_t statistics[SYNCHRONIZED_QUEUE_STATISTICS_SLOTS];
+#endif
 } synchronized_queue_t;
 
 static inline synchronized_queue_t *synchronized_queue_allocate(void);
@@ -29,6 +69,17 @@ static synchronized_queue_t *synchronized_queue_enqueue(synchronized_queue_t *qu
 
 static void *synchronized_queue_pop(synchronized_queue_t *queue);
 
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+/* Sums the counters of all the threads, the queue may be in use meanwhile */
+static inline void synchronized_queue_get_statistics(
+                       synchronized_queue_t *queue,
+                       synchronized_queue_statistics_t *statistics
+                   );
+
+/* Prints the statistics to the standard error, a queue does it with the report of the profiler */
+static inline void synchronized_queue_report(synchronized_queue_t *queue);
+#endif
+
 #include "synchronized_queue.impl.h.c"
 
 #endif // SYNCHRONIZED_QUEUE_H
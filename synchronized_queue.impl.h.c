@@ -1,11 +1,79 @@
 #include "synchronized_queue.h"
 
 #include <stdlib.h>
+#include <errno.h>
 #include <stdio.h>
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+#include <string.h>
+
+#include "profiler.h"
+#include "utils.h"
+
+/* Threads take the slots in turn on their first use of any queue */
+static size_t synchronized_queue_threads_count =
+    0;
+static __thread size_t synchronized_queue_thread_slot =
+    SIZE_MAX;
+
+static inline synchronized_queue_statistics_slot_t *_synchronized_queue_get_statistics_slot(
+                                                        synchronized_queue_t *queue
+                                                    )
+{
+    if (SIZE_MAX == synchronized_queue_thread_slot) {
+        synchronized_queue_thread_slot =
+            __atomic_fetch_add(&synchronized_queue_threads_count, 1, __ATOMIC_RELAXED) %
+                SYNCHRONIZED_QUEUE_STATISTICS_SLOTS;
+    }
+
+    return &queue->statistics[synchronized_queue_thread_slot];
+}
+
+/* Relaxed, a slot has a single writer unless there are more threads than slots */
+static inline void _synchronized_queue_count(uint64_t *counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static void _synchronized_queue_report(void *queue)
+{
+    synchronized_queue_report((synchronized_queue_t *) queue);
+}
+#endif
+
+/*
+    When counting, the lock is tried first, a failure counts as contention
+    and the wait for the lock that follows is timed.
+*/
+static inline int _synchronized_queue_lock(synchronized_queue_t *queue)
+{
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+    synchronized_queue_statistics_slot_t *slot =
+        _synchronized_queue_get_statistics_slot(queue);
+
+    int result =
+        pthread_mutex_trylock(&queue->access_mutex);
+    if (EBUSY == result) {
+        uint64_t start_time =
+            profiler_get_nanoseconds();
+        result =
+            pthread_mutex_lock(&queue->access_mutex);
+        _synchronized_queue_count(&slot->lock_wait_time, profiler_get_nanoseconds() - start_time);
+        _synchronized_queue_count(&slot->contended_acquisitions, 1);
+    }
+    if (0 == result) {
+        _synchronized_queue_count(&slot->lock_acquisitions, 1);
+    }
+
+    return result;
+#else
+    return pthread_mutex_lock(&queue->access_mutex);
+#endif
+}
 
 static inline synchronized_queue_t *synchronized_queue_allocate()
 {
-    return (synchronized_queue_t *) malloc(sizeof(synchronized_queue_t));
+    /* The statistics of the threads are aligned to cache lines when counted */
+    return (synchronized_queue_t *) aligned_alloc(_Alignof(synchronized_queue_t), sizeof(synchronized_queue_t));
 }
 
 static inline synchronized_queue_t *synchronized_queue_init(synchronized_queue_t *queue)
@@ -21,6 +89,13 @@ static inline synchronized_queue_t *synchronized_queue_init(synchronized_queue_t
     }
     queue_init(&queue->implementation);
 
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+    queue->maximum_size =
+        0;
+    memset(queue->statistics, 0, sizeof(queue->statistics));
+    profiler_add_report(_synchronized_queue_report, queue);
+#endif
+
     return queue;
 }
 
@@ -46,9 +121,13 @@ static inline void synchronized_queue_destroy(synchronized_queue_t *queue)
         return;
     }
 
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+    profiler_remove_report(_synchronized_queue_report, queue);
+#endif
+
     pthread_mutex_destroy(&queue->access_mutex);
     pthread_cond_destroy(&queue->not_empty_condition);
-    queue_destroy(&queue->implementation);
+    queue_deinit(&queue->implementation);
     free(queue);
 }
 
@@ -64,11 +143,15 @@ static inline bool synchronized_queue_is_empty(synchronized_queue_t *queue)
 
 static synchronized_queue_t *synchronized_queue_enqueue(synchronized_queue_t *queue, void *data)
 {
-    if (0 != pthread_mutex_lock(&queue->access_mutex)) {
+    if (0 != _synchronized_queue_lock(queue)) {
         return NULL;
     }
 
     queue_push(&queue->implementation, data);
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+    queue->maximum_size =
+        UTILS_MAX(queue->maximum_size, queue_get_size(&queue->implementation));
+#endif
     pthread_cond_broadcast(&queue->not_empty_condition);
 
     if (0 != pthread_mutex_unlock(&queue->access_mutex)) {
@@ -82,7 +165,7 @@ static void *synchronized_queue_pop(synchronized_queue_t *queue)
 {
     void *data = NULL;
 
-    if (0 != pthread_mutex_lock(&queue->access_mutex)) {
+    if (0 != _synchronized_queue_lock(queue)) {
         return data;
     }
 
@@ -90,6 +173,16 @@ static void *synchronized_queue_pop(synchronized_queue_t *queue)
         if (0 != pthread_cond_wait(&queue->not_empty_condition, &queue->access_mutex)) {
             return data;
         }
+
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+        /* Every waiter wakes up on a broadcast, all but the first find the queue empty again */
+        synchronized_queue_statistics_slot_t *slot =
+            _synchronized_queue_get_statistics_slot(queue);
+        _synchronized_queue_count(&slot->wakeups, 1);
+        if (queue_is_empty(&queue->implementation)) {
+            _synchronized_queue_count(&slot->spurious_wakeups, 1);
+        }
+#endif
     }
 
     data = queue_pop(&queue->implementation);
@@ -101,3 +194,67 @@ static void *synchronized_queue_pop(synchronized_queue_t *queue)
     return data;
 }
 
+
+#ifdef SYNCHRONIZED_QUEUE_STATISTICS
+static inline void synchronized_queue_get_statistics(
+                       synchronized_queue_t *queue,
+                       synchronized_queue_statistics_t *statistics
+                   )
+{
+    memset(statistics, 0, sizeof(*statistics));
+
+    for (size_t slot = 0; slot < SYNCHRONIZED_QUEUE_STATISTICS_SLOTS; ++slot) {
+        synchronized_queue_statistics_slot_t *counters =
+            &queue->statistics[slot];
+
+        uint64_t lock_acquisitions =
+            __atomic_load_n(&counters->lock_acquisitions, __ATOMIC_RELAXED);
+        if (0 == lock_acquisitions) {
+            continue;
+        }
+
+        statistics->lock_acquisitions +=
+            lock_acquisitions;
+        statistics->contended_acquisitions +=
+            __atomic_load_n(&counters->contended_acquisitions, __ATOMIC_RELAXED);
+        statistics->lock_wait_time +=
+            __atomic_load_n(&counters->lock_wait_time, __ATOMIC_RELAXED);
+        statistics->wakeups +=
+            __atomic_load_n(&counters->wakeups, __ATOMIC_RELAXED);
+        statistics->spurious_wakeups +=
+            __atomic_load_n(&counters->spurious_wakeups, __ATOMIC_RELAXED);
+        ++statistics->threads;
+    }
+
+    pthread_mutex_lock(&queue->access_mutex);
+    statistics->maximum_size =
+        queue->maximum_size;
+    pthread_mutex_unlock(&queue->access_mutex);
+}
+
+static inline void synchronized_queue_report(synchronized_queue_t *queue)
+{
+    synchronized_queue_statistics_t statistics;
+    synchronized_queue_get_statistics(queue, &statistics);
+    if (0 == statistics.lock_acquisitions) {
+        return;
+    }
+
+    fprintf(
+        stderr,
+        "Profiler: queue lock %llu acquisitions, %llu contended (%.1f%%), waited %.3f ms\n"
+        "Profiler: queue %llu wakeups, %llu spurious (%.1f%%), at most %zu items, %zu threads\n"
+        "---\n",
+        (unsigned long long) statistics.lock_acquisitions,
+        (unsigned long long) statistics.contended_acquisitions,
+        100.0 * (double) statistics.contended_acquisitions / (double) statistics.lock_acquisitions,
+        (double) statistics.lock_wait_time / 1e6,
+        (unsigned long long) statistics.wakeups,
+        (unsigned long long) statistics.spurious_wakeups,
+        0 < statistics.wakeups ?
+            100.0 * (double) statistics.spurious_wakeups / (double) statistics.wakeups : 0.0,
+        statistics.maximum_size,
+        statistics.threads
+    );
+}
+#endif
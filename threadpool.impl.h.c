@@ -1,20 +1,43 @@
 #include "synchronized_queue.h"
 #include "work_item.h"
+#include "profiler.h"
+#include "metrics.h"
 
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+/* Enqueued once per worker by `threadpool_destroy`, the worker that pops it exits */
+static void _threadpool_stop_task(void *task_data, void (*result_callback)(void *result))
+{
+    (void) task_data;
+    (void) result_callback;
+}
+
 static void *_thread_start(void *args)
 {
     synchronized_queue_t *queue = (synchronized_queue_t *) args;
+
+PROFILER_THREAD_START();
+METRICS_THREAD_START();
     while (true) {
         work_item_t *work_item = (work_item_t *) synchronized_queue_pop(queue);
         if (NULL == work_item) {
             continue;
         }
 
+        if (_threadpool_stop_task == work_item->task) {
+            work_item_destroy(work_item);
+METRICS_THREAD_STOP();
+
+            break;
+        }
+
+PROFILER_TASK_BEGIN(work_item->enqueue_time);
+METRICS_TASK_BEGIN();
         work_item->task(work_item->task_data, work_item->result_callback);
+METRICS_TASK_END();
+PROFILER_TASK_END();
         work_item_destroy(work_item);
     }
 
@@ -79,6 +102,13 @@ static void threadpool_destroy(threadpool_t *threadpool)
     }
 
     if (NULL != threadpool->threads) {
+        /* Not counted as tasks of the pool */
+        for (size_t i = 0; i < threadpool->thread_count; ++i) {
+            synchronized_queue_enqueue(
+                threadpool->queue,
+                work_item_create(_threadpool_stop_task, NULL, NULL)
+            );
+        }
         for (size_t i = 0; i < threadpool->thread_count; ++i) {
             pthread_join(threadpool->threads[i], NULL);
         }
@@ -107,6 +137,8 @@ static inline void threadpool_enqueue_task(
         return;
     }
 
+PROFILER_TASK_ENQUEUE(work_item->enqueue_time);
+METRICS_TASK_ENQUEUE();
     synchronized_queue_enqueue(threadpool->queue, work_item);
 }
 
@@ -2,6 +2,8 @@
 #define UTILS_H
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
 
 #if defined __i386 || defined __i386__ || defined _M_IX86
 #define x86_32_CPU
@@ -17,6 +19,10 @@
 
 static size_t utils_get_number_of_cpu_cores(void);
 
+static bool utils_copy_file(FILE *source, FILE *destination, size_t size);
+
+static char *utils_get_executable_path(const char *executable_name);
+
 #include "utils.impl.h.c"
 
 #endif /* UTILS_H */
@@ -9,8 +9,19 @@
     #include <unistd.h>
 #endif
 
+#ifndef _WIN32
+    #include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <linux/fs.h>
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 static size_t utils_get_number_of_cpu_cores()
 {
@@ -52,3 +63,149 @@ static size_t utils_get_number_of_cpu_cores()
     return (size_t) result;
 }
 
+
+/*
+    Copies the first `size` bytes of `source` over `destination` and cuts
+    it to that size, nothing is copied when both are the same file. Linux
+    shares the extents on file systems with reflinks, or copies in the
+    kernel with `copy_file_range`. Other systems and whatever is left over
+    are copied through a buffer.
+*/
+static bool utils_copy_file(FILE *source, FILE *destination, size_t size)
+{
+    if (0 != fflush(destination)) {
+        return false;
+    }
+
+    size_t copied =
+        0;
+
+#ifndef _WIN32
+    int source_descriptor =
+        fileno(source);
+    int destination_descriptor =
+        fileno(destination);
+
+    struct stat source_status, destination_status;
+    if (0 != fstat(source_descriptor, &source_status) ||
+        0 != fstat(destination_descriptor, &destination_status)) {
+        return false;
+    }
+
+    if (source_status.st_dev == destination_status.st_dev &&
+        source_status.st_ino == destination_status.st_ino) {
+        return true;
+    }
+
+#if defined FICLONE
+    /* Clones the whole file, the truncation below cuts what follows `size` */
+    if ((off_t) size <= source_status.st_size &&
+        0 == ioctl(destination_descriptor, FICLONE, source_descriptor)) {
+        copied =
+            size;
+    }
+#endif
+
+#if defined SYS_copy_file_range
+    loff_t source_offset =
+        0;
+    loff_t destination_offset =
+        0;
+    while (copied < size) {
+        long count =
+            syscall(
+                SYS_copy_file_range,
+                source_descriptor, &source_offset,
+                destination_descriptor, &destination_offset,
+                size - copied,
+                0
+            );
+        if (0 >= count) {
+            break;
+        }
+
+        copied +=
+            (size_t) count;
+    }
+#endif
+#endif
+
+    if (copied < size) {
+        if (0 != fseek(source, (long) copied, SEEK_SET) ||
+            0 != fseek(destination, (long) copied, SEEK_SET)) {
+            return false;
+        }
+
+        static char buffer[1 << 16];
+        while (copied < size) {
+            size_t count =
+                UTILS_MIN(sizeof(buffer), size - copied);
+            if (!fread(buffer, count, 1, source) ||
+                !fwrite(buffer, count, 1, destination)) {
+                return false;
+            }
+
+            copied +=
+                count;
+        }
+
+        if (0 != fflush(destination)) {
+            return false;
+        }
+    }
+
+#ifndef _WIN32
+    return 0 == ftruncate(destination_descriptor, (off_t) size);
+#else
+    return true;
+#endif
+}
+
+/*
+    The path of the running executable with the symbolic links resolved,
+    read from `/proc/self/exe` on Linux. Elsewhere, or when it cannot be
+    read, it is a copy of `executable_name`, `argv[0]` as the shell passed
+    it. The caller frees the path.
+*/
+static char *utils_get_executable_path(const char *executable_name)
+{
+#ifdef __linux__
+    size_t size =
+        256;
+    char *path =
+        NULL;
+    while (true) {
+        char *larger_path =
+            realloc(path, size);
+        if (NULL == larger_path) {
+            break;
+        }
+        path =
+            larger_path;
+
+        ssize_t length =
+            readlink("/proc/self/exe", path, size);
+        if (0 > length) {
+            break;
+        }
+        if ((size_t) length < size) {
+            path[length] =
+                '\0';
+
+            return path;
+        }
+
+        size *=
+            2;
+    }
+    free(path);
+#endif
+
+    char *copy =
+        malloc(strlen(executable_name) + 1);
+    if (NULL != copy) {
+        strcpy(copy, executable_name);
+    }
+
+    return copy;
+}
@@ -1,11 +1,16 @@
 #ifndef WORK_ITEM_H
 #define WORK_ITEM_H
 
+#include <stdint.h>
+
 typedef struct work_item
 {
     void (*task)(void *task_data, void (*result_callback)(void *result));
     void *task_data;
     void (*result_callback)(void *result);
+#ifdef PROFILE
+    uint64_t enqueue_time;
+#endif
 } work_item_t;
 
 static inline work_item_t *work_item_create(